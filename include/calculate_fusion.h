@@ -11,23 +11,450 @@
 #ifndef CALCULATE_FUSION_H
 #define CALCULATE_FUSION_H
 
+#ifdef HAVE_GSL
+#include <gsl/gsl_eigen.h>
+#endif
 #include "linked_list.h"
+#include "fusion_thread_pool.h"
+
+/**
+ * @brief Alignment (in bytes) of every matrix used by the fusion algorithm.
+ */
+#define FUSION_MATRIX_ALIGNMENT 64
+
+/**
+ * @brief Doubles of eigen_scratch per sensor in a fusion workspace.
+ */
+#define EIGEN_SCRATCH_PER_SENSOR 26
+
+/**
+ * @brief Integers of eigen_index_scratch per sensor in a fusion workspace.
+ */
+#define EIGEN_INDEX_SCRATCH_PER_SENSOR 12
+
+/**
+ * @brief Largest matrix EIGEN_BACKEND_AUTO solves with the Jacobi backend.
+ */
+#define JACOBI_MAX_SENSORS 32
+
+/**
+ * @brief Ways of building the support degree matrix
+ */
+typedef enum Support_Degree_Mode
+{
+	SUPPORT_DEGREE_EXACT,
+	/**< One exponential per pair of sensors (default) */
+
+	SUPPORT_DEGREE_SEPARABLE,
+	/**< Products of per-sensor exponentials of the sorted values */
+
+	SUPPORT_DEGREE_INCREMENTAL,
+	/**< As SUPPORT_DEGREE_EXACT, only recomputing the rows of the sensors
+	 * that changed since the previous epoch */
+
+	SUPPORT_DEGREE_MATRIX_FREE
+	/**< Never built; its products with a vector are found in O(n) from the
+	 * sorted values, and its leading eigenpairs by Lanczos */
+} Support_Degree_Mode_t;
+
+/**
+ * @brief Largest error, in units in the last place, of an entry of the
+ * separable support degree matrix against exp(), for entries in the normal
+ * range.
+ */
+#define SUPPORT_DEGREE_SEPARABLE_MAX_ULP	4
+
+/**
+ * @brief Most Lanczos steps of the matrix free eigensolver, which is also the
+ * number of rows its workspace holds in each matrix.
+ */
+#define MATRIX_FREE_MAX_STEPS	64
+
+/**
+ * @brief Support degree below which two neighbouring sensor values are put in
+ * different blocks by the block eigensolver. At machine precision, the
+ * entries it drops are below the rounding error of the others.
+ */
+#define EIGEN_BLOCK_TOLERANCE	2.220446049250313e-16
+
+/**
+ * @brief Ways of solving the eigensystem of the support degree matrix
+ */
+typedef enum Eigen_Solver
+{
+	EIGEN_SOLVER_FULL,
+	/**< Every eigenpair (default), with the backend of the workspace: GSL,
+	 * LAPACK, built-in or Jacobi (see Eigen_Backend_t) */
+
+	EIGEN_SOLVER_LANCZOS,
+	/**< Only the leading eigenpairs needed to reach the contribution rate
+	 * parameter, with the Lanczos method */
+
+	EIGEN_SOLVER_WARM,
+	/**< As EIGEN_SOLVER_LANCZOS, starting from the eigenvectors of the
+	 * previous epoch */
+
+	EIGEN_SOLVER_RANDOMIZED,
+	/**< Approximate leading eigenpairs from a randomized range finder, at a
+	 * bounded cost */
+
+	EIGEN_SOLVER_BLOCKS
+	/**< Every eigenpair, solving each block of sensors whose values are far
+	 * from the others on its own */
+} Eigen_Solver_t;
+
+/**
+ * @brief Default accuracy target of the randomized eigensolver, as a
+ * residual relative to the trace of the support degree matrix.
+ */
+#define RANDOMIZED_DEFAULT_ACCURACY	1e-6
+
+/**
+ * @brief Libraries the eigensystem can be solved with
+ *
+ * @details Whichever is used, the eigenvalues come out in descending order
+ * and each eigenvector has its first non-negligible component positive.
+ */
+typedef enum Eigen_Backend
+{
+	EIGEN_BACKEND_AUTO,
+	/**< EIGEN_BACKEND_JACOBI up to JACOBI_MAX_SENSORS, and above it
+	 * EIGEN_BACKEND_GSL (EIGEN_BACKEND_BUILTIN when built without GSL, or
+	 * when the epoch is shared between threads) (default) */
+
+	EIGEN_BACKEND_GSL,
+	/**< gsl_eigen_symmv, when the program is built with GSL */
+
+	EIGEN_BACKEND_LAPACK,
+	/**< LAPACK dsyevr (MRRR), when the program is built with LAPACK */
+
+	EIGEN_BACKEND_BUILTIN,
+	/**< Householder tridiagonalization and implicit QL, with no library */
+
+	EIGEN_BACKEND_JACOBI,
+	/**< Cyclic Jacobi, with no library, for small matrices */
+
+	EIGEN_BACKEND_COUNT
+	/**< Number of backends */
+} Eigen_Backend_t;
+
+/**
+ * @brief Largest residual |A x - lambda x|, relative to the number of
+ * sensors, of an eigenpair returned by the Lanczos solver.
+ */
+#define LANCZOS_TOLERANCE	1e-12
+
+/**
+ * @brief A sensor value along with its position in the sensor array
+ */
+typedef struct Sorted_Sensor
+{
+	double value;
+	/**< Value of the sensor */
+
+	int index;
+	/**< Index of the sensor in the sensor array */
+} Sorted_Sensor_t;
 
 /**
  * @brief Structure to store eigen_systems
  *
- * @details Structure eigen_systems stores pointer to double of eigen_value 
- * and pointer to pointer to double of eigen_vector
+ * @details Structure eigen_systems stores pointer to double of eigen_value
+ * and the eigenvectors as a row-major matrix, eigenvector i being row i
+ * (starting at eigen_vector + i * leading_dimension)
  */
 struct eigen_systems
 {
 	double *eigen_value;
 	/**< Pointer to Eigen Value */
 
-	double **eigen_vector;
-	/**< Pointer to multidimensional array of Eigen Vector */
+	double *eigen_vector;
+	/**< Pointer to row-major matrix of Eigen Vectors, one per row */
+
+	int leading_dimension;
+	/**< Distance (in doubles) between the starts of two rows of eigen_vector */
 };
 
+/**
+ * @brief Buffers reused by every run of the fusion algorithm
+ *
+ * @details Holds every intermediate result of the algorithm, sized for the
+ * largest number of sensors seen so far and only grown when that is
+ * exceeded. Once warmed up, an epoch allocates nothing. Every buffer is
+ * aligned to FUSION_MATRIX_ALIGNMENT, and matrices are row-major with
+ * leading_dimension doubles per row.
+ */
+typedef struct Fusion_Workspace
+{
+	int capacity;
+	/**< Number of sensors the buffers can hold */
+
+	Boolean matrix_free;
+	/**< TRUE if sized by fusion_workspace_prepare_matrix_free(), in which
+	 * case sd_matrix is NULL and every other matrix only has
+	 * MATRIX_FREE_MAX_STEPS + 1 rows */
+
+	double *sensor_array;
+	/**< Sensor values (capacity) */
+
+	int leading_dimension;
+	/**< Leading dimension of every matrix below for the current number of
+	 * sensors (set by fusion_workspace_prepare) */
+
+	double *sd_matrix;
+	/**< Support degree matrix (capacity rows) */
+
+	double *eigen_matrix;
+	/**< Copy of sd_matrix destroyed by GSL (capacity rows) */
+
+	double *eval;
+	/**< GSL eigenvalues (capacity) */
+
+	double *evec;
+	/**< GSL eigenvectors (capacity rows) */
+
+	double *eigen_value;
+	/**< Sorted eigenvalues (capacity) */
+
+	double *eigen_vector;
+	/**< Eigenvector of each eigenvalue, one per row (capacity rows) */
+
+	double *contribution_rate;
+	/**< Contribution rate of each principal component (capacity) */
+
+	double *integrated_support;
+	/**< Integrated support degree of each sensor (capacity) */
+
+	double *weight_coefficient;
+	/**< Weight coefficient of each sensor (capacity) */
+
+	Sorted_Sensor_t *sorted_sensors;
+	/**< Sensor values in ascending order (capacity) */
+
+	int *sensor_block;
+	/**< Block of each sensor in the separable support degree (capacity) */
+
+	double *factor_up;
+	/**< exp(x - shift of its block) of each sensor (capacity) */
+
+	double *factor_down;
+	/**< exp(-(x - shift of its block)) of each sensor (capacity) */
+
+	double *factor_next;
+	/**< exp(x - shift of the next block) of each sensor (capacity) */
+
+	double *factor_second;
+	/**< exp(x - shift of the block after next) of each sensor (capacity) */
+
+	double *support_decay;
+	/**< exp(-(gap to the next smaller value)) of each sorted sensor value,
+	 * for the matrix free support degree (capacity) */
+
+	int *sensor_id;
+	/**< Sensor ID of each sensor, for the warm started eigensolver
+	 * (capacity) */
+
+	int *sensor_row;
+	/**< Row of the support degree matrix of each sensor of the valid list,
+	 * when the matrix is not in the order of the list (capacity) */
+
+	double *krylov_basis;
+	/**< Orthonormal Lanczos vectors, one per row (capacity / 2 + 1 rows) */
+
+	double *lanczos_alpha;
+	/**< Diagonal of the Lanczos tridiagonal matrix (capacity) */
+
+	double *lanczos_beta;
+	/**< Off-diagonal of the Lanczos tridiagonal matrix (capacity) */
+
+	int lanczos_steps;
+	/**< Number of Lanczos steps taken by the last partial solve (0 if it
+	 * solved the full eigensystem instead) */
+
+	int sketch_size;
+	/**< Number of random vectors the last randomized solve ended with (0 if
+	 * it solved the full eigensystem instead) */
+
+	double approximation_error;
+	/**< Error estimate of the last randomized solve: the largest residual
+	 * |D u - lambda u| of the eigenpairs it returned, over the trace of D.
+	 * Each of their contribution rates is within this of the exact one. */
+
+	Eigen_Backend_t eigen_backend;
+	/**< Backend the full eigensystem is solved with (EIGEN_BACKEND_AUTO
+	 * unless set) */
+
+	double *eigen_scratch;
+	/**< Scratch space of the LAPACK and built-in backends
+	 * (EIGEN_SCRATCH_PER_SENSOR * capacity) */
+
+	int *eigen_index_scratch;
+	/**< Integer scratch space of the LAPACK backend
+	 * (EIGEN_INDEX_SCRATCH_PER_SENSOR * capacity) */
+
+	Fusion_Thread_Pool_t *thread_pool;
+	/**< Threads the steps of a large epoch are shared between (NULL unless
+	 * set) */
+
+	int parallel_threshold;
+	/**< Smallest number of sensors the steps are shared between the
+	 * threads for */
+
+	int no_of_blocks;
+	/**< Number of blocks the last block solve split the sensors into */
+
+#ifdef HAVE_GSL
+	gsl_eigen_symmv_workspace **symmv;
+	/**< GSL eigen workspace of each size seen (indexed by size) */
+#endif
+
+	long no_of_allocations;
+	/**< Number of allocations made by the workspace since it was created */
+} Fusion_Workspace_t;
+
+/**
+ * @brief Eigenvectors of the previous epoch, kept to start the next solve
+ *
+ * @details The leading eigenvectors of an epoch are summed into one seed
+ * vector, stored by sensor ID so that it still lines up with the sensors
+ * after some join or leave the valid list.
+ */
+typedef struct Eigen_Warm_Start
+{
+	double *seed;
+	/**< Component of the seed vector for each sensor ID (NAN for a sensor
+	 * not yet solved for) (capacity) */
+
+	int capacity;
+	/**< Number of sensor IDs the seed can hold */
+
+	Boolean is_seeded;
+	/**< Whether an epoch has been solved yet */
+
+	long no_of_warm_solves;
+	/**< Number of solves that converged from the seed */
+
+	long no_of_fallbacks;
+	/**< Number of solves from the seed that had to start cold instead */
+} Eigen_Warm_Start_t;
+
+/**
+ * @brief Support degree matrix kept from one epoch to the next
+ *
+ * @details Every sensor of the last epoch holds a slot, which is a row and a
+ * column of the matrix. Slots are found by sensor ID, so they survive the
+ * valid list changing order. The matrix is row-major with leading_dimension
+ * doubles per row, and aligned to FUSION_MATRIX_ALIGNMENT. The slots of the
+ * current epoch are its first rows, and the matrix is solved in place, in
+ * the order of the slots.
+ */
+typedef struct Support_Degree_Cache
+{
+	double *matrix;
+	/**< Support degree of every pair of slots (capacity rows) */
+
+	int leading_dimension;
+	/**< Leading dimension of matrix */
+
+	int capacity;
+	/**< Number of slots the cache can hold */
+
+	int no_of_slots;
+	/**< Number of slots in use */
+
+	int *slot_sensor_id;
+	/**< Sensor ID of each slot (capacity) */
+
+	double *slot_value;
+	/**< Sensor value each slot was computed for (capacity) */
+
+	unsigned char *slot_state;
+	/**< Whether each slot is in the current epoch, and whether it is dirty
+	 * (capacity) */
+
+	int *slot_of_sensor_id;
+	/**< Slot of each sensor ID (-1 if none) (id_capacity) */
+
+	int id_capacity;
+	/**< Number of sensor IDs slot_of_sensor_id can hold */
+
+	long no_of_rows_computed;
+	/**< Number of rows recomputed since the cache was created */
+
+	long no_of_rebuilds;
+	/**< Number of epochs in which the whole matrix was recomputed */
+} Support_Degree_Cache_t;
+
+/**
+ * @brief Allocates an aligned matrix (or vector) of doubles
+ *
+ * @param[in]	no_of_doubles	Number of doubles to allocate
+ *
+ * @details The buffer is aligned to FUSION_MATRIX_ALIGNMENT and is released
+ * with free().
+ *
+ * @return pointer to the buffer, if no, returns NULL.
+ */
+double *fusion_matrix_alloc(size_t no_of_doubles);
+
+/**
+ * @brief Leading dimension to use for a matrix with a number of columns
+ *
+ * @param[in]	no_of_columns	Number of columns of the matrix
+ *
+ * @details Rounds no_of_columns up so that every row of an aligned matrix
+ * starts on a FUSION_MATRIX_ALIGNMENT boundary.
+ *
+ * @return the leading dimension, in doubles.
+ */
+int fusion_matrix_leading_dimension(int no_of_columns);
+
+/**
+ * @brief Initializes an empty fusion workspace
+ *
+ * @param[out]	*workspace	Pointer to the workspace to initialize
+ */
+void fusion_workspace_init(Fusion_Workspace_t *workspace);
+
+/**
+ * @brief Releases all memory held by a fusion workspace
+ *
+ * @param[in,out]	*workspace	Pointer to the workspace to free
+ */
+void fusion_workspace_free(Fusion_Workspace_t *workspace);
+
+/**
+ * @brief Gets a fusion workspace ready for a number of sensors
+ *
+ * @param[in,out]	*workspace		Pointer to the workspace
+ * @param[in]		no_of_sensors	Number of sensors about to be fused
+ *
+ * @details Grows the buffers if no_of_sensors exceeds their capacity, and
+ * sets the leading dimension of the matrices for no_of_sensors.
+ *
+ * @return TRUE if the workspace is ready, otherwise FALSE.
+ */
+Boolean fusion_workspace_prepare(Fusion_Workspace_t *workspace,
+								 int no_of_sensors);
+
+/**
+ * @brief Gets a fusion workspace ready to fuse a number of sensors without a
+ * support degree matrix
+ *
+ * @param[in,out]	*workspace		Pointer to the workspace
+ * @param[in]		no_of_sensors	Number of sensors about to be fused
+ *
+ * @details As fusion_workspace_prepare(), but memory grows with
+ * no_of_sensors rather than its square: no support degree matrix is held,
+ * and the other matrices only have the MATRIX_FREE_MAX_STEPS + 1 rows the
+ * matrix free eigensolver uses. A workspace switching between the two
+ * sizings is reallocated.
+ *
+ * @return TRUE if the workspace is ready, otherwise FALSE.
+ */
+Boolean fusion_workspace_prepare_matrix_free(Fusion_Workspace_t *workspace,
+											 int no_of_sensors);
+
 /**
  * @brief Calculate Support degree matrix D for the set of sensor values
  *
@@ -36,28 +463,444 @@ struct eigen_systems
  *  @param[out]	*sensor_array 	Array contains sensor values
  *
  * @details Support degree matrix is calculated using the Sensor values taken
- * a given time interval
+ * a given time interval. The matrix is aligned, row-major, with a leading
+ * dimension of no_of_sensors. Being symmetric with a unit diagonal, only the
+ * n(n-1)/2 entries above the diagonal are evaluated (by the exp kernel of
+ * exp_kernel.h) and then mirrored.
  * 
  * @return pointer to double of support_degree_matrix, if no, returns NULL.
  */
 double *calculate_support_degree_matrix(Node_t *node, int no_of_sensors,
 										double *sensor_array);
 
+/**
+ * @brief Calculate Support degree matrix D into a caller provided buffer
+ *
+ * @param[in]	*node 			Linked list containing sensor values
+ * @param[in]	no_of_sensors	Number of sensor in the Linked list
+ * @param[out]	*sensor_array 	Array contains sensor values
+ * @param[out]	*sd_matrix		Support degree matrix (no_of_sensors rows)
+ * @param[in]	sd_ld			Leading dimension of sd_matrix
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_matrix_into(Node_t *node, int no_of_sensors,
+										 double *sensor_array,
+										 double *sd_matrix, int sd_ld);
+
+/**
+ * @brief Whether the steps of an epoch are shared between threads
+ *
+ * @param[in]	*workspace		Pointer to a workspace
+ * @param[in]	no_of_sensors	Number of sensors of the epoch
+ *
+ * @return TRUE if the workspace has a thread pool of more than one thread
+ * and no_of_sensors is at least its parallel_threshold, otherwise FALSE.
+ */
+Boolean fusion_workspace_parallel(Fusion_Workspace_t *workspace,
+								  int no_of_sensors);
+
+/**
+ * @brief Calculate Support degree matrix D, shared between the threads of
+ * a workspace
+ *
+ * @param[in]	*workspace		Pointer to a prepared workspace
+ * @param[in]	*node 			Linked list containing sensor values
+ * @param[in]	no_of_sensors	Number of sensor in the Linked list
+ * @param[out]	*sensor_array 	Array contains sensor values
+ * @param[out]	*sd_matrix		Support degree matrix (no_of_sensors rows)
+ * @param[in]	sd_ld			Leading dimension of sd_matrix
+ *
+ * @details Each thread builds blocks of rows above the diagonal, then
+ * mirrors blocks of rows below it. Every entry is computed as by
+ * calculate_support_degree_matrix_into(), so the matrix is the same to the
+ * last bit. Runs on the calling thread alone unless
+ * fusion_workspace_parallel().
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_matrix_parallel_into(Fusion_Workspace_t *workspace,
+												  Node_t *node,
+												  int no_of_sensors,
+												  double *sensor_array,
+												  double *sd_matrix,
+												  int sd_ld);
+
+/**
+ * @brief Initializes an empty support degree cache
+ *
+ * @param[out]	*cache	Pointer to the cache to initialize
+ */
+void support_degree_cache_init(Support_Degree_Cache_t *cache);
+
+/**
+ * @brief Releases all memory held by a support degree cache
+ *
+ * @param[in,out]	*cache	Pointer to the cache to free
+ */
+void support_degree_cache_free(Support_Degree_Cache_t *cache);
+
+/**
+ * @brief Calculate Support degree matrix D, recomputing only what changed
+ * since the previous epoch
+ *
+ * @param[in,out]	*cache			Support degree matrix of the previous epoch
+ * @param[in]		*node 			Linked list containing sensor values
+ * @param[in]		no_of_sensors	Number of sensor in the Linked list
+ * @param[in,out]	*sensor_id		Sensor ID of each sensor (no_of_sensors),
+ *									left in the order of the rows
+ * @param[out]		*sensor_array 	Sensor values, in the order of the rows
+ * @param[out]		*sensor_row		Row of each sensor of the list
+ * @param[out]		*sd_matrix		Support degree matrix (no_of_sensors
+ *									rows), only written when the cache can't
+ *									be used
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[out]		**solve_matrix	Support degree matrix to solve
+ * @param[out]		*solve_ld		Leading dimension of *solve_matrix
+ *
+ * @details The slots of sensors that left are compacted away, sensors that
+ * joined get a slot, and only the rows (and columns) of new sensors and of
+ * sensors whose value changed are recomputed, which takes O(changed * n)
+ * exponentials. When most entries would change, the whole matrix is
+ * recomputed instead. *solve_matrix is then the matrix of the cache, in the order
+ * of its slots: nothing of size n * n is copied, only the sensor values and
+ * IDs are put in that order. Its entries are those that
+ * calculate_support_degree_matrix_into() gives, with row and column i of
+ * the list at sensor_row[i]. When the epoch can't be cached (a sensor ID
+ * is negative or repeated), the matrix is computed into sd_matrix in the
+ * order of the list instead.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_matrix_cached_into(Support_Degree_Cache_t *cache,
+												Node_t *node,
+												int no_of_sensors,
+												int *sensor_id,
+												double *sensor_array,
+												int *sensor_row,
+												double *sd_matrix, int sd_ld,
+												double **solve_matrix,
+												int *solve_ld);
+
+/**
+ * @brief Calculate Support degree matrix D from sorted per-sensor factors
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*node 			Linked list containing sensor values
+ * @param[in]		no_of_sensors	Number of sensor in the Linked list
+ * @param[out]		*sensor_array 	Array contains sensor values
+ * @param[out]		*sd_matrix		Support degree matrix (no_of_sensors rows)
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ *
+ * @details For x_a <= x_b and any shift m,
+ * exp(-|x_b - x_a|) = exp(-(x_b - m)) * exp(x_a - m). The values are sorted
+ * once and cut into blocks spanning at most 512, each shifted by its smallest
+ * value so that no factor overflows; pairs from the next two blocks use the
+ * smallest value of the later block as the shift, and blocks further apart
+ * are left at 0, where exp underflows. This takes O(n) exponentials and n^2
+ * multiplies, and every entry is within SUPPORT_DEGREE_SEPARABLE_MAX_ULP of
+ * exp(). The matrix is in the order of the sensor array.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_matrix_separable_into(
+	Fusion_Workspace_t *workspace, Node_t *node, int no_of_sensors,
+	double *sensor_array, double *sd_matrix, int sd_ld);
+
+/**
+ * @brief Get the support degree of a set of sensor values ready to be
+ * multiplied without building the matrix
+ *
+ * @param[in,out]	*workspace		Pointer to a workspace prepared for
+ *									no_of_sensors (either sizing)
+ *  @param[in]		*node 			Linked list containing sensor values
+ *	@param[in]		no_of_sensors	Number of sensor in the Linked list
+ *  @param[out]		*sensor_array 	Array contains sensor values
+ *
+ * @details Sorts the values and keeps exp(-(x_k - x_k-1)) for each sorted
+ * value, n - 1 exponentials in all. Only O(n) memory is used.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_operator_into(Fusion_Workspace_t *workspace,
+										   Node_t *node, int no_of_sensors,
+										   double *sensor_array);
+
+/**
+ * @brief Multiply a vector by the support degree matrix without building it
+ *
+ * @param[in]	*workspace		Workspace set up by
+ *								calculate_support_degree_operator_into()
+ * @param[in]	no_of_sensors	Number of sensors it was set up for
+ * @param[in]	*vector			Vector, in the order of the sensor array
+ * @param[out]	*product		Set to D * vector (must not be vector)
+ *
+ * @details For sorted values, sum_j exp(-|x_i - x_j|) v_j is the sum over
+ * j <= i plus the sum over j >= i, less v_i. Each is a running sum scaled by
+ * exp(-(x_k - x_k-1)) from one value to the next, so the product takes O(n)
+ * operations. Every factor is at most 1, so nothing can overflow, and an
+ * entry is within about |i - j| rounding errors of exp().
+ *
+ * @return 0 if success, else returns negative.
+ */
+int support_degree_operator_multiply(Fusion_Workspace_t *workspace,
+									 int no_of_sensors, double *vector,
+									 double *product);
+
 /**
  * @brief Calculate eigen values and eigen vectors of the support degree matrix
  *
- * @param[in]	*sd_matrix 		Pointer to support degree matrix
+ * @param[in]	*sd_matrix 		Pointer to support degree matrix (leading
+ *								dimension no_of_sensors)
  * @param[in]	no_of_sensors	Number of sensors	
  *
  * @details Eigen values and eigen vectors of the support degree
- * matrix is calculated using GSL Library and stored in a
- * pointer to structure eigen
+ * matrix is calculated by the backend EIGEN_BACKEND_AUTO picks and stored in
+ * a pointer to structure eigen. The eigenvectors have a leading dimension of
+ * no_of_sensors, and each one has its first non-negligible component positive.
  * 
  * @return pointer to Structure eigen_systems, if no, returns NULL.
  */
 struct eigen_systems *calculate_eigensystem(double *sd_matrix,
 											int no_of_sensors);
 
+/**
+ * @brief Calculate the eigensystem using the buffers of a workspace
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in,out]	*eigen			Eigenvalues and eigenvectors, pointing at
+ *									buffers of no_of_sensors entries (rows).
+ *									Its leading_dimension must be set, and be
+ *									no more than that of the workspace
+ *									capacity.
+ *
+ * @details Solves with the backend set in the workspace. When the epoch is
+ * shared between threads (see fusion_workspace_parallel()), the built-in
+ * backend tridiagonalizes and applies the QL rotations a block of rows or
+ * columns per thread.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_eigensystem_into(Fusion_Workspace_t *workspace,
+							   double *sd_matrix, int sd_ld, int no_of_sensors,
+							   struct eigen_systems *eigen);
+
+/**
+ * @brief Calculate the leading eigenpairs using the buffers of a workspace
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in]		no_of_eigenpairs	Number of leading eigenpairs wanted
+ * @param[in,out]	*eigen			As for calculate_eigensystem_into()
+ *
+ * @details Solves with the backend set in the workspace. LAPACK only
+ * computes the eigenpairs wanted; the other backends compute them all, so
+ * eigen may be written past no_of_eigenpairs.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_eigensystem_leading_into(Fusion_Workspace_t *workspace,
+									   double *sd_matrix, int sd_ld,
+									   int no_of_sensors,
+									   int no_of_eigenpairs,
+									   struct eigen_systems *eigen);
+
+/**
+ * @brief Calculate the eigensystem one block of sensors at a time
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*sensor_array	Pointer to the sensor values
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in,out]	*eigen			As for calculate_eigensystem_into()
+ *
+ * @details The sensor values are sorted and cut wherever the support degree
+ * exp(-gap) of two neighbours is below EIGEN_BLOCK_TOLERANCE. The support
+ * degree matrix is then block diagonal (to machine precision) in the sorted
+ * order, so the eigensystem of each block is solved on its own, with the
+ * backend set in the workspace, and the spectra are merged into descending
+ * order. Each eigenvector is zero outside its block, and follows the sign
+ * convention of calculate_eigensystem_into(). A single block is solved as by
+ * calculate_eigensystem_into(). The number of blocks is left in
+ * workspace->no_of_blocks.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_eigensystem_blocks_into(Fusion_Workspace_t *workspace,
+									  double *sensor_array,
+									  double *sd_matrix, int sd_ld,
+									  int no_of_sensors,
+									  struct eigen_systems *eigen);
+
+/**
+ * @brief Fixes the sign of each eigenvector by the order of the sensors in
+ * the valid list
+ *
+ * @param[in,out]	*eigen				Eigenvalues and eigenvectors of a
+ *										matrix whose rows are not in the
+ *										order of the list
+ * @param[in]		no_of_eigenpairs	Number of eigenvectors
+ * @param[in]		no_of_sensors		Number of sensors
+ * @param[in]		*sensor_row			Row of each sensor of the list
+ *
+ * @details Makes the first component that is not negligible positive, as
+ * the solvers do, but taking the components in the order of the list, so
+ * that the fused output is that of the matrix built in that order.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int normalize_eigenvector_signs_in_order(struct eigen_systems *eigen,
+										 int no_of_eigenpairs,
+										 int no_of_sensors,
+										 int *sensor_row);
+
+/**
+ * @brief Whether a backend is available in this build
+ *
+ * @param[in]	backend	Backend to check
+ *
+ * @return TRUE if the backend can be used, otherwise FALSE.
+ */
+Boolean eigen_backend_supported(Eigen_Backend_t backend);
+
+/**
+ * @brief Name of a backend
+ *
+ * @param[in]	backend	Backend to name
+ *
+ * @return The name of the backend (eg: "lapack").
+ */
+const char *eigen_backend_name(Eigen_Backend_t backend);
+
+/**
+ * @brief Calculate only the leading eigenpairs needed by the contribution
+ * rate parameter
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in]		parameter		Contribution rate parameter (0 < p <= 1)
+ * @param[in,out]	*eigen			As for calculate_eigensystem_into()
+ *
+ * @details Runs the Lanczos method (with full reorthogonalization) until the
+ * largest eigenvalues reach parameter * no_of_sensors, the trace of the
+ * support degree matrix, and have converged to within LANCZOS_TOLERANCE.
+ * Those eigenpairs are stored in descending order, with the same sign
+ * convention as calculate_eigensystem_into(). Small fleets, a parameter of 1
+ * and runs that need too many steps solve the full eigensystem instead.
+ *
+ * @return number of leading eigenpairs stored if success, else returns
+ * negative.
+ */
+int calculate_eigensystem_partial_into(Fusion_Workspace_t *workspace,
+									   double *sd_matrix, int sd_ld,
+									   int no_of_sensors, float parameter,
+									   struct eigen_systems *eigen);
+
+/**
+ * @brief Calculate the leading eigenpairs needed by the contribution rate
+ * parameter without a support degree matrix
+ *
+ * @param[in,out]	*workspace		Workspace set up by
+ *									calculate_support_degree_operator_into()
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in]		parameter		Contribution rate parameter (0 to 1]
+ * @param[in,out]	*eigen			As for calculate_eigensystem_partial_into()
+ *
+ * @details Runs Lanczos with support_degree_operator_multiply(), for at
+ * most MATRIX_FREE_MAX_STEPS steps. There is no full eigensystem to fall
+ * back to, so a fleet needing more eigenpairs than that can find (sensors
+ * that mostly disagree) cannot be solved this way.
+ *
+ * @return number of leading eigenpairs stored if success, else returns
+ * negative.
+ */
+int calculate_eigensystem_matrix_free_into(Fusion_Workspace_t *workspace,
+										   int no_of_sensors, float parameter,
+										   struct eigen_systems *eigen);
+
+/**
+ * @brief Approximate the leading eigenpairs needed by the contribution rate
+ * parameter with a randomized range finder
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix, or NULL
+ *									to use the one set up by
+ *									calculate_support_degree_operator_into()
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in]		parameter		Contribution rate parameter (0 to 1]
+ * @param[in]		accuracy		Target of the error estimate (> 0)
+ * @param[in,out]	*eigen			As for calculate_eigensystem_partial_into()
+ *
+ * @details Multiplies a block of random vectors by the support degree
+ * matrix, with two power iterations, and takes the Ritz pairs of the
+ * subspace they span. Their residuals give the error estimate, left in
+ * workspace->approximation_error. Until the estimate meets accuracy, the
+ * block is doubled, keeping the subspace found so far, up to 32 vectors (or
+ * half the fleet with a matrix), after which the best pairs found are
+ * returned whatever their error, so the cost of an epoch is bounded. With a
+ * matrix, fleets of under 32 sensors are solved in full.
+ *
+ * @return number of leading eigenpairs stored if success, else returns
+ * negative.
+ */
+int calculate_eigensystem_randomized_into(Fusion_Workspace_t *workspace,
+										  double *sd_matrix, int sd_ld,
+										  int no_of_sensors, float parameter,
+										  double accuracy,
+										  struct eigen_systems *eigen);
+
+/**
+ * @brief Initializes an empty warm start
+ *
+ * @param[out]	*warm_start	Pointer to the warm start to initialize
+ */
+void eigen_warm_start_init(Eigen_Warm_Start_t *warm_start);
+
+/**
+ * @brief Releases all memory held by a warm start
+ *
+ * @param[in,out]	*warm_start	Pointer to the warm start to free
+ */
+void eigen_warm_start_free(Eigen_Warm_Start_t *warm_start);
+
+/**
+ * @brief Calculate the leading eigenpairs, starting from those of the
+ * previous epoch
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace
+ * @param[in,out]	*warm_start		Eigenvectors of the previous epoch, updated
+ *									with those of this one
+ * @param[in]		*sensor_id		Sensor ID of each sensor (no_of_sensors)
+ * @param[in]		*sd_matrix 		Pointer to support degree matrix
+ * @param[in]		sd_ld			Leading dimension of sd_matrix
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[in]		parameter		Contribution rate parameter (0 < p <= 1)
+ * @param[in,out]	*eigen			As for calculate_eigensystem_into()
+ *
+ * @details Runs the Lanczos method from the seed left by the previous
+ * epoch. When the sensors have barely changed it converges in a few steps;
+ * if it has not converged within a few, the solve starts cold as in
+ * calculate_eigensystem_partial_into().
+ *
+ * @return number of leading eigenpairs stored if success, else returns
+ * negative.
+ */
+int calculate_eigensystem_warm_into(Fusion_Workspace_t *workspace,
+									Eigen_Warm_Start_t *warm_start,
+									int *sensor_id, double *sd_matrix,
+									int sd_ld, int no_of_sensors,
+									float parameter,
+									struct eigen_systems *eigen);
+
 /**
  * @brief Calculate contribute rate of Principal Component
  *
@@ -71,6 +914,37 @@ struct eigen_systems *calculate_eigensystem(double *sd_matrix,
  */
 double *calculate_contribution_rate(double *eigen_value, int no_of_sensors);
 
+/**
+ * @brief Calculate contribute rate into a caller provided buffer
+ *
+ * @param[in]	*eigen_value		Pointer to Eigen Value
+ * @param[in]	no_of_sensors		Number of sensors
+ * @param[out]	*contribution_rate	Contribution rates (no_of_sensors)
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_contribution_rate_into(double *eigen_value, int no_of_sensors,
+									 double *contribution_rate);
+
+/**
+ * @brief Calculate contribute rate of the leading Principal Components from
+ * the trace of the support degree matrix
+ *
+ * @param[in]	*eigen_value		Pointer to the leading Eigen Values
+ * @param[in]	no_of_eigenpairs	Number of leading Eigen Values
+ * @param[in]	trace				Sum of all the Eigen Values
+ * @param[out]	*contribution_rate	Contribution rates (no_of_eigenpairs)
+ *
+ * @details The support degree matrix has a unit diagonal, so its trace (the
+ * sum of its eigenvalues) is the number of sensors, and the rates of the
+ * leading components can be found without the other eigenvalues.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_contribution_rate_trace_into(double *eigen_value,
+										   int no_of_eigenpairs, double trace,
+										   double *contribution_rate);
+
 /**
  * @brief Determine the number of contribution_rate to use
  *
@@ -91,39 +965,142 @@ int determine_contribution_rates_to_use(double *contribution_rate,
  *
  * @param[in]	*sd_matrix 		Pointer to support degree matrix
  * @param[in]	no_of_sensors	Number of sensors	
- * @param[in]	**eigen_vector	Pointer to multi-dimensional Eigen Vector
+ * @param[in]	*eigen_vector	Pointer to Eigen Vectors, one per row
  * @param[in]	no_of_contribution_rates_to_use Number of contribution rate
  *
  * @details Principal component matrix is determined by multiplying transpose
- * Eigen vector with the support degree matrix
+ * Eigen vector with the support degree matrix. Every matrix, including the
+ * returned one, has a leading dimension of no_of_sensors.
  * 
  * @return
- *	Pointer to pointer to double of principal_components_matrix
- *	If no, returns NULL.
+ *	Pointer to the row-major principal_components_matrix (one component per
+ *	row). If no, returns NULL.
+ */
+double *calculate_principal_components(double *sd_matrix, int no_of_sensors,
+									   double *eigen_vector,
+									   int no_of_contribution_rates_to_use);
+
+/**
+ * @brief Calculate the Principal components into a caller provided matrix
+ *
+ * @param[in]	*sd_matrix 		Pointer to support degree matrix
+ * @param[in]	sd_ld			Leading dimension of sd_matrix
+ * @param[in]	no_of_sensors	Number of sensors
+ * @param[in]	*eigen_vector	Pointer to Eigen Vectors, one per row
+ * @param[in]	eigen_ld		Leading dimension of eigen_vector
+ * @param[in]	no_of_contribution_rates_to_use Number of contribution rate
+ * @param[out]	*principal_components_matrix	Principal components, one per
+ *												row
+ * @param[in]	pc_ld			Leading dimension of
+ *								principal_components_matrix
+ *
+ * @return 0 if success, else returns negative.
  */
-double **calculate_principal_components(double *sd_matrix, int no_of_sensors,
-										double **eigen_vector,
-										int no_of_contribution_rates_to_use);
+int calculate_principal_components_into(double *sd_matrix, int sd_ld,
+										int no_of_sensors,
+										double *eigen_vector, int eigen_ld,
+										int no_of_contribution_rates_to_use,
+										double *principal_components_matrix,
+										int pc_ld);
 
 /**
  * @brief Calculate the Integrated Support Degree Score for all sensors
  *
- * @param[in] **principle_components	Pointer to principle_components array
+ * @param[in] *principle_components	Pointer to principle_components matrix
  * @param[in] *contribution_rate 		Pointer to contribution_rate
  * @param[in] no_of_contribution_rates_to_use	Number of contribuation rate
  * @param[in] no_of_sensors				Number of sensors
  *
  * @details Integrated support degree of each sensor is calculated using
- * the principal components and contribution rate
+ * the principal components (one per row, with a leading dimension of
+ * no_of_sensors) and contribution rate
  * 
  * @return 
  *	Pointer to Integrated Support Degree Matrix.
  *	If no, returns NULL.
  */
 double *calculate_integrated_support_degree_matrix(
-	double **principle_components, double *contribution_rate,
+	double *principle_components, double *contribution_rate,
 	int no_of_contribution_rates_to_use, int no_of_sensors);
 
+/**
+ * @brief Calculate the Integrated Support Degree Score into a caller
+ * provided buffer
+ *
+ * @param[in] *principle_components	Pointer to principle_components matrix
+ * @param[in] pc_ld						Leading dimension of
+ *										principle_components
+ * @param[in] *contribution_rate 		Pointer to contribution_rate
+ * @param[in] no_of_contribution_rates_to_use	Number of contribuation rate
+ * @param[in] no_of_sensors				Number of sensors
+ * @param[out] *integrated_support		Integrated support degree of each
+ *										sensor
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_integrated_support_degree_matrix_into(
+	double *principle_components, int pc_ld, double *contribution_rate,
+	int no_of_contribution_rates_to_use, int no_of_sensors,
+	double *integrated_support);
+
+/**
+ * @brief Calculate the Integrated Support Degree Score straight from the
+ * eigenpairs of the support degree matrix
+ *
+ * @param[in] *eigen_value				Pointer to the Eigen Values
+ * @param[in] *eigen_vector				Pointer to the Eigen Vectors, one per
+ *										row
+ * @param[in] eigen_ld					Leading dimension of eigen_vector
+ * @param[in] *contribution_rate 		Pointer to contribution_rate
+ * @param[in] no_of_contribution_rates_to_use	Number of contribuation rate
+ * @param[in] no_of_sensors				Number of sensors
+ * @param[out] *integrated_support		Integrated support degree of each
+ *										sensor
+ *
+ * @details The support degree matrix D is symmetric, so for an eigenpair
+ * (lambda_j, v_j), v_j^T D = lambda_j v_j^T: principal component j is
+ * eigenvector j scaled by its eigenvalue. The score is therefore
+ * sum_j contribution_rate_j * lambda_j * v_j, found in O(m * n) without
+ * the principal components. It agrees with the product through
+ * calculate_principal_components_into() up to rounding (and, for the
+ * Lanczos solvers, their convergence tolerance).
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_integrated_support_from_eigenpairs_into(
+	double *eigen_value, double *eigen_vector, int eigen_ld,
+	double *contribution_rate, int no_of_contribution_rates_to_use,
+	int no_of_sensors, double *integrated_support);
+
+/**
+ * @brief Calculate the fused output from the eigenpairs, shared between the
+ * threads of a workspace
+ *
+ * @param[in,out]	*workspace		Pointer to a prepared workspace, with the
+ *									sensor values in sensor_array and the
+ *									contribution rates in contribution_rate
+ * @param[in]		*eigen			Eigenvalues and eigenvectors
+ * @param[in]		no_of_contribution_rates_to_use	Number of eigenpairs used
+ * @param[in]		fault_tolerance	As for eliminate_incorrect_data()
+ * @param[in]		no_of_sensors	Number of sensors
+ * @param[out]		*fused_value	Fused output
+ *
+ * @details Steps 5 to 9 of the algorithm: each thread finds the integrated
+ * support, the weight coefficients and its part of the sums for its own
+ * range of sensors, and the partial sums are added in thread order. The
+ * result agrees with calculate_integrated_support_from_eigenpairs_into(),
+ * eliminate_incorrect_data(), calculate_weight_coefficient_into() and
+ * calculate_fused_output() up to the rounding of the sums.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_fused_output_parallel(Fusion_Workspace_t *workspace,
+									struct eigen_systems *eigen,
+									int no_of_contribution_rates_to_use,
+									double fault_tolerance,
+									int no_of_sensors,
+									double *fused_value);
+
 /**
  * @brief Eliminate the incorrect sensor data
  *
@@ -155,6 +1132,20 @@ int eliminate_incorrect_data(double *integrate_support_degree_matrix,
 double *calculate_weight_coefficient(double *integrate_support_degree_matrix,
 									 int no_of_sensors);
 
+/**
+ * @brief Calculate the weight coefficients into a caller provided buffer
+ *
+ * @param[in] *integrate_support_degree_matrix 	Pointer to
+ 												Integrated Support Degree Matrix
+ * @param[in] no_of_sensors			Number of sensors
+ * @param[out] *weight_coefficient	Weight coefficient of each sensor
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_weight_coefficient_into(double *integrate_support_degree_matrix,
+									  int no_of_sensors,
+									  double *weight_coefficient);
+
 /**
  * @brief Calculate the fused output
  *
@@ -0,0 +1,125 @@
+/**
+ * @file checkpoint.h
+ *
+ * @brief Checkpoint and restore of the sensor state, so that a long running
+ * fusion can resume where it stopped after a crash instead of reprocessing
+ * its input.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <sys/types.h>
+#include "linked_list.h"
+#include "sensor_registry.h"
+
+/**
+ * @brief Identifies a checkpoint file.
+ */
+#define CHECKPOINT_FILE_MAGIC       "SFCHKPNT"
+
+/**
+ * @brief Version of the checkpoint file layout.
+ */
+#define CHECKPOINT_FILE_VERSION     1
+
+/**
+ * @brief Default number of epochs between two checkpoints.
+ */
+#define DEFAULT_CHECKPOINT_INTERVAL 10
+
+/**
+ * @brief Where the processing of the input and output had got to
+ */
+typedef struct Checkpoint_Position
+{
+    int lines_read;
+    /**< Number of input lines consumed (including the header line) */
+
+    int current_time;
+    /**< Time of the epoch being accumulated (-1 if none yet) */
+
+    int time_in_minutes;
+    /**< Time of the last line read */
+
+    long output_offset;
+    /**< Size of the report file when the checkpoint was taken */
+} Checkpoint_Position_t;
+
+/**
+ * @brief Writes a checkpoint
+ *
+ * @param[in] *file_name    Pointer to the file name of the checkpoint
+ * @param[in] *position     Position within the input and output
+ * @param[in] **sensor_lists Head pointers of the MAX_SENSOR_LISTS lists
+ * @param[in] *registry     Pointer to the sensor registry
+ *
+ * @details The checkpoint is written to a temporary file which is renamed
+ * over *file_name once complete, so a crash while writing leaves the
+ * previous checkpoint intact.
+ *
+ * @return TRUE if the checkpoint was written, otherwise FALSE.
+ */
+Boolean checkpoint_write(char                  *file_name,
+                         Checkpoint_Position_t *position,
+                         Node_t                **sensor_lists,
+                         Sensor_Registry_t     *registry);
+
+/**
+ * @brief Writes a checkpoint in the background
+ *
+ * @param[in,out] *checkpoint_pid Process writing the caller's previous
+ *                              background checkpoint (0 if there is none),
+ *                              updated to the one started.
+ * @param[in] *file_name    Pointer to the file name of the checkpoint
+ * @param[in] *position     Position within the input and output
+ * @param[in] **sensor_lists Head pointers of the MAX_SENSOR_LISTS lists
+ * @param[in] *registry     Pointer to the sensor registry
+ *
+ * @details The checkpoint is laid out in memory, then a child process is
+ * forked to write it out, so the caller can carry on ingesting while it is
+ * written. The child only makes async-signal-safe calls, as other threads
+ * of the caller may hold locks when it is forked. If the previous
+ * checkpoint is still being written, this one is skipped.
+ *
+ * @return TRUE if a checkpoint was started, otherwise FALSE.
+ */
+Boolean checkpoint_start_async(pid_t                 *checkpoint_pid,
+                               char                  *file_name,
+                               Checkpoint_Position_t *position,
+                               Node_t                **sensor_lists,
+                               Sensor_Registry_t     *registry);
+
+/**
+ * @brief Waits for a background checkpoint to complete
+ *
+ * @param[in,out] *checkpoint_pid Process writing the checkpoint (0 if there
+ *                              is none), reset to 0.
+ *
+ * @return TRUE if there was none, or it completed successfully.
+ */
+Boolean checkpoint_wait(pid_t *checkpoint_pid);
+
+/**
+ * @brief Restores the state saved in a checkpoint
+ *
+ * @param[in]     *file_name    Pointer to the file name of the checkpoint
+ * @param[out]    *position     Position within the input and output
+ * @param[in,out] **sensor_lists Head pointers of the MAX_SENSOR_LISTS lists,
+ *                              which are emptied and refilled
+ * @param[in,out] *registry     Pointer to the sensor registry, which is
+ *                              cleared and refilled
+ *
+ * @return TRUE if the checkpoint was restored, FALSE if there is no usable
+ * checkpoint (in which case nothing is changed).
+ */
+Boolean checkpoint_read(char                  *file_name,
+                        Checkpoint_Position_t *position,
+                        Node_t                **sensor_lists,
+                        Sensor_Registry_t     *registry);
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file exp_kernel.h
+ *
+ * @brief Vectorized exp(-|x - y|) kernels used to build the support degree
+ * matrix, with the kernel chosen at run time from the features of the CPU.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef EXP_KERNEL_H
+#define EXP_KERNEL_H
+
+#include "parsing_csv_file.h"
+
+/**
+ * @brief Largest error, in units in the last place, of the polynomial kernels
+ * against exp() from libm, for results in the normal range.
+ *
+ * @details No error above 1 ULP has been observed over millions of arguments
+ * in [EXP_KERNEL_MIN_ARGUMENT, 0]. Arguments below it give 0 instead of a
+ * subnormal result (an absolute error below DBL_MIN, 2.3e-308).
+ */
+#define EXP_KERNEL_MAX_ULP          2
+
+/**
+ * @brief Smallest argument of exp for which a kernel returns a non-zero result.
+ *
+ * @details log(DBL_MIN), rounded up, so that every argument from it up has a
+ * normal result and every one below it a subnormal one.
+ */
+#define EXP_KERNEL_MIN_ARGUMENT     -708.3964185322641
+
+/**
+ * @brief Available kernels, from the slowest to the fastest
+ *
+ * @details Every polynomial kernel performs the same floating point
+ * operations in the same order, so they all give bit-identical results
+ * whichever one the CPU runs.
+ */
+typedef enum Exp_Kernel
+{
+    EXP_KERNEL_REFERENCE,
+    /**< exp() from libm, one value at a time (never picked automatically) */
+
+    EXP_KERNEL_PORTABLE,
+    /**< Polynomial exp in plain C, one value at a time */
+
+    EXP_KERNEL_SSE2,
+    /**< Polynomial exp, two values at a time */
+
+    EXP_KERNEL_AVX2,
+    /**< Polynomial exp, four values at a time */
+
+    EXP_KERNEL_AVX512,
+    /**< Polynomial exp, eight values at a time */
+
+    EXP_KERNEL_COUNT
+    /**< Number of kernels */
+} Exp_Kernel_t;
+
+/**
+ * @brief Computes one row of the support degree matrix
+ *
+ * @param[in]  x        Value the row is for
+ * @param[in]  *values  Values to compare x with
+ * @param[in]  count    Number of values
+ * @param[out] *row     Set to exp(-|x - values[j]|) for every value j
+ *
+ * @details Runs the selected kernel. On first use, the fastest kernel the CPU
+ * supports is selected.
+ */
+void exp_kernel_row(double x, double *values, int count, double *row);
+
+/**
+ * @brief Whether the CPU can run a kernel
+ *
+ * @param[in] kernel    Kernel to check
+ *
+ * @return TRUE if the kernel can run, otherwise FALSE.
+ */
+Boolean exp_kernel_supported(Exp_Kernel_t kernel);
+
+/**
+ * @brief Selects the kernel used by exp_kernel_row()
+ *
+ * @param[in] kernel    Kernel to use from now on
+ *
+ * @details Meant for validation and benchmarking; the selection applies to
+ * the whole process.
+ *
+ * @return TRUE if the kernel was selected, FALSE if the CPU can't run it.
+ */
+Boolean exp_kernel_select(Exp_Kernel_t kernel);
+
+/**
+ * @brief Kernel currently used by exp_kernel_row()
+ *
+ * @return The selected kernel.
+ */
+Exp_Kernel_t exp_kernel_selected(void);
+
+/**
+ * @brief Name of a kernel
+ *
+ * @param[in] kernel    Kernel to name
+ *
+ * @return The name of the kernel (eg: "avx2").
+ */
+const char *exp_kernel_name(Exp_Kernel_t kernel);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file fusion_batch.h
+ *
+ * @brief Fusion of many independent epochs of the same number of sensors at
+ * once, one epoch per SIMD lane.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef FUSION_BATCH_H
+#define FUSION_BATCH_H
+
+#include "calculate_fusion.h"
+
+/**
+ * @brief Number of epochs fused together by the batch kernel, one per lane
+ * (a FUSION_MATRIX_ALIGNMENT line of doubles).
+ */
+#define FUSION_BATCH_LANES          8
+
+/**
+ * @brief Largest number of sensors per epoch the batch kernel fuses, as it
+ * solves every eigensystem by Jacobi.
+ */
+#define FUSION_BATCH_MAX_SENSORS    JACOBI_MAX_SENSORS
+
+/**
+ * @brief Fuses many independent epochs of the same number of sensors
+ *
+ * @param[in]  *values          Sensor values, no_of_sensors per epoch, one
+ *                              epoch after the other
+ * @param[in]  no_of_epochs     Number of epochs
+ * @param[in]  no_of_sensors    Number of sensors in each epoch (1 to
+ *                              FUSION_BATCH_MAX_SENSORS)
+ * @param[in]  q_support        Fault tolerance, as passed to
+ *                              eliminate_incorrect_data()
+ * @param[in]  parameter        Contribution rate parameter (0 to 1]
+ * @param[out] *fused_values    Fused output of each epoch (no_of_epochs)
+ *
+ * @details The epochs are fused FUSION_BATCH_LANES at a time, with the
+ * values of each block transposed so that every step (the support degree
+ * matrix, the eigensystem, the contribution rates and the weights) runs
+ * across the block with one epoch per lane and no branch that depends on
+ * the values. The eigensystems are solved by Jacobi sweeps until every lane
+ * has converged, and a last partial block is padded with copies of its
+ * final epoch. Each fused value agrees with do_sensor_fusion_algorithm()
+ * with the Jacobi backend to within rounding.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int do_sensor_fusion_batch(double   *values,
+                           int      no_of_epochs,
+                           int      no_of_sensors,
+                           double   q_support,
+                           float    parameter,
+                           double   *fused_values);
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * @file fusion_float.h
+ *
+ * @brief Single precision (float) version of the sensor fusion algorithm,
+ * and the record of how far it strays from the double precision one.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef FUSION_FLOAT_H
+#define FUSION_FLOAT_H
+
+#include "calculate_fusion.h"
+
+/**
+ * @brief Precision the fusion algorithm is computed in
+ */
+typedef enum Fusion_Precision
+{
+    FUSION_PRECISION_DOUBLE,
+    /**< Every step in double (default) */
+
+    FUSION_PRECISION_FLOAT,
+    /**< Every step in float, with half the memory traffic */
+
+    FUSION_PRECISION_VALIDATE,
+    /**< The double result is reported, and the float one compared with it */
+
+    FUSION_PRECISION_COUNT
+    /**< Number of precisions */
+} Fusion_Precision_t;
+
+/**
+ * @brief Buffers reused by every run of the float fusion algorithm
+ *
+ * @details Sized for the largest number of sensors seen so far, like a
+ * Fusion_Workspace_t. Matrices are row-major with leading_dimension floats
+ * per row, and every buffer is aligned to FUSION_MATRIX_ALIGNMENT.
+ */
+typedef struct Fusion_Workspace_Float
+{
+    int capacity;
+    /**< Number of sensors the buffers can hold */
+
+    int leading_dimension;
+    /**< Leading dimension of the matrices for the current number of
+     * sensors (set by fusion_workspace_float_prepare) */
+
+    float *sensor_array;
+    /**< Sensor values (capacity) */
+
+    float *sd_matrix;
+    /**< Support degree matrix, destroyed by the eigensolver (capacity
+     * rows) */
+
+    float *transform;
+    /**< Eigenvectors, one per row, in the order the eigensolver found them
+     * (capacity rows) */
+
+    float *eigen_value;
+    /**< Eigenvalues in descending order (capacity) */
+
+    int *order;
+    /**< Row of transform holding the eigenvector of each eigenvalue, also
+     * used as LAPACK scratch (EIGEN_INDEX_SCRATCH_PER_SENSOR * capacity) */
+
+    float *scratch;
+    /**< Scratch space of the eigensolver
+     * (EIGEN_SCRATCH_PER_SENSOR * capacity) */
+
+    float *contribution_rate;
+    /**< Contribution rate of each eigenvalue (capacity) */
+
+    float *integrated_support;
+    /**< Integrated support degree of each sensor (capacity) */
+
+    float *weight_coefficient;
+    /**< Weight coefficient of each sensor (capacity) */
+} Fusion_Workspace_Float_t;
+
+/**
+ * @brief How far float fusion strays from double fusion over a run
+ */
+typedef struct Float_Divergence
+{
+    long no_of_epochs;
+    /**< Number of epochs both precisions fused */
+
+    long no_of_mismatches;
+    /**< Number of epochs only one precision could fuse */
+
+    double largest;
+    /**< Largest |float - double| of a fused value */
+
+    double largest_relative;
+    /**< Largest |float - double| / |double| of a fused value */
+
+    double total;
+    /**< Sum of |float - double| over the epochs, for the mean */
+} Float_Divergence_t;
+
+/**
+ * @brief Initializes an empty float workspace
+ *
+ * @param[out] *workspace   Pointer to the workspace to initialize
+ */
+void fusion_workspace_float_init(Fusion_Workspace_Float_t *workspace);
+
+/**
+ * @brief Releases all memory held by a float workspace
+ *
+ * @param[in,out] *workspace    Pointer to the workspace to free
+ */
+void fusion_workspace_float_free(Fusion_Workspace_Float_t *workspace);
+
+/**
+ * @brief Gets a float workspace ready for a number of sensors
+ *
+ * @param[in,out] *workspace    Pointer to the workspace
+ * @param[in]     no_of_sensors Number of sensors about to be fused
+ *
+ * @return TRUE if the workspace is ready, otherwise FALSE.
+ */
+Boolean fusion_workspace_float_prepare(Fusion_Workspace_Float_t *workspace,
+                                       int no_of_sensors);
+
+/**
+ * @brief Calculate the support degree matrix in float
+ *
+ * @param[in]  *node            Linked list containing sensor values
+ * @param[in]  no_of_sensors    Number of sensors in the linked list
+ * @param[out] *sensor_array    Sensor values
+ * @param[out] *sd_matrix       Support degree matrix (no_of_sensors rows)
+ * @param[in]  sd_ld            Leading dimension of sd_matrix
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_support_degree_matrix_float_into(Node_t *node,
+                                               int no_of_sensors,
+                                               float *sensor_array,
+                                               float *sd_matrix,
+                                               int sd_ld);
+
+/**
+ * @brief Calculate the eigensystem of the support degree matrix in float
+ *
+ * @param[in,out] *workspace    Workspace whose sd_matrix holds the matrix
+ *                              (it is destroyed)
+ * @param[in]     no_of_sensors Number of sensors
+ * @param[in]     backend       EIGEN_BACKEND_LAPACK for ssyevr; GSL has no
+ *                              single precision eigensolver, so any other
+ *                              backend uses the built-in one
+ *
+ * @details Leaves the eigenvalues in descending order in
+ * workspace->eigen_value, and the eigenvector of eigenvalue k in row
+ * workspace->order[k] of workspace->transform, with its first
+ * non-negligible component positive.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int calculate_eigensystem_float_into(Fusion_Workspace_Float_t *workspace,
+                                     int no_of_sensors,
+                                     Eigen_Backend_t backend);
+
+/**
+ * @brief Runs the whole fusion algorithm in float
+ *
+ * @param[in,out] *workspace            Pointer to the float workspace
+ * @param[in]     *node                 Linked list of the valid sensors
+ * @param[in]     no_of_sensors         Number of sensors in the list
+ * @param[in]     q_support             Fault tolerance (0 to 1)
+ * @param[in]     parameter             Contribution rate parameter (0 to 1]
+ * @param[in]     backend               As for
+ *                                      calculate_eigensystem_float_into()
+ * @param[out]    *fused_value          Fused output
+ *
+ * @details Follows the steps of do_sensor_fusion_algorithm() with the full
+ * eigensystem, with every value and sum in float.
+ *
+ * @return 0 if success, else returns negative.
+ */
+int do_sensor_fusion_float(Fusion_Workspace_Float_t  *workspace,
+                           Node_t                    *node,
+                           int                       no_of_sensors,
+                           float                     q_support,
+                           float                     parameter,
+                           Eigen_Backend_t           backend,
+                           float                     *fused_value);
+
+/**
+ * @brief Records how far the float result of an epoch is from the double one
+ *
+ * @param[in,out] *divergence       Record of the run
+ * @param[in]     double_valid      Whether double fusion gave a value
+ * @param[in]     double_value      Fused value in double
+ * @param[in]     float_valid       Whether float fusion gave a value
+ * @param[in]     float_value       Fused value in float
+ */
+void float_divergence_record(Float_Divergence_t *divergence,
+                             Boolean            double_valid,
+                             double             double_value,
+                             Boolean            float_valid,
+                             float              float_value);
+
+/**
+ * @brief Name of a precision
+ *
+ * @param[in] precision Precision to name
+ *
+ * @return The name of the precision (eg: "float").
+ */
+const char *fusion_precision_name(Fusion_Precision_t precision);
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * @file fusion_memo.h
+ *
+ * @brief Memo of recent fusion results, so that an epoch whose valid sensor
+ * values were all seen together before is not fused again.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef FUSION_MEMO_H
+#define FUSION_MEMO_H
+
+#include <stdint.h>
+#include "parsing_csv_file.h"
+
+/**
+ * @brief Number of fusion results kept by a memo.
+ */
+#define FUSION_MEMO_ENTRIES     16
+
+/**
+ * @brief One remembered fusion result
+ */
+typedef struct Fusion_Memo_Entry
+{
+    uint64_t hash;
+    /**< Hash of the key */
+
+    double *values;
+    /**< Valid sensor values of the epoch, in the order of the list */
+
+    int no_of_values;
+    /**< Number of valid sensor values */
+
+    int values_capacity;
+    /**< Number of values *values can hold */
+
+    int q_support_value;
+    /**< The q_support (percent) the result was fused with */
+
+    int principal_component_ratio;
+    /**< The ratio (percent) the result was fused with */
+
+    double fused_value;
+    /**< Fused output of the epoch */
+
+    unsigned long last_used;
+    /**< Value of the memo clock when the entry was last used (0 if unused) */
+} Fusion_Memo_Entry_t;
+
+/**
+ * @brief Least recently used memo of fusion results
+ *
+ * @details A result is keyed by the valid sensor values in the order of the
+ * valid list, along with the q and p parameters it was fused with. The
+ * order is part of the key because the signs of the eigenvectors, and so
+ * the fused output, depend on it. Keys are compared in full, so a hash
+ * collision never returns the wrong result.
+ */
+typedef struct Fusion_Memo
+{
+    Fusion_Memo_Entry_t entries[FUSION_MEMO_ENTRIES];
+    /**< Remembered results */
+
+    double *key;
+    /**< Values of the last lookup */
+
+    int key_capacity;
+    /**< Number of values *key can hold */
+
+    int no_of_key_values;
+    /**< Number of values in the key of the last lookup */
+
+    uint64_t key_hash;
+    /**< Hash of the key of the last lookup */
+
+    int key_q_support_value;
+    /**< q_support of the last lookup */
+
+    int key_principal_component_ratio;
+    /**< Ratio of the last lookup */
+
+    unsigned long clock;
+    /**< Number of lookups made, used to find the least recently used entry */
+
+    long no_of_hits;
+    /**< Number of lookups that found a result */
+
+    long no_of_misses;
+    /**< Number of lookups that did not */
+} Fusion_Memo_t;
+
+/**
+ * @brief Initializes an empty memo
+ *
+ * @param[out] *memo    Pointer to the memo to initialize
+ */
+void fusion_memo_init(Fusion_Memo_t *memo);
+
+/**
+ * @brief Releases all memory held by a memo
+ *
+ * @param[in,out] *memo Pointer to the memo to free
+ */
+void fusion_memo_free(Fusion_Memo_t *memo);
+
+/**
+ * @brief Looks up the fused output of a set of sensor values
+ *
+ * @param[in,out] *memo                     Pointer to the memo
+ * @param[in]     *values                   Valid sensor values, in list order
+ * @param[in]     no_of_values              Number of values
+ * @param[in]     q_support_value           The q_support (percent)
+ * @param[in]     principal_component_ratio The ratio (percent)
+ * @param[out]    *fused_value              Set to the remembered result on a
+ *                                          hit
+ *
+ * @details The key is kept, so that fusion_memo_store() can remember the
+ * result of a lookup that missed once it has been fused.
+ *
+ * @return TRUE on a hit, otherwise FALSE.
+ */
+Boolean fusion_memo_lookup(Fusion_Memo_t   *memo,
+                           double          *values,
+                           int             no_of_values,
+                           int             q_support_value,
+                           int             principal_component_ratio,
+                           double          *fused_value);
+
+/**
+ * @brief Remembers the fused output for the key of the last lookup
+ *
+ * @param[in,out] *memo         Pointer to the memo
+ * @param[in]     fused_value   Fused output of the values last looked up
+ *
+ * @details Replaces the least recently used entry. Does nothing if the memo
+ * has no key (no lookup yet, or it could not be allocated).
+ */
+void fusion_memo_store(Fusion_Memo_t *memo, double fused_value);
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file fusion_thread_pool.h
+ *
+ * @brief Pool of threads that the steps of one large epoch are shared
+ * between.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef FUSION_THREAD_POOL_H
+#define FUSION_THREAD_POOL_H
+
+#include <pthread.h>
+#include "parsing_csv_file.h"
+
+/**
+ * @brief Most threads a pool can have, the calling thread included.
+ */
+#define FUSION_MAX_THREADS          64
+
+/**
+ * @brief Default smallest number of valid sensors an epoch is shared
+ * between the threads for. Below it, the steps are too short to be worth
+ * waking the threads up.
+ */
+#define FUSION_PARALLEL_MIN_SENSORS 256
+
+/**
+ * @brief Task run on every thread of a pool
+ *
+ * @param[in] *arg              Argument given to fusion_thread_pool_run()
+ * @param[in] thread            Index of the thread (0 is the calling thread)
+ * @param[in] no_of_threads     Number of threads running the task
+ */
+typedef void (*Fusion_Task_t)(void *arg, int thread, int no_of_threads);
+
+struct Fusion_Thread_Pool;
+
+/**
+ * @brief Worker thread of a pool
+ */
+typedef struct Fusion_Worker
+{
+    pthread_t thread;
+    /**< The thread */
+
+    struct Fusion_Thread_Pool *pool;
+    /**< Pool the thread belongs to */
+
+    int index;
+    /**< Index of the thread in the pool (from 1) */
+} Fusion_Worker_t;
+
+/**
+ * @brief Threads that tasks are run on, kept from one epoch to the next
+ *
+ * @details The calling thread runs its share of each task too, so a pool of
+ * no_of_threads threads has no_of_threads - 1 workers. A pool that is all
+ * zeros (or was given one thread) has none, and runs every task on the
+ * calling thread. Only one thread may run tasks on a pool.
+ */
+typedef struct Fusion_Thread_Pool
+{
+    int no_of_threads;
+    /**< Number of threads a task is run on, the calling thread included */
+
+    Fusion_Worker_t *workers;
+    /**< Worker threads (no_of_threads - 1) */
+
+    pthread_mutex_t lock;
+    /**< Protects every field below */
+
+    pthread_cond_t start;
+    /**< Signalled when a task is started or the pool is stopped */
+
+    pthread_cond_t done;
+    /**< Signalled when the last worker finishes a task */
+
+    Fusion_Task_t task;
+    /**< Task being run */
+
+    void *arg;
+    /**< Argument of the task being run */
+
+    unsigned long generation;
+    /**< Number of tasks started so far */
+
+    int running;
+    /**< Number of workers still running the current task */
+
+    Boolean stopping;
+    /**< Set when the workers are to exit */
+} Fusion_Thread_Pool_t;
+
+/**
+ * @brief Starts a pool of threads
+ *
+ * @param[out] *pool            Pointer to the pool to start
+ * @param[in]  no_of_threads    Number of threads (1 to FUSION_MAX_THREADS),
+ *                              the calling thread included
+ *
+ * @return TRUE if every thread was started, otherwise FALSE (and the pool
+ * is left with no workers).
+ */
+Boolean fusion_thread_pool_init(Fusion_Thread_Pool_t *pool,
+                                int no_of_threads);
+
+/**
+ * @brief Stops the threads of a pool
+ *
+ * @param[in,out] *pool Pointer to the pool to stop
+ */
+void fusion_thread_pool_free(Fusion_Thread_Pool_t *pool);
+
+/**
+ * @brief Runs a task on every thread of a pool
+ *
+ * @param[in] *pool     Pointer to the pool
+ * @param[in] task      Task to run
+ * @param[in] *arg      Argument passed to every thread
+ *
+ * @details The calling thread runs the share of thread 0, and the call
+ * returns once every thread has finished, so whatever the task wrote is
+ * then visible to the caller.
+ */
+void fusion_thread_pool_run(Fusion_Thread_Pool_t    *pool,
+                            Fusion_Task_t           task,
+                            void                    *arg);
+
+/**
+ * @brief Share of count items given to one thread
+ *
+ * @param[in]  count            Number of items
+ * @param[in]  thread           Index of the thread
+ * @param[in]  no_of_threads    Number of threads
+ * @param[out] *first           First item of the thread
+ * @param[out] *last            One past the last item of the thread
+ *
+ * @details The items are split into contiguous ranges whose sizes differ by
+ * at most one.
+ */
+void fusion_thread_share(int count, int thread, int no_of_threads,
+                         int *first, int *last);
+
+#endif
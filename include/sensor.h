@@ -13,6 +13,12 @@
 
 #include "linked_list.h"
 #include "calculate_fusion.h"
+#include "sensor_registry.h"
+#include "sensor_limits.h"
+#include "checkpoint.h"
+#include "snapshot.h"
+#include "fusion_memo.h"
+#include "fusion_float.h"
 
 /**
  * Invalid value to specify that an error should be written into the final
@@ -25,51 +31,224 @@
  */
 #define INVALID_CONTRIBUTION_RATES  -9998
 
+/**
+ * @brief Parameters of a fusion run, as given on the command line
+ */
+typedef struct Fusion_Parameters
+{
+    Boolean use_high_range;
+    /**< Whether or not the user has specified a high sensor limit */
+
+    float high_range;
+    /**< The high limit the user has specified */
+
+    Boolean use_low_range;
+    /**< Whether or not the user has specified a low sensor limit */
+
+    float low_range;
+    /**< The low limit the user has specified */
+
+    Boolean use_stuck;
+    /**< Whether or not the user has specified a stuck limit */
+
+    int stuck_range;
+    /**< The stuck interval (in minutes) the user has specified */
+
+    Boolean use_flat_line;
+    /**< Whether or not the user has specified a flat-line limit */
+
+    int flat_line_repeats;
+    /**< Number of identical readings in a row after which a sensor is stuck */
+
+    int q_support_value;
+    /**< The q_support (percent), used as part of the fusion algorithm */
+
+    int principal_component_ratio;
+    /**< The ratio (percent) used to decide how many principal components are
+     * used */
+
+    int checkpoint_interval;
+    /**< Number of epochs between two checkpoints */
+
+    Support_Degree_Mode_t support_degree_mode;
+    /**< How the support degree matrix is built */
+
+    Eigen_Solver_t eigen_solver;
+    /**< How the eigensystem of the support degree matrix is solved */
+
+    Eigen_Backend_t eigen_backend;
+    /**< Library the eigensystem is solved with */
+
+    double approximation_accuracy;
+    /**< Target of the error estimate of EIGEN_SOLVER_RANDOMIZED */
+
+    Boolean use_fusion_memo;
+    /**< Whether the results of recent epochs are remembered and reused */
+
+    Fusion_Precision_t precision;
+    /**< Precision the fusion algorithm is computed in */
+
+    int no_of_threads;
+    /**< Number of threads a large epoch is shared between (1 or less for
+     * none) */
+
+    int parallel_threshold;
+    /**< Smallest number of valid sensors an epoch is shared between the
+     * threads for */
+} Fusion_Parameters_t;
+
+/**
+ * @brief Contiguous copies of the valid list used by classify_sensor_ranges()
+ *
+ * @details Kept between epochs, and only grown when the valid list does.
+ */
+typedef struct Range_Batch
+{
+    Node_t **nodes;
+    /**< Node of each reading */
+
+    float *values;
+    /**< Value of each reading */
+
+    float *low;
+    /**< Low limit of each reading */
+
+    float *high;
+    /**< High limit of each reading */
+
+    unsigned char *oor;
+    /**< Set for each reading that is out of range */
+
+    int capacity;
+    /**< Number of readings the arrays can hold */
+} Range_Batch_t;
+
+/**
+ * @brief State of one fusion stream
+ *
+ * @details Owns everything a stream needs: its sensor lists, registry, range
+ * limits, parameters, workspaces and the report file it writes to. Nothing
+ * is shared between engines, so independent streams can be fused in one
+ * process, each on its own thread.
+ */
+typedef struct Fusion_Engine
+{
+    Node_t *sensor_lists[MAX_SENSOR_LISTS];
+    /**< Head pointers of the Valid, Out of Range and Stuck lists */
+
+    Sensor_Registry_t registry;
+    /**< Every sensor seen so far, with its limits and running statistics */
+
+    Boolean restore_pending;
+    /**< Set while the sensors of the registry file that have not reported
+     * yet still have to be put back into the sensor lists */
+
+    Sensor_Limits_Table_t limits;
+    /**< Range limits that sensors are resolved against when first seen */
+
+    Fusion_Parameters_t parameters;
+    /**< Parameters of the run */
+
+    Range_Batch_t range_batch;
+    /**< Workspace of classify_sensor_ranges() */
+
+    Fusion_Workspace_t fusion_workspace;
+    /**< Workspace of do_sensor_fusion_algorithm() */
+
+    Support_Degree_Cache_t sd_cache;
+    /**< Support degree matrix of the previous epoch (used by
+     * SUPPORT_DEGREE_INCREMENTAL) */
+
+    Eigen_Warm_Start_t warm_start;
+    /**< Eigenvectors of the previous epoch (used by EIGEN_SOLVER_WARM) */
+
+    Fusion_Memo_t memo;
+    /**< Results of recent epochs (used if parameters.use_fusion_memo) */
+
+    double largest_approximation_error;
+    /**< Largest error estimate of the epochs fused so far (used by
+     * EIGEN_SOLVER_RANDOMIZED) */
+
+    Fusion_Workspace_Float_t float_workspace;
+    /**< Workspace of the float fusion algorithm (used by
+     * FUSION_PRECISION_FLOAT and FUSION_PRECISION_VALIDATE) */
+
+    Float_Divergence_t float_divergence;
+    /**< How far float fusion strayed from double fusion (used by
+     * FUSION_PRECISION_VALIDATE) */
+
+    Fusion_Thread_Pool_t thread_pool;
+    /**< Threads the steps of a large epoch are shared between (used if
+     * parameters.no_of_threads is above 1) */
+
+    char *out_file_name;
+    /**< Report file the fused output of each epoch is appended to */
+
+    pid_t checkpoint_pid;
+    /**< Process writing a background checkpoint (0 if there is none) */
+
+    Fusion_Snapshot_t *snapshot;
+    /**< Snapshot published after every epoch (NULL if none is wanted) */
+} Fusion_Engine_t;
+
+/**
+ * @brief Initializes a fusion engine
+ *
+ * @param[out] *engine          Pointer to the engine to initialize
+ * @param[in]  *parameters      Parameters of the run (copied)
+ * @param[in]  *out_file_name   Pointer to the filename of the report file,
+ *                              which must outlive the engine.
+ *
+ * @details The engine starts with empty sensor lists and registry, and with
+ * the global limits from *parameters.
+ */
+void engine_init(Fusion_Engine_t        *engine,
+                 Fusion_Parameters_t    *parameters,
+                 char                   *out_file_name);
+
+/**
+ * @brief Releases everything held by a fusion engine
+ *
+ * @param[in,out] *engine   Pointer to the engine to free
+ *
+ * @details The registry file (if there is one) is flushed for the next run.
+ */
+void engine_free(Fusion_Engine_t *engine);
+
 /**
  * @brief Starts the sensor fusion algorithm by parsing the CSV
  *
- * @param[in] *in_file_name                 Pointer to the filename of the file
- *                                          that contains the data to run the
- *                                          sensor fusion algorithm on.
- * @param[in] *out_file_name                Pointer to the filename of the file
- *                                          that will contain the output data
- *                                          from the sensor fusion algorithm.
- * @param[in] high_range                    The high limit the user has
- *                                          specified.
- * @param[in] use_high_range                Whether or not the user has
- *                                          specified a high sensor limit.
- * @param[in] low_range                     The low limit the user has
- *                                          specified
- * @param[in] use_low_range                 Whether or not the user has
- *                                          specified a low sensor limit.
- * @param[in] stuck_range                   The stuck interval the user has
- *                                          specified.
- * @param[in] use_stuck                     Whether or not the user has
- *                                          specified a stuck limit.
- * @param[in] q_support_value               The value of the q_support, used as
- *                                          part of the sensor fusion algorithm.
- * @param[in] principal_component_ratio     The ratio that is used to determine
- *                                          how many principal components will
- *                                          be used.
+ * @param[in,out] *engine               Pointer to the engine to run
+ * @param[in] *in_file_name             Pointer to the filename of the file
+ *                                      that contains the data to run the
+ *                                      sensor fusion algorithm on.
+ * @param[in] *limits_file_name         Pointer to the filename of the
+ *                                      per-sensor limits file (NULL if
+ *                                      only the global limits are used).
+ * @param[in] *registry_file_name       Pointer to the filename of the
+ *                                      persistent sensor registry (NULL
+ *                                      to start from an empty registry).
+ * @param[in] *checkpoint_file_name     Pointer to the filename of the
+ *                                      checkpoint file (NULL to not take
+ *                                      checkpoints). If it exists, the
+ *                                      run resumes from it.
  *
  * @details Starts off the sensor algorithm by reading in the values from the
- * CSV file specified by *in_file_name.
+ * CSV file specified by *in_file_name. The fused output of each epoch is
+ * written to the engine's report file, and published to the engine's
+ * snapshot if it has one.
  */
-void run_main_sensor_algorithm(char     *in_file_name,
-                               char     *out_file_name,
-                               float    high_range,
-                               Boolean  use_high_range,
-                               float    low_range,
-                               Boolean  use_low_range,
-                               float    stuck_range,
-                               Boolean  use_stuck,
-                               int      q_support_value,
-                               int      principal_component_ratio);
+void run_main_sensor_algorithm(Fusion_Engine_t  *engine,
+                               char             *in_file_name,
+                               char             *limits_file_name,
+                               char             *registry_file_name,
+                               char             *checkpoint_file_name);
 
 
 /**
  * @brief Updates sensors in linked lists
  *
+ * @param[in,out] *engine      Pointer to the engine
  * @param[in] time_in_minutes  Time in minutes, read from the input file
  * @param[in] *sensor_name     Sensor name, read from the input file
  * @param[in] sensor_value     Sensor value, read from the input file
@@ -80,20 +259,81 @@ void run_main_sensor_algorithm(char     *in_file_name,
  *                             sensor limit.
  * @param[in] low_range        The limit the user has specified
  *
- * @details Updates the Valid and Out of Range sensor lists.
+ * @details Updates the Valid and Out of Range sensor lists, and registers the
+ * sensor if it has not been seen before.
  */
-void update_sensor_lists(int    time_in_minutes,
-                         char   *sensor_name,
-                         float  sensor_value,
-                         int    use_high_range,
-                         int    high_range,
-                         int    use_low_range,
-                         int    low_range);
+void update_sensor_lists(Fusion_Engine_t    *engine,
+                         int                time_in_minutes,
+                         char               *sensor_name,
+                         float              sensor_value,
+                         int                use_high_range,
+                         float              high_range,
+                         int                use_low_range,
+                         float              low_range);
+
+
+/**
+ * @brief Opens the persistent sensor registry
+ *
+ * @param[in,out] *engine           Pointer to the engine
+ * @param[in] *registry_file_name   Pointer to the filename of the registry.
+ *
+ * @details Maps the registry file left by the previous run (or creates it).
+ * No work is done per sensor here: sensors that report are listed as usual,
+ * and the ones that have not reported by the end of the first epoch are put
+ * back into the list they were in, with their last time and value, when
+ * that epoch is processed. The run continues where the last one stopped
+ * instead of re-learning the fleet from the input.
+ *
+ * @return TRUE if the registry was opened, otherwise FALSE.
+ */
+Boolean open_sensor_registry(Fusion_Engine_t *engine,
+                             char            *registry_file_name);
+
+
+/**
+ * @brief Loads the range limits used by classify_sensor_ranges()
+ *
+ * @param[in,out] *engine        Pointer to the engine
+ * @param[in] *limits_file_name  Pointer to the filename of the per-sensor
+ *                               limits file (NULL if there is none).
+ * @param[in] use_high_range     Whether or not the user has specified a high
+ *                               sensor limit.
+ * @param[in] high_range         The global high limit.
+ * @param[in] use_low_range      Whether or not the user has specified a low
+ *                               sensor limit.
+ * @param[in] low_range          The global low limit.
+ *
+ * @details The global limits apply to every sensor that has no entry in the
+ * limits file. Sensors that are already registered are re-resolved.
+ *
+ * @return TRUE if the limits were loaded, otherwise FALSE.
+ */
+Boolean load_sensor_limits(Fusion_Engine_t  *engine,
+                           char             *limits_file_name,
+                           Boolean          use_high_range,
+                           float            high_range,
+                           Boolean          use_low_range,
+                           float            low_range);
+
+
+/**
+ * @brief Moves out of range sensors into the out of range list
+ *
+ * @param[in,out] *engine   Pointer to the engine
+ *
+ * @details Run once an epoch is complete. Gathers the valid list into
+ * contiguous arrays of values and per-sensor limits, classifies all of them
+ * in a single pass, then moves the out of range readings into the out of
+ * range sensor list.
+ */
+void classify_sensor_ranges(Fusion_Engine_t *engine);
 
 
 /**
  * @brief Search all lists for a node with a name of *str
  *
+ * @param[in]   *engine     Pointer to the engine
  * @param[in]   *str        Sensor name to search for
  * @param[out]  *list_index Index of the chain that str was found in.
  *
@@ -103,12 +343,13 @@ void update_sensor_lists(int    time_in_minutes,
  *
  * @return Pointer to the matching node, if no node is found, returns NULL.
  */
-Node_t* search_all_chains(char *str, int *list_index);
+Node_t* search_all_chains(Fusion_Engine_t *engine, char *str, int *list_index);
 
 
 /**
  * @brief Moves sensors into stuck list if needed
  *
+ * @param[in,out] *engine   Pointer to the engine
  * @param[in] current_time  The current time with respect to where the parser
  *                          is within the input.csv file.
  * @param[in] stuck_value   User specified limit for determining stuck sensors.
@@ -118,75 +359,72 @@ Node_t* search_all_chains(char *str, int *list_index);
  * stuck_value.If so, will move that node from its current list into the stuck
  * sensor list.
  */
-void determine_if_sensors_are_stuck(int current_time, int stuck_value);
+void determine_if_sensors_are_stuck(Fusion_Engine_t *engine,
+                                    int             current_time,
+                                    int             stuck_value);
+
+
+/**
+ * @brief Moves flat-lined sensors into stuck list
+ *
+ * @param[in,out] *engine       Pointer to the engine
+ * @param[in] flat_line_repeats User specified number of identical readings
+ *                              in a row after which a sensor is stuck.
+ *
+ * @details A sensor that keeps reporting exactly the same value is as stuck
+ * as one that stops reporting. Iterates through the valid sensor list and
+ * the out of range sensor list, and moves every sensor whose running repeat
+ * count (kept in the sensor registry) has reached flat_line_repeats into the
+ * stuck sensor list.
+ */
+void determine_if_sensors_are_flat_lined(Fusion_Engine_t *engine,
+                                         int             flat_line_repeats);
 
 
 /**
  * @brief Display contents of all nodes
  *
+ * @param[in] *engine   Pointer to the engine
+ *
  * @details A compact dump of all the nodes contained within all the linked
  * lists.
  */
-void dump_current_lists(void);
+void dump_current_lists(Fusion_Engine_t *engine);
 
 
 /**
  * @brief Writes output file
  *
- * @param[in] *file_name                    Pointer to the filename of the file
- *                                          that will contain the output data
- *                                          from the sensor fusion algorithm.
- * @param[in] use_high_range                Whether or not the user has
- *                                          specified a high sensor limit.
- * @param[in] high_range                    The high limit the user has
- *                                          specified.
- * @param[in] use_low_range                 Whether or not the user has
- *                                          specified a low sensor limit.
- * @param[in] low_range                     The low limit the user has specified
- * @param[in] use_stuck                     Whether or not the user has
- *                                          specified a stuck limit.
- * @param[in] stuck_range                   The stuck interval the user has
- *                                          specified.
+ * @param[in] *engine                       Pointer to the engine, whose
+ *                                          parameters are reported and whose
+ *                                          report file is appended to.
  *`@param[in] current_time                  The time within the CSV the parser
  *                                          is currently looking at.
- * @param[in] q_support_value               The value of the q_support, used as
- *                                          part of the sensor fusion algorithm.
  * @param[in] fused_sensor_value            The final fused sensor value
  *                                          returned by the sensor fusion
  *                                          algorithm.
- * @param[in] principal_component_ratio     The ratio that is used to determine
- *                                          how many principal components will
- *                                          be used.
  *
  * @details Writes the final sensor fusion report to file.
  */
-void write_output_file(char     *file_name,
-                       int      use_high_range,
-                       float    high_range,
-                       int      use_low_range,
-                       float    low_range,
-                       int      use_stuck,
-                       int      stuck_range,
-                       int      current_time,
-                       int      q_support_value,
-                       int      principal_component_ratio,
-                       float    fused_sensor_value);
+void write_output_file(Fusion_Engine_t  *engine,
+                       int              current_time,
+                       float            fused_sensor_value);
 
 
 /**
  * @brief Starts the sensor fusion algorithm
  *
- * @param[in] q_support_value               The value of the q_support, used as
- *                                          part of the sensor fusion algorithm.
- * @param[in] principal_component_ratio     The ratio that is used to determine
- *                                          how many principal components will
- *                                          be used.
+ * @param[in] *engine   Pointer to the engine, whose valid list is fused with
+ *                      its q_support and principal component ratio.
  *
- * @details Entry point to the Fused Sensor Algorithm
+ * @details Entry point to the Fused Sensor Algorithm. With
+ * FUSION_PRECISION_FLOAT the algorithm is run in float; with
+ * FUSION_PRECISION_VALIDATE the double result is returned, and the float
+ * result of the same epoch is recorded against it in the engine's
+ * float_divergence.
  *
  * @return The fused sensor value after, the algorithm has been run.
  */
-double do_sensor_fusion_algorithm(int q_support_value,
-                                  int principal_component_ratio);
+double do_sensor_fusion_algorithm(Fusion_Engine_t *engine);
 
 #endif
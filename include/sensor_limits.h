@@ -0,0 +1,118 @@
+/**
+ * @file sensor_limits.h
+ *
+ * @brief Per-sensor range limits loaded from a limits file. Allows a mixed
+ * fleet of sensor types to each be checked against their own valid range.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef SENSOR_LIMITS_H
+#define SENSOR_LIMITS_H
+
+#include "parsing_csv_file.h"
+
+/**
+ * @brief Character that marks a limits entry as a sensor name prefix.
+ */
+#define LIMITS_PREFIX_WILDCARD  '*'
+
+/**
+ * @brief A single entry of the limits file
+ */
+typedef struct Sensor_Limit
+{
+    char pattern[MAX_SENSOR_NAME_SIZE];
+    /**< Sensor name, or sensor name prefix (without the wildcard) */
+
+    int pattern_length;
+    /**< Length of the pattern */
+
+    Boolean is_prefix;
+    /**< Whether the pattern matches every sensor name it is a prefix of */
+
+    float low_range;
+    /**< Lower limit (-FLT_MAX if the entry has no lower limit) */
+
+    float high_range;
+    /**< Upper limit (FLT_MAX if the entry has no upper limit) */
+} Sensor_Limit_t;
+
+/**
+ * @brief Table of range limits
+ *
+ * @details Sensors not matched by any entry use the default limits, which are
+ * the global -l/-u values.
+ */
+typedef struct Sensor_Limits_Table
+{
+    Sensor_Limit_t *limits;
+    /**< Array of entries read from the limits file */
+
+    int no_of_limits;
+    /**< Number of entries */
+
+    float default_low_range;
+    /**< Lower limit used by sensors with no entry */
+
+    float default_high_range;
+    /**< Upper limit used by sensors with no entry */
+} Sensor_Limits_Table_t;
+
+/**
+ * @brief Initializes a limits table with the global limits
+ *
+ * @param[out] *table           Pointer to the table to initialize
+ * @param[in]  use_high_range   Whether the user has specified a high limit
+ * @param[in]  high_range       The high limit the user has specified
+ * @param[in]  use_low_range    Whether the user has specified a low limit
+ * @param[in]  low_range        The low limit the user has specified
+ */
+void limits_init(Sensor_Limits_Table_t *table,
+                 Boolean               use_high_range,
+                 float                 high_range,
+                 Boolean               use_low_range,
+                 float                 low_range);
+
+/**
+ * @brief Loads a limits file into a limits table
+ *
+ * @param[in,out] *table        Pointer to the table to load into
+ * @param[in]     *file_name    Pointer to the file name of the limits file
+ *
+ * @details The limits file is a CSV with a header line followed by lines of
+ * the form "name,low,high". A name ending in '*' is a prefix which matches
+ * every sensor whose name starts with it. An empty low or high field means
+ * that side of the range is not checked.
+ *
+ * @return TRUE if the file was loaded, otherwise FALSE.
+ */
+Boolean limits_load_file(Sensor_Limits_Table_t *table, char *file_name);
+
+/**
+ * @brief Releases the memory held by a limits table
+ *
+ * @param[in,out] *table    Pointer to the table to free
+ */
+void limits_free(Sensor_Limits_Table_t *table);
+
+/**
+ * @brief Finds the range limits that apply to a sensor
+ *
+ * @param[in]  *table       Pointer to the limits table
+ * @param[in]  *sensor_name Name of the sensor
+ * @param[out] *low_range   Lower limit of the sensor
+ * @param[out] *high_range  Upper limit of the sensor
+ *
+ * @details An exact name match takes precedence over a prefix match, and
+ * the longest matching prefix wins. If nothing matches, the default limits
+ * are used.
+ */
+void limits_resolve(Sensor_Limits_Table_t *table,
+                    char                  *sensor_name,
+                    float                 *low_range,
+                    float                 *high_range);
+
+#endif
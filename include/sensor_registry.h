@@ -0,0 +1,275 @@
+/**
+ * @file sensor_registry.h
+ *
+ * @brief Registry of every sensor seen in the input, indexed by sensor ID.
+ * Maps a sensor name to a small integer ID so that per-sensor data can be
+ * stored in flat arrays instead of being searched for by name.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <stdint.h>
+#include "parsing_csv_file.h"
+
+/**
+ * @brief Number of sensors the registry can hold before it has to grow.
+ */
+#define REGISTRY_INITIAL_CAPACITY   64
+
+/**
+ * @brief Marks an unused slot in the registry hash table.
+ */
+#define REGISTRY_EMPTY_SLOT         -1
+
+/**
+ * @brief Identifies a sensor registry file.
+ */
+#define REGISTRY_FILE_MAGIC         "SFREGSTR"
+
+/**
+ * @brief Version of the registry file layout. Must be bumped whenever
+ * Registry_Header_t or Sensor_Record_t change.
+ */
+#define REGISTRY_FILE_VERSION       4
+
+/**
+ * @brief Size reserved for the header at the start of the registry storage.
+ */
+#define REGISTRY_HEADER_SIZE        64
+
+/**
+ * @brief Per-sensor record stored in the registry
+ */
+typedef struct Sensor_Record
+{
+    char sensor_name[MAX_SENSOR_NAME_SIZE];
+    /**< Name of the sensor */
+
+    float low_range;
+    /**< Value below which the sensor is out of range (-FLT_MAX if none) */
+
+    float high_range;
+    /**< Value above which the sensor is out of range (FLT_MAX if none) */
+
+    int no_of_readings;
+    /**< Number of readings reported by the sensor */
+
+    double mean;
+    /**< Running mean of the readings (Welford) */
+
+    double m2;
+    /**< Running sum of squared differences from the mean (Welford) */
+
+    float last_value;
+    /**< Most recent reading */
+
+    int last_change_time;
+    /**< Time (in minutes) at which the reading last changed value */
+
+    int repeat_count;
+    /**< Number of consecutive readings identical to the one before */
+
+    int last_time;
+    /**< Time (in minutes) of the most recent reading */
+
+    int status;
+    /**< Sensor list the sensor is currently in (eg: VALID_SENSOR_LIST) */
+} Sensor_Record_t;
+
+/**
+ * @brief Header at the start of the registry storage
+ *
+ * @details The storage is laid out as the header, followed by capacity
+ * records, followed by a hash table of 2 * capacity sensor IDs. When the
+ * registry is backed by a file, this is exactly the file contents.
+ */
+typedef struct Registry_Header
+{
+    char magic[8];
+    /**< REGISTRY_FILE_MAGIC (not NUL terminated) */
+
+    uint32_t version;
+    /**< REGISTRY_FILE_VERSION of the program that created the storage */
+
+    uint32_t record_size;
+    /**< sizeof(Sensor_Record_t) of the program that created the storage */
+
+    int32_t capacity;
+    /**< Number of records allocated */
+
+    int32_t no_of_sensors;
+    /**< Number of sensors registered */
+
+    int32_t latest_time;
+    /**< Time (in minutes) of the most recent reading of any sensor (-1 if
+     * none) */
+} Registry_Header_t;
+
+/**
+ * @brief Registry of all known sensors
+ *
+ * @details Sensor IDs are handed out in the order sensors are first seen, and
+ * are the index of the sensor's record in *records. The hash table is an
+ * open-addressed table of sensor IDs, keyed by the sensor name. Both live in
+ * one contiguous block of storage, which is either heap memory or a memory
+ * mapped registry file.
+ */
+typedef struct Sensor_Registry
+{
+    Registry_Header_t *header;
+    /**< Start of the registry storage */
+
+    Sensor_Record_t *records;
+    /**< Array of sensor records, indexed by sensor ID */
+
+    int no_of_sensors;
+    /**< Number of sensors currently registered */
+
+    int capacity;
+    /**< Number of records allocated */
+
+    int *hash_table;
+    /**< Open-addressed table of sensor IDs (REGISTRY_EMPTY_SLOT if unused) */
+
+    int hash_mask;
+    /**< Size of the hash table minus one (size is a power of two) */
+
+    Boolean is_mapped;
+    /**< Whether the storage is a memory mapped registry file */
+
+    int fd;
+    /**< File descriptor of the registry file (if is_mapped) */
+
+    size_t storage_size;
+    /**< Size of the storage in bytes */
+
+    int resume_time;
+    /**< Time of the most recent reading in the registry file when it was
+     * opened. Readings up to it are the previous run being replayed, and are
+     * only recorded for sensors that had not seen them (-1 once past it) */
+} Sensor_Registry_t;
+
+/**
+ * @brief Initializes an empty registry
+ *
+ * @param[out] *registry    Pointer to the registry to initialize
+ *
+ * @details Allocates the record array and hash table with
+ * REGISTRY_INITIAL_CAPACITY entries.
+ *
+ * @return TRUE if the registry was initialized, otherwise FALSE.
+ */
+Boolean registry_init(Sensor_Registry_t *registry);
+
+/**
+ * @brief Opens a registry backed by a memory mapped file
+ *
+ * @param[out] *registry    Pointer to the registry to open
+ * @param[in]  *file_name   Pointer to the file name of the registry file
+ *
+ * @details If the file holds a registry written by a previous run with the
+ * same layout version, it is mapped and used as is: no record is read or
+ * rehashed, so opening takes the same time whatever the number of sensors.
+ * Otherwise (new file, or different version) the file is reset to an empty
+ * registry. Every change to the registry is written straight to the file.
+ * When the same input is read again, readings of a sensor up to the last one
+ * the file holds for it are not recorded twice.
+ *
+ * @return TRUE if the registry was opened, otherwise FALSE.
+ */
+Boolean registry_open_file(Sensor_Registry_t *registry, char *file_name);
+
+/**
+ * @brief Releases all memory held by a registry
+ *
+ * @param[in,out] *registry Pointer to the registry to free
+ *
+ * @details A file backed registry is flushed and unmapped; the file is left
+ * in place for the next run.
+ */
+void registry_free(Sensor_Registry_t *registry);
+
+/**
+ * @brief Removes every sensor from a registry
+ *
+ * @param[in,out] *registry Pointer to the registry to clear
+ *
+ * @details The storage is kept (and stays file backed if it was).
+ */
+void registry_clear(Sensor_Registry_t *registry);
+
+/**
+ * @brief Looks up the ID of a sensor
+ *
+ * @param[in] *registry     Pointer to the registry
+ * @param[in] *sensor_name  Name of the sensor to look up
+ *
+ * @return The sensor ID, or -1 if the sensor has not been registered.
+ */
+int registry_lookup_sensor(Sensor_Registry_t *registry, char *sensor_name);
+
+/**
+ * @brief Registers a sensor
+ *
+ * @param[in,out] *registry     Pointer to the registry
+ * @param[in]     *sensor_name  Name of the sensor to register
+ * @param[out]    *is_new       Set to TRUE if the sensor was not previously
+ *                              registered (may be NULL)
+ *
+ * @details Returns the ID of the sensor, adding a new record (with no range
+ * limits) if the sensor has not been seen before. The registry grows as
+ * needed.
+ *
+ * @return The sensor ID, or -1 if the registry could not grow.
+ */
+int registry_register_sensor(Sensor_Registry_t *registry,
+                             char              *sensor_name,
+                             Boolean           *is_new);
+
+/**
+ * @brief Updates the running statistics of a sensor with a new reading
+ *
+ * @param[in,out] *registry         Pointer to the registry
+ * @param[in]     id                ID of the sensor that reported
+ * @param[in]     time_in_minutes   Time of the reading
+ * @param[in]     sensor_value      Value of the reading
+ *
+ * @details Updates the mean and variance with Welford's method, and tracks
+ * when the value last changed and how many times in a row it has repeated.
+ * This is O(1) per reading; no history is kept.
+ */
+void registry_record_reading(Sensor_Registry_t *registry,
+                             int               id,
+                             int               time_in_minutes,
+                             float             sensor_value);
+
+/**
+ * @brief Sample variance of the readings of a sensor
+ *
+ * @param[in] *record   Pointer to the sensor record
+ *
+ * @return The sample variance, or 0 if fewer than two readings were seen.
+ */
+double registry_variance(Sensor_Record_t *record);
+
+/**
+ * @brief Writes the reading statistics of every sensor to a file
+ *
+ * @param[in] *registry     Pointer to the registry
+ * @param[in] *file_name    File to write (replaced if it exists)
+ *
+ * @details One line per sensor, in sensor ID order, of the form
+ * name,readings,mean,variance. With a registry file, the statistics cover
+ * every run that used the file.
+ *
+ * @return TRUE if the file was written, otherwise FALSE.
+ */
+Boolean registry_write_statistics(Sensor_Registry_t *registry,
+                                  char              *file_name);
+
+#endif
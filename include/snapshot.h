@@ -0,0 +1,193 @@
+/**
+ * @file snapshot.h
+ *
+ * @brief Snapshots of the live sensor state, published by the fusion engine
+ * after every epoch and served to other processes over a local query socket.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <pthread.h>
+#include "linked_list.h"
+
+/**
+ * @brief Largest request line accepted by the query server.
+ */
+#define SNAPSHOT_MAX_REQUEST_SIZE   (MAX_SENSOR_NAME_SIZE + 16)
+
+/**
+ * @brief A sensor as seen in a snapshot
+ */
+typedef struct Snapshot_Sensor
+{
+    char sensor_name[MAX_SENSOR_NAME_SIZE];
+    /**< Name of the sensor */
+
+    float sensor_value;
+    /**< Last reading of the sensor */
+
+    int time_in_minutes;
+    /**< Time of the last reading */
+
+    int status;
+    /**< Sensor list the sensor is in (eg: VALID_SENSOR_LIST) */
+} Snapshot_Sensor_t;
+
+/**
+ * @brief Buffer of sensors a snapshot was published into
+ *
+ * @details Buffers are never freed while readers may still be copying from
+ * them; a buffer that is outgrown is kept on a retired list until the
+ * snapshot is freed.
+ */
+typedef struct Snapshot_Buffer
+{
+    Snapshot_Sensor_t *sensors;
+    /**< Array of sensors */
+
+    int capacity;
+    /**< Number of sensors the array can hold */
+
+    struct Snapshot_Buffer *retired;
+    /**< Next outgrown buffer (only used on the retired list) */
+} Snapshot_Buffer_t;
+
+/**
+ * @brief Latest published state of a fusion engine
+ *
+ * @details Published with a sequence lock: the writer makes the sequence
+ * odd, updates the fields, then makes it even again. Readers copy the fields
+ * and retry if the sequence was odd or changed while they copied. The
+ * writer never waits for readers, so queries add no latency to fusion.
+ */
+typedef struct Fusion_Snapshot
+{
+    unsigned int sequence;
+    /**< Sequence lock (odd while a snapshot is being published) */
+
+    int epoch_time;
+    /**< Time (in minutes) of the epoch the snapshot was taken after */
+
+    double fused_value;
+    /**< Fused output of that epoch */
+
+    int no_of_sensors;
+    /**< Number of sensors in the snapshot */
+
+    Snapshot_Buffer_t *buffer;
+    /**< Buffer holding the sensors */
+
+    Snapshot_Buffer_t *retired;
+    /**< Outgrown buffers that readers may still be looking at */
+} Fusion_Snapshot_t;
+
+/**
+ * @brief Query server answering requests from a snapshot
+ */
+typedef struct Snapshot_Server
+{
+    Fusion_Snapshot_t *snapshot;
+    /**< Snapshot the requests are answered from */
+
+    int listen_fd;
+    /**< Listening Unix domain socket */
+
+    int stop_fd[2];
+    /**< Pipe used to wake the server thread when it is stopped */
+
+    pthread_t thread;
+    /**< Server thread */
+
+    char socket_path[MAX_FILE_NAME_SIZE];
+    /**< Path of the socket, removed when the server stops */
+
+    Fusion_Snapshot_t copy;
+    /**< Copy of the snapshot the current request is answered from */
+} Snapshot_Server_t;
+
+/**
+ * @brief Initializes an empty snapshot
+ *
+ * @param[out] *snapshot    Pointer to the snapshot to initialize
+ *
+ * @details Until the first publish, the snapshot has no sensors and a fused
+ * value of INVALID_SENSOR_FUSION_VALUE.
+ */
+void snapshot_init(Fusion_Snapshot_t *snapshot);
+
+/**
+ * @brief Releases all memory held by a snapshot
+ *
+ * @param[in,out] *snapshot Pointer to the snapshot to free
+ *
+ * @details Must only be called once no reader is left.
+ */
+void snapshot_free(Fusion_Snapshot_t *snapshot);
+
+/**
+ * @brief Publishes the state of the sensor lists
+ *
+ * @param[in,out] *snapshot     Pointer to the snapshot
+ * @param[in]     **sensor_lists Head pointers of the MAX_SENSOR_LISTS lists
+ * @param[in]     epoch_time    Time (in minutes) of the epoch just fused
+ * @param[in]     fused_value   Fused output of that epoch
+ *
+ * @details Only one thread may publish to a snapshot.
+ *
+ * @return TRUE if the snapshot was published, FALSE if memory ran out (the
+ * previous snapshot is left in place).
+ */
+Boolean snapshot_publish(Fusion_Snapshot_t  *snapshot,
+                         Node_t             **sensor_lists,
+                         int                epoch_time,
+                         double             fused_value);
+
+/**
+ * @brief Takes a consistent copy of a snapshot
+ *
+ * @param[in]     *snapshot Pointer to the snapshot being published
+ * @param[in,out] *copy     Pointer to the copy, initialized by
+ *                          snapshot_init(). Its buffer grows as needed.
+ *
+ * @details Never blocks the publisher; retries if a publish happened while
+ * copying.
+ *
+ * @return TRUE if the copy was taken, FALSE if memory ran out.
+ */
+Boolean snapshot_read(Fusion_Snapshot_t *snapshot, Fusion_Snapshot_t *copy);
+
+/**
+ * @brief Starts a query server on a Unix domain socket
+ *
+ * @param[out] *server       Pointer to the server to start
+ * @param[in]  *snapshot     Pointer to the snapshot to answer from
+ * @param[in]  *socket_path  Path of the socket to listen on
+ *
+ * @details Each connection sends one request line and gets the answer back
+ * before the connection is closed:
+ *  - "FUSED" : "<time> <fused value>"
+ *  - "SENSOR <name>" : "<name> <status> <value> <time>", or "UNKNOWN <name>"
+ *  - "LIST" : one "<name> <status> <value> <time>" line per sensor,
+ *    followed by "END"
+ *
+ * Times are given as HHMM, and statuses as Valid, OOR or Stuck.
+ *
+ * @return TRUE if the server was started, otherwise FALSE.
+ */
+Boolean snapshot_server_start(Snapshot_Server_t *server,
+                              Fusion_Snapshot_t *snapshot,
+                              char              *socket_path);
+
+/**
+ * @brief Stops a query server and removes its socket
+ *
+ * @param[in,out] *server   Pointer to the server to stop
+ */
+void snapshot_server_stop(Snapshot_Server_t *server);
+
+#endif
@@ -0,0 +1,218 @@
+/**
+ * @file symmetric_eigen_template.h
+ *
+ * @brief Householder tridiagonalization and implicit QL, the eigensolver that
+ * needs no library, written once for any floating point type.
+ *
+ * @details Not a normal header: a source file defines EIGEN_REAL (the type),
+ * EIGEN_EPSILON (its machine epsilon), EIGEN_MATH(name) (the libm function
+ * for the type, eg: name##f for float) and EIGEN_NAME(name) (the name of each
+ * function for the type), then includes this file to get static
+ * householder_tridiagonalize() and implicit_ql() functions for that type.
+ * The macros are undefined at the end, so it can be included again for
+ * another type.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#if !defined(EIGEN_REAL) || !defined(EIGEN_EPSILON) || \
+    !defined(EIGEN_MATH) || !defined(EIGEN_NAME)
+#error "Define EIGEN_REAL, EIGEN_EPSILON, EIGEN_MATH and EIGEN_NAME first"
+#endif
+
+#ifndef BUILTIN_QL_MAX_ITERATIONS
+/*
+ * Most QL iterations spent on one eigenvalue (LAPACK allows 30).
+ */
+#define BUILTIN_QL_MAX_ITERATIONS 30
+#endif
+
+/*
+ * Reduces the symmetric matrix v (row-major, leading dimension ld) to
+ * tridiagonal form by Householder reflections, leaving the diagonal in d,
+ * the subdiagonal in e[1..n-1] and the accumulated transformation in v
+ * (tred2 of EISPACK, as in JAMA).
+ */
+static void EIGEN_NAME(householder_tridiagonalize)(EIGEN_REAL *v, int n,
+    int ld, EIGEN_REAL *d, EIGEN_REAL *e) {
+#define V(i, j) v[(size_t)(i) * ld + (j)]
+    for (int j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+    }
+
+    for (int i = n - 1; i > 0; i--) {
+        EIGEN_REAL scale = 0, h = 0;
+        for (int k = 0; k < i; k++) {
+            scale += EIGEN_MATH(fabs)(d[k]);
+        }
+        if (scale == 0) {
+            e[i] = d[i - 1];
+            for (int j = 0; j < i; j++) {
+                d[j] = V(i - 1, j);
+                V(i, j) = 0;
+                V(j, i) = 0;
+            }
+        } else {
+            for (int k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            EIGEN_REAL f = d[i - 1];
+            EIGEN_REAL g = EIGEN_MATH(sqrt)(h);
+            if (f > 0) {
+                g = -g;
+            }
+            e[i] = scale * g;
+            h = h - f * g;
+            d[i - 1] = f - g;
+            for (int j = 0; j < i; j++) {
+                e[j] = 0;
+            }
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                V(j, i) = f;
+                g = e[j] + V(j, j) * f;
+                for (int k = j + 1; k <= i - 1; k++) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0;
+            for (int j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            EIGEN_REAL hh = f / (h + h);
+            for (int j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (int k = j; k <= i - 1; k++) {
+                    V(k, j) -= (f * e[k] + g * d[k]);
+                }
+                d[j] = V(i - 1, j);
+                V(i, j) = 0;
+            }
+        }
+        d[i] = h;
+    }
+
+    for (int i = 0; i < n - 1; i++) {
+        V(n - 1, i) = V(i, i);
+        V(i, i) = 1;
+        EIGEN_REAL h = d[i + 1];
+        if (h != 0) {
+            for (int k = 0; k <= i; k++) {
+                d[k] = V(k, i + 1) / h;
+            }
+            for (int j = 0; j <= i; j++) {
+                EIGEN_REAL g = 0;
+                for (int k = 0; k <= i; k++) {
+                    g += V(k, i + 1) * V(k, j);
+                }
+                for (int k = 0; k <= i; k++) {
+                    V(k, j) -= g * d[k];
+                }
+            }
+        }
+        for (int k = 0; k <= i; k++) {
+            V(k, i + 1) = 0;
+        }
+    }
+    for (int j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+        V(n - 1, j) = 0;
+    }
+    V(n - 1, n - 1) = 1;
+    e[0] = 0;
+#undef V
+}
+
+/*
+ * Diagonalizes the tridiagonal matrix (d, e) by the implicit QL method
+ * (tql2 of EISPACK, as in JAMA), leaving the eigenvalues in d. Each rotation
+ * is applied to the first no_of_columns columns of the rows of vt, the
+ * transposed transformation of householder_tridiagonalize(), so that row i
+ * ends up the eigenvector of d[i] (or as much of it as is kept). Returns
+ * FALSE if an eigenvalue does not converge.
+ */
+static Boolean EIGEN_NAME(implicit_ql)(EIGEN_REAL *vt, int n, int ld,
+    int no_of_columns, EIGEN_REAL *d, EIGEN_REAL *e) {
+    for (int i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0;
+
+    EIGEN_REAL f = 0, tst1 = 0;
+    for (int l = 0; l < n; l++) {
+        tst1 = EIGEN_MATH(fmax)(tst1,
+            EIGEN_MATH(fabs)(d[l]) + EIGEN_MATH(fabs)(e[l]));
+        int m = l;
+        while (m < n - 1 && EIGEN_MATH(fabs)(e[m]) > EIGEN_EPSILON * tst1) {
+            m++;
+        }
+
+        int iterations = 0;
+        while (m > l && EIGEN_MATH(fabs)(e[l]) > EIGEN_EPSILON * tst1) {
+            if (++iterations > BUILTIN_QL_MAX_ITERATIONS) {
+                return FALSE;
+            }
+
+            EIGEN_REAL g = d[l];
+            EIGEN_REAL p = (d[l + 1] - g) / (2 * e[l]);
+            EIGEN_REAL r = EIGEN_MATH(hypot)(p, 1);
+            if (p < 0) {
+                r = -r;
+            }
+            d[l] = e[l] / (p + r);
+            d[l + 1] = e[l] * (p + r);
+            EIGEN_REAL dl1 = d[l + 1];
+            EIGEN_REAL h = g - d[l];
+            for (int i = l + 2; i < n; i++) {
+                d[i] -= h;
+            }
+            f += h;
+
+            p = d[m];
+            EIGEN_REAL c = 1, c2 = 1, c3 = 1, s = 0, s2 = 0;
+            EIGEN_REAL el1 = e[l + 1];
+            for (int i = m - 1; i >= l; i--) {
+                c3 = c2;
+                c2 = c;
+                s2 = s;
+                g = c * e[i];
+                h = c * p;
+                r = EIGEN_MATH(hypot)(p, e[i]);
+                e[i + 1] = s * r;
+                s = e[i] / r;
+                c = p / r;
+                p = c * d[i] - s * g;
+                d[i + 1] = h + s * (c * g + s * d[i]);
+
+                EIGEN_REAL *row = vt + (size_t)i * ld;
+                EIGEN_REAL *next = row + ld;
+                for (int k = 0; k < no_of_columns; k++) {
+                    h = next[k];
+                    next[k] = s * row[k] + c * h;
+                    row[k] = c * row[k] - s * h;
+                }
+            }
+            p = -s * s2 * c3 * el1 * e[l] / dl1;
+            e[l] = s * p;
+            d[l] = c * p;
+        }
+        d[l] = d[l] + f;
+        e[l] = 0;
+    }
+    return TRUE;
+}
+
+#undef EIGEN_REAL
+#undef EIGEN_EPSILON
+#undef EIGEN_MATH
+#undef EIGEN_NAME
@@ -9,126 +9,2678 @@
  */
 
 #include <stdio.h>
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_GSL
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_eigen.h>
+#endif
 #include "calculate_fusion.h"
+#include "exp_kernel.h"
+
+/*
+ * Capacity of a workspace the first time it is sized.
+ */
+#define FUSION_WORKSPACE_MIN_CAPACITY 16
+
+/*
+ * Number of doubles in one FUSION_MATRIX_ALIGNMENT sized block.
+ */
+#define DOUBLES_PER_ALIGNMENT ((int)(FUSION_MATRIX_ALIGNMENT / sizeof(double)))
+
+/*
+ * Largest span of values sharing one shift in the separable support degree,
+ * which keeps every factor within exp(+-512).
+ */
+#define SEPARABLE_BLOCK_SPAN 512.0
+
+/*
+ * Differences beyond which exp(-difference) is 0 in double precision.
+ */
+#define SEPARABLE_UNDERFLOW 746.0
+
+/*
+ * Flags of the slots of a support degree cache.
+ */
+#define CACHE_SLOT_PRESENT 1
+#define CACHE_SLOT_DIRTY 2
+
+/*
+ * Magnitude below which a component of an eigenvector is too small to fix its
+ * sign.
+ */
+#define EIGENVECTOR_SIGN_EPSILON 1e-12
+
+/*
+ * Fleets smaller than this solve the full eigensystem, which is as quick as
+ * the Lanczos method there.
+ */
+#define LANCZOS_MIN_SENSORS 32
+
+/*
+ * Norm of a new Lanczos vector, relative to the number of sensors, below
+ * which the Krylov subspace is invariant.
+ */
+#define LANCZOS_BREAKDOWN 1e-14
+
+/*
+ * Most Lanczos steps a cold start takes before the full eigensystem is
+ * solved instead, and the steps it may always take (up to half the fleet).
+ */
+#define LANCZOS_MAX_STEPS 64
+#define LANCZOS_MIN_STEPS 16
+
+/*
+ * Lanczos steps between two convergence tests.
+ */
+#define LANCZOS_CHECK_INTERVAL 2
+
+/*
+ * Most Lanczos steps a warm start may take before the epoch starts cold.
+ */
+#define WARM_START_MAX_STEPS 8
+
+/*
+ * Weight of the cold starting vector mixed into a warm one.
+ */
+#define WARM_START_COLD_WEIGHT 1e-4
+
+/*
+ * Random vectors the randomized eigensolver starts with, and the most it
+ * grows to.
+ */
+#define RANDOMIZED_MIN_BLOCK 8
+#define RANDOMIZED_MAX_BLOCK 32
+
+/*
+ * Times the random block is multiplied by the support degree matrix before
+ * the Ritz pairs are taken, sharpening the leading directions.
+ */
+#define RANDOMIZED_POWER_ITERATIONS 2
+
+/*
+ * Fraction of its length a vector must keep once orthogonalized against the
+ * block to add a direction to it.
+ */
+#define RANDOMIZED_RANK_TOLERANCE 1e-10
+
+/*
+ * Most sweeps of the Jacobi backend. Once the off-diagonal is small each
+ * sweep about squares it, so a handful is usual.
+ */
+#define JACOBI_MAX_SWEEPS 50
+
+/*
+ * Rows of a triangular loop handed to each thread in turn, so that the long
+ * and the short rows are spread over the threads.
+ */
+#define PARALLEL_ROW_BLOCK 16
+
+/*
+ * Partial sum of each thread, a cache line apart.
+ */
+#define PARTIAL(partial, thread) (partial)[(thread) * DOUBLES_PER_ALIGNMENT]
+
+double *fusion_matrix_alloc(size_t no_of_doubles) {
+    void *matrix = NULL;
+
+    if (no_of_doubles == 0) {
+        no_of_doubles = 1;
+    }
+    if (posix_memalign(&matrix, FUSION_MATRIX_ALIGNMENT,
+            no_of_doubles * sizeof(double)) != 0) {
+        return NULL;
+    }
+    return (double *)matrix;
+}
+
+int fusion_matrix_leading_dimension(int no_of_columns) {
+    return (no_of_columns + DOUBLES_PER_ALIGNMENT - 1) /
+        DOUBLES_PER_ALIGNMENT * DOUBLES_PER_ALIGNMENT;
+}
+
+void fusion_workspace_init(Fusion_Workspace_t *workspace) {
+    memset(workspace, 0, sizeof(Fusion_Workspace_t));
+}
+
+void fusion_workspace_free(Fusion_Workspace_t *workspace) {
+#ifdef HAVE_GSL
+    if (workspace->symmv) {
+        for (int i = 0; i <= workspace->capacity; i++) {
+            if (workspace->symmv[i]) {
+                gsl_eigen_symmv_free(workspace->symmv[i]);
+            }
+        }
+    }
+    free(workspace->symmv);
+#endif
+    free(workspace->sensor_array);
+    free(workspace->sd_matrix);
+    free(workspace->eigen_matrix);
+    free(workspace->eval);
+    free(workspace->evec);
+    free(workspace->eigen_value);
+    free(workspace->eigen_vector);
+    free(workspace->contribution_rate);
+    free(workspace->integrated_support);
+    free(workspace->weight_coefficient);
+    free(workspace->sorted_sensors);
+    free(workspace->sensor_block);
+    free(workspace->factor_up);
+    free(workspace->factor_down);
+    free(workspace->factor_next);
+    free(workspace->factor_second);
+    free(workspace->support_decay);
+    free(workspace->sensor_id);
+    free(workspace->sensor_row);
+    free(workspace->krylov_basis);
+    free(workspace->lanczos_alpha);
+    free(workspace->lanczos_beta);
+    free(workspace->eigen_scratch);
+    free(workspace->eigen_index_scratch);
+
+    long no_of_allocations = workspace->no_of_allocations;
+    fusion_workspace_init(workspace);
+    workspace->no_of_allocations = no_of_allocations;
+}
+
+/*
+ * Allocates an aligned part of a workspace, counting the allocation.
+ */
+static double *workspace_alloc(Fusion_Workspace_t *workspace,
+    size_t no_of_doubles) {
+    workspace->no_of_allocations++;
+    return fusion_matrix_alloc(no_of_doubles);
+}
+
+/*
+ * Grows the workspace so that it can hold no_of_sensors sensors, with full
+ * matrices or only the rows of the matrix free eigensolver.
+ */
+static Boolean reserve_workspace(Fusion_Workspace_t *workspace,
+    int no_of_sensors, Boolean matrix_free) {
+    if (no_of_sensors <= workspace->capacity &&
+        matrix_free == workspace->matrix_free) {
+        return TRUE;
+    }
+
+    int capacity = (workspace->capacity &&
+        matrix_free == workspace->matrix_free) ? workspace->capacity :
+        FUSION_WORKSPACE_MIN_CAPACITY;
+    while (capacity < no_of_sensors) {
+        capacity *= 2;
+    }
+
+    size_t n = capacity;
+#ifdef HAVE_GSL
+    /*
+    * The GSL eigen workspaces are per size, so the ones already made stay
+    * valid; only the table holding them grows.
+    */
+    workspace->no_of_allocations++;
+    gsl_eigen_symmv_workspace **symmv = (gsl_eigen_symmv_workspace **)
+        malloc((n + 1) * sizeof(*symmv));
+    if (symmv == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return FALSE;
+    }
+    for (int i = 0; i <= capacity; i++) {
+        symmv[i] = (workspace->symmv && i <= workspace->capacity) ?
+            workspace->symmv[i] : NULL;
+    }
+    for (int i = capacity + 1; workspace->symmv && i <= workspace->capacity;
+        i++) {
+        if (workspace->symmv[i]) {
+            gsl_eigen_symmv_free(workspace->symmv[i]);
+        }
+    }
+    free(workspace->symmv);
+    workspace->symmv = NULL;
+#endif
+
+    long no_of_allocations = workspace->no_of_allocations;
+    Eigen_Backend_t eigen_backend = workspace->eigen_backend;
+    Fusion_Thread_Pool_t *thread_pool = workspace->thread_pool;
+    int parallel_threshold = workspace->parallel_threshold;
+    fusion_workspace_free(workspace);
+    workspace->no_of_allocations = no_of_allocations;
+    workspace->eigen_backend = eigen_backend;
+    workspace->thread_pool = thread_pool;
+    workspace->parallel_threshold = parallel_threshold;
+#ifdef HAVE_GSL
+    workspace->symmv = symmv;
+#endif
+    workspace->capacity = capacity;
+    workspace->matrix_free = matrix_free;
+
+    /*
+    * Matrices are sized for the widest leading dimension they will be used
+    * with, which is that of capacity sensors. Without a support degree
+    * matrix, none needs more rows than the Krylov basis.
+    */
+    size_t rows = matrix_free ? MATRIX_FREE_MAX_STEPS + 1 : n;
+    size_t matrix_size = rows * fusion_matrix_leading_dimension(capacity);
+    workspace->sensor_array = workspace_alloc(workspace, n);
+    if (!matrix_free) {
+        workspace->sd_matrix = workspace_alloc(workspace, matrix_size);
+    }
+    workspace->eigen_matrix = workspace_alloc(workspace, matrix_size);
+    workspace->eval = workspace_alloc(workspace, n);
+    workspace->evec = workspace_alloc(workspace, matrix_size);
+    workspace->eigen_value = workspace_alloc(workspace, n);
+    workspace->eigen_vector = workspace_alloc(workspace, matrix_size);
+    workspace->contribution_rate = workspace_alloc(workspace, n);
+    workspace->integrated_support = workspace_alloc(workspace, n);
+    workspace->weight_coefficient = workspace_alloc(workspace, n);
+    workspace->no_of_allocations++;
+    workspace->sorted_sensors = (Sorted_Sensor_t *)malloc(n *
+        sizeof(Sorted_Sensor_t));
+    workspace->no_of_allocations++;
+    workspace->sensor_block = (int *)malloc(n * sizeof(int));
+    workspace->factor_up = workspace_alloc(workspace, n);
+    workspace->factor_down = workspace_alloc(workspace, n);
+    workspace->factor_next = workspace_alloc(workspace, n);
+    workspace->factor_second = workspace_alloc(workspace, n);
+    workspace->support_decay = workspace_alloc(workspace, n);
+    workspace->no_of_allocations++;
+    workspace->sensor_id = (int *)malloc(n * sizeof(int));
+    workspace->no_of_allocations++;
+    workspace->sensor_row = (int *)malloc(n * sizeof(int));
+    workspace->krylov_basis = workspace_alloc(workspace,
+        (matrix_free ? rows : n / 2 + 1) *
+        fusion_matrix_leading_dimension(capacity));
+    workspace->lanczos_alpha = workspace_alloc(workspace, n);
+    workspace->lanczos_beta = workspace_alloc(workspace, n);
+    workspace->eigen_scratch = workspace_alloc(workspace,
+        EIGEN_SCRATCH_PER_SENSOR * n);
+    workspace->no_of_allocations++;
+    workspace->eigen_index_scratch = (int *)malloc(
+        EIGEN_INDEX_SCRATCH_PER_SENSOR * n * sizeof(int));
+    if (workspace->sensor_array == NULL ||
+        (workspace->sd_matrix == NULL && !matrix_free) ||
+        workspace->eigen_matrix == NULL || workspace->eval == NULL ||
+        workspace->evec == NULL || workspace->eigen_value == NULL ||
+        workspace->eigen_vector == NULL ||
+        workspace->contribution_rate == NULL ||
+        workspace->integrated_support == NULL ||
+        workspace->weight_coefficient == NULL ||
+        workspace->sorted_sensors == NULL ||
+        workspace->sensor_block == NULL || workspace->factor_up == NULL ||
+        workspace->factor_down == NULL || workspace->factor_next == NULL ||
+        workspace->factor_second == NULL ||
+        workspace->support_decay == NULL ||
+        workspace->sensor_id == NULL || workspace->sensor_row == NULL ||
+        workspace->krylov_basis == NULL ||
+        workspace->lanczos_alpha == NULL ||
+        workspace->lanczos_beta == NULL ||
+        workspace->eigen_scratch == NULL ||
+        workspace->eigen_index_scratch == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        fusion_workspace_free(workspace);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+Boolean fusion_workspace_prepare(Fusion_Workspace_t *workspace,
+    int no_of_sensors) {
+    if (workspace == NULL || no_of_sensors <= 0) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+
+    if (!reserve_workspace(workspace, no_of_sensors, FALSE)) {
+        return FALSE;
+    }
+
+    workspace->leading_dimension =
+        fusion_matrix_leading_dimension(no_of_sensors);
+    return TRUE;
+}
+
+Boolean fusion_workspace_prepare_matrix_free(Fusion_Workspace_t *workspace,
+    int no_of_sensors) {
+    if (workspace == NULL || no_of_sensors <= 0) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+
+    if (!reserve_workspace(workspace, no_of_sensors, TRUE)) {
+        return FALSE;
+    }
+
+    workspace->leading_dimension =
+        fusion_matrix_leading_dimension(no_of_sensors);
+    return TRUE;
+}
+
+int calculate_support_degree_matrix_into(Node_t *node, int no_of_sensors,
+    double *sensor_array, double *sd_matrix, int sd_ld) {
+    if (node == NULL || no_of_sensors <= 0 || sensor_array == NULL ||
+        sd_matrix == NULL || sd_ld < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int i = 0;
+    /*
+    * Sensor array value obtained from Node list
+    */
+    while (node != NULL && i < no_of_sensors) {
+        sensor_array[i] = node->sensor_value;
+        node = node->next;
+        i++;
+    }
+
+    /*
+    * d_ij = exp(-|x_i - x_j|) is symmetric with a unit diagonal, so exp is
+    * only evaluated above the diagonal, a row at a time by the vector kernel,
+    * and mirrored below it.
+    */
+    for (int i = 0; i < no_of_sensors; i++) {
+        double *row = sd_matrix + (size_t)i * sd_ld;
+        row[i] = 1;
+        exp_kernel_row(sensor_array[i], sensor_array + i + 1,
+            no_of_sensors - i - 1, row + i + 1);
+        for (int j = i + 1; j < no_of_sensors; j++) {
+            sd_matrix[(size_t)j * sd_ld + i] = row[j];
+        }
+    }
+    return 0;
+}
 
 double *calculate_support_degree_matrix(Node_t *node, int no_of_sensors,
     double *sensor_array) {
     if (node == NULL || no_of_sensors <= 0 || sensor_array == NULL) {
         printf("%s: Incorrect Input\n", __func__);
-        return NULL;
+        return NULL;
+    }
+    double *sd_matrix = fusion_matrix_alloc((size_t)no_of_sensors *
+        no_of_sensors);
+    if (sd_matrix == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return NULL;
+    }
+
+    calculate_support_degree_matrix_into(node, no_of_sensors, sensor_array,
+        sd_matrix, no_of_sensors);
+    return sd_matrix;
+}
+
+Boolean fusion_workspace_parallel(Fusion_Workspace_t *workspace,
+    int no_of_sensors) {
+    return (workspace != NULL && workspace->thread_pool != NULL &&
+            workspace->thread_pool->no_of_threads > 1 &&
+            no_of_sensors >= workspace->parallel_threshold) ? TRUE : FALSE;
+}
+
+/*
+ * Support degree matrix shared between threads.
+ */
+typedef struct Parallel_Support_Degree
+{
+    double *sensor_array;
+    int no_of_sensors;
+    double *sd_matrix;
+    int sd_ld;
+} Parallel_Support_Degree_t;
+
+/*
+ * Rows of a thread above the diagonal.
+ */
+static void support_degree_upper_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Support_Degree_t *task = (Parallel_Support_Degree_t *)arg;
+    int n = task->no_of_sensors;
+
+    for (int first = thread * PARALLEL_ROW_BLOCK; first < n;
+        first += no_of_threads * PARALLEL_ROW_BLOCK) {
+        int last = (first + PARALLEL_ROW_BLOCK < n) ?
+            first + PARALLEL_ROW_BLOCK : n;
+        for (int i = first; i < last; i++) {
+            double *row = task->sd_matrix + (size_t)i * task->sd_ld;
+            row[i] = 1;
+            exp_kernel_row(task->sensor_array[i], task->sensor_array + i + 1,
+                n - i - 1, row + i + 1);
+        }
+    }
+}
+
+/*
+ * Rows of a thread below the diagonal, mirrored from above it.
+ */
+static void support_degree_lower_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Support_Degree_t *task = (Parallel_Support_Degree_t *)arg;
+    int n = task->no_of_sensors;
+
+    for (int first = thread * PARALLEL_ROW_BLOCK; first < n;
+        first += no_of_threads * PARALLEL_ROW_BLOCK) {
+        int last = (first + PARALLEL_ROW_BLOCK < n) ?
+            first + PARALLEL_ROW_BLOCK : n;
+        for (int j = first; j < last; j++) {
+            double *row = task->sd_matrix + (size_t)j * task->sd_ld;
+            for (int i = 0; i < j; i++) {
+                row[i] = task->sd_matrix[(size_t)i * task->sd_ld + j];
+            }
+        }
+    }
+}
+
+int calculate_support_degree_matrix_parallel_into(Fusion_Workspace_t *workspace,
+    Node_t *node, int no_of_sensors, double *sensor_array, double *sd_matrix,
+    int sd_ld) {
+    if (workspace == NULL || node == NULL || no_of_sensors <= 0 ||
+        sensor_array == NULL || sd_matrix == NULL || sd_ld < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    if (!fusion_workspace_parallel(workspace, no_of_sensors)) {
+        return calculate_support_degree_matrix_into(node, no_of_sensors,
+            sensor_array, sd_matrix, sd_ld);
+    }
+    Parallel_Support_Degree_t task = {sensor_array, no_of_sensors, sd_matrix,
+                                      sd_ld};
+
+    for (int i = 0; i < no_of_sensors && node != NULL; i++) {
+        sensor_array[i] = node->sensor_value;
+        node = node->next;
+    }
+    fusion_thread_pool_run(workspace->thread_pool, support_degree_upper_task,
+        &task);
+    fusion_thread_pool_run(workspace->thread_pool, support_degree_lower_task,
+        &task);
+    return 0;
+}
+
+void support_degree_cache_init(Support_Degree_Cache_t *cache) {
+    memset(cache, 0, sizeof(Support_Degree_Cache_t));
+}
+
+void support_degree_cache_free(Support_Degree_Cache_t *cache) {
+    free(cache->matrix);
+    free(cache->slot_sensor_id);
+    free(cache->slot_value);
+    free(cache->slot_state);
+    free(cache->slot_of_sensor_id);
+
+    long no_of_rows_computed = cache->no_of_rows_computed;
+    long no_of_rebuilds = cache->no_of_rebuilds;
+    support_degree_cache_init(cache);
+    cache->no_of_rows_computed = no_of_rows_computed;
+    cache->no_of_rebuilds = no_of_rebuilds;
+}
+
+/*
+ * Empties the cache, keeping its buffers.
+ */
+static void clear_support_degree_cache(Support_Degree_Cache_t *cache) {
+    for (int slot = 0; slot < cache->no_of_slots; slot++) {
+        cache->slot_of_sensor_id[cache->slot_sensor_id[slot]] = -1;
+    }
+    cache->no_of_slots = 0;
+}
+
+/*
+ * Grows the cache so that it holds no_of_sensors slots and the sensor IDs up
+ * to max_id. Growing the slots empties the cache.
+ */
+static Boolean reserve_support_degree_cache(Support_Degree_Cache_t *cache,
+    int no_of_sensors, int max_id) {
+    if (max_id >= cache->id_capacity) {
+        int id_capacity = cache->id_capacity ? cache->id_capacity :
+            FUSION_WORKSPACE_MIN_CAPACITY;
+        while (id_capacity <= max_id) {
+            id_capacity *= 2;
+        }
+        int *slot_of_sensor_id = (int *)realloc(cache->slot_of_sensor_id,
+            id_capacity * sizeof(int));
+        if (slot_of_sensor_id == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            return FALSE;
+        }
+        for (int id = cache->id_capacity; id < id_capacity; id++) {
+            slot_of_sensor_id[id] = -1;
+        }
+        cache->slot_of_sensor_id = slot_of_sensor_id;
+        cache->id_capacity = id_capacity;
+    }
+
+    if (no_of_sensors <= cache->capacity) {
+        return TRUE;
+    }
+    int capacity = cache->capacity ? cache->capacity :
+        FUSION_WORKSPACE_MIN_CAPACITY;
+    while (capacity < no_of_sensors) {
+        capacity *= 2;
+    }
+    clear_support_degree_cache(cache);
+    free(cache->matrix);
+    free(cache->slot_sensor_id);
+    free(cache->slot_value);
+    free(cache->slot_state);
+
+    size_t n = capacity;
+    cache->leading_dimension = fusion_matrix_leading_dimension(capacity);
+    cache->matrix = fusion_matrix_alloc(n * cache->leading_dimension);
+    cache->slot_sensor_id = (int *)malloc(n * sizeof(int));
+    cache->slot_value = (double *)malloc(n * sizeof(double));
+    cache->slot_state = (unsigned char *)malloc(n);
+    cache->capacity = capacity;
+    if (cache->matrix == NULL || cache->slot_sensor_id == NULL ||
+        cache->slot_value == NULL || cache->slot_state == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        support_degree_cache_free(cache);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Frees a slot whose sensor has left, by moving the last slot (its row and
+ * column) into it.
+ */
+static void remove_cache_slot(Support_Degree_Cache_t *cache, int slot) {
+    int last = cache->no_of_slots - 1;
+    int ld = cache->leading_dimension;
+    double *matrix = cache->matrix;
+
+    cache->slot_of_sensor_id[cache->slot_sensor_id[slot]] = -1;
+    if (slot != last) {
+        memcpy(matrix + (size_t)slot * ld, matrix + (size_t)last * ld,
+            sizeof(double) * (last + 1));
+        for (int row = 0; row < last; row++) {
+            matrix[(size_t)row * ld + slot] = matrix[(size_t)row * ld + last];
+        }
+        cache->slot_sensor_id[slot] = cache->slot_sensor_id[last];
+        cache->slot_value[slot] = cache->slot_value[last];
+        cache->slot_state[slot] = cache->slot_state[last];
+        cache->slot_of_sensor_id[cache->slot_sensor_id[slot]] = slot;
+    }
+    cache->no_of_slots--;
+}
+
+/*
+ * Computes the support degree matrix of an epoch the cache can't hold into
+ * sd_matrix, in the order of the list.
+ */
+static int uncached_support_degree_matrix(Node_t *node, int no_of_sensors,
+    double *sensor_array, int *sensor_row, double *sd_matrix, int sd_ld,
+    double **solve_matrix, int *solve_ld) {
+    for (int i = 0; i < no_of_sensors; i++) {
+        sensor_row[i] = i;
+    }
+    *solve_matrix = sd_matrix;
+    *solve_ld = sd_ld;
+    return calculate_support_degree_matrix_into(node, no_of_sensors,
+        sensor_array, sd_matrix, sd_ld);
+}
+
+int calculate_support_degree_matrix_cached_into(Support_Degree_Cache_t *cache,
+    Node_t *node, int no_of_sensors, int *sensor_id, double *sensor_array,
+    int *sensor_row, double *sd_matrix, int sd_ld, double **solve_matrix,
+    int *solve_ld) {
+    if (cache == NULL || node == NULL || no_of_sensors <= 0 ||
+        sensor_id == NULL || sensor_array == NULL || sensor_row == NULL ||
+        sd_matrix == NULL || sd_ld < no_of_sensors || solve_matrix == NULL ||
+        solve_ld == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    int max_id = -1;
+    Boolean is_cacheable = TRUE;
+
+    for (int i = 0; i < n; i++) {
+        max_id = (sensor_id[i] > max_id) ? sensor_id[i] : max_id;
+        is_cacheable = is_cacheable && (sensor_id[i] >= 0);
+    }
+    if (!is_cacheable || !reserve_support_degree_cache(cache, n, max_id)) {
+        if (cache->matrix != NULL) {
+            clear_support_degree_cache(cache);
+        }
+        return uncached_support_degree_matrix(node, n, sensor_array,
+            sensor_row, sd_matrix, sd_ld, solve_matrix, solve_ld);
+    }
+
+    int i = 0;
+    for (Node_t *valid = node; valid != NULL && i < n; valid = valid->next) {
+        sensor_array[i++] = valid->sensor_value;
+    }
+
+    /*
+    * Find the slot of every sensor, marking the slots whose value changed.
+    * A sensor ID listed twice can't be cached, so the cache starts over.
+    */
+    for (int slot = 0; slot < cache->no_of_slots; slot++) {
+        cache->slot_state[slot] = 0;
+    }
+    for (i = 0; i < n; i++) {
+        int slot = cache->slot_of_sensor_id[sensor_id[i]];
+        if (slot < 0) {
+            continue;
+        }
+        if (cache->slot_state[slot] & CACHE_SLOT_PRESENT) {
+            clear_support_degree_cache(cache);
+            return uncached_support_degree_matrix(node, n, sensor_array,
+                sensor_row, sd_matrix, sd_ld, solve_matrix, solve_ld);
+        }
+        cache->slot_state[slot] = CACHE_SLOT_PRESENT;
+        if (cache->slot_value[slot] != sensor_array[i]) {
+            cache->slot_value[slot] = sensor_array[i];
+            cache->slot_state[slot] |= CACHE_SLOT_DIRTY;
+        }
+    }
+
+    /*
+    * Compact away the slots of sensors that left, then give the sensors that
+    * joined the slots at the end.
+    */
+    int slot = 0;
+    while (slot < cache->no_of_slots) {
+        if (cache->slot_state[slot] & CACHE_SLOT_PRESENT) {
+            slot++;
+        } else {
+            remove_cache_slot(cache, slot);
+        }
+    }
+    for (i = 0; i < n; i++) {
+        if (cache->slot_of_sensor_id[sensor_id[i]] < 0) {
+            slot = cache->no_of_slots++;
+            cache->slot_of_sensor_id[sensor_id[i]] = slot;
+            cache->slot_sensor_id[slot] = sensor_id[i];
+            cache->slot_value[slot] = sensor_array[i];
+            cache->slot_state[slot] = CACHE_SLOT_PRESENT | CACHE_SLOT_DIRTY;
+        }
+        sensor_row[i] = cache->slot_of_sensor_id[sensor_id[i]];
+    }
+
+    int no_of_dirty = 0;
+    for (slot = 0; slot < n; slot++) {
+        no_of_dirty += (cache->slot_state[slot] & CACHE_SLOT_DIRTY) ? 1 : 0;
+    }
+
+    /*
+    * Rows are computed as in calculate_support_degree_matrix_into(); the
+    * kernel only depends on |x_i - x_j|, so an entry is the same whichever
+    * of its two rows it was computed in.
+    */
+    int ld = cache->leading_dimension;
+    double *matrix = cache->matrix;
+    double dirty_entries = (double)no_of_dirty * (2.0 * n - no_of_dirty);
+    if (dirty_entries > 0.5 * n * n) {
+        for (slot = 0; slot < n; slot++) {
+            double *row = matrix + (size_t)slot * ld;
+            row[slot] = 1;
+            exp_kernel_row(cache->slot_value[slot],
+                cache->slot_value + slot + 1, n - slot - 1, row + slot + 1);
+            for (int j = slot + 1; j < n; j++) {
+                matrix[(size_t)j * ld + slot] = row[j];
+            }
+        }
+        cache->no_of_rows_computed += n;
+        cache->no_of_rebuilds++;
+    } else {
+        for (slot = 0; slot < n; slot++) {
+            if (!(cache->slot_state[slot] & CACHE_SLOT_DIRTY)) {
+                continue;
+            }
+            double *row = matrix + (size_t)slot * ld;
+            exp_kernel_row(cache->slot_value[slot], cache->slot_value, n,
+                row);
+            row[slot] = 1;
+            for (int j = 0; j < n; j++) {
+                matrix[(size_t)j * ld + slot] = row[j];
+            }
+        }
+        cache->no_of_rows_computed += no_of_dirty;
+    }
+
+    /*
+    * The matrix is solved in the order of the slots, so only the vectors
+    * are put in that order.
+    */
+    for (slot = 0; slot < n; slot++) {
+        sensor_array[slot] = cache->slot_value[slot];
+        sensor_id[slot] = cache->slot_sensor_id[slot];
+    }
+    *solve_matrix = matrix;
+    *solve_ld = ld;
+    return 0;
+}
+
+/*
+ * Orders sensors by value, and sensors of equal value by index.
+ */
+static int compare_sorted_sensors(const void *a, const void *b) {
+    const Sorted_Sensor_t *sensor_a = a;
+    const Sorted_Sensor_t *sensor_b = b;
+
+    if (sensor_a->value != sensor_b->value) {
+        return (sensor_a->value < sensor_b->value) ? -1 : 1;
+    }
+    return sensor_a->index - sensor_b->index;
+}
+
+/*
+ * Entry (i, j) of the separable support degree matrix, from the factors of
+ * calculate_support_degree_matrix_separable_into().
+ */
+static inline double separable_entry(Fusion_Workspace_t *workspace,
+    double *sensor_array, int i, int j) {
+    int a = i;
+    int b = j;
+
+    if (sensor_array[j] < sensor_array[i]) {
+        a = j;
+        b = i;
+    }
+
+    switch (workspace->sensor_block[b] - workspace->sensor_block[a]) {
+    case 0:
+        return workspace->factor_down[b] * workspace->factor_up[a];
+    case 1:
+        return workspace->factor_down[b] * workspace->factor_next[a];
+    case 2:
+        return workspace->factor_down[b] * workspace->factor_second[a];
+    default:
+        return 0;
+    }
+}
+
+int calculate_support_degree_matrix_separable_into(
+    Fusion_Workspace_t *workspace, Node_t *node, int no_of_sensors,
+    double *sensor_array, double *sd_matrix, int sd_ld) {
+    if (workspace == NULL || node == NULL || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity || sensor_array == NULL ||
+        sd_matrix == NULL || sd_ld < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    Sorted_Sensor_t *sorted = workspace->sorted_sensors;
+    int *block = workspace->sensor_block;
+    double *up = workspace->factor_up;
+    double *down = workspace->factor_down;
+    double *next = workspace->factor_next;
+    double *second = workspace->factor_second;
+    int n = 0;
+
+    while (node != NULL && n < no_of_sensors) {
+        sensor_array[n] = node->sensor_value;
+        sorted[n].value = node->sensor_value;
+        sorted[n].index = n;
+        next[n] = 0;
+        second[n] = 0;
+        node = node->next;
+        n++;
+    }
+    qsort(sorted, n, sizeof(Sorted_Sensor_t), compare_sorted_sensors);
+
+    /*
+    * The sorted values are cut into blocks, each shifted by its smallest
+    * value. Within a block, for x_a <= x_b,
+    * exp(-(x_b - x_a)) = down[b] * up[a], with down[b] = exp(-(x_b - shift))
+    * and up[a] = exp(x_a - shift). A sensor of an earlier block uses the
+    * shift of the later one instead: next[a] and second[a] are exp(x_a -
+    * shift) for the next two blocks, both <= 1. Blocks three or more apart
+    * are over 2 * SEPARABLE_BLOCK_SPAN apart, where exp underflows to 0. The
+    * values are sensor readings, which are floats, so every shifted
+    * difference is exact.
+    */
+    int no_of_blocks = 0;
+    int second_start = 0;
+    int previous_start = 0;
+    int start = 0;
+    while (start < n) {
+        double shift = sorted[start].value;
+        int end = start;
+        while (end < n && sorted[end].value - shift <= SEPARABLE_BLOCK_SPAN) {
+            int index = sorted[end].index;
+            block[index] = no_of_blocks;
+            down[index] = exp(-(sorted[end].value - shift));
+            up[index] = exp(sorted[end].value - shift);
+            end++;
+        }
+
+        for (int a = previous_start; a < start; a++) {
+            next[sorted[a].index] = exp(-(shift - sorted[a].value));
+        }
+        for (int a = second_start; a < previous_start; a++) {
+            second[sorted[a].index] = exp(-(shift - sorted[a].value));
+        }
+
+        no_of_blocks++;
+        second_start = previous_start;
+        previous_start = start;
+        start = end;
+    }
+
+    /*
+    * Rows are filled above the diagonal in sensor order and mirrored, like
+    * the exact matrix. With a single block (the usual case, all values
+    * within SEPARABLE_BLOCK_SPAN), each entry is one multiply.
+    */
+    for (int i = 0; i < n; i++) {
+        double *row = sd_matrix + (size_t)i * sd_ld;
+        row[i] = 1;
+        if (no_of_blocks == 1) {
+            double x = sensor_array[i];
+            double down_i = down[i];
+            double up_i = up[i];
+            for (int j = i + 1; j < n; j++) {
+                row[j] = (sensor_array[j] <= x) ? down_i * up[j] :
+                    down[j] * up_i;
+            }
+        } else {
+            for (int j = i + 1; j < n; j++) {
+                row[j] = separable_entry(workspace, sensor_array, i, j);
+            }
+        }
+        for (int j = i + 1; j < n; j++) {
+            sd_matrix[(size_t)j * sd_ld + i] = row[j];
+        }
+    }
+    return 0;
+}
+
+int calculate_support_degree_operator_into(Fusion_Workspace_t *workspace,
+    Node_t *node, int no_of_sensors, double *sensor_array) {
+    if (workspace == NULL || node == NULL || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity || sensor_array == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    Sorted_Sensor_t *sorted = workspace->sorted_sensors;
+    double *decay = workspace->support_decay;
+    int n = 0;
+
+    while (node != NULL && n < no_of_sensors) {
+        sensor_array[n] = node->sensor_value;
+        sorted[n].value = node->sensor_value;
+        sorted[n].index = n;
+        node = node->next;
+        n++;
+    }
+    if (n < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    qsort(sorted, n, sizeof(Sorted_Sensor_t), compare_sorted_sensors);
+
+    decay[0] = 0;
+    for (int k = 1; k < n; k++) {
+        decay[k] = exp(-(sorted[k].value - sorted[k - 1].value));
+    }
+    return 0;
+}
+
+int support_degree_operator_multiply(Fusion_Workspace_t *workspace,
+    int no_of_sensors, double *vector, double *product) {
+    if (workspace == NULL || vector == NULL || product == NULL ||
+        vector == product || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    Sorted_Sensor_t *sorted = workspace->sorted_sensors;
+    double *decay = workspace->support_decay;
+    int n = no_of_sensors;
+
+    /*
+    * The sum over the values at or below each one is left in product, and
+    * the sum over those at or above it added on the way back down; v_i is
+    * in both.
+    */
+    double sum = 0;
+    for (int k = 0; k < n; k++) {
+        int i = sorted[k].index;
+        sum = sum * decay[k] + vector[i];
+        product[i] = sum;
+    }
+    sum = 0;
+    for (int k = n - 1; k >= 0; k--) {
+        int i = sorted[k].index;
+        sum = (k + 1 < n) ? sum * decay[k + 1] + vector[i] : vector[i];
+        product[i] += sum - vector[i];
+    }
+    return 0;
+}
+
+/*
+ * Flips the sign of each of the no_of_vectors rows of eigen_vector whose
+ * first non-negligible component is negative, so that every solver returns
+ * the same eigenvectors.
+ */
+static void normalize_eigenvector_signs(double *eigen_vector, int ld,
+    int no_of_vectors, int no_of_sensors) {
+    for (int i = 0; i < no_of_vectors; i++) {
+        double *row = eigen_vector + (size_t)i * ld;
+        int k = 0;
+        while (k < no_of_sensors && fabs(row[k]) < EIGENVECTOR_SIGN_EPSILON) {
+            k++;
+        }
+        if (k < no_of_sensors && row[k] < 0) {
+            for (int j = 0; j < no_of_sensors; j++) {
+                row[j] = -row[j];
+            }
+        }
+    }
+}
+
+int normalize_eigenvector_signs_in_order(struct eigen_systems *eigen,
+    int no_of_eigenpairs, int no_of_sensors, int *sensor_row) {
+    if (eigen == NULL || eigen->eigen_vector == NULL ||
+        no_of_eigenpairs < 0 || no_of_sensors <= 0 ||
+        no_of_eigenpairs > no_of_sensors || sensor_row == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    for (int i = 0; i < no_of_eigenpairs; i++) {
+        double *row = eigen->eigen_vector + (size_t)i * eigen->leading_dimension;
+        int k = 0;
+        while (k < no_of_sensors &&
+               fabs(row[sensor_row[k]]) < EIGENVECTOR_SIGN_EPSILON) {
+            k++;
+        }
+        if (k < no_of_sensors && row[sensor_row[k]] < 0) {
+            for (int j = 0; j < no_of_sensors; j++) {
+                row[j] = -row[j];
+            }
+        }
+    }
+    return 0;
+}
+
+#ifdef HAVE_GSL
+/*
+ * Solves the eigensystem of matrix (which is destroyed) with GSL, and stores
+ * the eigenvalues in descending order along with their eigenvectors (one per
+ * row of eigen_vector). eval_data is scratch space of n doubles, evec_data of
+ * n rows; matrix, evec_data and eigen_vector all have leading dimension ld.
+ */
+static void solve_eigensystem(double *matrix, int no_of_sensors, int ld,
+    double *eval_data, double *evec_data, gsl_eigen_symmv_workspace *w,
+    double *eigen_value, double *eigen_vector) {
+    gsl_matrix_view m = gsl_matrix_view_array_with_tda(matrix, no_of_sensors,
+        no_of_sensors, ld);
+    gsl_vector_view eval = gsl_vector_view_array(eval_data, no_of_sensors);
+    gsl_matrix_view evec = gsl_matrix_view_array_with_tda(evec_data,
+        no_of_sensors, no_of_sensors, ld);
+
+    gsl_eigen_symmv(&m.matrix, &eval.vector, &evec.matrix, w);
+
+    gsl_eigen_symmv_sort(&eval.vector, &evec.matrix,
+                         GSL_EIGEN_SORT_VAL_DESC);
+
+    for (int i = 0; i < no_of_sensors; i++) {
+        eigen_value[i] = eval_data[i];
+    }
+
+    /*
+    * GSL returns the eigenvectors as columns; they are stored as rows so that
+    * the principal components read them contiguously.
+    */
+    for (int j = 0; j < no_of_sensors; j++) {
+        double *evec_row = evec_data + (size_t)j * ld;
+        for (int i = 0; i < no_of_sensors; i++) {
+            eigen_vector[(size_t)i * ld + j] = evec_row[i];
+        }
+    }
+    normalize_eigenvector_signs(eigen_vector, ld, no_of_sensors,
+        no_of_sensors);
+}
+
+#endif
+
+struct eigen_systems *calculate_eigensystem(double *sd_matrix,
+    int no_of_sensors) {
+    if (sd_matrix == NULL || no_of_sensors <= 0) {
+        printf("%s: Incorrect Input\n", __func__);
+        return NULL;
+    }
+    Fusion_Workspace_t workspace;
+    struct eigen_systems *eigen;
+    size_t matrix_size = (size_t)no_of_sensors * no_of_sensors;
+    eigen = (struct eigen_systems *)malloc(sizeof(struct eigen_systems));
+    if (eigen == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return NULL;
+    }
+    eigen->eigen_value = (double *)malloc(sizeof(double) * no_of_sensors);
+    eigen->eigen_vector = fusion_matrix_alloc(matrix_size);
+    eigen->leading_dimension = no_of_sensors;
+    if (eigen->eigen_vector == NULL || eigen->eigen_value == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return NULL;
+    }
+
+    /*
+    * Solved by the backend EIGEN_BACKEND_AUTO picks, in a workspace of its
+    * own, so that the result is the same as that of the workspace functions.
+    */
+    fusion_workspace_init(&workspace);
+    if (!fusion_workspace_prepare(&workspace, no_of_sensors) ||
+        calculate_eigensystem_into(&workspace, sd_matrix, no_of_sensors,
+            no_of_sensors, eigen) < 0) {
+        fusion_workspace_free(&workspace);
+        free(eigen->eigen_value);
+        free(eigen->eigen_vector);
+        free(eigen);
+        return NULL;
+    }
+    fusion_workspace_free(&workspace);
+    return eigen;
+}
+
+#ifdef HAVE_GSL
+/*
+ * Makes sure the workspace holds a GSL eigen workspace of a size.
+ */
+static Boolean reserve_symmv(Fusion_Workspace_t *workspace, int size) {
+    if (workspace->symmv[size] == NULL) {
+        workspace->symmv[size] = gsl_eigen_symmv_alloc(size);
+        workspace->no_of_allocations++;
+        if (workspace->symmv[size] == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+#endif
+
+#ifdef HAVE_LAPACK
+/*
+ * LAPACK symmetric eigensolver using the MRRR algorithm (Fortran interface,
+ * with the hidden lengths of the character arguments).
+ */
+extern void dsyevr_(const char *jobz, const char *range, const char *uplo,
+    const int *n, double *a, const int *lda, const double *vl,
+    const double *vu, const int *il, const int *iu, const double *abstol,
+    int *m, double *w, double *z, const int *ldz, int *isuppz, double *work,
+    const int *lwork, int *iwork, const int *liwork, int *info,
+    size_t jobz_length, size_t range_length, size_t uplo_length);
+
+/*
+ * Solves for the no_of_eigenpairs largest eigenpairs of matrix (which is
+ * destroyed) with dsyevr. A symmetric row-major matrix is its own
+ * column-major transpose, and the column-major eigenvectors come back one
+ * per row of evec, in ascending order of eigenvalue.
+ */
+static int solve_eigensystem_lapack(Fusion_Workspace_t *workspace,
+    double *matrix, int no_of_sensors, int ld, int no_of_eigenpairs,
+    double *eigen_value, double *eigen_vector) {
+    int n = no_of_sensors;
+    int il = no_of_sensors - no_of_eigenpairs + 1;
+    int iu = no_of_sensors;
+    int lwork = EIGEN_SCRATCH_PER_SENSOR * workspace->capacity;
+    int liwork = (EIGEN_INDEX_SCRATCH_PER_SENSOR - 2) * workspace->capacity;
+    int *isuppz = workspace->eigen_index_scratch + liwork;
+    double unused = 0, abstol = 0;
+    int no_found = 0, info = 0;
+
+    dsyevr_("V", (no_of_eigenpairs < no_of_sensors) ? "I" : "A", "L", &n,
+        matrix, &ld, &unused, &unused, &il, &iu, &abstol, &no_found,
+        workspace->eval, workspace->evec, &ld, isuppz,
+        workspace->eigen_scratch, &lwork, workspace->eigen_index_scratch,
+        &liwork, &info, 1, 1, 1);
+    if (info != 0 || no_found != no_of_eigenpairs) {
+        printf("%s: dsyevr failed (info %d)\n", __func__, info);
+        return -1;
+    }
+
+    for (int i = 0; i < no_of_eigenpairs; i++) {
+        int k = no_of_eigenpairs - 1 - i;
+        eigen_value[i] = workspace->eval[k];
+        memcpy(eigen_vector + (size_t)i * ld,
+            workspace->evec + (size_t)k * ld, sizeof(double) * n);
+    }
+    return 0;
+}
+#endif
+
+/*
+ * householder_tridiagonalize() and implicit_ql() in double precision.
+ */
+#define EIGEN_REAL double
+#define EIGEN_EPSILON DBL_EPSILON
+#define EIGEN_MATH(name) name
+#define EIGEN_NAME(name) name
+#include "symmetric_eigen_template.h"
+
+/*
+ * Diagonalizes the symmetric matrix a (row-major, leading dimension ld,
+ * destroyed) by cyclic Jacobi rotations, leaving the eigenvalues in d and
+ * the eigenvector of d[i] in row i of vt. A rotation is skipped once its
+ * off-diagonal entry is negligible next to its two diagonal entries, which
+ * gives even the smallest eigenvalues to high relative accuracy. Returns
+ * FALSE if the sweeps still rotate after JACOBI_MAX_SWEEPS.
+ */
+static Boolean jacobi_diagonalize(double *a, int n, int ld, double *vt,
+    double *d) {
+#define A(i, j) a[(size_t)(i) * ld + (j)]
+    double norm = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            vt[(size_t)i * ld + j] = (i == j) ? 1 : 0;
+            norm += A(i, j) * A(i, j);
+        }
+    }
+    double negligible = DBL_EPSILON * DBL_EPSILON * sqrt(norm) + DBL_MIN;
+
+    for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+        Boolean rotated = FALSE;
+        for (int p = 0; p < n - 1; p++) {
+            for (int q = p + 1; q < n; q++) {
+                double apq = A(p, q);
+                if (fabs(apq) <= negligible || fabs(apq) <=
+                    DBL_EPSILON * sqrt(fabs(A(p, p) * A(q, q)))) {
+                    continue;
+                }
+                rotated = TRUE;
+
+                /*
+                * t = tan of the angle that zeroes a_pq, taken as the
+                * smaller root so that the rotation is at most 45 degrees.
+                */
+                double theta = (A(q, q) - A(p, p)) / (2 * apq);
+                double t = 1 / (fabs(theta) + hypot(theta, 1));
+                if (theta < 0) {
+                    t = -t;
+                }
+                double c = 1 / sqrt(t * t + 1);
+                double s = t * c;
+
+                A(p, p) -= t * apq;
+                A(q, q) += t * apq;
+                A(p, q) = 0;
+                A(q, p) = 0;
+                for (int r = 0; r < n; r++) {
+                    if (r == p || r == q) {
+                        continue;
+                    }
+                    double arp = A(r, p);
+                    double arq = A(r, q);
+                    A(r, p) = c * arp - s * arq;
+                    A(p, r) = A(r, p);
+                    A(r, q) = s * arp + c * arq;
+                    A(q, r) = A(r, q);
+                }
+                double *vp = vt + (size_t)p * ld;
+                double *vq = vt + (size_t)q * ld;
+                for (int k = 0; k < n; k++) {
+                    double x = vp[k];
+                    double y = vq[k];
+                    vp[k] = c * x - s * y;
+                    vq[k] = s * x + c * y;
+                }
+            }
+        }
+        if (!rotated) {
+            for (int i = 0; i < n; i++) {
+                d[i] = A(i, i);
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+#undef A
+}
+
+/*
+ * Insertion sort of the eigenvalues d into descending order, as indices
+ * into d, which is stable so that equal eigenvalues keep the order they
+ * came in.
+ */
+static void sort_eigenvalues_descending(double *d, int n, int *order) {
+    for (int i = 0; i < n; i++) {
+        int k = i;
+        while (k > 0 && d[order[k - 1]] < d[i]) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+}
+
+/*
+ * Stores the eigenpairs (d, rows of vt) of the built-in and Jacobi backends
+ * in descending order of eigenvalue.
+ */
+static void store_sorted_eigenpairs(Fusion_Workspace_t *workspace, double *d,
+    double *vt, int no_of_sensors, int ld, double *eigen_value,
+    double *eigen_vector) {
+    int *order = workspace->eigen_index_scratch;
+
+    sort_eigenvalues_descending(d, no_of_sensors, order);
+    for (int i = 0; i < no_of_sensors; i++) {
+        eigen_value[i] = d[order[i]];
+        memcpy(eigen_vector + (size_t)i * ld, vt + (size_t)order[i] * ld,
+            sizeof(double) * no_of_sensors);
+    }
+}
+
+/*
+ * Solves the eigensystem of matrix (which is destroyed) with no library.
+ */
+static int solve_eigensystem_builtin(Fusion_Workspace_t *workspace,
+    double *matrix, int no_of_sensors, int ld, double *eigen_value,
+    double *eigen_vector) {
+    int n = no_of_sensors;
+    double *d = workspace->eval;
+    double *e = workspace->eigen_scratch;
+    double *vt = workspace->evec;
+
+    householder_tridiagonalize(matrix, n, ld, d, e);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            vt[(size_t)j * ld + i] = matrix[(size_t)i * ld + j];
+        }
+    }
+    if (!implicit_ql(vt, n, ld, n, d, e)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+    store_sorted_eigenpairs(workspace, d, vt, n, ld, eigen_value,
+        eigen_vector);
+    return 0;
+}
+
+/*
+ * Solves the eigensystem of matrix (which is destroyed) by cyclic Jacobi,
+ * which for a small matrix kept in cache is quicker than tridiagonalizing
+ * it, and needs no workspace of its size.
+ */
+static int solve_eigensystem_jacobi(Fusion_Workspace_t *workspace,
+    double *matrix, int no_of_sensors, int ld, double *eigen_value,
+    double *eigen_vector) {
+    double *d = workspace->eval;
+    double *vt = workspace->evec;
+
+    if (!jacobi_diagonalize(matrix, no_of_sensors, ld, vt, d)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+    store_sorted_eigenpairs(workspace, d, vt, no_of_sensors, ld,
+        eigen_value, eigen_vector);
+    return 0;
+}
+
+/*
+ * Built-in eigensolver shared between threads. The matrix is reduced to
+ * tridiagonal form by one Householder reflection per column, the
+ * transformation is formed a block of its rows per thread, and the
+ * rotations of each QL iteration are applied a block of columns per thread.
+ */
+typedef struct Parallel_Eigen
+{
+    double *a;
+    /**< Matrix being reduced (its trailing rows) and, in row k, the
+     * Householder vector of column k */
+    int no_of_sensors;
+    int ld;
+    int k;
+    /**< Column being reduced */
+    double tau;
+    /**< Scale of the reflection of column k */
+    double *tau_all;
+    /**< Scale of the reflection of each column (0 for none) */
+    double *p;
+    /**< tau * A u for the trailing matrix A */
+    double *w;
+    /**< p less its component along u */
+    double *vt;
+    /**< Transposed transformation, then the eigenvectors */
+    int first_rotation;
+    int last_rotation;
+    /**< Rows rotated by the current QL iteration */
+    double *rotation_c;
+    double *rotation_s;
+    /**< Cosine and sine of each rotation of the current QL iteration */
+    double partial[FUSION_MAX_THREADS * DOUBLES_PER_ALIGNMENT];
+    /**< Partial sum of each thread */
+} Parallel_Eigen_t;
+
+/*
+ * p = tau A u for the rows of a thread of the trailing matrix, with its
+ * part of u^T p.
+ */
+static void householder_multiply_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Eigen_t *task = (Parallel_Eigen_t *)arg;
+    int offset = task->k + 1;
+    int m = task->no_of_sensors - offset;
+    double *u = task->a + (size_t)task->k * task->ld + offset;
+    double partial = 0;
+    int first, last;
+
+    fusion_thread_share(m, thread, no_of_threads, &first, &last);
+    for (int i = first; i < last; i++) {
+        double *row = task->a + (size_t)(offset + i) * task->ld + offset;
+        double sum = 0;
+        for (int j = 0; j < m; j++) {
+            sum += row[j] * u[j];
+        }
+        task->p[i] = task->tau * sum;
+        partial += task->p[i] * u[i];
+    }
+    PARTIAL(task->partial, thread) = partial;
+}
+
+/*
+ * A -= u w^T + w u^T for the rows of a thread of the trailing matrix. Each
+ * entry is the sum of the same two products as its mirror, so A stays
+ * exactly symmetric.
+ */
+static void householder_update_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Eigen_t *task = (Parallel_Eigen_t *)arg;
+    int offset = task->k + 1;
+    int m = task->no_of_sensors - offset;
+    double *u = task->a + (size_t)task->k * task->ld + offset;
+    double *w = task->w;
+    int first, last;
+
+    fusion_thread_share(m, thread, no_of_threads, &first, &last);
+    for (int i = first; i < last; i++) {
+        double *row = task->a + (size_t)(offset + i) * task->ld + offset;
+        for (int j = 0; j < m; j++) {
+            row[j] -= u[i] * w[j] + w[i] * u[j];
+        }
+    }
+}
+
+/*
+ * Rows of a thread of the transposed transformation. Row r is column r of
+ * H_0 H_1 ... H_(n-3), which the reflections of columns r - 1 down to 0
+ * are the only ones to change.
+ */
+static void householder_transform_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Eigen_t *task = (Parallel_Eigen_t *)arg;
+    int n = task->no_of_sensors;
+
+    for (int first = thread * PARALLEL_ROW_BLOCK; first < n;
+        first += no_of_threads * PARALLEL_ROW_BLOCK) {
+        int last = (first + PARALLEL_ROW_BLOCK < n) ?
+            first + PARALLEL_ROW_BLOCK : n;
+        for (int r = first; r < last; r++) {
+            double *row = task->vt + (size_t)r * task->ld;
+            for (int j = 0; j < n; j++) {
+                row[j] = 0;
+            }
+            row[r] = 1;
+            for (int k = ((r - 1 < n - 3) ? r - 1 : n - 3); k >= 0; k--) {
+                double *u = task->a + (size_t)k * task->ld + k + 1;
+                double *x = row + k + 1;
+                double sum = 0;
+                if (task->tau_all[k] == 0) {
+                    continue;
+                }
+                for (int j = 0; j < n - k - 1; j++) {
+                    sum += u[j] * x[j];
+                }
+                sum *= task->tau_all[k];
+                for (int j = 0; j < n - k - 1; j++) {
+                    x[j] -= sum * u[j];
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Rotations of a QL iteration, applied to the columns of a thread of vt in
+ * the order implicit_ql() applies them.
+ */
+static void ql_rotation_task(void *arg, int thread, int no_of_threads) {
+    Parallel_Eigen_t *task = (Parallel_Eigen_t *)arg;
+    int first, last;
+
+    fusion_thread_share(task->no_of_sensors, thread, no_of_threads, &first,
+        &last);
+    for (int i = task->last_rotation; i >= task->first_rotation; i--) {
+        double c = task->rotation_c[i];
+        double s = task->rotation_s[i];
+        double *row = task->vt + (size_t)i * task->ld;
+        double *next = row + task->ld;
+        for (int k = first; k < last; k++) {
+            double h = next[k];
+            next[k] = s * row[k] + c * h;
+            row[k] = c * row[k] - s * h;
+        }
+    }
+}
+
+/*
+ * Reduces matrix (destroyed) to the tridiagonal (d, e[1..n-1]), leaving the
+ * transposed transformation in task->vt.
+ */
+static void householder_tridiagonalize_parallel(Fusion_Thread_Pool_t *pool,
+    Parallel_Eigen_t *task, double *d, double *e) {
+    int n = task->no_of_sensors;
+    int ld = task->ld;
+    double *a = task->a;
+
+    for (int k = 0; k < n - 2; k++) {
+        double *x = a + (size_t)k * ld + k + 1;
+        int m = n - k - 1;
+        double tail = 0;
+
+        d[k] = a[(size_t)k * ld + k];
+        for (int j = 1; j < m; j++) {
+            tail += x[j] * x[j];
+        }
+        if (tail == 0) {
+            task->tau_all[k] = 0;
+            e[k + 1] = x[0];
+            continue;
+        }
+        double norm = sqrt(x[0] * x[0] + tail);
+        double beta = (x[0] > 0) ? -norm : norm;
+        x[0] -= beta;
+        task->tau = 2 / (x[0] * x[0] + tail);
+        task->tau_all[k] = task->tau;
+        task->k = k;
+        e[k + 1] = beta;
+
+        double pu = 0;
+        fusion_thread_pool_run(pool, householder_multiply_task, task);
+        for (int t = 0; t < pool->no_of_threads; t++) {
+            pu += PARTIAL(task->partial, t);
+        }
+        double half_tau_pu = task->tau / 2 * pu;
+        for (int j = 0; j < m; j++) {
+            task->w[j] = task->p[j] - half_tau_pu * x[j];
+        }
+        fusion_thread_pool_run(pool, householder_update_task, task);
+    }
+    if (n >= 2) {
+        d[n - 2] = a[(size_t)(n - 2) * ld + n - 2];
+        e[n - 1] = a[(size_t)(n - 1) * ld + n - 2];
+    }
+    d[n - 1] = a[(size_t)(n - 1) * ld + n - 1];
+    e[0] = 0;
+    fusion_thread_pool_run(pool, householder_transform_task, task);
+}
+
+/*
+ * implicit_ql(), with the rotations of each iteration applied to vt by the
+ * threads once the iteration has found them all.
+ */
+static Boolean implicit_ql_parallel(Fusion_Thread_Pool_t *pool,
+    Parallel_Eigen_t *task, double *d, double *e) {
+    int n = task->no_of_sensors;
+
+    for (int i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0;
+
+    double f = 0, tst1 = 0;
+    for (int l = 0; l < n; l++) {
+        tst1 = fmax(tst1, fabs(d[l]) + fabs(e[l]));
+        int m = l;
+        while (m < n - 1 && fabs(e[m]) > DBL_EPSILON * tst1) {
+            m++;
+        }
+
+        int iterations = 0;
+        while (m > l && fabs(e[l]) > DBL_EPSILON * tst1) {
+            if (++iterations > BUILTIN_QL_MAX_ITERATIONS) {
+                return FALSE;
+            }
+
+            double g = d[l];
+            double p = (d[l + 1] - g) / (2 * e[l]);
+            double r = hypot(p, 1);
+            if (p < 0) {
+                r = -r;
+            }
+            d[l] = e[l] / (p + r);
+            d[l + 1] = e[l] * (p + r);
+            double dl1 = d[l + 1];
+            double h = g - d[l];
+            for (int i = l + 2; i < n; i++) {
+                d[i] -= h;
+            }
+            f += h;
+
+            p = d[m];
+            double c = 1, c2 = 1, c3 = 1, s = 0, s2 = 0;
+            double el1 = e[l + 1];
+            for (int i = m - 1; i >= l; i--) {
+                c3 = c2;
+                c2 = c;
+                s2 = s;
+                g = c * e[i];
+                h = c * p;
+                r = hypot(p, e[i]);
+                e[i + 1] = s * r;
+                s = e[i] / r;
+                c = p / r;
+                p = c * d[i] - s * g;
+                d[i + 1] = h + s * (c * g + s * d[i]);
+                task->rotation_c[i] = c;
+                task->rotation_s[i] = s;
+            }
+            task->first_rotation = l;
+            task->last_rotation = m - 1;
+            fusion_thread_pool_run(pool, ql_rotation_task, task);
+            p = -s * s2 * c3 * el1 * e[l] / dl1;
+            e[l] = s * p;
+            d[l] = c * p;
+        }
+        d[l] = d[l] + f;
+        e[l] = 0;
+    }
+    return TRUE;
+}
+
+/*
+ * Solves the eigensystem of matrix (which is destroyed) with no library,
+ * shared between the threads of the workspace.
+ */
+static int solve_eigensystem_parallel(Fusion_Workspace_t *workspace,
+    double *matrix, int no_of_sensors, int ld, double *eigen_value,
+    double *eigen_vector) {
+    int n = no_of_sensors;
+    double *d = workspace->eval;
+    double *e = workspace->eigen_scratch;
+    Parallel_Eigen_t task;
+
+    task.a = matrix;
+    task.no_of_sensors = n;
+    task.ld = ld;
+    task.vt = workspace->evec;
+    task.tau_all = e + n;
+    task.p = e + 2 * n;
+    task.w = e + 3 * n;
+    task.rotation_c = e + 4 * n;
+    task.rotation_s = e + 5 * n;
+
+    householder_tridiagonalize_parallel(workspace->thread_pool, &task, d, e);
+    if (!implicit_ql_parallel(workspace->thread_pool, &task, d, e)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+    store_sorted_eigenpairs(workspace, d, task.vt, n, ld, eigen_value,
+        eigen_vector);
+    return 0;
+}
+
+/*
+ * Backend that solves a matrix of no_of_sensors rows for a backend, which
+ * is backend itself unless it is EIGEN_BACKEND_AUTO.
+ */
+static Eigen_Backend_t resolve_eigen_backend(Eigen_Backend_t backend,
+    int no_of_sensors) {
+    if (backend != EIGEN_BACKEND_AUTO) {
+        return backend;
+    }
+    if (no_of_sensors <= JACOBI_MAX_SENSORS) {
+        return EIGEN_BACKEND_JACOBI;
+    }
+#ifdef HAVE_GSL
+    return EIGEN_BACKEND_GSL;
+#else
+    return EIGEN_BACKEND_BUILTIN;
+#endif
+}
+
+/*
+ * Solves the eigensystem of a small matrix (size rows, leading dimension
+ * ld, destroyed) for the Lanczos and randomized solvers, leaving the
+ * eigenvalues in descending order and eigenvector i in column i of
+ * eigen_vector, as gsl_eigen_symmv_sort() does. The matrix is solved by
+ * the backend EIGEN_BACKEND_AUTO picks for its size.
+ */
+static int solve_small_eigensystem(Fusion_Workspace_t *workspace,
+    double *matrix, int size, int ld, double *eigen_value,
+    double *eigen_vector) {
+    Eigen_Backend_t backend = resolve_eigen_backend(EIGEN_BACKEND_AUTO,
+        size);
+#ifdef HAVE_GSL
+    if (backend == EIGEN_BACKEND_GSL) {
+        if (!reserve_symmv(workspace, size)) {
+            return -1;
+        }
+        gsl_matrix_view m = gsl_matrix_view_array_with_tda(matrix, size,
+            size, ld);
+        gsl_vector_view eval = gsl_vector_view_array(eigen_value, size);
+        gsl_matrix_view evec = gsl_matrix_view_array_with_tda(eigen_vector,
+            size, size, ld);
+        gsl_eigen_symmv(&m.matrix, &eval.vector, &evec.matrix,
+            workspace->symmv[size]);
+        gsl_eigen_symmv_sort(&eval.vector, &evec.matrix,
+            GSL_EIGEN_SORT_VAL_DESC);
+        return 0;
+    }
+#endif
+    double *d = workspace->eigen_scratch;
+    double *e = d + size;
+    int *order = workspace->eigen_index_scratch;
+
+    if (backend == EIGEN_BACKEND_JACOBI) {
+        if (!jacobi_diagonalize(matrix, size, ld, eigen_vector, d)) {
+            printf("%s: Eigenvalues did not converge\n", __func__);
+            return -1;
+        }
+    } else {
+        householder_tridiagonalize(matrix, size, ld, d, e);
+        for (int i = 0; i < size; i++) {
+            for (int j = 0; j < size; j++) {
+                eigen_vector[(size_t)j * ld + i] = matrix[(size_t)i * ld + j];
+            }
+        }
+        if (!implicit_ql(eigen_vector, size, ld, size, d, e)) {
+            printf("%s: Eigenvalues did not converge\n", __func__);
+            return -1;
+        }
+    }
+
+    /*
+    * The eigenvectors are rows of eigen_vector; they are sorted into the
+    * columns of matrix, which is no longer needed, and copied back.
+    */
+    sort_eigenvalues_descending(d, size, order);
+    for (int i = 0; i < size; i++) {
+        double *vector = eigen_vector + (size_t)order[i] * ld;
+        eigen_value[i] = d[order[i]];
+        for (int l = 0; l < size; l++) {
+            matrix[(size_t)l * ld + i] = vector[l];
+        }
+    }
+    for (int l = 0; l < size; l++) {
+        memcpy(eigen_vector + (size_t)l * ld, matrix + (size_t)l * ld,
+            sizeof(double) * size);
+    }
+    return 0;
+}
+
+Boolean eigen_backend_supported(Eigen_Backend_t backend) {
+    switch (backend) {
+    case EIGEN_BACKEND_AUTO:
+    case EIGEN_BACKEND_BUILTIN:
+    case EIGEN_BACKEND_JACOBI:
+        return TRUE;
+    case EIGEN_BACKEND_GSL:
+#ifdef HAVE_GSL
+        return TRUE;
+#else
+        return FALSE;
+#endif
+    case EIGEN_BACKEND_LAPACK:
+#ifdef HAVE_LAPACK
+        return TRUE;
+#else
+        return FALSE;
+#endif
+    default:
+        return FALSE;
+    }
+}
+
+const char *eigen_backend_name(Eigen_Backend_t backend) {
+    switch (backend) {
+    case EIGEN_BACKEND_AUTO:
+        return "auto";
+    case EIGEN_BACKEND_GSL:
+        return "gsl";
+    case EIGEN_BACKEND_LAPACK:
+        return "lapack";
+    case EIGEN_BACKEND_BUILTIN:
+        return "builtin";
+    case EIGEN_BACKEND_JACOBI:
+        return "jacobi";
+    default:
+        return "unknown";
+    }
+}
+
+/*
+ * Solves the eigensystem of the first no_of_sensors rows of
+ * workspace->eigen_matrix (which is destroyed) with the backend set in the
+ * workspace, leaving the eigenvalues in descending order and eigenvector i
+ * in row i of eigen_vector.
+ */
+static int solve_eigen_matrix(Fusion_Workspace_t *workspace,
+    int no_of_sensors, int ld, int no_of_eigenpairs, double *eigen_value,
+    double *eigen_vector) {
+    /*
+    * An epoch shared between threads is solved by the built-in backend
+    * unless a library was asked for.
+    */
+    Boolean parallel = fusion_workspace_parallel(workspace, no_of_sensors);
+    Eigen_Backend_t backend = (parallel &&
+        workspace->eigen_backend == EIGEN_BACKEND_AUTO) ?
+        EIGEN_BACKEND_BUILTIN : resolve_eigen_backend(
+        workspace->eigen_backend, no_of_sensors);
+
+    switch (backend) {
+#ifdef HAVE_LAPACK
+    case EIGEN_BACKEND_LAPACK:
+        if (solve_eigensystem_lapack(workspace, workspace->eigen_matrix,
+            no_of_sensors, ld, no_of_eigenpairs, eigen_value,
+            eigen_vector) != 0) {
+            return -1;
+        }
+        break;
+#endif
+    case EIGEN_BACKEND_BUILTIN:
+        if ((parallel ? solve_eigensystem_parallel :
+            solve_eigensystem_builtin)(workspace, workspace->eigen_matrix,
+            no_of_sensors, ld, eigen_value,
+            eigen_vector) != 0) {
+            return -1;
+        }
+        break;
+    case EIGEN_BACKEND_JACOBI:
+        if (solve_eigensystem_jacobi(workspace, workspace->eigen_matrix,
+            no_of_sensors, ld, eigen_value,
+            eigen_vector) != 0) {
+            return -1;
+        }
+        break;
+#ifdef HAVE_GSL
+    default:
+        /*
+        * GSL needs a workspace of exactly the matrix size. One is kept for
+        * every size seen, so that a fleet whose size changes from epoch to
+        * epoch does not allocate once it has been seen at each size.
+        */
+        if (!reserve_symmv(workspace, no_of_sensors)) {
+            return -1;
+        }
+        solve_eigensystem(workspace->eigen_matrix, no_of_sensors, ld,
+            workspace->eval, workspace->evec,
+            workspace->symmv[no_of_sensors], eigen_value,
+            eigen_vector);
+        return 0;
+#else
+    default:
+        return -1;
+#endif
+    }
+
+    normalize_eigenvector_signs(eigen_vector, ld, no_of_eigenpairs,
+        no_of_sensors);
+    return 0;
+}
+
+int calculate_eigensystem_leading_into(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors, int no_of_eigenpairs,
+    struct eigen_systems *eigen) {
+    if (workspace == NULL || sd_matrix == NULL || eigen == NULL ||
+        no_of_sensors <= 0 || no_of_sensors > workspace->capacity ||
+        workspace->matrix_free ||
+        no_of_eigenpairs <= 0 || no_of_eigenpairs > no_of_sensors ||
+        sd_ld < no_of_sensors ||
+        eigen->leading_dimension < no_of_sensors ||
+        eigen->leading_dimension > fusion_matrix_leading_dimension(
+            workspace->capacity) ||
+        !eigen_backend_supported(workspace->eigen_backend)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int ld = eigen->leading_dimension;
+
+    for (int i = 0; i < no_of_sensors; i++) {
+        memcpy(workspace->eigen_matrix + (size_t)i * ld,
+            sd_matrix + (size_t)i * sd_ld, sizeof(double) * no_of_sensors);
+    }
+    return solve_eigen_matrix(workspace, no_of_sensors, ld, no_of_eigenpairs,
+        eigen->eigen_value, eigen->eigen_vector);
+}
+
+int calculate_eigensystem_into(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors,
+    struct eigen_systems *eigen) {
+    return calculate_eigensystem_leading_into(workspace, sd_matrix, sd_ld,
+        no_of_sensors, no_of_sensors, eigen);
+}
+
+int calculate_eigensystem_blocks_into(Fusion_Workspace_t *workspace,
+    double *sensor_array, double *sd_matrix, int sd_ld, int no_of_sensors,
+    struct eigen_systems *eigen) {
+    if (workspace == NULL || sensor_array == NULL || sd_matrix == NULL ||
+        eigen == NULL || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity || workspace->matrix_free ||
+        sd_ld < no_of_sensors ||
+        eigen->leading_dimension < no_of_sensors ||
+        eigen->leading_dimension > fusion_matrix_leading_dimension(
+            workspace->capacity) ||
+        !eigen_backend_supported(workspace->eigen_backend)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    int ld = eigen->leading_dimension;
+    Sorted_Sensor_t *sorted = workspace->sorted_sensors;
+    int *block = workspace->sensor_block;
+
+    for (int i = 0; i < n; i++) {
+        sorted[i].value = sensor_array[i];
+        sorted[i].index = i;
+    }
+    qsort(sorted, n, sizeof(Sorted_Sensor_t), compare_sorted_sensors);
+
+    /*
+    * block[k] is the first sorted position of the block of position k.
+    */
+    workspace->no_of_blocks = 1;
+    block[0] = 0;
+    for (int k = 1; k < n; k++) {
+        if (exp(-(sorted[k].value - sorted[k - 1].value)) <
+            EIGEN_BLOCK_TOLERANCE) {
+            workspace->no_of_blocks++;
+            block[k] = k;
+        } else {
+            block[k] = block[k - 1];
+        }
+    }
+    if (workspace->no_of_blocks == 1) {
+        return calculate_eigensystem_into(workspace, sd_matrix, sd_ld, n,
+            eigen);
+    }
+
+    /*
+    * The eigenpairs of the block at s go to entries (rows) s.. of eigen,
+    * over the positions of the block.
+    */
+    for (int s = 0, e; s < n; s = e) {
+        for (e = s + 1; e < n && block[e] == s; e++) {
+        }
+        int size = e - s;
+
+        if (size == 1) {
+            eigen->eigen_value[s] =
+                sd_matrix[(size_t)sorted[s].index * sd_ld + sorted[s].index];
+            eigen->eigen_vector[(size_t)s * ld] = 1.0;
+            continue;
+        }
+        for (int a = 0; a < size; a++) {
+            double *row = sd_matrix + (size_t)sorted[s + a].index * sd_ld;
+            for (int b = 0; b < size; b++) {
+                workspace->eigen_matrix[(size_t)a * ld + b] =
+                    row[sorted[s + b].index];
+            }
+        }
+        if (solve_eigen_matrix(workspace, size, ld, size,
+            eigen->eigen_value + s,
+            eigen->eigen_vector + (size_t)s * ld) != 0) {
+            return -1;
+        }
+    }
+
+    /*
+    * Merges the spectra, scattering each eigenvector back to the sensors of
+    * its block.
+    */
+    int *order = workspace->eigen_index_scratch;
+    int *rank = workspace->eigen_index_scratch + n;
+
+    sort_eigenvalues_descending(eigen->eigen_value, n, order);
+    for (int i = 0; i < n; i++) {
+        rank[order[i]] = i;
+        workspace->eval[i] = eigen->eigen_value[order[i]];
+    }
+    for (int r = 0; r < n; r++) {
+        int s = block[r];
+        double *source = eigen->eigen_vector + (size_t)r * ld;
+        double *target = workspace->evec + (size_t)rank[r] * ld;
+
+        memset(target, 0, sizeof(double) * n);
+        for (int b = s; b < n && block[b] == s; b++) {
+            target[sorted[b].index] = source[b - s];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        eigen->eigen_value[i] = workspace->eval[i];
+        memcpy(eigen->eigen_vector + (size_t)i * ld,
+            workspace->evec + (size_t)i * ld, sizeof(double) * n);
+    }
+
+    normalize_eigenvector_signs(eigen->eigen_vector, ld, n, n);
+    return 0;
+}
+
+/*
+ * Scales a vector to unit length, returning its original length (a zero
+ * vector is left as is).
+ */
+static double normalize_vector(double *v, int length) {
+    double norm = 0;
+    for (int i = 0; i < length; i++) {
+        norm += v[i] * v[i];
+    }
+    norm = sqrt(norm);
+    if (norm > 0) {
+        for (int i = 0; i < length; i++) {
+            v[i] /= norm;
+        }
+    }
+    return norm;
+}
+
+/*
+ * Fills a Lanczos starting vector with fixed pseudo-random values in
+ * [0.5, 1.5). All positive, it overlaps the leading (positive) eigenvector
+ * of the support degree matrix well, and being irregular it is not
+ * orthogonal to eigenvectors that are antisymmetric about the middle of the
+ * fleet, as a vector of ones would be.
+ */
+static void lanczos_start_vector(double *q, int no_of_sensors) {
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < no_of_sensors; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        q[i] = 0.5 + (double)(state >> 11) / 9007199254740992.0;
+    }
+    normalize_vector(q, no_of_sensors);
+}
+
+/*
+ * Number of the leading eigenvalues (of count, in descending order) whose
+ * contribution rates, from the trace no_of_sensors, reach parameter; 0 if
+ * they all fall short.
+ */
+static int leading_eigenpairs_needed(double *eigen_value, int count,
+    int no_of_sensors, float parameter) {
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += eigen_value[i] / no_of_sensors;
+        if (sum >= parameter) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * w = A q, with A sd_matrix (one row at a time) or, when it is NULL, the
+ * matrix free support degree set up in the workspace.
+ */
+static void support_degree_multiply(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors, double *q, double *w) {
+    int n = no_of_sensors;
+
+    if (sd_matrix == NULL) {
+        support_degree_operator_multiply(workspace, n, q, w);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        double *sd_row = sd_matrix + (size_t)i * sd_ld;
+        double sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += sd_row[j] * q[j];
+        }
+        w[i] = sum;
+    }
+}
+
+/*
+ * Most Lanczos steps a cold start of no_of_sensors takes. Step k costs a
+ * product with the support degree matrix (n^2) and reorthogonalization
+ * (4kn), so a quarter of the fleet costs about 3n^3/8, well below the full
+ * solve. Small fleets may take a few more, up to half the fleet (about n^3),
+ * as the full solve costs them as much as the steps do.
+ */
+static int lanczos_cold_steps(int no_of_sensors) {
+    int steps = no_of_sensors / 4 + LANCZOS_MIN_STEPS;
+
+    steps = (steps < no_of_sensors / 2) ? steps : no_of_sensors / 2;
+    return (steps < LANCZOS_MAX_STEPS) ? steps : LANCZOS_MAX_STEPS;
+}
+
+/*
+ * Number of the leading Ritz values of the first size Lanczos steps that
+ * parameter needs, once every one of them has converged, the residual of
+ * Ritz pair i being beta[size - 1] * |last component of its vector|; 0
+ * while they have not, and negative on error. Only the Ritz values and the
+ * last component of each vector are found, by implicit QL on the
+ * tridiagonal matrix, which takes O(size^2). The Ritz values are left in
+ * descending order in workspace->eval.
+ */
+static int lanczos_ritz_values_converged(Fusion_Workspace_t *workspace,
+    int size, int no_of_sensors, float parameter) {
+    double *alpha = workspace->lanczos_alpha;
+    double *beta = workspace->lanczos_beta;
+    double *d = workspace->eigen_scratch;
+    double *e = d + size;
+    double *last_row = e + size;
+    int *order = workspace->eigen_index_scratch;
+
+    for (int i = 0; i < size; i++) {
+        d[i] = alpha[i];
+        e[i] = (i > 0) ? beta[i - 1] : 0;
+        last_row[i] = (i == size - 1) ? 1 : 0;
+    }
+    if (!implicit_ql(last_row, size, 1, 1, d, e)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+
+    sort_eigenvalues_descending(d, size, order);
+    for (int i = 0; i < size; i++) {
+        workspace->eval[i] = d[order[i]];
+    }
+    int needed = leading_eigenpairs_needed(workspace->eval, size,
+        no_of_sensors, parameter);
+    for (int i = 0; i < needed; i++) {
+        if (beta[size - 1] * fabs(last_row[order[i]]) >
+            LANCZOS_TOLERANCE * no_of_sensors) {
+            return 0;
+        }
+    }
+    return needed;
+}
+
+/*
+ * Runs at most max_steps Lanczos steps from the unit vector in the first row
+ * of the Krylov basis, multiplying by sd_matrix or, when it is NULL, by the
+ * matrix free support degree set up in the workspace. Returns the number of
+ * leading eigenpairs stored in eigen once they have converged, 0 if they did
+ * not within max_steps (or the Krylov subspace became invariant first), and
+ * negative on error.
+ */
+static int lanczos_solve(Fusion_Workspace_t *workspace, double *sd_matrix,
+    int sd_ld, int no_of_sensors, float parameter, int max_steps,
+    struct eigen_systems *eigen) {
+    int n = no_of_sensors;
+    int ld = eigen->leading_dimension;
+    double *basis = workspace->krylov_basis;
+    double *alpha = workspace->lanczos_alpha;
+    double *beta = workspace->lanczos_beta;
+    double *tridiagonal = workspace->eigen_matrix;
+    double *ritz_value = workspace->eval;
+    double *ritz_vector = workspace->evec;
+    double trace = 0;
+    int next_check = 0;
+    int needed = 0;
+    int size = 0;
+
+    workspace->lanczos_steps = 0;
+    for (int k = 0; k < max_steps; k++) {
+        double *q = basis + (size_t)k * ld;
+        double *w = basis + (size_t)(k + 1) * ld;
+        size = k + 1;
+
+        support_degree_multiply(workspace, sd_matrix, sd_ld, n, q, w);
+
+        double a = 0;
+        for (int i = 0; i < n; i++) {
+            a += q[i] * w[i];
+        }
+        alpha[k] = a;
+        trace += a;
+        for (int i = 0; i < n; i++) {
+            w[i] -= a * q[i];
+        }
+        if (k > 0) {
+            double *previous = basis + (size_t)(k - 1) * ld;
+            for (int i = 0; i < n; i++) {
+                w[i] -= beta[k - 1] * previous[i];
+            }
+        }
+
+        /*
+        * Full reorthogonalization, done twice, keeps the basis orthonormal
+        * so that no eigenvalue is found twice.
+        */
+        for (int pass = 0; pass < 2; pass++) {
+            for (int j = 0; j <= k; j++) {
+                double *basis_row = basis + (size_t)j * ld;
+                double c = 0;
+                for (int i = 0; i < n; i++) {
+                    c += basis_row[i] * w[i];
+                }
+                for (int i = 0; i < n; i++) {
+                    w[i] -= c * basis_row[i];
+                }
+            }
+        }
+
+        double b = 0;
+        for (int i = 0; i < n; i++) {
+            b += w[i] * w[i];
+        }
+        b = sqrt(b);
+        beta[k] = b;
+        Boolean is_invariant = (b <= LANCZOS_BREAKDOWN * n);
+
+        /*
+        * The support degree matrix is positive definite, so its Ritz values
+        * are positive and the leading ones can't hold parameter of the
+        * trace n before all of them do. From then on, convergence is tested
+        * every LANCZOS_CHECK_INTERVAL steps, and at the last step.
+        */
+        if (trace >= parameter * n &&
+            (size >= next_check || k == max_steps - 1 || is_invariant)) {
+            next_check = size + LANCZOS_CHECK_INTERVAL;
+            needed = lanczos_ritz_values_converged(workspace, size, n,
+                parameter);
+            if (needed != 0) {
+                break;
+            }
+        }
+
+        /*
+        * An invariant subspace that does not hold enough of the trace
+        * leaves nothing to continue from.
+        */
+        if (is_invariant) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            w[i] /= b;
+        }
+    }
+    if (needed <= 0) {
+        return needed;
+    }
+
+    /*
+    * The eigenvectors of the tridiagonal matrix are the Ritz vectors in the
+    * Lanczos basis (columns of ritz_vector). They are only found once, for
+    * the step that converged.
+    */
+    for (int i = 0; i < size; i++) {
+        double *t_row = tridiagonal + (size_t)i * ld;
+        for (int j = 0; j < size; j++) {
+            t_row[j] = 0;
+        }
+        t_row[i] = alpha[i];
+        if (i > 0) {
+            t_row[i - 1] = beta[i - 1];
+        }
+        if (i + 1 < size) {
+            t_row[i + 1] = beta[i];
+        }
+    }
+    if (solve_small_eigensystem(workspace, tridiagonal, size, ld,
+        ritz_value, ritz_vector) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < needed; i++) {
+        double *row = eigen->eigen_vector + (size_t)i * ld;
+        eigen->eigen_value[i] = ritz_value[i];
+        for (int j = 0; j < n; j++) {
+            row[j] = 0;
+        }
+        for (int l = 0; l < size; l++) {
+            double y = ritz_vector[(size_t)l * ld + i];
+            double *basis_row = basis + (size_t)l * ld;
+            for (int j = 0; j < n; j++) {
+                row[j] += y * basis_row[j];
+            }
+        }
+    }
+    normalize_eigenvector_signs(eigen->eigen_vector, ld, needed, n);
+    workspace->lanczos_steps = size;
+    return needed;
+}
+
+/*
+ * Checks the arguments shared by the partial eigensolvers.
+ */
+static Boolean partial_eigensystem_input_valid(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors, float parameter,
+    struct eigen_systems *eigen) {
+    return !(workspace == NULL || sd_matrix == NULL || eigen == NULL ||
+        workspace->matrix_free ||
+        no_of_sensors <= 0 || no_of_sensors > workspace->capacity ||
+        sd_ld < no_of_sensors || parameter <= 0 || parameter > 1 ||
+        eigen->leading_dimension < no_of_sensors ||
+        eigen->leading_dimension > fusion_matrix_leading_dimension(
+            workspace->capacity));
+}
+
+int calculate_eigensystem_partial_into(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors, float parameter,
+    struct eigen_systems *eigen) {
+    if (!partial_eigensystem_input_valid(workspace, sd_matrix, sd_ld,
+            no_of_sensors, parameter, eigen)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+
+    /*
+    * Eigenpairs that take more than lanczos_cold_steps() are found sooner
+    * by the full solve.
+    */
+    if (n >= LANCZOS_MIN_SENSORS && parameter < 1) {
+        lanczos_start_vector(workspace->krylov_basis, n);
+        int needed = lanczos_solve(workspace, sd_matrix, sd_ld, n, parameter,
+            lanczos_cold_steps(n), eigen);
+        if (needed != 0) {
+            return needed;
+        }
+    }
+
+    workspace->lanczos_steps = 0;
+    return (calculate_eigensystem_into(workspace, sd_matrix, sd_ld, n,
+        eigen) < 0) ? -1 : n;
+}
+
+int calculate_eigensystem_matrix_free_into(Fusion_Workspace_t *workspace,
+    int no_of_sensors, float parameter, struct eigen_systems *eigen) {
+    if (workspace == NULL || eigen == NULL || !workspace->matrix_free ||
+        no_of_sensors <= 0 || no_of_sensors > workspace->capacity ||
+        parameter <= 0 || parameter > 1 ||
+        eigen->leading_dimension < no_of_sensors ||
+        eigen->leading_dimension > fusion_matrix_leading_dimension(
+            workspace->capacity)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+
+    /*
+    * A fleet no bigger than the step limit always converges, since by the
+    * last step the Krylov subspace is the whole space.
+    */
+    lanczos_start_vector(workspace->krylov_basis, n);
+    int needed = lanczos_solve(workspace, NULL, 0, n, parameter,
+        (n < MATRIX_FREE_MAX_STEPS) ? n : MATRIX_FREE_MAX_STEPS, eigen);
+    if (needed == 0) {
+        printf("%s: More eigenpairs needed than %d Lanczos steps find\n",
+            __func__, MATRIX_FREE_MAX_STEPS);
+        return -1;
+    }
+    return needed;
+}
+
+/*
+ * Orthonormalizes rows first to count - 1 of block (leading dimension ld)
+ * against rows 0 to first - 1, which already are, by Gram-Schmidt done
+ * twice. Rows that add no new direction are dropped and the rest moved up;
+ * returns the number of rows left.
+ */
+static int orthonormalize_block(double *block, int ld, int first, int count,
+    int no_of_sensors) {
+    int rank = first;
+
+    for (int k = first; k < count; k++) {
+        double *row = block + (size_t)rank * ld;
+        if (k != rank) {
+            memcpy(row, block + (size_t)k * ld,
+                sizeof(double) * no_of_sensors);
+        }
+        double length = 0;
+        for (int i = 0; i < no_of_sensors; i++) {
+            length += row[i] * row[i];
+        }
+        length = sqrt(length);
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int j = 0; j < rank; j++) {
+                double *basis_row = block + (size_t)j * ld;
+                double c = 0;
+                for (int i = 0; i < no_of_sensors; i++) {
+                    c += basis_row[i] * row[i];
+                }
+                for (int i = 0; i < no_of_sensors; i++) {
+                    row[i] -= c * basis_row[i];
+                }
+            }
+        }
+        if (normalize_vector(row, no_of_sensors) >
+            RANDOMIZED_RANK_TOLERANCE * length) {
+            rank++;
+        }
+    }
+    return rank;
+}
+
+/*
+ * Fills rows first to count - 1 of block with pseudo-random values in
+ * [-1, 1), carrying on the sequence in *state.
+ */
+static void random_block(double *block, int ld, int first, int count,
+    int no_of_sensors, unsigned long long *state) {
+    for (int k = first; k < count; k++) {
+        double *row = block + (size_t)k * ld;
+        for (int i = 0; i < no_of_sensors; i++) {
+            *state ^= *state << 13;
+            *state ^= *state >> 7;
+            *state ^= *state << 17;
+            row[i] = 2.0 * (double)(*state >> 11) / 9007199254740992.0 - 1;
+        }
+    }
+}
+
+int calculate_eigensystem_randomized_into(Fusion_Workspace_t *workspace,
+    double *sd_matrix, int sd_ld, int no_of_sensors, float parameter,
+    double accuracy, struct eigen_systems *eigen) {
+    if (workspace == NULL || eigen == NULL || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity || parameter <= 0 ||
+        parameter > 1 || !(accuracy > 0) ||
+        (sd_matrix != NULL && (workspace->matrix_free ||
+                               sd_ld < no_of_sensors)) ||
+        (sd_matrix == NULL && !workspace->matrix_free) ||
+        eigen->leading_dimension < no_of_sensors ||
+        eigen->leading_dimension > fusion_matrix_leading_dimension(
+            workspace->capacity)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
     }
-    int i = 0;
+    int n = no_of_sensors;
+    int ld = eigen->leading_dimension;
+
+    workspace->approximation_error = 0;
+    workspace->sketch_size = 0;
+    if (sd_matrix != NULL && n < LANCZOS_MIN_SENSORS) {
+        return (calculate_eigensystem_into(workspace, sd_matrix, sd_ld, n,
+            eigen) < 0) ? -1 : n;
+    }
+
     /*
-    * Sensor array value obtained from Node list
+    * The block Q lives in the Krylov basis and A Q in the first rows of
+    * evec, with the eigenvectors of Q' A Q after them. A workspace with a
+    * matrix has n / 2 + 1 rows of basis, a matrix free one
+    * MATRIX_FREE_MAX_STEPS + 1.
     */
-    while (node != NULL) {
-        sensor_array[i] = node->sensor_value;
-        node = node->next;
-        i++;
+    int max_block = (sd_matrix != NULL) ? n / 2 : n;
+    max_block = (max_block < RANDOMIZED_MAX_BLOCK) ? max_block :
+        RANDOMIZED_MAX_BLOCK;
+    int block_size = (max_block < RANDOMIZED_MIN_BLOCK) ? max_block :
+        RANDOMIZED_MIN_BLOCK;
+    double *q = workspace->krylov_basis;
+    double *aq = workspace->evec;
+    double *b = workspace->eigen_matrix;
+    double *theta = workspace->eval;
+    double *residual = workspace->eigen_scratch;
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    int rank = 0;
+
+    for (;;) {
+        random_block(q, ld, rank, block_size, n, &state);
+        rank = orthonormalize_block(q, ld, 0, block_size, n);
+        for (int iteration = 0; iteration < RANDOMIZED_POWER_ITERATIONS;
+            iteration++) {
+            for (int k = 0; k < rank; k++) {
+                support_degree_multiply(workspace, sd_matrix, sd_ld, n,
+                    q + (size_t)k * ld, aq + (size_t)k * ld);
+                memcpy(q + (size_t)k * ld, aq + (size_t)k * ld,
+                    sizeof(double) * n);
+            }
+            rank = orthonormalize_block(q, ld, 0, rank, n);
+        }
+        for (int k = 0; k < rank; k++) {
+            support_degree_multiply(workspace, sd_matrix, sd_ld, n,
+                q + (size_t)k * ld, aq + (size_t)k * ld);
+        }
+
+        /*
+        * The Ritz pairs of the subspace are the eigenpairs of Q' A Q,
+        * symmetrized against rounding.
+        */
+        for (int i = 0; i < rank; i++) {
+            for (int j = 0; j <= i; j++) {
+                double *q_row = q + (size_t)i * ld;
+                double *aq_row = aq + (size_t)j * ld;
+                double *q_other = q + (size_t)j * ld;
+                double *aq_other = aq + (size_t)i * ld;
+                double sum = 0;
+                for (int l = 0; l < n; l++) {
+                    sum += q_row[l] * aq_row[l] + q_other[l] * aq_other[l];
+                }
+                b[(size_t)i * ld + j] = sum / 2;
+                b[(size_t)j * ld + i] = sum / 2;
+            }
+        }
+        double *ritz_vector = aq + (size_t)rank * ld;
+        if (solve_small_eigensystem(workspace, b, rank, ld, theta,
+            ritz_vector) < 0) {
+            return -1;
+        }
+
+        int needed = leading_eigenpairs_needed(theta, rank, n, parameter);
+        Boolean last = (block_size >= max_block);
+        if (needed == 0 && !last) {
+            block_size = (2 * block_size < max_block) ? 2 * block_size :
+                max_block;
+            continue;
+        }
+        if (needed == 0) {
+            needed = rank;
+        }
+
+        /*
+        * Ritz vector i is Q' s_i, and its residual A Q' s_i - theta_i Q' s_i
+        * comes from A Q with no further multiply.
+        */
+        double error = 0;
+        for (int i = 0; i < needed; i++) {
+            double *row = eigen->eigen_vector + (size_t)i * ld;
+            for (int j = 0; j < n; j++) {
+                row[j] = 0;
+                residual[j] = 0;
+            }
+            for (int l = 0; l < rank; l++) {
+                double s = ritz_vector[(size_t)l * ld + i];
+                double *q_row = q + (size_t)l * ld;
+                double *aq_row = aq + (size_t)l * ld;
+                for (int j = 0; j < n; j++) {
+                    row[j] += s * q_row[j];
+                    residual[j] += s * aq_row[j];
+                }
+            }
+            double norm = 0;
+            for (int j = 0; j < n; j++) {
+                double r = residual[j] - theta[i] * row[j];
+                norm += r * r;
+            }
+            norm = sqrt(norm) / n;
+            error = (norm > error) ? norm : error;
+        }
+
+        if (error > accuracy && !last) {
+            block_size = (2 * block_size < max_block) ? 2 * block_size :
+                max_block;
+            continue;
+        }
+
+        for (int i = 0; i < needed; i++) {
+            eigen->eigen_value[i] = theta[i];
+        }
+        normalize_eigenvector_signs(eigen->eigen_vector, ld, needed, n);
+        workspace->approximation_error = error;
+        workspace->sketch_size = rank;
+        return needed;
     }
-    double *sd_matrix;
-    double **arrptr = (double **)malloc(no_of_sensors * sizeof(double *));
-    int count = 0;
-    for (int i = 0; i < no_of_sensors; i++) {
-        arrptr[i] = (double *)malloc(no_of_sensors * sizeof(double));
+}
+
+void eigen_warm_start_init(Eigen_Warm_Start_t *warm_start) {
+    memset(warm_start, 0, sizeof(Eigen_Warm_Start_t));
+}
+
+void eigen_warm_start_free(Eigen_Warm_Start_t *warm_start) {
+    free(warm_start->seed);
+    eigen_warm_start_init(warm_start);
+}
+
+/*
+ * Grows the seed so that it holds the sensor ID max_id, marking the new IDs
+ * as not seen.
+ */
+static Boolean reserve_warm_start(Eigen_Warm_Start_t *warm_start,
+    int max_id) {
+    if (max_id < warm_start->capacity) {
+        return TRUE;
     }
 
-    sd_matrix = (double *)malloc(sizeof(double) * no_of_sensors *
-        no_of_sensors);
-    if (arrptr == NULL || sd_matrix == NULL) {
+    int capacity = warm_start->capacity ? warm_start->capacity :
+        FUSION_WORKSPACE_MIN_CAPACITY;
+    while (capacity <= max_id) {
+        capacity *= 2;
+    }
+    double *seed = (double *)realloc(warm_start->seed,
+        capacity * sizeof(double));
+    if (seed == NULL) {
         printf("%s: Unable to allocate memory!\n", __func__);
-        return NULL;
+        return FALSE;
+    }
+    for (int i = warm_start->capacity; i < capacity; i++) {
+        seed[i] = NAN;
     }
+    warm_start->seed = seed;
+    warm_start->capacity = capacity;
+    return TRUE;
+}
+
+/*
+ * Builds the Lanczos starting vector from the seed, in the first row of the
+ * Krylov basis. Sensors without a seed take the mean of those with one.
+ * Returns FALSE if no sensor has a seed.
+ */
+static Boolean warm_start_vector(Fusion_Workspace_t *workspace,
+    Eigen_Warm_Start_t *warm_start, int *sensor_id, int no_of_sensors) {
+    double *q = workspace->krylov_basis;
+    double *cold = workspace->krylov_basis + workspace->leading_dimension;
+    double sum = 0;
+    int no_of_seeded = 0;
 
     for (int i = 0; i < no_of_sensors; i++) {
-        for (int j = 0; j < no_of_sensors; j++) {
-            arrptr[i][j] = exp(-1 * fabs(sensor_array[i] - sensor_array[j]));
-            sd_matrix[count] = arrptr[i][j];
-            count++;
+        int id = sensor_id[i];
+        q[i] = (id >= 0 && id < warm_start->capacity) ?
+            warm_start->seed[id] : NAN;
+        if (!isnan(q[i])) {
+            sum += q[i];
+            no_of_seeded++;
+        }
+    }
+    if (no_of_seeded == 0) {
+        return FALSE;
+    }
+    for (int i = 0; i < no_of_sensors; i++) {
+        if (isnan(q[i])) {
+            q[i] = sum / no_of_seeded;
         }
     }
+    if (normalize_vector(q, no_of_sensors) == 0) {
+        return FALSE;
+    }
 
     /*
-    * Pointer Memory freed
+    * A little of the cold starting vector keeps an eigenvector that was not
+    * among the leading ones last epoch from being missed.
     */
+    lanczos_start_vector(cold, no_of_sensors);
     for (int i = 0; i < no_of_sensors; i++) {
-        free(arrptr[i]);
+        q[i] += WARM_START_COLD_WEIGHT * cold[i];
     }
-    free(arrptr);
-    return sd_matrix;
+    normalize_vector(q, no_of_sensors);
+    return TRUE;
 }
 
-struct eigen_systems *calculate_eigensystem(double *sd_matrix,
-    int no_of_sensors) {
-    if (sd_matrix == NULL || no_of_sensors <= 0) {
+int calculate_eigensystem_warm_into(Fusion_Workspace_t *workspace,
+    Eigen_Warm_Start_t *warm_start, int *sensor_id, double *sd_matrix,
+    int sd_ld, int no_of_sensors, float parameter,
+    struct eigen_systems *eigen) {
+    if (warm_start == NULL || sensor_id == NULL ||
+        !partial_eigensystem_input_valid(workspace, sd_matrix, sd_ld,
+            no_of_sensors, parameter, eigen)) {
         printf("%s: Incorrect Input\n", __func__);
-        return NULL;
-    }
-    struct eigen_systems *eigen;
-    eigen = (struct eigen_systems *)malloc(sizeof(struct eigen_systems));
-    eigen->eigen_value = (double *)malloc(sizeof(double) * no_of_sensors);
-    eigen->eigen_vector = (double **)malloc(no_of_sensors * sizeof(double *));
-    for (int i = 0; i < no_of_sensors; i++) {
-        eigen->eigen_vector[i] = (double *)malloc(no_of_sensors *
-            sizeof(double));
-    }
-    if (eigen == NULL || eigen->eigen_vector == NULL
-        || eigen->eigen_value == NULL) {
-        printf("%s: Unable to allocate memory!\n", __func__);
-        return NULL;
+        return -1;
     }
-    /* Creating a copy of sd_matrix as gsl destructs
-     * the value
-     */
-    double *local_sd_matrix = (double *)malloc(sizeof(double) * no_of_sensors *
-        no_of_sensors);
-    for (int i = 0; i < no_of_sensors * no_of_sensors; i++) {
-        local_sd_matrix[i] = sd_matrix[i];
+    int n = no_of_sensors;
+    int ld = eigen->leading_dimension;
+    int no_of_eigenpairs = 0;
+
+    if (warm_start->is_seeded && n >= LANCZOS_MIN_SENSORS && parameter < 1 &&
+        warm_start_vector(workspace, warm_start, sensor_id, n)) {
+        int max_steps = (WARM_START_MAX_STEPS < n / 2) ?
+            WARM_START_MAX_STEPS : n / 2;
+        no_of_eigenpairs = lanczos_solve(workspace, sd_matrix, sd_ld, n,
+            parameter, max_steps, eigen);
+        if (no_of_eigenpairs < 0) {
+            return -1;
+        }
+        if (no_of_eigenpairs > 0) {
+            warm_start->no_of_warm_solves++;
+        } else {
+            warm_start->no_of_fallbacks++;
+        }
     }
 
     /*
-    * GSL to obtain Eigen values and Eigen Vectors
+    * Without a seed, or when it has stopped converging quickly, this epoch
+    * starts cold.
     */
-    gsl_matrix_view m = gsl_matrix_view_array(local_sd_matrix, no_of_sensors,
-        no_of_sensors);
-
-    gsl_vector *eval = gsl_vector_alloc(no_of_sensors);
-
-    gsl_matrix *evec = gsl_matrix_alloc(no_of_sensors, no_of_sensors);
-
-    gsl_eigen_symmv_workspace *w =
-        gsl_eigen_symmv_alloc(no_of_sensors);
-
-    gsl_eigen_symmv(&m.matrix, eval, evec, w);
-
-    gsl_eigen_symmv_free(w);
+    if (no_of_eigenpairs == 0) {
+        no_of_eigenpairs = calculate_eigensystem_partial_into(workspace,
+            sd_matrix, sd_ld, n, parameter, eigen);
+        if (no_of_eigenpairs < 0) {
+            return -1;
+        }
+    }
 
-    gsl_eigen_symmv_sort(eval, evec,
-                         GSL_EIGEN_SORT_VAL_DESC);
+    /*
+    * The seed of the next epoch is the sum of the leading eigenvectors of
+    * this one.
+    */
+    int needed = leading_eigenpairs_needed(eigen->eigen_value,
+        no_of_eigenpairs, n, parameter);
+    if (needed == 0) {
+        needed = no_of_eigenpairs;
+    }
+    int max_id = -1;
+    for (int j = 0; j < n; j++) {
+        max_id = (sensor_id[j] > max_id) ? sensor_id[j] : max_id;
+    }
+    if (!reserve_warm_start(warm_start, max_id)) {
+        return -1;
+    }
+    for (int j = 0; j < n; j++) {
+        double component = 0;
+        for (int i = 0; i < needed; i++) {
+            component += eigen->eigen_vector[(size_t)i * ld + j];
+        }
+        if (sensor_id[j] >= 0) {
+            warm_start->seed[sensor_id[j]] = component;
+        }
+    }
+    warm_start->is_seeded = TRUE;
+    return no_of_eigenpairs;
+}
 
+int calculate_contribution_rate_into(double *eigen_value, int no_of_sensors,
+    double *contribution_rate) {
+    if (eigen_value == NULL || no_of_sensors <= 0 ||
+        contribution_rate == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    double sum = 0;
     for (int i = 0; i < no_of_sensors; i++) {
-        eigen->eigen_value[i] = gsl_vector_get(eval, i);
-
-        gsl_vector_view evec_i = gsl_matrix_column(evec, i);
+        sum += eigen_value[i];
+    }
 
-        for (int j = 0; j < no_of_sensors; j++) {
-            eigen->eigen_vector[i][j] = *(*(&evec_i.vector.data) + j *
-                no_of_sensors);
-        }
+    for (int j = 0; j < no_of_sensors; j++) {
+        contribution_rate[j] = eigen_value[j] / sum;
     }
+    return 0;
+}
 
-    /*
-    * Pointer Memory freed
-    */
-    free(local_sd_matrix);
-    gsl_vector_free(eval);
-    gsl_matrix_free(evec);
-    return eigen;
+int calculate_contribution_rate_trace_into(double *eigen_value,
+    int no_of_eigenpairs, double trace, double *contribution_rate) {
+    if (eigen_value == NULL || no_of_eigenpairs <= 0 || trace <= 0 ||
+        contribution_rate == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    for (int j = 0; j < no_of_eigenpairs; j++) {
+        contribution_rate[j] = eigen_value[j] / trace;
+    }
+    return 0;
 }
 
 double *calculate_contribution_rate(double *eigen_value, int no_of_sensors) {
@@ -142,14 +2694,8 @@ double *calculate_contribution_rate(double *eigen_value, int no_of_sensors) {
         printf("%s: Unable to allocate memory!\n", __func__);
         return NULL;
     }
-    double sum = 0;
-    for (int i = 0; i < no_of_sensors; i++) {
-        sum += eigen_value[i];
-    }
-
-    for (int j = 0; j < no_of_sensors; j++) {
-        contribution_rate[j] = eigen_value[j] / sum;
-    }
+    calculate_contribution_rate_into(eigen_value, no_of_sensors,
+        contribution_rate);
     return contribution_rate;
 }
 
@@ -177,8 +2723,44 @@ int determine_contribution_rates_to_use(double *contribution_rate,
     return no_of_sensors;
 }
 
-double **calculate_principal_components(double *sd_matrix, int no_of_sensors,
-    double **eigen_vector, int no_of_contribution_rates_to_use) {
+int calculate_principal_components_into(double *sd_matrix, int sd_ld,
+    int no_of_sensors, double *eigen_vector, int eigen_ld,
+    int no_of_contribution_rates_to_use,
+    double *principal_components_matrix, int pc_ld) {
+    if (sd_matrix == NULL || eigen_vector == NULL || no_of_sensors <= 0
+        || no_of_contribution_rates_to_use <= 0
+        || principal_components_matrix == NULL || sd_ld < no_of_sensors
+        || eigen_ld < no_of_sensors || pc_ld < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    int m = no_of_contribution_rates_to_use;
+
+    /*
+    * Matrix Multiplication to calculate principal_components_matrix. The
+    * inner loop runs along a row of sd_matrix and of the result, so both are
+    * read and written contiguously; every element still sums over k in order.
+    */
+    for (int i = 0; i < m; i++) {
+        double *pc_row = principal_components_matrix + (size_t)i * pc_ld;
+        double *eigen_row = eigen_vector + (size_t)i * eigen_ld;
+        for (int j = 0; j < n; j++) {
+            pc_row[j] = 0;
+        }
+        for (int k = 0; k < n; k++) {
+            double e = eigen_row[k];
+            double *sd_row = sd_matrix + (size_t)k * sd_ld;
+            for (int j = 0; j < n; j++) {
+                pc_row[j] += e * sd_row[j];
+            }
+        }
+    }
+    return 0;
+}
+
+double *calculate_principal_components(double *sd_matrix, int no_of_sensors,
+    double *eigen_vector, int no_of_contribution_rates_to_use) {
     if (sd_matrix == NULL || eigen_vector == NULL || no_of_sensors <= 0
         || no_of_contribution_rates_to_use <= 0) {
         printf("%s: Incorrect Input\n", __func__);
@@ -186,58 +2768,213 @@ double **calculate_principal_components(double *sd_matrix, int no_of_sensors,
     }
     int n = no_of_sensors;
     int m = no_of_contribution_rates_to_use;
-    int count = 0;
-    double **arrptr = (double **)malloc(n * sizeof(double *));
-    for (int i = 0; i < n; i++) {
-        arrptr[i] = (double *)malloc(n * sizeof(double));
-    }
-    if (arrptr == NULL) {
+
+    double *principal_components_matrix = fusion_matrix_alloc((size_t)m * n);
+    if (principal_components_matrix == NULL) {
         printf("%s: Unable to allocate memory!\n", __func__);
         return NULL;
     }
 
+    calculate_principal_components_into(sd_matrix, n, n, eigen_vector, n, m,
+        principal_components_matrix, n);
+    return principal_components_matrix;
+}
+
+int calculate_integrated_support_degree_matrix_into(
+        double *principle_components, int pc_ld,
+        double *contribution_rate, int no_of_contribution_rates_to_use,
+        int no_of_sensors, double *integrated_support) {
+    int n_contribute = no_of_contribution_rates_to_use;
+    int n_sensors = no_of_sensors;
+
+    if ((principle_components == NULL) || (contribution_rate == NULL) ||
+        (n_contribute <= 0) || (n_sensors <= 0) ||
+        (integrated_support == NULL) || (pc_ld < n_sensors)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+
+    double *arr = integrated_support;
     for (int i = 0; i < no_of_sensors; i++) {
-        for (int j = 0; j < n; j++) {
-            arrptr[i][j] = sd_matrix[count];
-            count++;
+        arr[i] = 0.0;
+    }
+
+    /*
+    * Accumulated one principal component (row) at a time, so the rows are
+    * read contiguously; each sensor still sums over j in order.
+    */
+    for (int j = 0; j < n_contribute; j++) {
+        double *pc_row = principle_components + (size_t)j * pc_ld;
+        double rate = contribution_rate[j];
+        for (int i = 0; i < n_sensors; i++) {
+            arr[i] += pc_row[i] * rate;
         }
     }
+    return 0;
+}
 
-    double **principal_components_matrix = (double **)malloc(m *
-        sizeof(double *));
-    for (int i = 0; i < m; i++) {
-        principal_components_matrix[i] = (double *)malloc(n * sizeof(double));
+int calculate_integrated_support_from_eigenpairs_into(
+        double *eigen_value, double *eigen_vector, int eigen_ld,
+        double *contribution_rate, int no_of_contribution_rates_to_use,
+        int no_of_sensors, double *integrated_support) {
+    int n_contribute = no_of_contribution_rates_to_use;
+    int n_sensors = no_of_sensors;
+
+    if ((eigen_value == NULL) || (eigen_vector == NULL) ||
+        (contribution_rate == NULL) || (n_contribute <= 0) ||
+        (n_sensors <= 0) || (integrated_support == NULL) ||
+        (eigen_ld < n_sensors)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
     }
-    if (principal_components_matrix == NULL) {
-        printf("%s: Unable to allocate memory!\n", __func__);
-        return NULL;
+
+    double *arr = integrated_support;
+    for (int i = 0; i < n_sensors; i++) {
+        arr[i] = 0.0;
     }
 
     /*
-    * Matrix Multiplication to calculate principal_components_matrix
+    * Principal component j is lambda_j * v_j, so it is never formed.
     */
-    for (int i = 0; i < m; i++) {
-        for (int j = 0; j < n; j++) {
-            principal_components_matrix[i][j] = 0;
-            for (int k = 0; k < n; k++) {
-                principal_components_matrix[i][j] += eigen_vector[i][k] *
-                arrptr[k][j];
-            }
+    for (int j = 0; j < n_contribute; j++) {
+        double *eigen_row = eigen_vector + (size_t)j * eigen_ld;
+        double scale = contribution_rate[j] * eigen_value[j];
+        for (int i = 0; i < n_sensors; i++) {
+            arr[i] += eigen_row[i] * scale;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Steps 5 to 9 shared between threads, each over its range of sensors.
+ */
+typedef struct Parallel_Fused_Output
+{
+    struct eigen_systems *eigen;
+    double *contribution_rate;
+    int no_of_contribution_rates_to_use;
+    double *sensor_array;
+    double *integrated_support;
+    double *weight_coefficient;
+    int no_of_sensors;
+    double limit;
+    /**< Integrated support below which a sensor is eliminated */
+    double sum;
+    /**< Integrated support of every sensor left */
+    double partial[FUSION_MAX_THREADS * DOUBLES_PER_ALIGNMENT];
+    /**< Partial sum of each thread */
+} Parallel_Fused_Output_t;
+
+static void integrated_support_task(void *arg, int thread,
+    int no_of_threads) {
+    Parallel_Fused_Output_t *task = (Parallel_Fused_Output_t *)arg;
+    double *support = task->integrated_support;
+    double partial = 0;
+    int first, last;
+
+    fusion_thread_share(task->no_of_sensors, thread, no_of_threads, &first,
+        &last);
+    for (int i = first; i < last; i++) {
+        support[i] = 0.0;
+    }
+    for (int j = 0; j < task->no_of_contribution_rates_to_use; j++) {
+        double *eigen_row = task->eigen->eigen_vector +
+            (size_t)j * task->eigen->leading_dimension;
+        double scale = task->contribution_rate[j] *
+            task->eigen->eigen_value[j];
+        for (int i = first; i < last; i++) {
+            support[i] += eigen_row[i] * scale;
+        }
+    }
+    for (int i = first; i < last; i++) {
+        partial += support[i];
+    }
+    PARTIAL(task->partial, thread) = partial;
+}
+
+static void eliminate_task(void *arg, int thread, int no_of_threads) {
+    Parallel_Fused_Output_t *task = (Parallel_Fused_Output_t *)arg;
+    double *support = task->integrated_support;
+    double partial = 0;
+    int first, last;
+
+    fusion_thread_share(task->no_of_sensors, thread, no_of_threads, &first,
+        &last);
+    for (int i = first; i < last; i++) {
+        if (fabs(support[i]) < task->limit) {
+            support[i] = 0;
         }
+        partial += support[i];
+    }
+    PARTIAL(task->partial, thread) = partial;
+}
+
+static void weighted_sum_task(void *arg, int thread, int no_of_threads) {
+    Parallel_Fused_Output_t *task = (Parallel_Fused_Output_t *)arg;
+    double partial = 0;
+    int first, last;
+
+    fusion_thread_share(task->no_of_sensors, thread, no_of_threads, &first,
+        &last);
+    for (int i = first; i < last; i++) {
+        task->weight_coefficient[i] = task->integrated_support[i] / task->sum;
+        partial += task->weight_coefficient[i] * task->sensor_array[i];
+    }
+    PARTIAL(task->partial, thread) = partial;
+}
+
+/*
+ * Sum of the partial sums of the threads of a pool, in thread order.
+ */
+static double sum_partials(Fusion_Thread_Pool_t *pool, double *partial) {
+    int no_of_threads = (pool != NULL && pool->no_of_threads > 1) ?
+        pool->no_of_threads : 1;
+    double sum = 0;
+
+    for (int t = 0; t < no_of_threads; t++) {
+        sum += PARTIAL(partial, t);
+    }
+    return sum;
+}
+
+int calculate_fused_output_parallel(Fusion_Workspace_t *workspace,
+    struct eigen_systems *eigen, int no_of_contribution_rates_to_use,
+    double fault_tolerance, int no_of_sensors, double *fused_value) {
+    if (workspace == NULL || eigen == NULL || eigen->eigen_value == NULL ||
+        eigen->eigen_vector == NULL || no_of_contribution_rates_to_use <= 0 ||
+        no_of_sensors <= 0 || no_of_sensors > workspace->capacity ||
+        eigen->leading_dimension < no_of_sensors || fused_value == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
     }
+    Fusion_Thread_Pool_t *pool = fusion_workspace_parallel(workspace,
+        no_of_sensors) ? workspace->thread_pool : NULL;
+    Parallel_Fused_Output_t task;
+
+    task.eigen = eigen;
+    task.contribution_rate = workspace->contribution_rate;
+    task.no_of_contribution_rates_to_use = no_of_contribution_rates_to_use;
+    task.sensor_array = workspace->sensor_array;
+    task.integrated_support = workspace->integrated_support;
+    task.weight_coefficient = workspace->weight_coefficient;
+    task.no_of_sensors = no_of_sensors;
 
     /*
-    * Pointer Memory freed
+    * The mean of eliminate_incorrect_data() is over no_of_sensors + 1.
     */
-    for (int i = 0; i < no_of_sensors; i++) {
-        free(arrptr[i]);
-    }
-    free(arrptr);
-    return principal_components_matrix;
+    fusion_thread_pool_run(pool, integrated_support_task, &task);
+    task.limit = fabs(fault_tolerance * (sum_partials(pool, task.partial) /
+        (no_of_sensors + 1)));
+    fusion_thread_pool_run(pool, eliminate_task, &task);
+    task.sum = sum_partials(pool, task.partial);
+    fusion_thread_pool_run(pool, weighted_sum_task, &task);
+    *fused_value = sum_partials(pool, task.partial);
+    return 0;
 }
 
 double *calculate_integrated_support_degree_matrix(
-        double **principle_components,
+        double *principle_components,
         double *contribution_rate, int no_of_contribution_rates_to_use,
         int no_of_sensors) {
     int n_contribute = no_of_contribution_rates_to_use;
@@ -255,15 +2992,8 @@ double *calculate_integrated_support_degree_matrix(
         return NULL;
     }
 
-    for (int i = 0; i < no_of_sensors; i++) {
-        arr[i] = 0.0;
-    }
-
-    for (int i = 0; i < n_sensors; i++) {
-        for (int j = 0; j < n_contribute; j++) {
-            arr[i] += principle_components[j][i] * contribution_rate[j];
-        }
-    }
+    calculate_integrated_support_degree_matrix_into(principle_components,
+        n_sensors, contribution_rate, n_contribute, n_sensors, arr);
     return arr;
 }
 
@@ -294,11 +3024,33 @@ int eliminate_incorrect_data(double *integrate_support_degree_matrix,
     return 0;
 }
 
+int calculate_weight_coefficient_into(double *integrate_support_degree_matrix,
+                                     int no_of_sensors,
+                                     double *weight_coefficient) {
+    int n_sensors = no_of_sensors;
+    double *integrate_matrix = integrate_support_degree_matrix;
+    double *arr = weight_coefficient;
+    double sum = 0;
+
+    if ((integrate_matrix == NULL) || (n_sensors <= 0) || (arr == NULL)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+
+    for (int i = 0; i < n_sensors; i++) {
+        sum += integrate_matrix[i];
+    }
+
+    for (int i = 0; i < n_sensors; i++) {
+        arr[i] = integrate_matrix[i] / sum;
+    }
+    return 0;
+}
+
 double *calculate_weight_coefficient(double *integrate_support_degree_matrix,
                                      int no_of_sensors) {
     int n_sensors = no_of_sensors;
     double *integrate_matrix = integrate_support_degree_matrix;
-    double sum = 0;
 
     if ((integrate_matrix == NULL) || (n_sensors <= 0)) {
         printf("%s: Incorrect Input\n", __func__);
@@ -311,17 +3063,7 @@ double *calculate_weight_coefficient(double *integrate_support_degree_matrix,
         return NULL;
     }
 
-    for (int i = 0; i < n_sensors; i++) {
-        arr[i] = 0.0;
-    }
-
-    for (int i = 0; i < n_sensors; i++) {
-        sum += integrate_matrix[i];
-    }
-
-    for (int i = 0; i < n_sensors; i++) {
-        arr[i] = integrate_matrix[i] / sum;
-    }
+    calculate_weight_coefficient_into(integrate_matrix, n_sensors, arr);
     return arr;
 }
 
@@ -0,0 +1,321 @@
+/**
+ * @file checkpoint.c
+ *
+ * @brief Implementation of checkpoint and restore of the sensor state.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include "checkpoint.h"
+
+/*
+ * Header at the start of a checkpoint file. It is followed by the nodes of
+ * each sensor list (in list order), then by the registry records (in sensor
+ * ID order).
+ */
+typedef struct Checkpoint_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    Checkpoint_Position_t position;
+    int32_t list_counts[MAX_SENSOR_LISTS];
+    int32_t no_of_records;
+} Checkpoint_Header_t;
+
+/*
+ * A sensor list node as stored in a checkpoint file.
+ */
+typedef struct Checkpoint_Node
+{
+    int32_t time_in_minutes;
+    float sensor_value;
+    char sensor_name[MAX_SENSOR_NAME_SIZE];
+} Checkpoint_Node_t;
+
+/*
+ * Lays out the whole checkpoint in memory: the header, the nodes of each
+ * sensor list and the registry records. Returns NULL if it can't be
+ * allocated.
+ */
+static char *format_checkpoint(Checkpoint_Position_t *position,
+                               Node_t **sensor_lists,
+                               Sensor_Registry_t *registry,
+                               size_t *size) {
+    Checkpoint_Header_t *header;
+    Checkpoint_Node_t *saved_node;
+    Node_t *node;
+    char *buffer;
+    int no_of_nodes = 0;
+    int list_counts[MAX_SENSOR_LISTS];
+    int i;
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        list_counts[i] = count(sensor_lists[i]);
+        no_of_nodes += list_counts[i];
+    }
+
+    *size = sizeof(Checkpoint_Header_t) +
+            no_of_nodes * sizeof(Checkpoint_Node_t) +
+            registry->no_of_sensors * sizeof(Sensor_Record_t);
+    buffer = calloc(1, *size);
+    if (buffer == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return NULL;
+    }
+
+    header = (Checkpoint_Header_t *)buffer;
+    memcpy(header->magic, CHECKPOINT_FILE_MAGIC, sizeof(header->magic));
+    header->version = CHECKPOINT_FILE_VERSION;
+    header->record_size = sizeof(Sensor_Record_t);
+    header->position = *position;
+    header->no_of_records = registry->no_of_sensors;
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        header->list_counts[i] = list_counts[i];
+    }
+
+    saved_node = (Checkpoint_Node_t *)(header + 1);
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        for (node = sensor_lists[i]; node; node = node->next) {
+            saved_node->time_in_minutes = node->time_in_minutes;
+            saved_node->sensor_value = node->sensor_value;
+            memcpy(saved_node->sensor_name, node->sensor_name,
+                   MAX_SENSOR_NAME_SIZE);
+            saved_node++;
+        }
+    }
+
+    if (registry->no_of_sensors > 0) {
+        memcpy(saved_node, registry->records,
+               registry->no_of_sensors * sizeof(Sensor_Record_t));
+    }
+
+    return buffer;
+}
+
+/*
+ * Writes a formatted checkpoint to a temporary file, then renames it into
+ * place. Only async-signal-safe calls are made, so that it can run in a
+ * child forked from a process with several threads. Errors are left in
+ * errno for the caller to report.
+ */
+static Boolean write_checkpoint_file(char *file_name,
+                                     char *tmp_file_name,
+                                     char *buffer,
+                                     size_t size) {
+    ssize_t written;
+    Boolean rc = TRUE;
+    int fd;
+
+    fd = open(tmp_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return FALSE;
+    }
+
+    while (rc && (size > 0)) {
+        written = write(fd, buffer, size);
+        if (written < 0) {
+            rc = (errno == EINTR);
+            continue;
+        }
+        buffer += written;
+        size -= written;
+    }
+
+    rc = (fsync(fd) == 0) && rc;
+    rc = (close(fd) == 0) && rc;
+    if (!rc || (rename(tmp_file_name, file_name) != 0)) {
+        unlink(tmp_file_name);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+Boolean checkpoint_write(char *file_name,
+                         Checkpoint_Position_t *position,
+                         Node_t **sensor_lists,
+                         Sensor_Registry_t *registry) {
+    char tmp_file_name[MAX_FILE_NAME_SIZE + 8];
+    char *buffer;
+    size_t size;
+    Boolean rc;
+
+    buffer = format_checkpoint(position, sensor_lists, registry, &size);
+    if (buffer == NULL) {
+        return FALSE;
+    }
+
+    snprintf(tmp_file_name, sizeof(tmp_file_name), "%s.tmp", file_name);
+    rc = write_checkpoint_file(file_name, tmp_file_name, buffer, size);
+    if (!rc) {
+        printf("Error writing checkpoint file %s - %s\n",
+               file_name, strerror(errno));
+    }
+
+    free(buffer);
+    return rc;
+}
+
+Boolean checkpoint_start_async(pid_t *checkpoint_pid,
+                               char *file_name,
+                               Checkpoint_Position_t *position,
+                               Node_t **sensor_lists,
+                               Sensor_Registry_t *registry) {
+    char tmp_file_name[MAX_FILE_NAME_SIZE + 8];
+    char *buffer;
+    size_t size;
+    pid_t pid;
+
+    if (*checkpoint_pid > 0) {
+        if (waitpid(*checkpoint_pid, NULL, WNOHANG) == 0) {
+            /*
+             * The last checkpoint is still being written. Rather than stall
+             * ingest waiting for it, this one is skipped.
+             */
+            return FALSE;
+        }
+        *checkpoint_pid = 0;
+    }
+
+    /*
+     * Other threads (the snapshot server, the fusion pool) may hold locks,
+     * such as the allocator's, at the time of the fork, and the child only
+     * gets a copy of this one. Everything is formatted here, so the child
+     * only has to write it out with async-signal-safe calls.
+     */
+    buffer = format_checkpoint(position, sensor_lists, registry, &size);
+    if (buffer == NULL) {
+        return FALSE;
+    }
+    snprintf(tmp_file_name, sizeof(tmp_file_name), "%s.tmp", file_name);
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        _exit(write_checkpoint_file(file_name, tmp_file_name, buffer, size) ?
+              EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    free(buffer);
+    if (pid < 0) {
+        printf("%s: Unable to fork - %s\n", __func__, strerror(errno));
+        return FALSE;
+    }
+
+    *checkpoint_pid = pid;
+    return TRUE;
+}
+
+Boolean checkpoint_wait(pid_t *checkpoint_pid) {
+    int status;
+    pid_t pid = *checkpoint_pid;
+
+    if (pid <= 0) {
+        return TRUE;
+    }
+
+    *checkpoint_pid = 0;
+    if (waitpid(pid, &status, 0) != pid) {
+        return FALSE;
+    }
+
+    return WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+Boolean checkpoint_read(char *file_name,
+                        Checkpoint_Position_t *position,
+                        Node_t **sensor_lists,
+                        Sensor_Registry_t *registry) {
+    Checkpoint_Header_t header;
+    Checkpoint_Node_t *saved_nodes = NULL;
+    Sensor_Record_t *records = NULL;
+    Node_t *tail;
+    Node_t *node;
+    FILE *fp;
+    Boolean rc;
+    int no_of_nodes = 0;
+    int id;
+    int i;
+    int j;
+
+    fp = fopen(file_name, "rb");
+    if (fp == NULL) {
+        return FALSE;
+    }
+
+    rc = (fread(&header, sizeof(header), 1, fp) == 1) &&
+         (memcmp(header.magic, CHECKPOINT_FILE_MAGIC,
+                 sizeof(header.magic)) == 0) &&
+         (header.version == CHECKPOINT_FILE_VERSION) &&
+         (header.record_size == sizeof(Sensor_Record_t)) &&
+         (header.no_of_records >= 0);
+    for (i = 0; rc && (i < MAX_SENSOR_LISTS); i++) {
+        rc = (header.list_counts[i] >= 0);
+        no_of_nodes += header.list_counts[i];
+    }
+
+    /*
+     * Everything is read in before any state is touched, so that a bad
+     * checkpoint leaves the caller as it was.
+     */
+    if (rc) {
+        saved_nodes = malloc((no_of_nodes + 1) * sizeof(Checkpoint_Node_t));
+        records = malloc((header.no_of_records + 1) * sizeof(Sensor_Record_t));
+        rc = saved_nodes && records &&
+             (fread(saved_nodes, sizeof(Checkpoint_Node_t), no_of_nodes, fp) ==
+              (size_t)no_of_nodes) &&
+             (fread(records, sizeof(Sensor_Record_t), header.no_of_records,
+                    fp) == (size_t)header.no_of_records);
+    }
+    fclose(fp);
+
+    if (!rc) {
+        printf("Checkpoint file %s is not usable, ignoring it\n", file_name);
+        free(saved_nodes);
+        free(records);
+        return FALSE;
+    }
+
+    no_of_nodes = 0;
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        while (sensor_lists[i]) {
+            sensor_lists[i] = remove_from_front(sensor_lists[i]);
+        }
+
+        tail = NULL;
+        for (j = 0; j < header.list_counts[i]; j++, no_of_nodes++) {
+            saved_nodes[no_of_nodes].sensor_name[MAX_SENSOR_NAME_SIZE - 1] =
+                '\0';
+            node = create(saved_nodes[no_of_nodes].time_in_minutes,
+                          saved_nodes[no_of_nodes].sensor_name,
+                          saved_nodes[no_of_nodes].sensor_value,
+                          NULL);
+            if (tail) {
+                tail->next = node;
+            } else {
+                sensor_lists[i] = node;
+            }
+            tail = node;
+        }
+    }
+
+    registry_clear(registry);
+    for (i = 0; i < header.no_of_records; i++) {
+        records[i].sensor_name[MAX_SENSOR_NAME_SIZE - 1] = '\0';
+        id = registry_register_sensor(registry, records[i].sensor_name, NULL);
+        if (id >= 0) {
+            registry->records[id] = records[i];
+        }
+    }
+
+    *position = header.position;
+    free(saved_nodes);
+    free(records);
+    return TRUE;
+}
@@ -0,0 +1,331 @@
+/**
+ * @file exp_kernel.c
+ *
+ * @brief Implementation of the exp(-|x - y|) kernels.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include "exp_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EXP_KERNEL_X86
+#endif
+
+/*
+ * The kernels must round every multiply and add on its own for their results
+ * to match, so contracting them into fused multiply-adds is not allowed.
+ */
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+/*
+ * exp(t) is computed as 2^k * exp(r), with k = round(t / ln 2) and
+ * r = t - k ln 2 (|r| <= ln 2 / 2). ln 2 is split in two (Cody-Waite) so that
+ * k * EXP_LN2_HI is exact, and exp(r) is its Taylor series up to r^13, whose
+ * truncation error is below 0.05 ULP. k is rounded by adding EXP_SHIFT
+ * (1.5 * 2^52), which leaves k in the low bits of the sum.
+ */
+#define EXP_LOG2E   1.4426950408889634074
+#define EXP_LN2_HI  6.93147180369123816490e-01
+#define EXP_LN2_LO  1.90821492927058770002e-10
+#define EXP_SHIFT   6755399441055744.0
+
+#define EXP_C13     1.6059043836821613e-10
+#define EXP_C12     2.08767569878681e-09
+#define EXP_C11     2.505210838544172e-08
+#define EXP_C10     2.755731922398589e-07
+#define EXP_C9      2.7557319223985893e-06
+#define EXP_C8      2.48015873015873e-05
+#define EXP_C7      0.0001984126984126984
+#define EXP_C6      0.001388888888888889
+#define EXP_C5      0.008333333333333333
+#define EXP_C4      0.041666666666666664
+#define EXP_C3      0.16666666666666666
+#define EXP_C2      0.5
+
+#define EXP_BIAS    ((uint64_t)1023 << 52)
+
+typedef void (*Exp_Row_Function_t)(double x, double *values, int count,
+                                   double *row);
+
+static void reference_row(double x, double *values, int count, double *row) {
+    for (int j = 0; j < count; j++) {
+        row[j] = exp(-1 * fabs(x - values[j]));
+    }
+}
+
+/*
+ * Polynomial exp(-|x - value|), the operations every vector kernel repeats
+ * lane by lane.
+ */
+static inline double portable_exp(double x, double value) {
+    union { double d; uint64_t u; } z, scale;
+    double t = -fabs(x - value);
+    double c = (EXP_KERNEL_MIN_ARGUMENT > t) ? EXP_KERNEL_MIN_ARGUMENT : t;
+
+    z.d = c * EXP_LOG2E + EXP_SHIFT;
+    double k = z.d - EXP_SHIFT;
+    double r = c - k * EXP_LN2_HI;
+    r = r - k * EXP_LN2_LO;
+
+    double p = EXP_C13;
+    p = p * r + EXP_C12;
+    p = p * r + EXP_C11;
+    p = p * r + EXP_C10;
+    p = p * r + EXP_C9;
+    p = p * r + EXP_C8;
+    p = p * r + EXP_C7;
+    p = p * r + EXP_C6;
+    p = p * r + EXP_C5;
+    p = p * r + EXP_C4;
+    p = p * r + EXP_C3;
+    p = p * r + EXP_C2;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    scale.u = (z.u << 52) + EXP_BIAS;
+    return (t < EXP_KERNEL_MIN_ARGUMENT) ? 0 : p * scale.d;
+}
+
+static void portable_row(double x, double *values, int count, double *row) {
+    for (int j = 0; j < count; j++) {
+        row[j] = portable_exp(x, values[j]);
+    }
+}
+
+#ifdef EXP_KERNEL_X86
+
+__attribute__((target("sse2")))
+static void sse2_row(double x, double *values, int count, double *row) {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d min = _mm_set1_pd(EXP_KERNEL_MIN_ARGUMENT);
+    const __m128d shift = _mm_set1_pd(EXP_SHIFT);
+    const __m128i bias = _mm_set1_epi64x(EXP_BIAS);
+    __m128d vx = _mm_set1_pd(x);
+    int j = 0;
+
+    for (; j + 2 <= count; j += 2) {
+        __m128d t = _mm_or_pd(_mm_sub_pd(vx, _mm_loadu_pd(values + j)), sign);
+        /* max(min, t) keeps t if it is NaN, like the portable kernel. */
+        __m128d c = _mm_max_pd(min, t);
+        __m128d z = _mm_add_pd(_mm_mul_pd(c, _mm_set1_pd(EXP_LOG2E)), shift);
+        __m128d k = _mm_sub_pd(z, shift);
+        __m128d r = _mm_sub_pd(c, _mm_mul_pd(k, _mm_set1_pd(EXP_LN2_HI)));
+        r = _mm_sub_pd(r, _mm_mul_pd(k, _mm_set1_pd(EXP_LN2_LO)));
+
+        __m128d p = _mm_set1_pd(EXP_C13);
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C12));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C11));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C10));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C9));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C8));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C7));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C6));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C5));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C4));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C3));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(EXP_C2));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+        p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(1.0));
+
+        __m128d scale = _mm_castsi128_pd(_mm_add_epi64(
+            _mm_slli_epi64(_mm_castpd_si128(z), 52), bias));
+        __m128d underflow = _mm_cmplt_pd(t, min);
+        _mm_storeu_pd(row + j, _mm_andnot_pd(underflow, _mm_mul_pd(p, scale)));
+    }
+
+    for (; j < count; j++) {
+        row[j] = portable_exp(x, values[j]);
+    }
+}
+
+__attribute__((target("avx2")))
+static void avx2_row(double x, double *values, int count, double *row) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d min = _mm256_set1_pd(EXP_KERNEL_MIN_ARGUMENT);
+    const __m256d shift = _mm256_set1_pd(EXP_SHIFT);
+    const __m256i bias = _mm256_set1_epi64x(EXP_BIAS);
+    __m256d vx = _mm256_set1_pd(x);
+    int j = 0;
+
+    for (; j + 4 <= count; j += 4) {
+        __m256d t = _mm256_or_pd(_mm256_sub_pd(vx,
+            _mm256_loadu_pd(values + j)), sign);
+        __m256d c = _mm256_max_pd(min, t);
+        __m256d z = _mm256_add_pd(_mm256_mul_pd(c,
+            _mm256_set1_pd(EXP_LOG2E)), shift);
+        __m256d k = _mm256_sub_pd(z, shift);
+        __m256d r = _mm256_sub_pd(c, _mm256_mul_pd(k,
+            _mm256_set1_pd(EXP_LN2_HI)));
+        r = _mm256_sub_pd(r, _mm256_mul_pd(k, _mm256_set1_pd(EXP_LN2_LO)));
+
+        __m256d p = _mm256_set1_pd(EXP_C13);
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C12));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C11));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C10));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C9));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C8));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C7));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C6));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C5));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C4));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C3));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(EXP_C2));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0));
+        p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(1.0));
+
+        __m256d scale = _mm256_castsi256_pd(_mm256_add_epi64(
+            _mm256_slli_epi64(_mm256_castpd_si256(z), 52), bias));
+        __m256d underflow = _mm256_cmp_pd(t, min, _CMP_LT_OQ);
+        _mm256_storeu_pd(row + j, _mm256_andnot_pd(underflow,
+            _mm256_mul_pd(p, scale)));
+    }
+
+    for (; j < count; j++) {
+        row[j] = portable_exp(x, values[j]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void avx512_row(double x, double *values, int count, double *row) {
+    const __m512i sign = _mm512_castpd_si512(_mm512_set1_pd(-0.0));
+    const __m512d min = _mm512_set1_pd(EXP_KERNEL_MIN_ARGUMENT);
+    const __m512d shift = _mm512_set1_pd(EXP_SHIFT);
+    const __m512i bias = _mm512_set1_epi64(EXP_BIAS);
+    __m512d vx = _mm512_set1_pd(x);
+    int j = 0;
+
+    for (; j + 8 <= count; j += 8) {
+        __m512d t = _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(
+            _mm512_sub_pd(vx, _mm512_loadu_pd(values + j))), sign));
+        __m512d c = _mm512_max_pd(min, t);
+        __m512d z = _mm512_add_pd(_mm512_mul_pd(c,
+            _mm512_set1_pd(EXP_LOG2E)), shift);
+        __m512d k = _mm512_sub_pd(z, shift);
+        __m512d r = _mm512_sub_pd(c, _mm512_mul_pd(k,
+            _mm512_set1_pd(EXP_LN2_HI)));
+        r = _mm512_sub_pd(r, _mm512_mul_pd(k, _mm512_set1_pd(EXP_LN2_LO)));
+
+        __m512d p = _mm512_set1_pd(EXP_C13);
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C12));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C11));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C10));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C9));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C8));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C7));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C6));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C5));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C4));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C3));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(EXP_C2));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(1.0));
+        p = _mm512_add_pd(_mm512_mul_pd(p, r), _mm512_set1_pd(1.0));
+
+        __m512d scale = _mm512_castsi512_pd(_mm512_add_epi64(
+            _mm512_slli_epi64(_mm512_castpd_si512(z), 52), bias));
+        __mmask8 underflow = _mm512_cmp_pd_mask(t, min, _CMP_LT_OQ);
+        _mm512_storeu_pd(row + j, _mm512_maskz_mov_pd(
+            (__mmask8)~underflow, _mm512_mul_pd(p, scale)));
+    }
+
+    for (; j < count; j++) {
+        row[j] = portable_exp(x, values[j]);
+    }
+}
+
+#endif
+
+/*
+ * Dispatch table, indexed by Exp_Kernel_t. Kernels the build can't provide
+ * fall back to the portable one and are reported as unsupported.
+ */
+static const struct {
+    const char *name;
+    Exp_Row_Function_t row;
+} exp_kernels[EXP_KERNEL_COUNT] = {
+    {"reference", reference_row},
+    {"portable", portable_row},
+#ifdef EXP_KERNEL_X86
+    {"sse2", sse2_row},
+    {"avx2", avx2_row},
+    {"avx512", avx512_row},
+#else
+    {"sse2", portable_row},
+    {"avx2", portable_row},
+    {"avx512", portable_row},
+#endif
+};
+
+/*
+ * Selected kernel, or -1 until the first use.
+ */
+static int selected_kernel = -1;
+
+Boolean exp_kernel_supported(Exp_Kernel_t kernel) {
+    switch (kernel) {
+    case EXP_KERNEL_REFERENCE:
+    case EXP_KERNEL_PORTABLE:
+        return TRUE;
+#ifdef EXP_KERNEL_X86
+    case EXP_KERNEL_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2") ? TRUE : FALSE;
+    case EXP_KERNEL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+    case EXP_KERNEL_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") ? TRUE : FALSE;
+#endif
+    default:
+        return FALSE;
+    }
+}
+
+Boolean exp_kernel_select(Exp_Kernel_t kernel) {
+    if (!exp_kernel_supported(kernel)) {
+        return FALSE;
+    }
+
+    __atomic_store_n(&selected_kernel, (int)kernel, __ATOMIC_RELAXED);
+    return TRUE;
+}
+
+Exp_Kernel_t exp_kernel_selected(void) {
+    int kernel = __atomic_load_n(&selected_kernel, __ATOMIC_RELAXED);
+
+    if (kernel < 0) {
+        /*
+         * Fastest kernel the CPU supports. Every engine that races here picks
+         * the same one, so the race is harmless.
+         */
+        kernel = EXP_KERNEL_COUNT - 1;
+        while (!exp_kernel_supported((Exp_Kernel_t)kernel)) {
+            kernel--;
+        }
+        __atomic_store_n(&selected_kernel, kernel, __ATOMIC_RELAXED);
+    }
+
+    return (Exp_Kernel_t)kernel;
+}
+
+const char *exp_kernel_name(Exp_Kernel_t kernel) {
+    if ((int)kernel < 0 || kernel >= EXP_KERNEL_COUNT) {
+        return "unknown";
+    }
+
+    return exp_kernels[kernel].name;
+}
+
+void exp_kernel_row(double x, double *values, int count, double *row) {
+    exp_kernels[exp_kernel_selected()].row(x, values, count, row);
+}
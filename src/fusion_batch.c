@@ -0,0 +1,365 @@
+/**
+ * @file fusion_batch.c
+ *
+ * @brief Implementation of the batched fusion of many small epochs.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fusion_batch.h"
+#include "exp_kernel.h"
+
+#define LANES FUSION_BATCH_LANES
+
+/*
+ * Most Jacobi sweeps made for a block. Once the off-diagonal is small each
+ * sweep about squares it, so a handful is usual.
+ */
+#define BATCH_JACOBI_MAX_SWEEPS 50
+
+/*
+ * Same threshold as the eigensolvers of calculate_fusion.c, so that the
+ * eigenvectors come out the same way round.
+ */
+#define BATCH_EIGENVECTOR_SIGN_EPSILON 1e-12
+
+/*
+ * Lane l of entry (i, j) of an n by n matrix of the block.
+ */
+#define LANE(m, i, j, l) (m)[((size_t)(i) * n + (j)) * LANES + (l)]
+
+/*
+ * Buffers of one block, with n sensors per epoch.
+ */
+typedef struct Batch_Block
+{
+    double *x;          /* Sensor values (n by LANES) */
+    double *a;          /* Support degree matrix, diagonalized in place */
+    double *v;          /* Eigenvectors, one per row */
+    double *difference; /* Differences of a row of sensor values */
+    double *rate;       /* Contribution rate of each eigenvalue */
+    double *support;    /* Integrated support of each sensor */
+    double norm[LANES]; /* Squared norm of each support degree matrix */
+} Batch_Block_t;
+
+/*
+ * Finds the rotation of each lane that zeroes a_pq and applies it to a_pp,
+ * a_qq and a_pq. t is the tangent of the smaller angle, with
+ * 2 a_pq / (d + sqrt(d^2 + 4 a_pq^2)) in place of 1 / (theta +
+ * sqrt(theta^2 + 1)) so that nothing is divided by a_pq; a lane where a_pq
+ * and d are both zero is rotated by the identity.
+ */
+static void rotation_lanes(double *restrict app, double *restrict aqq,
+                           double *restrict apq, double *restrict c,
+                           double *restrict s) {
+    for (int l = 0; l < LANES; l++) {
+        double d = aqq[l] - app[l];
+        double numerator = (d >= 0) ? 2 * apq[l] : -2 * apq[l];
+        double denominator = fabs(d) + sqrt(d * d + 4 * apq[l] * apq[l]);
+        double t = (denominator > 0) ? numerator / denominator : 0;
+        c[l] = 1 / sqrt(t * t + 1);
+        s[l] = t * c[l];
+        app[l] -= t * apq[l];
+        aqq[l] += t * apq[l];
+        apq[l] = 0;
+    }
+}
+
+/*
+ * Rotates the pairs (x, y) of each lane by that lane's rotation.
+ */
+static void rotate_lanes(double *restrict x, double *restrict y,
+                         const double *restrict c,
+                         const double *restrict s) {
+    for (int l = 0; l < LANES; l++) {
+        double x_l = x[l];
+        double y_l = y[l];
+        x[l] = c[l] * x_l - s[l] * y_l;
+        y[l] = s[l] * x_l + c[l] * y_l;
+    }
+}
+
+/*
+ * Diagonalizes the support degree matrices of a block by cyclic Jacobi
+ * sweeps, made for every lane until the off-diagonal of every lane is
+ * negligible. A lane with nothing left to rotate is rotated by the identity.
+ */
+static Boolean jacobi_block(Batch_Block_t *block, int n) {
+    double *a = block->a;
+    double *v = block->v;
+    double c[LANES], s[LANES];
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            for (int l = 0; l < LANES; l++) {
+                LANE(v, i, j, l) = (i == j) ? 1 : 0;
+            }
+        }
+    }
+
+    for (int sweep = 0; sweep <= BATCH_JACOBI_MAX_SWEEPS; sweep++) {
+        double off[LANES] = {0};
+        Boolean converged = TRUE;
+        for (int p = 0; p < n - 1; p++) {
+            for (int q = p + 1; q < n; q++) {
+                for (int l = 0; l < LANES; l++) {
+                    off[l] += LANE(a, p, q, l) * LANE(a, p, q, l);
+                }
+            }
+        }
+        for (int l = 0; l < LANES; l++) {
+            if (off[l] > DBL_EPSILON * DBL_EPSILON * block->norm[l]) {
+                converged = FALSE;
+            }
+        }
+        if (converged) {
+            return TRUE;
+        }
+        if (sweep == BATCH_JACOBI_MAX_SWEEPS) {
+            break;
+        }
+
+        for (int p = 0; p < n - 1; p++) {
+            for (int q = p + 1; q < n; q++) {
+                rotation_lanes(&LANE(a, p, p, 0), &LANE(a, q, q, 0),
+                    &LANE(a, p, q, 0), c, s);
+                memcpy(&LANE(a, q, p, 0), &LANE(a, p, q, 0),
+                    sizeof(double) * LANES);
+                for (int r = 0; r < n; r++) {
+                    if (r == p || r == q) {
+                        continue;
+                    }
+                    rotate_lanes(&LANE(a, r, p, 0), &LANE(a, r, q, 0), c, s);
+                    memcpy(&LANE(a, p, r, 0), &LANE(a, r, p, 0),
+                        sizeof(double) * LANES);
+                    memcpy(&LANE(a, q, r, 0), &LANE(a, r, q, 0),
+                        sizeof(double) * LANES);
+                }
+                for (int k = 0; k < n; k++) {
+                    rotate_lanes(&LANE(v, p, k, 0), &LANE(v, q, k, 0), c, s);
+                }
+            }
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Fuses the LANES epochs of a block whose sensor values are in block->x,
+ * storing the fused output of each lane in fused.
+ */
+static int fuse_block(Batch_Block_t *block, int n, double q_support,
+    float parameter, double *fused) {
+    double *x = block->x;
+    double *a = block->a;
+    double *v = block->v;
+    double *rate = block->rate;
+    double *support = block->support;
+    double sum[LANES];
+
+    /*
+    * Step 1 - support degree matrices, a row of every lane at a time by the
+    * vector exp kernel (exp(-|0 - d|) of each difference d).
+    */
+    for (int l = 0; l < LANES; l++) {
+        block->norm[l] = n;
+    }
+    for (int i = 0; i < n; i++) {
+        int count = (n - i - 1) * LANES;
+        for (int j = i + 1; j < n; j++) {
+            for (int l = 0; l < LANES; l++) {
+                block->difference[(j - i - 1) * LANES + l] =
+                    x[i * LANES + l] - x[j * LANES + l];
+            }
+        }
+        for (int l = 0; l < LANES; l++) {
+            LANE(a, i, i, l) = 1;
+        }
+        if (count > 0) {
+            exp_kernel_row(0, block->difference, count, &LANE(a, i, i + 1, 0));
+        }
+        for (int j = i + 1; j < n; j++) {
+            for (int l = 0; l < LANES; l++) {
+                LANE(a, j, i, l) = LANE(a, i, j, l);
+                block->norm[l] += 2 * LANE(a, i, j, l) * LANE(a, i, j, l);
+            }
+        }
+    }
+
+    /*
+    * Step 2 - eigensystems, left unsorted with the eigenvalues on the
+    * diagonal of a, and each eigenvector turned so that its first
+    * non-negligible component is positive.
+    */
+    if (!jacobi_block(block, n)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        double sign[LANES] = {0};
+        for (int k = 0; k < n; k++) {
+            for (int l = 0; l < LANES; l++) {
+                double component = LANE(v, i, k, l);
+                Boolean first = (sign[l] == 0) &&
+                    (fabs(component) >= BATCH_EIGENVECTOR_SIGN_EPSILON);
+                sign[l] = first ? ((component < 0) ? -1 : 1) : sign[l];
+            }
+        }
+        for (int k = 0; k < n; k++) {
+            for (int l = 0; l < LANES; l++) {
+                LANE(v, i, k, l) *= (sign[l] < 0) ? -1 : 1;
+            }
+        }
+    }
+
+    /*
+    * Step 3 - contribution rates.
+    */
+    for (int l = 0; l < LANES; l++) {
+        sum[l] = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int l = 0; l < LANES; l++) {
+            sum[l] += LANE(a, i, i, l);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int l = 0; l < LANES; l++) {
+            rate[i * LANES + l] = LANE(a, i, i, l) / sum[l];
+        }
+    }
+
+    /*
+    * Steps 4 to 6 - with the eigenvalues unsorted, eigenpair j is used when
+    * the rates of the eigenvalues before it in descending order (ties
+    * broken by index, as the stable sort does) have not reached the
+    * parameter. Its principal component is lambda_j * v_j.
+    */
+    for (int k = 0; k < n * LANES; k++) {
+        support[k] = 0;
+    }
+    for (int j = 0; j < n; j++) {
+        double before[LANES] = {0};
+        double scale[LANES];
+        for (int i = 0; i < n; i++) {
+            for (int l = 0; l < LANES; l++) {
+                double lambda_i = LANE(a, i, i, l);
+                double lambda_j = LANE(a, j, j, l);
+                Boolean ahead = (lambda_i > lambda_j) ||
+                    (lambda_i == lambda_j && i < j);
+                before[l] += ahead ? rate[i * LANES + l] : 0;
+            }
+        }
+        for (int l = 0; l < LANES; l++) {
+            scale[l] = (before[l] < parameter) ?
+                rate[j * LANES + l] * LANE(a, j, j, l) : 0;
+        }
+        for (int k = 0; k < n; k++) {
+            for (int l = 0; l < LANES; l++) {
+                support[k * LANES + l] += LANE(v, j, k, l) * scale[l];
+            }
+        }
+    }
+
+    /*
+    * Step 7 - eliminate_incorrect_data(), with its mean over n + 1.
+    */
+    for (int l = 0; l < LANES; l++) {
+        sum[l] = 0;
+    }
+    for (int k = 0; k < n; k++) {
+        for (int l = 0; l < LANES; l++) {
+            sum[l] += support[k * LANES + l];
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        for (int l = 0; l < LANES; l++) {
+            double limit = fabs(q_support * (sum[l] / (n + 1)));
+            support[k * LANES + l] = (fabs(support[k * LANES + l]) < limit) ?
+                0 : support[k * LANES + l];
+        }
+    }
+
+    /*
+    * Steps 8 and 9 - weight coefficients and the fused output.
+    */
+    for (int l = 0; l < LANES; l++) {
+        sum[l] = 0;
+        fused[l] = 0;
+    }
+    for (int k = 0; k < n; k++) {
+        for (int l = 0; l < LANES; l++) {
+            sum[l] += support[k * LANES + l];
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        for (int l = 0; l < LANES; l++) {
+            fused[l] += (support[k * LANES + l] / sum[l]) * x[k * LANES + l];
+        }
+    }
+    return 0;
+}
+
+int do_sensor_fusion_batch(double   *values,
+                           int      no_of_epochs,
+                           int      no_of_sensors,
+                           double   q_support,
+                           float    parameter,
+                           double   *fused_values) {
+    if (values == NULL || no_of_epochs <= 0 || no_of_sensors <= 0 ||
+        no_of_sensors > FUSION_BATCH_MAX_SENSORS || parameter <= 0 ||
+        parameter > 1 || fused_values == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    size_t matrix_size = (size_t)n * n * LANES;
+    size_t vector_size = (size_t)n * LANES;
+    Batch_Block_t block;
+    double fused[LANES];
+    int status = 0;
+
+    double *buffer = fusion_matrix_alloc(2 * matrix_size + 4 * vector_size);
+    if (buffer == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return -1;
+    }
+    block.a = buffer;
+    block.v = block.a + matrix_size;
+    block.x = block.v + matrix_size;
+    block.difference = block.x + vector_size;
+    block.rate = block.difference + vector_size;
+    block.support = block.rate + vector_size;
+
+    for (int first = 0; first < no_of_epochs && status == 0;
+        first += LANES) {
+        int count = (no_of_epochs - first < LANES) ? no_of_epochs - first :
+            LANES;
+
+        /*
+        * Transposed into lanes; the lanes past the last epoch repeat it, so
+        * that they fuse like any other and their results are dropped.
+        */
+        for (int l = 0; l < LANES; l++) {
+            double *epoch = values +
+                (size_t)(first + ((l < count) ? l : count - 1)) * n;
+            for (int i = 0; i < n; i++) {
+                block.x[i * LANES + l] = epoch[i];
+            }
+        }
+        status = fuse_block(&block, n, q_support, parameter, fused);
+        for (int l = 0; l < count; l++) {
+            fused_values[first + l] = fused[l];
+        }
+    }
+
+    free(buffer);
+    return status;
+}
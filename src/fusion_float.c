@@ -0,0 +1,403 @@
+/**
+ * @file fusion_float.c
+ *
+ * @brief Implementation of the sensor fusion algorithm in single precision.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fusion_float.h"
+
+/*
+ * Number of floats in FUSION_MATRIX_ALIGNMENT bytes, so that every row of a
+ * matrix starts on an aligned boundary.
+ */
+#define FLOATS_PER_ALIGNMENT ((int)(FUSION_MATRIX_ALIGNMENT / sizeof(float)))
+
+/*
+ * Magnitude below which an eigenvector component is taken as zero when
+ * choosing its sign. Float keeps about 7 digits, so this is far above the
+ * rounding noise of a zero component.
+ */
+#define FLOAT_EIGENVECTOR_SIGN_EPSILON 1e-6f
+
+/*
+ * householder_tridiagonalize_float() and implicit_ql_float().
+ */
+#define EIGEN_REAL float
+#define EIGEN_EPSILON FLT_EPSILON
+#define EIGEN_MATH(name) name##f
+#define EIGEN_NAME(name) name##_float
+#include "symmetric_eigen_template.h"
+
+#ifdef HAVE_LAPACK
+/*
+ * Single precision symmetric eigensolver of LAPACK (Fortran calling
+ * convention, with the hidden lengths of the character arguments).
+ */
+extern void ssyevr_(const char *jobz, const char *range, const char *uplo,
+    const int *n, float *a, const int *lda, const float *vl,
+    const float *vu, const int *il, const int *iu, const float *abstol,
+    int *m, float *w, float *z, const int *ldz, int *isuppz, float *work,
+    const int *lwork, int *iwork, const int *liwork, int *info,
+    size_t jobz_length, size_t range_length, size_t uplo_length);
+#endif
+
+/*
+ * Allocates an aligned buffer of no_of_floats floats.
+ */
+static float *float_alloc(size_t no_of_floats) {
+    return (float *)fusion_matrix_alloc((no_of_floats + 1) / 2);
+}
+
+/*
+ * Leading dimension of a float matrix with no_of_columns columns.
+ */
+static int float_leading_dimension(int no_of_columns) {
+    return (no_of_columns + FLOATS_PER_ALIGNMENT - 1) /
+        FLOATS_PER_ALIGNMENT * FLOATS_PER_ALIGNMENT;
+}
+
+void fusion_workspace_float_init(Fusion_Workspace_Float_t *workspace) {
+    memset(workspace, 0, sizeof(Fusion_Workspace_Float_t));
+}
+
+void fusion_workspace_float_free(Fusion_Workspace_Float_t *workspace) {
+    free(workspace->sensor_array);
+    free(workspace->sd_matrix);
+    free(workspace->transform);
+    free(workspace->eigen_value);
+    free(workspace->order);
+    free(workspace->scratch);
+    free(workspace->contribution_rate);
+    free(workspace->integrated_support);
+    free(workspace->weight_coefficient);
+    fusion_workspace_float_init(workspace);
+}
+
+Boolean fusion_workspace_float_prepare(Fusion_Workspace_Float_t *workspace,
+    int no_of_sensors) {
+    if (workspace == NULL || no_of_sensors <= 0) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+    if (no_of_sensors > workspace->capacity) {
+        /*
+        * Grown in the same steps as a Fusion_Workspace_t, so that a run of
+        * slowly growing epochs does not reallocate every time.
+        */
+        int capacity = (workspace->capacity * 2 > no_of_sensors) ?
+            workspace->capacity * 2 : no_of_sensors;
+        size_t matrix_size = (size_t)capacity *
+            float_leading_dimension(capacity);
+
+        fusion_workspace_float_free(workspace);
+        workspace->sensor_array = float_alloc(capacity);
+        workspace->sd_matrix = float_alloc(matrix_size);
+        workspace->transform = float_alloc(matrix_size);
+        workspace->eigen_value = float_alloc(capacity);
+        workspace->order = (int *)malloc((size_t)capacity *
+            EIGEN_INDEX_SCRATCH_PER_SENSOR * sizeof(int));
+        workspace->scratch = float_alloc((size_t)capacity *
+            EIGEN_SCRATCH_PER_SENSOR);
+        workspace->contribution_rate = float_alloc(capacity);
+        workspace->integrated_support = float_alloc(capacity);
+        workspace->weight_coefficient = float_alloc(capacity);
+        if (workspace->sensor_array == NULL || workspace->sd_matrix == NULL ||
+            workspace->transform == NULL || workspace->eigen_value == NULL ||
+            workspace->order == NULL || workspace->scratch == NULL ||
+            workspace->contribution_rate == NULL ||
+            workspace->integrated_support == NULL ||
+            workspace->weight_coefficient == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            fusion_workspace_float_free(workspace);
+            return FALSE;
+        }
+        workspace->capacity = capacity;
+    }
+    workspace->leading_dimension = float_leading_dimension(no_of_sensors);
+    return TRUE;
+}
+
+int calculate_support_degree_matrix_float_into(Node_t *node,
+    int no_of_sensors, float *sensor_array, float *sd_matrix, int sd_ld) {
+    if (node == NULL || no_of_sensors <= 0 || sensor_array == NULL ||
+        sd_matrix == NULL || sd_ld < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int i = 0;
+    while (node != NULL && i < no_of_sensors) {
+        sensor_array[i] = node->sensor_value;
+        node = node->next;
+        i++;
+    }
+
+    for (int i = 0; i < no_of_sensors; i++) {
+        float *row = sd_matrix + (size_t)i * sd_ld;
+        row[i] = 1;
+        for (int j = i + 1; j < no_of_sensors; j++) {
+            row[j] = expf(-fabsf(sensor_array[i] - sensor_array[j]));
+            sd_matrix[(size_t)j * sd_ld + i] = row[j];
+        }
+    }
+    return 0;
+}
+
+#ifdef HAVE_LAPACK
+/*
+ * Solves the eigensystem of workspace->sd_matrix with ssyevr, which returns
+ * the eigenvalues in ascending order.
+ */
+static int solve_eigensystem_float_lapack(Fusion_Workspace_Float_t *workspace,
+    int no_of_sensors) {
+    int n = no_of_sensors;
+    int ld = workspace->leading_dimension;
+    int lwork = EIGEN_SCRATCH_PER_SENSOR * workspace->capacity;
+    int liwork = (EIGEN_INDEX_SCRATCH_PER_SENSOR - 2) * workspace->capacity;
+    int *isuppz = workspace->order + liwork;
+    float *w = workspace->integrated_support;
+    float unused = 0, abstol = 0;
+    int il = 1, no_found = 0, info = 0;
+
+    ssyevr_("V", "A", "L", &n, workspace->sd_matrix, &ld, &unused, &unused,
+        &il, &n, &abstol, &no_found, w, workspace->transform, &ld, isuppz,
+        workspace->scratch, &lwork, workspace->order, &liwork, &info,
+        1, 1, 1);
+    if (info != 0 || no_found != n) {
+        printf("%s: ssyevr failed (info %d)\n", __func__, info);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        workspace->eigen_value[i] = w[n - 1 - i];
+        workspace->order[i] = n - 1 - i;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Solves the eigensystem of workspace->sd_matrix with no library.
+ */
+static int solve_eigensystem_float_builtin(
+    Fusion_Workspace_Float_t *workspace, int no_of_sensors) {
+    int n = no_of_sensors;
+    int ld = workspace->leading_dimension;
+    float *matrix = workspace->sd_matrix;
+    float *vt = workspace->transform;
+    float *d = workspace->integrated_support;
+    float *e = workspace->scratch;
+    int *order = workspace->order;
+
+    householder_tridiagonalize_float(matrix, n, ld, d, e);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            vt[(size_t)j * ld + i] = matrix[(size_t)i * ld + j];
+        }
+    }
+    if (!implicit_ql_float(vt, n, ld, n, d, e)) {
+        printf("%s: Eigenvalues did not converge\n", __func__);
+        return -1;
+    }
+
+    /*
+    * Insertion sort of the eigenvalues in descending order, as for double.
+    */
+    for (int i = 0; i < n; i++) {
+        int k = i;
+        while (k > 0 && d[order[k - 1]] < d[i]) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+    for (int i = 0; i < n; i++) {
+        workspace->eigen_value[i] = d[order[i]];
+    }
+    return 0;
+}
+
+int calculate_eigensystem_float_into(Fusion_Workspace_Float_t *workspace,
+    int no_of_sensors, Eigen_Backend_t backend) {
+    if (workspace == NULL || no_of_sensors <= 0 ||
+        no_of_sensors > workspace->capacity ||
+        workspace->leading_dimension < no_of_sensors) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    int ld = workspace->leading_dimension;
+    int status;
+
+#ifdef HAVE_LAPACK
+    if (backend == EIGEN_BACKEND_LAPACK) {
+        status = solve_eigensystem_float_lapack(workspace, n);
+    } else {
+        status = solve_eigensystem_float_builtin(workspace, n);
+    }
+#else
+    (void)backend;
+    status = solve_eigensystem_float_builtin(workspace, n);
+#endif
+    if (status != 0) {
+        return status;
+    }
+
+    /*
+    * Same sign convention as the double eigensolvers.
+    */
+    for (int i = 0; i < n; i++) {
+        float *row = workspace->transform + (size_t)workspace->order[i] * ld;
+        int k = 0;
+        while (k < n && fabsf(row[k]) < FLOAT_EIGENVECTOR_SIGN_EPSILON) {
+            k++;
+        }
+        if (k < n && row[k] < 0) {
+            for (int j = 0; j < n; j++) {
+                row[j] = -row[j];
+            }
+        }
+    }
+    return 0;
+}
+
+int do_sensor_fusion_float(Fusion_Workspace_Float_t  *workspace,
+                           Node_t                    *node,
+                           int                       no_of_sensors,
+                           float                     q_support,
+                           float                     parameter,
+                           Eigen_Backend_t           backend,
+                           float                     *fused_value) {
+    if (workspace == NULL || node == NULL || no_of_sensors <= 0 ||
+        parameter <= 0 || parameter > 1 || fused_value == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return -1;
+    }
+    int n = no_of_sensors;
+    int ld;
+    int no_of_rates = n;
+    float sum = 0;
+
+    if (!fusion_workspace_float_prepare(workspace, n)) {
+        return -1;
+    }
+    ld = workspace->leading_dimension;
+    if (calculate_support_degree_matrix_float_into(node, n,
+            workspace->sensor_array, workspace->sd_matrix, ld) != 0 ||
+        calculate_eigensystem_float_into(workspace, n, backend) != 0) {
+        return -1;
+    }
+
+    /*
+    * Contribution rates, and how many of them reach the parameter.
+    */
+    float *eigen_value = workspace->eigen_value;
+    float *rate = workspace->contribution_rate;
+    for (int i = 0; i < n; i++) {
+        sum += eigen_value[i];
+    }
+    for (int i = 0; i < n; i++) {
+        rate[i] = eigen_value[i] / sum;
+    }
+    sum = 0;
+    for (int k = 0; k < n; k++) {
+        sum += rate[k];
+        if (sum >= parameter) {
+            no_of_rates = k + 1;
+            break;
+        }
+    }
+
+    /*
+    * Integrated support degree straight from the eigenpairs, since principal
+    * component j is lambda_j * v_j.
+    */
+    float *support = workspace->integrated_support;
+    for (int i = 0; i < n; i++) {
+        support[i] = 0;
+    }
+    for (int j = 0; j < no_of_rates; j++) {
+        float *eigen_row = workspace->transform +
+            (size_t)workspace->order[j] * ld;
+        float scale = rate[j] * eigen_value[j];
+        for (int i = 0; i < n; i++) {
+            support[i] += eigen_row[i] * scale;
+        }
+    }
+
+    /*
+    * Elimination of incorrect data, with the mean taken over n + 1 as
+    * eliminate_incorrect_data() does.
+    */
+    sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += support[i];
+    }
+    float mean_z = sum / (n + 1);
+    for (int i = 0; i < n; i++) {
+        if (fabsf(support[i]) < fabsf(q_support * mean_z)) {
+            support[i] = 0;
+        }
+    }
+
+    /*
+    * Weight coefficients and the fused output.
+    */
+    float *weight = workspace->weight_coefficient;
+    sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += support[i];
+    }
+    *fused_value = 0;
+    for (int i = 0; i < n; i++) {
+        weight[i] = support[i] / sum;
+        *fused_value += weight[i] * workspace->sensor_array[i];
+    }
+    return isfinite(*fused_value) ? 0 : -1;
+}
+
+void float_divergence_record(Float_Divergence_t *divergence,
+                             Boolean            double_valid,
+                             double             double_value,
+                             Boolean            float_valid,
+                             float              float_value) {
+    if (double_valid != float_valid) {
+        divergence->no_of_mismatches++;
+        return;
+    }
+    if (!double_valid) {
+        return;
+    }
+    double difference = fabs((double)float_value - double_value);
+
+    divergence->no_of_epochs++;
+    divergence->total += difference;
+    if (difference > divergence->largest) {
+        divergence->largest = difference;
+    }
+    if (double_value != 0 &&
+        difference / fabs(double_value) > divergence->largest_relative) {
+        divergence->largest_relative = difference / fabs(double_value);
+    }
+}
+
+const char *fusion_precision_name(Fusion_Precision_t precision) {
+    switch (precision) {
+    case FUSION_PRECISION_DOUBLE:
+        return "double";
+    case FUSION_PRECISION_FLOAT:
+        return "float";
+    case FUSION_PRECISION_VALIDATE:
+        return "validate";
+    default:
+        return "unknown";
+    }
+}
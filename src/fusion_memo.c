@@ -0,0 +1,140 @@
+/**
+ * @file fusion_memo.c
+ *
+ * @brief Implementation of the memo of recent fusion results.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include "fusion_memo.h"
+
+/*
+ * 64 bit FNV-1a hash of some bytes, carrying on from hash.
+ */
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size) {
+    const unsigned char *byte = (const unsigned char *)bytes;
+
+    while (size--) {
+        hash ^= *byte++;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void fusion_memo_init(Fusion_Memo_t *memo) {
+    memset(memo, 0, sizeof(Fusion_Memo_t));
+}
+
+void fusion_memo_free(Fusion_Memo_t *memo) {
+    int i;
+
+    for (i = 0; i < FUSION_MEMO_ENTRIES; i++) {
+        free(memo->entries[i].values);
+    }
+    free(memo->key);
+    fusion_memo_init(memo);
+}
+
+Boolean fusion_memo_lookup(Fusion_Memo_t   *memo,
+                           double          *values,
+                           int             no_of_values,
+                           int             q_support_value,
+                           int             principal_component_ratio,
+                           double          *fused_value) {
+    Fusion_Memo_Entry_t *entry;
+    uint64_t hash = 14695981039346656037ull;
+    int i;
+
+    memo->no_of_key_values = 0;
+    memo->clock++;
+
+    if (no_of_values > memo->key_capacity) {
+        double *key = (double *)realloc(memo->key,
+                                        no_of_values * sizeof(double));
+        if (key == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            memo->no_of_misses++;
+            return FALSE;
+        }
+        memo->key = key;
+        memo->key_capacity = no_of_values;
+    }
+
+    /*
+     * -0.0 and 0.0 fuse the same, so they are given the same bits.
+     */
+    for (i = 0; i < no_of_values; i++) {
+        memo->key[i] = (values[i] == 0) ? 0 : values[i];
+    }
+
+    hash = hash_bytes(hash, &q_support_value, sizeof(q_support_value));
+    hash = hash_bytes(hash, &principal_component_ratio,
+                      sizeof(principal_component_ratio));
+    hash = hash_bytes(hash, memo->key, no_of_values * sizeof(double));
+    memo->no_of_key_values = no_of_values;
+    memo->key_hash = hash;
+    memo->key_q_support_value = q_support_value;
+    memo->key_principal_component_ratio = principal_component_ratio;
+
+    for (i = 0; i < FUSION_MEMO_ENTRIES; i++) {
+        entry = &memo->entries[i];
+        if ((entry->last_used != 0) &&
+                (entry->hash == hash) &&
+                (entry->no_of_values == no_of_values) &&
+                (entry->q_support_value == q_support_value) &&
+                (entry->principal_component_ratio ==
+                 principal_component_ratio) &&
+                (memcmp(entry->values, memo->key,
+                        no_of_values * sizeof(double)) == 0)) {
+            entry->last_used = memo->clock;
+            *fused_value = entry->fused_value;
+            memo->no_of_hits++;
+            return TRUE;
+        }
+    }
+
+    memo->no_of_misses++;
+    return FALSE;
+}
+
+void fusion_memo_store(Fusion_Memo_t *memo, double fused_value) {
+    Fusion_Memo_Entry_t *entry = &memo->entries[0];
+    int no_of_values = memo->no_of_key_values;
+    int i;
+
+    if (no_of_values == 0) {
+        return;
+    }
+
+    /*
+     * Unused entries have last_used 0, so they are picked first.
+     */
+    for (i = 1; i < FUSION_MEMO_ENTRIES; i++) {
+        if (memo->entries[i].last_used < entry->last_used) {
+            entry = &memo->entries[i];
+        }
+    }
+
+    if (no_of_values > entry->values_capacity) {
+        double *entry_values = (double *)realloc(entry->values,
+                                                 no_of_values *
+                                                 sizeof(double));
+        if (entry_values == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            return;
+        }
+        entry->values = entry_values;
+        entry->values_capacity = no_of_values;
+    }
+
+    memcpy(entry->values, memo->key, no_of_values * sizeof(double));
+    entry->no_of_values = no_of_values;
+    entry->hash = memo->key_hash;
+    entry->q_support_value = memo->key_q_support_value;
+    entry->principal_component_ratio = memo->key_principal_component_ratio;
+    entry->fused_value = fused_value;
+    entry->last_used = memo->clock;
+    memo->no_of_key_values = 0;
+}
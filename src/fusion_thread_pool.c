@@ -0,0 +1,144 @@
+/**
+ * @file fusion_thread_pool.c
+ *
+ * @brief Implementation of the pool of threads large epochs are shared
+ * between.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fusion_thread_pool.h"
+
+/*
+ * Runs the tasks of a pool until it is stopped.
+ */
+static void *worker_thread(void *arg) {
+    Fusion_Worker_t *worker = (Fusion_Worker_t *)arg;
+    Fusion_Thread_Pool_t *pool = worker->pool;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == generation) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        generation = pool->generation;
+        Fusion_Task_t task = pool->task;
+        void *task_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(task_arg, worker->index, pool->no_of_threads);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+Boolean fusion_thread_pool_init(Fusion_Thread_Pool_t *pool,
+                                int no_of_threads) {
+    if (pool == NULL) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->no_of_threads = 1;
+    if (no_of_threads < 1 || no_of_threads > FUSION_MAX_THREADS) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+    if (no_of_threads == 1) {
+        return TRUE;
+    }
+
+    pool->workers = (Fusion_Worker_t *)calloc(no_of_threads - 1,
+        sizeof(Fusion_Worker_t));
+    if (pool->workers == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return FALSE;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    /*
+    * no_of_threads is only raised as workers start, so a pool that cannot
+    * start them all is stopped with the ones it has.
+    */
+    for (int i = 1; i < no_of_threads; i++) {
+        Fusion_Worker_t *worker = &pool->workers[i - 1];
+        worker->pool = pool;
+        worker->index = i;
+        if (pthread_create(&worker->thread, NULL, worker_thread,
+                worker) != 0) {
+            printf("%s: Unable to start thread %d\n", __func__, i);
+            fusion_thread_pool_free(pool);
+            return FALSE;
+        }
+        pool->no_of_threads = i + 1;
+    }
+    return TRUE;
+}
+
+void fusion_thread_pool_free(Fusion_Thread_Pool_t *pool) {
+    if (pool->workers == NULL) {
+        memset(pool, 0, sizeof(*pool));
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = TRUE;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->no_of_threads; i++) {
+        pthread_join(pool->workers[i - 1].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void fusion_thread_pool_run(Fusion_Thread_Pool_t *pool,
+                            Fusion_Task_t task,
+                            void *arg) {
+    if (pool == NULL || pool->no_of_threads <= 1) {
+        task(arg, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->running = pool->no_of_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    task(arg, 0, pool->no_of_threads);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void fusion_thread_share(int count, int thread, int no_of_threads,
+                         int *first, int *last) {
+    *first = (int)((long long)count * thread / no_of_threads);
+    *last = (int)((long long)count * (thread + 1) / no_of_threads);
+}
@@ -19,7 +19,8 @@ Node_t *create(int time, char *name, float value, Node_t *next) {
     }
 
     new_node->time_in_minutes = time;
-    strncpy(new_node->sensor_name, name, MAX_SENSOR_NAME_SIZE);
+    strncpy(new_node->sensor_name, name, MAX_SENSOR_NAME_SIZE - 1);
+    new_node->sensor_name[MAX_SENSOR_NAME_SIZE - 1] = '\0';
     new_node->sensor_value = value;
     new_node->next = next;
 
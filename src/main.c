@@ -24,34 +24,109 @@
 #define OUTPUT_FILE_NAME "sensor_fusion_report.txt"
 
 int main(int argc, char *argv[]) {
+    Fusion_Parameters_t parameters;
+    Fusion_Engine_t engine;
+    Fusion_Snapshot_t snapshot;
+    Snapshot_Server_t server;
+    char socket_path[MAX_FILE_NAME_SIZE];
+    Boolean use_query_socket = FALSE;
     Boolean use_high_range = FALSE;
     Boolean use_low_range = FALSE;
     Boolean use_stuck = FALSE;
-    float high_range;
-    float low_range;
+    Boolean use_flat_line = FALSE;
+    float high_range = 0;
+    float low_range = 0;
     char in_file_name[MAX_FILE_NAME_SIZE];
     char out_file_name[MAX_FILE_NAME_SIZE];
+    char limits_file_name[MAX_FILE_NAME_SIZE];
+    char registry_file_name[MAX_FILE_NAME_SIZE];
+    Boolean use_registry_file = FALSE;
+    char statistics_file_name[MAX_FILE_NAME_SIZE];
+    Boolean use_statistics_file = FALSE;
+    char checkpoint_file_name[MAX_FILE_NAME_SIZE];
+    Boolean use_checkpoint_file = FALSE;
+    int checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    Boolean use_limits_file = FALSE;
     int opt;
-    int stuck_range;
+    int stuck_range = 0;
+    int flat_line_repeats = 0;
     int q_support_value = 0;
     int principal_component_ratio = 100;
+    Support_Degree_Mode_t support_degree_mode = SUPPORT_DEGREE_EXACT;
+    Eigen_Solver_t eigen_solver = EIGEN_SOLVER_FULL;
+    Eigen_Backend_t eigen_backend = EIGEN_BACKEND_AUTO;
+    double approximation_accuracy = RANDOMIZED_DEFAULT_ACCURACY;
+    Boolean use_fusion_memo = TRUE;
+    Fusion_Precision_t precision = FUSION_PRECISION_DOUBLE;
+    int no_of_threads = 1;
+    int parallel_threshold = FUSION_PARALLEL_MIN_SENSORS;
 
-    strncpy(in_file_name, INPUT_FILE_NAME, MAX_FILE_NAME_SIZE);
-    strncpy(out_file_name, OUTPUT_FILE_NAME, MAX_FILE_NAME_SIZE);
+    strncpy(in_file_name, INPUT_FILE_NAME, MAX_FILE_NAME_SIZE - 1);
+    in_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
+    strncpy(out_file_name, OUTPUT_FILE_NAME, MAX_FILE_NAME_SIZE - 1);
+    out_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
 
-    while ((opt = getopt(argc, argv, "htl:u:s:f:q:p:")) != -1) {
+    while ((opt = getopt(argc, argv, "htnl:u:s:f:q:p:r:k:g:c:i:m:d:e:b:"
+                         "a:x:j:y:w:")) != -1) {
         switch (opt) {
         case 'h':
             printf("\n\n");
-            printf("Usage: sensorfusion.exe [-f] [-h] [-l] [-p] [-q] [-s] [-t]"
-                   " [-u]\n\n");
+            printf("Usage: sensorfusion.exe [-a] [-b] [-c] [-d] [-e] [-f] [-g]"
+                   " [-h] [-i] [-j] [-k] [-l] [-m] [-n] [-p] [-q] [-r] [-s]"
+                   " [-t] [-u] [-w] [-x] [-y]\n\n");
             printf("Usage:\n");
+            printf("    -a value        Specifies the error estimate the "
+                   "randomized eigen\n                    solver aims for "
+                   "(default %g).\n", RANDOMIZED_DEFAULT_ACCURACY);
+            printf("    -b backend      Specifies the library the eigensystem "
+                   "is solved with: auto\n                    (default: jacobi "
+                   "up to %d sensors, gsl above), gsl\n                    "
+                   "(when built with GSL), lapack (when built with\n"
+                   "                    LAPACK), builtin or jacobi.\n",
+                   JACOBI_MAX_SENSORS);
+            printf("    -c file_name    Specifies a checkpoint file. The "
+                   "state is saved to it\n                    periodically, "
+                   "and a run that did not complete\n                    "
+                   "resumes from it.\n");
+            printf("    -d mode         Specifies how the support degree "
+                   "matrix is built: exact\n                    (default), "
+                   "separable (O(n) exponentials),\n                    "
+                   "incremental (only the sensors that changed) or\n"
+                   "                    matrixfree (never built, for very "
+                   "large fleets).\n");
+            printf("    -e solver       Specifies how the eigensystem is "
+                   "solved: full (default),\n                    lanczos "
+                   "(only the leading eigenpairs needed),\n                "
+                   "    warm (lanczos started from the previous epoch),\n"
+                   "                    randomized (approximate, at a bounded "
+                   "cost) or\n                    blocks (each block of "
+                   "close values on its own).\n");
             printf("    -f file_name    Specifies a non-default input file"
                    "path.\n");
+            printf("    -g file_name    Specifies a sensor registry file. "
+                   "Sensor state is kept\n                    in this file and "
+                   "picked up again by the next run.\n");
             printf("    -h              Prints this message and exits\n");
+            printf("    -i value        Specifies how many epochs between "
+                   "checkpoints (default\n                    %d).\n",
+                   DEFAULT_CHECKPOINT_INTERVAL);
+            printf("    -j value        Specifies how many threads (up to %d) "
+                   "the steps of an\n                    epoch with many "
+                   "valid sensors are shared\n                    between "
+                   "(default 1).\n", FUSION_MAX_THREADS);
+            printf("    -k value        Specifies how many identical readings "
+                   "in a row after\n                    which the sensor is "
+                   "considered to be stuck\n                    "
+                   "(flat-lined).\n");
             printf("    -l value        Specifies the lower limit below "
                    "which the sensor will be\n                    marked "
                    "out of range.\n");
+            printf("    -m socket_path  Serves the fused value and sensor "
+                   "statuses of the last\n                    epoch on this "
+                   "local (Unix domain) socket.\n");
+            printf("    -n              Fuses every epoch, instead of "
+                   "reusing the result of a\n                    recent epoch "
+                   "with the same sensor values.\n");
             printf("    -p value        Specifies the ratio used to determine "
                    "how many principle\n                    components are "
                    "to be used\n");
@@ -59,6 +134,11 @@ int main(int argc, char *argv[]) {
                    "that must agree\n                    before a sensor value "
                    "is considered valid.\n                    This is input as "
                    "a percentage * 100.\n");
+            printf("    -r file_name    Specifies a file of per-sensor "
+                   "limits (name,low,high),\n                    which "
+                   "override -l and -u. A name ending in\n"
+                   "                    '*' matches all sensors starting "
+                   "with it.\n");
             printf("    -s value        Specifies how long (in minutes) "
                    "beyond which, the sensor\n                    is "
                    "considered to be stuck, and no longer valid.\n");
@@ -67,6 +147,18 @@ int main(int argc, char *argv[]) {
             printf("    -u value        Specifies the upper limit above "
                    "which the sensor will be\n                    marked "
                    "out of range.\n");
+            printf("    -w file_name    Writes the number of readings, mean "
+                   "and variance of\n                    every sensor to this "
+                   "file at the end of the\n                    run.\n");
+            printf("    -x precision    Specifies the precision the fusion "
+                   "algorithm is computed\n                    in: double "
+                   "(default), float, or validate (double,\n"
+                   "                    with how far float strays from it "
+                   "reported).\n");
+            printf("    -y value        Specifies the smallest number of valid "
+                   "sensors for which\n                    an epoch is shared "
+                   "between the -j threads\n                    (default "
+                   "%d).\n", FUSION_PARALLEL_MIN_SENSORS);
             return 0;
             break;
         case 't':
@@ -76,6 +168,12 @@ int main(int argc, char *argv[]) {
             printf("Automated testing has completed\n");
             return 0;
             break;
+        case 'n':
+            /*
+             * Fuse every epoch, even when its values were fused recently.
+             */
+            use_fusion_memo = FALSE;
+            break;
         case 'l':
             /*
              * Specifies the low edge of the valid sensor range. If the
@@ -107,7 +205,8 @@ int main(int argc, char *argv[]) {
              * Specifies a non-default input file to use for the sensor
              * input data.
              */
-            strncpy(in_file_name, optarg, MAX_FILE_NAME_SIZE);
+            strncpy(in_file_name, optarg, MAX_FILE_NAME_SIZE - 1);
+            in_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
             break;
         case 'q':
             /*
@@ -134,22 +233,245 @@ int main(int argc, char *argv[]) {
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'k':
+            /*
+             * Specifies how many times in a row a sensor can repeat exactly
+             * the same value before it is considered stuck (flat-lined).
+             */
+            flat_line_repeats = (int)strtol(optarg, NULL, 10);
+            if (flat_line_repeats < 1) {
+                printf("Error, flat-line repeats (-k) must be at least 1\n");
+                exit(EXIT_FAILURE);
+            }
+            use_flat_line = TRUE;
+            break;
+        case 'c':
+            /*
+             * Specifies the checkpoint file used to recover from a crash.
+             */
+            strncpy(checkpoint_file_name, optarg, MAX_FILE_NAME_SIZE - 1);
+            checkpoint_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
+            use_checkpoint_file = TRUE;
+            break;
+        case 'i':
+            /*
+             * Specifies how many epochs are fused between two checkpoints.
+             */
+            checkpoint_interval = strtod(optarg, NULL);
+            if (checkpoint_interval < 1) {
+                printf("Error, checkpoint interval (-i) must be at least 1\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'a':
+            /*
+             * Specifies the error estimate the randomized eigensolver aims
+             * for.
+             */
+            approximation_accuracy = strtod(optarg, NULL);
+            if (!(approximation_accuracy > 0)) {
+                printf("Error, accuracy (-a) must be above 0\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'd':
+            /*
+             * Specifies how the support degree matrix is built.
+             */
+            if (strcmp(optarg, "exact") == 0) {
+                support_degree_mode = SUPPORT_DEGREE_EXACT;
+            } else if (strcmp(optarg, "separable") == 0) {
+                support_degree_mode = SUPPORT_DEGREE_SEPARABLE;
+            } else if (strcmp(optarg, "incremental") == 0) {
+                support_degree_mode = SUPPORT_DEGREE_INCREMENTAL;
+            } else if (strcmp(optarg, "matrixfree") == 0) {
+                support_degree_mode = SUPPORT_DEGREE_MATRIX_FREE;
+            } else {
+                printf("Error, support degree mode (-d) must be exact, "
+                       "separable, incremental or matrixfree\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'e':
+            /*
+             * Specifies how the eigensystem of the support degree matrix is
+             * solved.
+             */
+            if (strcmp(optarg, "full") == 0) {
+                eigen_solver = EIGEN_SOLVER_FULL;
+            } else if (strcmp(optarg, "lanczos") == 0) {
+                eigen_solver = EIGEN_SOLVER_LANCZOS;
+            } else if (strcmp(optarg, "warm") == 0) {
+                eigen_solver = EIGEN_SOLVER_WARM;
+            } else if (strcmp(optarg, "randomized") == 0) {
+                eigen_solver = EIGEN_SOLVER_RANDOMIZED;
+            } else if (strcmp(optarg, "blocks") == 0) {
+                eigen_solver = EIGEN_SOLVER_BLOCKS;
+            } else {
+                printf("Error, eigen solver (-e) must be full, lanczos, warm, "
+                       "randomized or blocks\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            /*
+             * Specifies the library the eigensystem is solved with.
+             */
+            for (eigen_backend = 0; eigen_backend < EIGEN_BACKEND_COUNT;
+                    eigen_backend++) {
+                if (strcmp(optarg, eigen_backend_name(eigen_backend)) == 0) {
+                    break;
+                }
+            }
+            if (!eigen_backend_supported(eigen_backend)) {
+                printf("Error, eigen backend (-b) must be auto, gsl, lapack, "
+                       "builtin or jacobi, and gsl and lapack need a build "
+                       "with them\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'x':
+            /*
+             * Specifies the precision the fusion algorithm is computed in.
+             */
+            for (precision = 0; precision < FUSION_PRECISION_COUNT;
+                    precision++) {
+                if (strcmp(optarg, fusion_precision_name(precision)) == 0) {
+                    break;
+                }
+            }
+            if (precision == FUSION_PRECISION_COUNT) {
+                printf("Error, precision (-x) must be double, float or "
+                       "validate\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'j':
+            /*
+             * Specifies how many threads a large epoch is shared between.
+             */
+            no_of_threads = strtod(optarg, NULL);
+            if ((no_of_threads < 1) || (no_of_threads > FUSION_MAX_THREADS)) {
+                printf("Error, threads (-j) must be between 1 - %d\n",
+                       FUSION_MAX_THREADS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'y':
+            /*
+             * Specifies the smallest epoch shared between the threads.
+             */
+            parallel_threshold = strtod(optarg, NULL);
+            if (parallel_threshold < 1) {
+                printf("Error, parallel threshold (-y) must be at least 1\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'm':
+            /*
+             * Specifies the local socket that queries of the live sensor
+             * state are served on.
+             */
+            strncpy(socket_path, optarg, MAX_FILE_NAME_SIZE - 1);
+            socket_path[MAX_FILE_NAME_SIZE - 1] = '\0';
+            use_query_socket = TRUE;
+            break;
+        case 'g':
+            /*
+             * Specifies the persistent sensor registry file. The sensors
+             * known to the previous run are restored from it.
+             */
+            strncpy(registry_file_name, optarg, MAX_FILE_NAME_SIZE - 1);
+            registry_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
+            use_registry_file = TRUE;
+            break;
+        case 'w':
+            /*
+             * Specifies the file the per-sensor reading statistics are
+             * written to at the end of the run.
+             */
+            strncpy(statistics_file_name, optarg, MAX_FILE_NAME_SIZE - 1);
+            statistics_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
+            use_statistics_file = TRUE;
+            break;
+        case 'r':
+            /*
+             * Specifies a file of per-sensor (or per-prefix) range limits.
+             * Sensors with no entry in this file use the -l and -u limits.
+             */
+            strncpy(limits_file_name, optarg, MAX_FILE_NAME_SIZE - 1);
+            limits_file_name[MAX_FILE_NAME_SIZE - 1] = '\0';
+            use_limits_file = TRUE;
+            break;
         default:
-            printf("sensorfusion usage: sensorfusion.exe [-htlusf]\n");
+            printf("sensorfusion usage: sensorfusion.exe"
+                   " [-htnlusfqprkgcimdebaxjyw]\n");
             break;
         }
     }
 
-    run_main_sensor_algorithm(in_file_name,
-                              out_file_name,
-                              high_range,
-                              use_high_range,
-                              low_range,
-                              use_low_range,
-                              stuck_range,
-                              use_stuck,
-                              q_support_value,
-                              principal_component_ratio);
+    parameters.use_high_range = use_high_range;
+    parameters.high_range = high_range;
+    parameters.use_low_range = use_low_range;
+    parameters.low_range = low_range;
+    parameters.use_stuck = use_stuck;
+    parameters.stuck_range = stuck_range;
+    parameters.use_flat_line = use_flat_line;
+    parameters.flat_line_repeats = flat_line_repeats;
+    parameters.q_support_value = q_support_value;
+    parameters.principal_component_ratio = principal_component_ratio;
+    parameters.checkpoint_interval = checkpoint_interval;
+    parameters.support_degree_mode = support_degree_mode;
+    parameters.eigen_solver = eigen_solver;
+    parameters.eigen_backend = eigen_backend;
+    parameters.approximation_accuracy = approximation_accuracy;
+    parameters.use_fusion_memo = use_fusion_memo;
+    parameters.precision = precision;
+    parameters.no_of_threads = no_of_threads;
+    parameters.parallel_threshold = parallel_threshold;
+
+    engine_init(&engine, &parameters, out_file_name);
+    if (use_query_socket) {
+        snapshot_init(&snapshot);
+        if (!snapshot_server_start(&server, &snapshot, socket_path)) {
+            exit(EXIT_FAILURE);
+        }
+        engine.snapshot = &snapshot;
+    }
+
+    run_main_sensor_algorithm(&engine,
+                              in_file_name,
+                              use_limits_file ? limits_file_name : NULL,
+                              use_registry_file ? registry_file_name : NULL,
+                              use_checkpoint_file ?
+                              checkpoint_file_name : NULL);
+    if (use_statistics_file) {
+        registry_write_statistics(&engine.registry, statistics_file_name);
+    }
+    if (use_fusion_memo) {
+        printf("Fusion memo: %ld hits, %ld misses\n",
+               engine.memo.no_of_hits, engine.memo.no_of_misses);
+    }
+    if (eigen_solver == EIGEN_SOLVER_RANDOMIZED) {
+        printf("Largest approximation error estimate: %g (target %g)\n",
+               engine.largest_approximation_error, approximation_accuracy);
+    }
+    if (precision == FUSION_PRECISION_VALIDATE) {
+        Float_Divergence_t *divergence = &engine.float_divergence;
+        printf("Float divergence over %ld epochs: largest %g (relative %g), "
+               "mean %g, %ld epochs fused by only one precision\n",
+               divergence->no_of_epochs, divergence->largest,
+               divergence->largest_relative,
+               (divergence->no_of_epochs > 0) ?
+               divergence->total / divergence->no_of_epochs : 0.0,
+               divergence->no_of_mismatches);
+    }
+    engine_free(&engine);
+
+    if (use_query_socket) {
+        snapshot_server_stop(&server);
+        snapshot_free(&snapshot);
+    }
 
     return 0;
 }
@@ -25,8 +25,8 @@ Boolean parser_parse_csv_file(char *file_name,
     int time_field_count;
     int field_count = 0;
     int row_count = 0;
-    int minutes;
-    int hours;
+    int minutes = 0;
+    int hours = 0;
 
     ifp = fopen(file_name, INPUT_MODE);
     if (ifp == NULL) {
@@ -76,7 +76,8 @@ Boolean parser_parse_csv_file(char *file_name,
                 break;
 
             case 1: /* Sensor Name */
-                strncpy(sensor_name, field, MAX_SENSOR_NAME_SIZE);
+                strncpy(sensor_name, field, MAX_SENSOR_NAME_SIZE - 1);
+                sensor_name[MAX_SENSOR_NAME_SIZE - 1] = '\0';
                 break;
 
             case 2: /* Sensor Value*/
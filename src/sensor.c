@@ -10,6 +10,8 @@
  * @author Jason Miller - jasonmiller@cmail.carleton.ca
  */
 
+#include <float.h>
+#include <sys/stat.h>
 #include "sensor.h"
 
 const char *list_name[] = {"Valid",
@@ -18,28 +20,279 @@ const char *list_name[] = {"Valid",
                           };
 
 /*
- * Head pointers to three linked lists used for storing three types of sensors
- * retrieved from the specified input file.
+ * Records which list a sensor is in, so that it can be restored from the
+ * registry on the next run.
  */
-Node_t *sensor_list_head_array[MAX_SENSOR_LISTS] = {NULL};
-
-void run_main_sensor_algorithm(char *in_file_name,
-                               char *out_file_name,
-                               float high_range,
-                               Boolean use_high_range,
-                               float low_range,
-                               Boolean use_low_range,
-                               float stuck_range,
-                               Boolean use_stuck,
-                               int q_support_value,
-                               int principal_component_ratio) {
+static void set_sensor_status(Fusion_Engine_t *engine,
+                              char *sensor_name,
+                              int list_index) {
+    int id = registry_lookup_sensor(&engine->registry, sensor_name);
+
+    if (id >= 0) {
+        engine->registry.records[id].status = list_index;
+    }
+}
+
+/*
+ * Flags the readings that fall outside their range. This is written without
+ * branches over contiguous arrays so that the compiler turns it into a single
+ * SIMD pass.
+ */
+static void classify_range_batch(const float *restrict values,
+                                 const float *restrict low_range,
+                                 const float *restrict high_range,
+                                 unsigned char *restrict out_of_range,
+                                 int no_of_readings) {
+    int i;
+
+    for (i = 0; i < no_of_readings; i++) {
+        out_of_range[i] = (values[i] < low_range[i]) |
+                          (values[i] > high_range[i]);
+    }
+}
+
+/*
+ * Makes sure the range batch arrays can hold no_of_readings entries.
+ */
+static Boolean reserve_range_batch(Range_Batch_t *batch, int no_of_readings) {
+    int capacity = batch->capacity ? batch->capacity : 64;
+
+    if (no_of_readings <= batch->capacity) {
+        return TRUE;
+    }
+
+    while (capacity < no_of_readings) {
+        capacity *= 2;
+    }
+
+    free(batch->nodes);
+    free(batch->values);
+    free(batch->low);
+    free(batch->high);
+    free(batch->oor);
+    batch->nodes = malloc(capacity * sizeof(Node_t *));
+    batch->values = malloc(capacity * sizeof(float));
+    batch->low = malloc(capacity * sizeof(float));
+    batch->high = malloc(capacity * sizeof(float));
+    batch->oor = malloc(capacity * sizeof(unsigned char));
+    if (!batch->nodes || !batch->values || !batch->low ||
+            !batch->high || !batch->oor) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        batch->capacity = 0;
+        return FALSE;
+    }
+
+    batch->capacity = capacity;
+    return TRUE;
+}
+
+/*
+ * Current size of the report file, which is where output will resume from
+ * if a checkpoint taken now is restored.
+ */
+static long output_file_size(char *file_name) {
+    struct stat st;
+
+    if (stat(file_name, &st) != 0) {
+        return 0;
+    }
+
+    return st.st_size;
+}
+
+/*
+ * Puts the sensors of the registry file that have not reported since it was
+ * opened back into the list they were in, with their last reading, so that
+ * stuck timers carry on from where the last run left off. This is done once,
+ * at the first epoch, which walks every listed sensor anyway.
+ */
+static void restore_unreported_sensors(Fusion_Engine_t *engine) {
+    Sensor_Registry_t *registry = &engine->registry;
+    Sensor_Record_t *record;
+    Node_t *node;
+    char *listed;
+    int id;
+    int i;
+
+    engine->restore_pending = FALSE;
+    if (registry->no_of_sensors == 0) {
+        return;
+    }
+
+    listed = calloc(registry->no_of_sensors, sizeof(char));
+    if (!listed) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return;
+    }
+
+    /*
+     * Only the sensors that reported in the first epoch are in the lists.
+     */
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        for (node = engine->sensor_lists[i]; node; node = node->next) {
+            id = registry_lookup_sensor(registry, node->sensor_name);
+            if (id >= 0) {
+                listed[id] = TRUE;
+            }
+        }
+    }
+
+    /*
+     * Nodes are pushed onto the front of the lists (walking the IDs
+     * backwards) to avoid walking to the end of a list for every sensor.
+     */
+    for (id = registry->no_of_sensors - 1; id >= 0; id--) {
+        record = &registry->records[id];
+        if (listed[id] || (record->no_of_readings == 0) ||
+                (record->status < 0) || (record->status >= MAX_SENSOR_LISTS)) {
+            continue;
+        }
+
+        engine->sensor_lists[record->status] = create(
+                record->last_time,
+                record->sensor_name,
+                record->last_value,
+                engine->sensor_lists[record->status]);
+    }
+
+    free(listed);
+}
+
+/*
+ * Restores the state saved by the last checkpoint, and drops any report
+ * output written after it, since it will be produced again.
+ */
+static Boolean resume_from_checkpoint(Fusion_Engine_t *engine,
+                                      char *checkpoint_file_name,
+                                      Checkpoint_Position_t *position) {
+    char *out_file_name = engine->out_file_name;
+
+    if (!checkpoint_read(checkpoint_file_name,
+                         position,
+                         engine->sensor_lists,
+                         &engine->registry)) {
+        return FALSE;
+    }
+
+    if ((output_file_size(out_file_name) > position->output_offset) &&
+            (truncate(out_file_name, position->output_offset) != 0)) {
+        printf("Can't truncate output file %s\n", out_file_name);
+        printf("Error - %s\n", strerror(errno));
+    }
+
+    printf("Resuming from checkpoint %s at input line %d\n",
+           checkpoint_file_name,
+           position->lines_read);
+    return TRUE;
+}
+
+void engine_init(Fusion_Engine_t *engine,
+                 Fusion_Parameters_t *parameters,
+                 char *out_file_name) {
+    int i;
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        engine->sensor_lists[i] = NULL;
+    }
+
+    memset(&engine->registry, 0, sizeof(engine->registry));
+    engine->registry.fd = -1;
+    limits_init(&engine->limits,
+                parameters->use_high_range,
+                parameters->high_range,
+                parameters->use_low_range,
+                parameters->low_range);
+    memset(&engine->range_batch, 0, sizeof(engine->range_batch));
+    engine->parameters = *parameters;
+    engine->out_file_name = out_file_name;
+    engine->restore_pending = FALSE;
+    engine->checkpoint_pid = 0;
+    engine->snapshot = NULL;
+    fusion_workspace_init(&engine->fusion_workspace);
+    support_degree_cache_init(&engine->sd_cache);
+    eigen_warm_start_init(&engine->warm_start);
+    fusion_memo_init(&engine->memo);
+    engine->largest_approximation_error = 0;
+    fusion_workspace_float_init(&engine->float_workspace);
+    memset(&engine->float_divergence, 0, sizeof(engine->float_divergence));
+    memset(&engine->thread_pool, 0, sizeof(engine->thread_pool));
+    if (parameters->no_of_threads > 1 &&
+        !fusion_thread_pool_init(&engine->thread_pool,
+            parameters->no_of_threads)) {
+        printf("Fusing on one thread\n");
+    }
+}
+
+void engine_free(Fusion_Engine_t *engine) {
+    Range_Batch_t *batch = &engine->range_batch;
+    int i;
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        while (engine->sensor_lists[i]) {
+            engine->sensor_lists[i] =
+                remove_from_front(engine->sensor_lists[i]);
+        }
+    }
+
+    /*
+     * Flushes the registry file (if there is one) for the next run.
+     */
+    registry_free(&engine->registry);
+    limits_free(&engine->limits);
+
+    free(batch->nodes);
+    free(batch->values);
+    free(batch->low);
+    free(batch->high);
+    free(batch->oor);
+    memset(batch, 0, sizeof(*batch));
+
+    fusion_workspace_free(&engine->fusion_workspace);
+    support_degree_cache_free(&engine->sd_cache);
+    eigen_warm_start_free(&engine->warm_start);
+    fusion_memo_free(&engine->memo);
+    fusion_workspace_float_free(&engine->float_workspace);
+    fusion_thread_pool_free(&engine->thread_pool);
+}
+
+void run_main_sensor_algorithm(Fusion_Engine_t *engine,
+                               char *in_file_name,
+                               char *limits_file_name,
+                               char *registry_file_name,
+                               char *checkpoint_file_name) {
+    Fusion_Parameters_t *parameters = &engine->parameters;
     Boolean end_of_file_reached = FALSE;
     float fused_sensor_value;
     float sensor_value;
     char sensor_name[MAX_SENSOR_NAME_SIZE];
+    Checkpoint_Position_t position;
     int time_in_minutes = 0;
     int current_time = -1;
     int lines_read = 1;
+    int epochs_since_checkpoint = 0;
+
+    if (registry_file_name &&
+            !open_sensor_registry(engine, registry_file_name)) {
+        return;
+    }
+
+    if (checkpoint_file_name &&
+            resume_from_checkpoint(engine,
+                                   checkpoint_file_name,
+                                   &position)) {
+        lines_read = position.lines_read;
+        current_time = position.current_time;
+        time_in_minutes = position.time_in_minutes;
+    }
+
+    if (!load_sensor_limits(engine,
+                            limits_file_name,
+                            parameters->use_high_range,
+                            parameters->high_range,
+                            parameters->use_low_range,
+                            parameters->low_range)) {
+        return;
+    }
 
     do {
         end_of_file_reached = parser_parse_csv_file(in_file_name,
@@ -64,38 +317,72 @@ void run_main_sensor_algorithm(char *in_file_name,
                  * We have read a line that has a different time stamp than
                  * the rest (or we have hit the end of the file)
                  */
-                if (use_stuck) {
-                    determine_if_sensors_are_stuck(current_time,
-                                                   stuck_range);
+                if (engine->restore_pending) {
+                    restore_unreported_sensors(engine);
                 }
 
-                fused_sensor_value = do_sensor_fusion_algorithm(
-                                         q_support_value,
-                                         principal_component_ratio);
-                write_output_file(out_file_name,
-                                  use_high_range,
-                                  high_range,
-                                  use_low_range,
-                                  low_range,
-                                  use_stuck,
-                                  stuck_range,
-                                  current_time,
-                                  q_support_value,
-                                  principal_component_ratio,
-                                  fused_sensor_value);
+                classify_sensor_ranges(engine);
+
+                if (parameters->use_stuck) {
+                    determine_if_sensors_are_stuck(engine,
+                                                   current_time,
+                                                   parameters->stuck_range);
+                }
+
+                if (parameters->use_flat_line) {
+                    determine_if_sensors_are_flat_lined(
+                        engine,
+                        parameters->flat_line_repeats);
+                }
+
+                fused_sensor_value = do_sensor_fusion_algorithm(engine);
+                write_output_file(engine, current_time, fused_sensor_value);
+                if (engine->snapshot) {
+                    snapshot_publish(engine->snapshot,
+                                     engine->sensor_lists,
+                                     current_time,
+                                     fused_sensor_value);
+                }
 
                 current_time = -1;
+                ++epochs_since_checkpoint;
             }
         }
 
         ++lines_read;
-        update_sensor_lists(time_in_minutes,
+
+        /*
+         * Range checking is deferred to classify_sensor_ranges(), which
+         * checks the whole epoch in one pass once it is complete.
+         */
+        update_sensor_lists(engine,
+                            time_in_minutes,
                             sensor_name,
                             sensor_value,
-                            use_high_range,
-                            high_range,
-                            use_low_range,
-                            low_range);
+                            FALSE,
+                            0,
+                            FALSE,
+                            0);
+
+        /*
+         * Checkpoints are taken between lines, so the epoch being
+         * accumulated is part of the saved sensor lists.
+         */
+        if (checkpoint_file_name && !end_of_file_reached &&
+                (epochs_since_checkpoint >=
+                 parameters->checkpoint_interval)) {
+            position.lines_read = lines_read;
+            position.current_time = current_time;
+            position.time_in_minutes = time_in_minutes;
+            position.output_offset = output_file_size(engine->out_file_name);
+            if (checkpoint_start_async(&engine->checkpoint_pid,
+                                       checkpoint_file_name,
+                                       &position,
+                                       engine->sensor_lists,
+                                       &engine->registry)) {
+                epochs_since_checkpoint = 0;
+            }
+        }
     } while (!end_of_file_reached);
 
     /*
@@ -103,43 +390,100 @@ void run_main_sensor_algorithm(char *in_file_name,
      * with the same timestamp, so we will run the fusion algorithm after
      * hitting the end of the file since there will be no more entries.
      */
-    if (use_stuck) {
-        determine_if_sensors_are_stuck(time_in_minutes, stuck_range);
-    }
-
-    fused_sensor_value = do_sensor_fusion_algorithm(q_support_value,
-                         principal_component_ratio);
-    write_output_file(out_file_name,
-                      use_high_range,
-                      high_range,
-                      use_low_range,
-                      low_range,
-                      use_stuck,
-                      stuck_range,
-                      time_in_minutes,
-                      q_support_value,
-                      principal_component_ratio,
-                      fused_sensor_value);
+    if (engine->restore_pending) {
+        restore_unreported_sensors(engine);
+    }
+
+    classify_sensor_ranges(engine);
+
+    if (parameters->use_stuck) {
+        determine_if_sensors_are_stuck(engine,
+                                       time_in_minutes,
+                                       parameters->stuck_range);
+    }
+
+    if (parameters->use_flat_line) {
+        determine_if_sensors_are_flat_lined(engine,
+                                            parameters->flat_line_repeats);
+    }
+
+    fused_sensor_value = do_sensor_fusion_algorithm(engine);
+    write_output_file(engine, time_in_minutes, fused_sensor_value);
+    if (engine->snapshot) {
+        snapshot_publish(engine->snapshot,
+                         engine->sensor_lists,
+                         time_in_minutes,
+                         fused_sensor_value);
+    }
+
+    /*
+     * The run has completed, so there is nothing left to recover.
+     */
+    if (checkpoint_file_name) {
+        checkpoint_wait(&engine->checkpoint_pid);
+        unlink(checkpoint_file_name);
+    }
 }
 
-void update_sensor_lists(int time_in_minutes,
+Boolean open_sensor_registry(Fusion_Engine_t *engine,
+                             char *registry_file_name) {
+    registry_free(&engine->registry);
+    if (!registry_open_file(&engine->registry, registry_file_name)) {
+        return FALSE;
+    }
+
+    /*
+     * The sensor lists are only rebuilt at the first epoch, so opening the
+     * registry costs the same whatever the size of the fleet.
+     */
+    engine->restore_pending = TRUE;
+    return TRUE;
+}
+
+void update_sensor_lists(Fusion_Engine_t *engine,
+                         int time_in_minutes,
                          char *sensor_name,
                          float sensor_value,
                          int use_high_range,
-                         int high_range,
+                         float high_range,
                          int use_low_range,
-                         int low_range) {
+                         float low_range) {
     Node_t *node = NULL;
+    Boolean is_new;
+    float sensor_low_range;
+    float sensor_high_range;
     int list_index;
+    int id;
+
+    /*
+     * Make sure the sensor has an ID. The range limits of a sensor are looked
+     * up once, when it is first seen.
+     */
+    id = registry_register_sensor(&engine->registry, sensor_name, &is_new);
+    if ((id >= 0) && is_new) {
+        limits_resolve(&engine->limits,
+                       sensor_name,
+                       &sensor_low_range,
+                       &sensor_high_range);
+        engine->registry.records[id].low_range = sensor_low_range;
+        engine->registry.records[id].high_range = sensor_high_range;
+    }
+
+    if (id >= 0) {
+        registry_record_reading(&engine->registry,
+                                id,
+                                time_in_minutes,
+                                sensor_value);
+    }
 
     /*
      * Check to see if the node already exists. If it does, we will remove
      * it from the chain it belongs to, it will be re-added in a bit.
      */
-    node = search_all_chains(sensor_name, &list_index);
+    node = search_all_chains(engine, sensor_name, &list_index);
     if (node) {
-        sensor_list_head_array[list_index] = remove_node(
-          sensor_list_head_array[list_index], node);
+        engine->sensor_lists[list_index] = remove_node(
+          engine->sensor_lists[list_index], node);
     }
 
     if ((use_high_range) && (sensor_value > high_range)) {
@@ -147,37 +491,134 @@ void update_sensor_lists(int time_in_minutes,
          * Sensor is above the high range, so we dump it into the out of
          * range list.
          */
-        sensor_list_head_array[OOR_SENSOR_LIST] = append(
-                sensor_list_head_array[OOR_SENSOR_LIST],
+        engine->sensor_lists[OOR_SENSOR_LIST] = append(
+                engine->sensor_lists[OOR_SENSOR_LIST],
                 time_in_minutes,
                 sensor_name,
                 sensor_value);
+        set_sensor_status(engine, sensor_name, OOR_SENSOR_LIST);
     } else if ((use_low_range) && (sensor_value < low_range)) {
         /*
          * Sensor is below the low range, so we dump it into the out of
          * range list.
          */
-        sensor_list_head_array[OOR_SENSOR_LIST] = append(
-                sensor_list_head_array[OOR_SENSOR_LIST],
+        engine->sensor_lists[OOR_SENSOR_LIST] = append(
+                engine->sensor_lists[OOR_SENSOR_LIST],
                 time_in_minutes,
                 sensor_name,
                 sensor_value);
+        set_sensor_status(engine, sensor_name, OOR_SENSOR_LIST);
     } else {
         /* Sensor is fine, it gets to go into the valid list. */
-        sensor_list_head_array[VALID_SENSOR_LIST] = append(
-                sensor_list_head_array[VALID_SENSOR_LIST],
+        engine->sensor_lists[VALID_SENSOR_LIST] = append(
+                engine->sensor_lists[VALID_SENSOR_LIST],
                 time_in_minutes,
                 sensor_name,
                 sensor_value);
+        set_sensor_status(engine, sensor_name, VALID_SENSOR_LIST);
     }
 }
 
-Node_t *search_all_chains(char *str, int *list_index) {
+Boolean load_sensor_limits(Fusion_Engine_t *engine,
+                           char *limits_file_name,
+                           Boolean use_high_range,
+                           float high_range,
+                           Boolean use_low_range,
+                           float low_range) {
+    Sensor_Record_t *record;
+    int id;
+
+    limits_free(&engine->limits);
+    limits_init(&engine->limits,
+                use_high_range,
+                high_range,
+                use_low_range,
+                low_range);
+
+    if (limits_file_name &&
+            !limits_load_file(&engine->limits, limits_file_name)) {
+        return FALSE;
+    }
+
+    /*
+     * Sensors that are already registered need to pick up the new limits.
+     */
+    for (id = 0; id < engine->registry.no_of_sensors; id++) {
+        record = &engine->registry.records[id];
+        limits_resolve(&engine->limits,
+                       record->sensor_name,
+                       &record->low_range,
+                       &record->high_range);
+    }
+
+    return TRUE;
+}
+
+void classify_sensor_ranges(Fusion_Engine_t *engine) {
+    Range_Batch_t *batch = &engine->range_batch;
+    Sensor_Record_t *record;
+    Node_t *node;
+    int no_of_readings;
+    int id;
+    int i;
+
+    no_of_readings = count(engine->sensor_lists[VALID_SENSOR_LIST]);
+    if ((no_of_readings == 0) || !reserve_range_batch(batch, no_of_readings)) {
+        return;
+    }
+
+    /*
+     * Gather the readings and their limits into contiguous arrays.
+     */
+    node = engine->sensor_lists[VALID_SENSOR_LIST];
+    for (i = 0; node; node = node->next, i++) {
+        batch->nodes[i] = node;
+        batch->values[i] = node->sensor_value;
+        id = registry_lookup_sensor(&engine->registry, node->sensor_name);
+        if (id >= 0) {
+            record = &engine->registry.records[id];
+            batch->low[i] = record->low_range;
+            batch->high[i] = record->high_range;
+        } else {
+            batch->low[i] = engine->limits.default_low_range;
+            batch->high[i] = engine->limits.default_high_range;
+        }
+    }
+
+    classify_range_batch(batch->values,
+                         batch->low,
+                         batch->high,
+                         batch->oor,
+                         no_of_readings);
+
+    for (i = 0; i < no_of_readings; i++) {
+        if (!batch->oor[i]) {
+            continue;
+        }
+
+        set_sensor_status(engine,
+                          batch->nodes[i]->sensor_name,
+                          OOR_SENSOR_LIST);
+        if (!move_node(batch->nodes[i],
+                       &engine->sensor_lists[VALID_SENSOR_LIST],
+                       &engine->sensor_lists[OOR_SENSOR_LIST])) {
+            printf("Error: Could not move sensor node \"%s\" from %s "
+                   "list to %s list\n",
+                   batch->nodes[i]->sensor_name,
+                   list_name[VALID_SENSOR_LIST],
+                   list_name[OOR_SENSOR_LIST]);
+        }
+    }
+}
+
+Node_t *search_all_chains(Fusion_Engine_t *engine,
+                          char *str,
+                          int *list_index) {
     Node_t *node = NULL;
     int i;
 
     for (i = 0; i < MAX_SENSOR_LISTS; i++) {
-        node = search_sensor_name(sensor_list_head_array[i], str);
+        node = search_sensor_name(engine->sensor_lists[i], str);
         if (node) {
             (*list_index) = i;
             return node;
@@ -187,7 +628,9 @@ Node_t *search_all_chains(char *str, int *list_index) {
     return NULL;
 }
 
-void determine_if_sensors_are_stuck(int current_time, int stuck_value) {
+void determine_if_sensors_are_stuck(Fusion_Engine_t *engine,
+                                    int current_time,
+                                    int stuck_value) {
     Boolean rc = 0;
     Node_t *node = NULL;
     Node_t *next = NULL;
@@ -202,7 +645,7 @@ void determine_if_sensors_are_stuck(int current_time, int stuck_value) {
             continue;
         }
 
-        node = sensor_list_head_array[i];
+        node = engine->sensor_lists[i];
         while (node) {
             /*
              * We're moving around nodes here, so we want to make sure we're
@@ -215,9 +658,12 @@ void determine_if_sensors_are_stuck(int current_time, int stuck_value) {
                  * Sensor has not been updated recently enough and must be
                  * considered stuck. It will be moved to the stuck list.
                  */
+                set_sensor_status(engine,
+                                  node->sensor_name,
+                                  STUCK_SENSOR_LIST);
                 rc = move_node(node,
-                               &sensor_list_head_array[i],
-                               &sensor_list_head_array[STUCK_SENSOR_LIST]);
+                               &engine->sensor_lists[i],
+                               &engine->sensor_lists[STUCK_SENSOR_LIST]);
                 if (!rc) {
                     printf("Error: Could not move sensor node \"%s\" from %s "
                            "list to %s list\n",
@@ -232,12 +678,55 @@ void determine_if_sensors_are_stuck(int current_time, int stuck_value) {
     }
 }
 
-void dump_current_lists(void) {
+void determine_if_sensors_are_flat_lined(Fusion_Engine_t *engine,
+                                         int flat_line_repeats) {
+    Boolean rc = 0;
     Node_t *node = NULL;
+    Node_t *next = NULL;
+    int id;
     int i;
 
     for (i = 0; i < MAX_SENSOR_LISTS; i++) {
-        node = sensor_list_head_array[i];
+        if (i == STUCK_SENSOR_LIST) {
+            continue;
+        }
+
+        node = engine->sensor_lists[i];
+        while (node) {
+            next = node->next;
+
+            /*
+             * The repeat count is kept up to date as readings come in, so
+             * this never needs to look back at previous readings.
+             */
+            id = registry_lookup_sensor(&engine->registry, node->sensor_name);
+            if ((id >= 0) &&
+                    (engine->registry.records[id].repeat_count >=
+                     flat_line_repeats)) {
+                engine->registry.records[id].status = STUCK_SENSOR_LIST;
+                rc = move_node(node,
+                               &engine->sensor_lists[i],
+                               &engine->sensor_lists[STUCK_SENSOR_LIST]);
+                if (!rc) {
+                    printf("Error: Could not move sensor node \"%s\" from %s "
+                           "list to %s list\n",
+                           node->sensor_name,
+                           list_name[i],
+                           list_name[STUCK_SENSOR_LIST]);
+                }
+            }
+
+            node = next;
+        }
+    }
+}
+
+void dump_current_lists(Fusion_Engine_t *engine) {
+    Node_t *node = NULL;
+    int i;
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        node = engine->sensor_lists[i];
         while (node) {
             switch (i) {
             case VALID_SENSOR_LIST:
@@ -267,17 +756,11 @@ void dump_current_lists(void) {
     }
 }
 
-void write_output_file(char *file_name,
-                       int use_high_range,
-                       float high_range,
-                       int use_low_range,
-                       float low_range,
-                       int use_stuck,
-                       int stuck_range,
+void write_output_file(Fusion_Engine_t *engine,
                        int current_time,
-                       int q_support_value,
-                       int principal_component_ratio,
                        float fused_sensor_value) {
+    Fusion_Parameters_t *parameters = &engine->parameters;
+    char *file_name = engine->out_file_name;
     Node_t *node;
     FILE *fp;
     int minutes;
@@ -307,17 +790,24 @@ void write_output_file(char *file_name,
             minutes);
     fprintf(fp, "Sensor Parameters\n");
     fprintf(fp, "High Limit --------- ");
-    use_high_range ? fprintf(fp, "%0.4f\n", high_range) : fprintf(fp, "N/A\n");
+    parameters->use_high_range ?
+        fprintf(fp, "%0.4f\n", parameters->high_range) :
+        fprintf(fp, "N/A\n");
 
     fprintf(fp, "Low Limit ---------- ");
-    use_low_range ? fprintf(fp, "%0.4f\n", low_range) : fprintf(fp, "N/A\n");
+    parameters->use_low_range ?
+        fprintf(fp, "%0.4f\n", parameters->low_range) :
+        fprintf(fp, "N/A\n");
 
     fprintf(fp, "Stuck Interval ----- ");
-    use_stuck ? fprintf(fp, "%02d\n", stuck_range) : fprintf(fp, "N/A\n");
+    parameters->use_stuck ?
+        fprintf(fp, "%02d\n", parameters->stuck_range) :
+        fprintf(fp, "N/A\n");
 
-    fprintf(fp, "Q Support Value ---- %d%%\n", q_support_value);
+    fprintf(fp, "Q Support Value ---- %d%%\n", parameters->q_support_value);
 
-    fprintf(fp, "P Component Ratio -- %d%%\n", principal_component_ratio);
+    fprintf(fp, "P Component Ratio -- %d%%\n",
+            parameters->principal_component_ratio);
 
     fprintf(fp, "Fused Sensor Value - ");
     if (fused_sensor_value == INVALID_SENSOR_FUSION_VALUE) {
@@ -335,7 +825,7 @@ void write_output_file(char *file_name,
     fprintf(fp, "--------+--------+------------+------\n");
     for (i = 0; i < MAX_SENSOR_LISTS; i++) {
 
-        node = sensor_list_head_array[i];
+        node = engine->sensor_lists[i];
         while (node) {
 
             hours = node->time_in_minutes / 60;
@@ -373,70 +863,210 @@ void write_output_file(char *file_name,
     return;
 }
 
-double do_sensor_fusion_algorithm(int q_support_value,
-                                  int principal_component_ratio) {
-    Node_t *node = sensor_list_head_array[VALID_SENSOR_LIST];
+/*
+ * Runs the fusion algorithm on the valid list of the engine in the
+ * precision of its parameters, except that FUSION_PRECISION_VALIDATE is run
+ * in double.
+ */
+static double fuse_valid_sensors(Fusion_Engine_t *engine) {
+    Fusion_Workspace_t *workspace = &engine->fusion_workspace;
+    int q_support_value = engine->parameters.q_support_value;
+    int principal_component_ratio =
+        engine->parameters.principal_component_ratio;
+    Node_t *node = engine->sensor_lists[VALID_SENSOR_LIST];
     if (node == NULL) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
     /*
      ** Sensor Fusion Algorithm starts
      */
-    int no_of_sensors = count(sensor_list_head_array[VALID_SENSOR_LIST]);
+    int no_of_sensors = count(engine->sensor_lists[VALID_SENSOR_LIST]);
+    Boolean matrix_free = (engine->parameters.support_degree_mode ==
+        SUPPORT_DEGREE_MATRIX_FREE);
     /*
-    * Sensor array allocated to store the sensor data
+    * Every intermediate result lives in the workspace, which only allocates
+    * when the fleet is bigger than it has ever been. Without a support
+    * degree matrix, it holds O(n) memory instead of O(n^2); in float, the
+    * matrices are in the float workspace, so it only needs the same.
     */
-    double *sensor_array = (double *)malloc(no_of_sensors * sizeof(double));
-    if (sensor_array == NULL) {
+    if (!((matrix_free ||
+           engine->parameters.precision == FUSION_PRECISION_FLOAT) ?
+          fusion_workspace_prepare_matrix_free(workspace, no_of_sensors) :
+          fusion_workspace_prepare(workspace, no_of_sensors))) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
+    int ld = workspace->leading_dimension;
+    workspace->eigen_backend = engine->parameters.eigen_backend;
+    workspace->thread_pool = &engine->thread_pool;
+    workspace->parallel_threshold = engine->parameters.parallel_threshold;
+    Boolean parallel = fusion_workspace_parallel(workspace, no_of_sensors);
+
+    /*
+    * An epoch whose valid values were all fused together recently, in the
+    * same order, gives the same result again.
+    */
+    if (engine->parameters.use_fusion_memo) {
+        Node_t *valid = node;
+        double remembered_value;
+        for (int i = 0; i < no_of_sensors && valid; i++) {
+            workspace->sensor_array[i] = valid->sensor_value;
+            valid = valid->next;
+        }
+        if (fusion_memo_lookup(&engine->memo, workspace->sensor_array,
+                no_of_sensors, q_support_value, principal_component_ratio,
+                &remembered_value)) {
+            return remembered_value;
+        }
+    }
+
+    /*
+    * In float, every step below is run by do_sensor_fusion_float().
+    */
+    if (engine->parameters.precision == FUSION_PRECISION_FLOAT) {
+        float float_value;
+        if (do_sensor_fusion_float(&engine->float_workspace, node,
+                no_of_sensors, (float)q_support_value / 100.0f,
+                (float)principal_component_ratio / 100.0f,
+                engine->parameters.eigen_backend, &float_value) < 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+        if (engine->parameters.use_fusion_memo) {
+            fusion_memo_store(&engine->memo, float_value);
+        }
+        return float_value;
+    }
+
+    /*
+    * What is kept from the previous epoch is kept by sensor ID, since the
+    * valid list is not in the same order from one epoch to the next.
+    */
+    if (engine->parameters.support_degree_mode == SUPPORT_DEGREE_INCREMENTAL
+        || engine->parameters.eigen_solver == EIGEN_SOLVER_WARM) {
+        Node_t *valid = node;
+        for (int i = 0; i < no_of_sensors && valid; i++) {
+            workspace->sensor_id[i] = registry_lookup_sensor(
+                &engine->registry, valid->sensor_name);
+            valid = valid->next;
+        }
+    }
 
     /*
     * Step 1 - calculate_support_degree_matrix
     */
-    double *sd_matrix = calculate_support_degree_matrix(node, no_of_sensors,
-      sensor_array);
-    if (sd_matrix == NULL) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
+    int result_sd_matrix;
+    double *sd_matrix = workspace->sd_matrix;
+    int sd_ld = ld;
+    Boolean is_reordered = FALSE;
+    if (matrix_free) {
+        result_sd_matrix = calculate_support_degree_operator_into(workspace,
+            node, no_of_sensors, workspace->sensor_array);
+    } else if (engine->parameters.support_degree_mode ==
+        SUPPORT_DEGREE_INCREMENTAL) {
+        result_sd_matrix = calculate_support_degree_matrix_cached_into(
+            &engine->sd_cache, node, no_of_sensors, workspace->sensor_id,
+            workspace->sensor_array, workspace->sensor_row,
+            workspace->sd_matrix, ld, &sd_matrix, &sd_ld);
+        is_reordered = TRUE;
+    } else if (engine->parameters.support_degree_mode ==
+        SUPPORT_DEGREE_SEPARABLE) {
+        result_sd_matrix = calculate_support_degree_matrix_separable_into(
+            workspace, node, no_of_sensors, workspace->sensor_array,
+            workspace->sd_matrix, ld);
+    } else if (parallel) {
+        result_sd_matrix = calculate_support_degree_matrix_parallel_into(
+            workspace, node, no_of_sensors, workspace->sensor_array,
+            workspace->sd_matrix, ld);
+    } else {
+        result_sd_matrix = calculate_support_degree_matrix_into(node,
+            no_of_sensors, workspace->sensor_array, workspace->sd_matrix, ld);
+    }
+    if (result_sd_matrix < 0) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
     /*
     * Step 2 - calculate_eigensystem
     */
-    struct eigen_systems *eigen = calculate_eigensystem(sd_matrix,
-      no_of_sensors);
-    if (eigen == NULL) {
+    struct eigen_systems eigen = {workspace->eigen_value,
+                                  workspace->eigen_vector, ld};
+    float parameter = ((float)principal_component_ratio / 100.0);
+    int no_of_eigenpairs = no_of_sensors;
+    if (engine->parameters.eigen_solver == EIGEN_SOLVER_RANDOMIZED) {
+        no_of_eigenpairs = calculate_eigensystem_randomized_into(workspace,
+            matrix_free ? NULL : sd_matrix, sd_ld, no_of_sensors,
+            parameter, engine->parameters.approximation_accuracy, &eigen);
+        if (no_of_eigenpairs <= 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+        if (workspace->approximation_error >
+            engine->largest_approximation_error) {
+            engine->largest_approximation_error =
+                workspace->approximation_error;
+        }
+    } else if (matrix_free) {
         /*
-        * Pointer Memory freed
+        * With no matrix to solve in full, the leading eigenpairs always
+        * come from Lanczos.
         */
-        free(sensor_array);
-        free(sd_matrix);
+        no_of_eigenpairs = calculate_eigensystem_matrix_free_into(workspace,
+            no_of_sensors, parameter, &eigen);
+        if (no_of_eigenpairs <= 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+    } else if (engine->parameters.eigen_solver == EIGEN_SOLVER_WARM) {
+        no_of_eigenpairs = calculate_eigensystem_warm_into(workspace,
+            &engine->warm_start, workspace->sensor_id, sd_matrix,
+            sd_ld, no_of_sensors, parameter, &eigen);
+        if (no_of_eigenpairs <= 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+    } else if (engine->parameters.eigen_solver == EIGEN_SOLVER_LANCZOS) {
+        /*
+        * Only the leading eigenpairs the parameter needs are solved, and
+        * their rates come from the trace of the support degree matrix,
+        * which its unit diagonal makes no_of_sensors.
+        */
+        no_of_eigenpairs = calculate_eigensystem_partial_into(workspace,
+            sd_matrix, sd_ld, no_of_sensors, parameter, &eigen);
+        if (no_of_eigenpairs <= 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+    } else if (engine->parameters.eigen_solver == EIGEN_SOLVER_BLOCKS) {
+        if (calculate_eigensystem_blocks_into(workspace,
+                workspace->sensor_array, sd_matrix, sd_ld,
+                no_of_sensors, &eigen) < 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
+        }
+    } else if (calculate_eigensystem_into(workspace, sd_matrix, sd_ld,
+            no_of_sensors, &eigen) < 0) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
     /*
-    * Step 3 - calculate_contribution_rate
+    * A matrix solved in the order of the cache gives the same eigenvectors
+    * up to sign, and the sign is fixed by the order of the valid list, as
+    * it is for a matrix built in that order.
     */
-    double *contribution_rate = calculate_contribution_rate(eigen->eigen_value,
-      no_of_sensors);
-    if (contribution_rate == NULL) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
+    if (is_reordered && normalize_eigenvector_signs_in_order(&eigen,
+            no_of_eigenpairs, no_of_sensors, workspace->sensor_row) < 0) {
+        return INVALID_SENSOR_FUSION_VALUE;
+    }
 
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
-        }
-        free(eigen->eigen_vector);
-        free(eigen);
-        
+    /*
+    * Step 3 - calculate_contribution_rate
+    */
+    int result_contribution_rate;
+    if (matrix_free ||
+        (engine->parameters.eigen_solver != EIGEN_SOLVER_FULL &&
+        engine->parameters.eigen_solver != EIGEN_SOLVER_BLOCKS)) {
+        result_contribution_rate = calculate_contribution_rate_trace_into(
+            eigen.eigen_value, no_of_eigenpairs, no_of_sensors,
+            workspace->contribution_rate);
+    } else {
+        result_contribution_rate = calculate_contribution_rate_into(
+            eigen.eigen_value, no_of_sensors, workspace->contribution_rate);
+    }
+    if (result_contribution_rate < 0) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
@@ -444,143 +1074,56 @@ double do_sensor_fusion_algorithm(int q_support_value,
     * Step 4 - determine_contribution_rates_to_use
     */
     int contribution_rates_to_use = determine_contribution_rates_to_use(
-      contribution_rate, ((float)principal_component_ratio / 100.0),
-      no_of_sensors);
+      workspace->contribution_rate, parameter, no_of_eigenpairs);
     if (contribution_rates_to_use <= 0) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
-
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
-        }
-        free(eigen->eigen_vector);
-        free(eigen);
-
-        free(contribution_rate);
-
         return INVALID_CONTRIBUTION_RATES;
     }
 
     /*
-    * Step 5 - calculate_principal_components
+    * Steps 5 to 9 of an epoch shared between threads, each over a range of
+    * the sensors.
     */
-    double **principal_components_matrix = calculate_principal_components(
-      sd_matrix, no_of_sensors, eigen->eigen_vector, contribution_rates_to_use);
-    if (principal_components_matrix == NULL) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
-
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
+    if (parallel) {
+        double parallel_value;
+        if (calculate_fused_output_parallel(workspace, &eigen,
+                contribution_rates_to_use, ((float)q_support_value / 100.0),
+                no_of_sensors, &parallel_value) < 0) {
+            return INVALID_SENSOR_FUSION_VALUE;
         }
-        free(eigen->eigen_vector);
-        free(eigen);
-
-        free(contribution_rate);
-        return INVALID_SENSOR_FUSION_VALUE;
+        if (engine->parameters.use_fusion_memo) {
+            fusion_memo_store(&engine->memo, parallel_value);
+        }
+        return parallel_value;
     }
 
     /*
-    * Step 6 - calculate_integrated_support_degree_matrix
+    * Steps 5 and 6 - calculate_principal_components and
+    * calculate_integrated_support_degree_matrix. Each principal component
+    * is its eigenvector scaled by its eigenvalue, so the integrated support
+    * is found from the eigenpairs in O(m * n), with no matrix multiply.
     */
-    double *integrated_support_matrix =
-        calculate_integrated_support_degree_matrix(
-            principal_components_matrix,
-            contribution_rate,
-            contribution_rates_to_use, no_of_sensors);
-
-    if (integrated_support_matrix == NULL) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
-
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
-        }
-        free(eigen->eigen_vector);
-        free(eigen);
-
-        free(contribution_rate);
-
-        for (int i = 0; i < contribution_rates_to_use; i++) {
-            free(principal_components_matrix[i]);
-        }
-        free(principal_components_matrix);
-
+    if (calculate_integrated_support_from_eigenpairs_into(eigen.eigen_value,
+            eigen.eigen_vector, ld, workspace->contribution_rate,
+            contribution_rates_to_use, no_of_sensors,
+            workspace->integrated_support) < 0) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
     /*
     * Step 7 - eliminate_incorrect_data
     */
-    int result_eliminate = eliminate_incorrect_data(integrated_support_matrix,
-                           ((float)q_support_value / 100.0), no_of_sensors);
-
+    int result_eliminate = eliminate_incorrect_data(
+        workspace->integrated_support, ((float)q_support_value / 100.0),
+        no_of_sensors);
     if (result_eliminate < 0) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
-
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
-        }
-        free(eigen->eigen_vector);
-        free(eigen);
-
-        free(contribution_rate);
-
-        for (int i = 0; i < contribution_rates_to_use; i++) {
-            free(principal_components_matrix[i]);
-        }
-        free(principal_components_matrix);
-
-        free(integrated_support_matrix);
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
     /*
     * Step 8 - calculate_weight_coefficient
     */
-    double *weight_coeff;
-    weight_coeff = calculate_weight_coefficient(integrated_support_matrix,
-                   no_of_sensors);
-
-    if (weight_coeff == NULL) {
-        /*
-        * Pointer Memory freed
-        */
-        free(sensor_array);
-        free(sd_matrix);
-
-        free(eigen->eigen_value);
-        for (int i = 0; i < no_of_sensors; i++) {
-            free(eigen->eigen_vector[i]);
-        }
-        free(eigen->eigen_vector);
-        free(eigen);
-
-        free(contribution_rate);
-
-        for (int i = 0; i < contribution_rates_to_use; i++) {
-            free(principal_components_matrix[i]);
-        }
-        free(principal_components_matrix);
-
-        free(integrated_support_matrix);
+    if (calculate_weight_coefficient_into(workspace->integrated_support,
+            no_of_sensors, workspace->weight_coefficient) < 0) {
         return INVALID_SENSOR_FUSION_VALUE;
     }
 
@@ -588,36 +1131,36 @@ double do_sensor_fusion_algorithm(int q_support_value,
     * Step 9 - calculate_fused_output
     */
     double sensed_value;
-    double result_fused = calculate_fused_output(weight_coeff, sensor_array,
-                          no_of_sensors, &sensed_value);
-
-    /*
-    * Pointer Memory freed
-    */
-
-    free(sensor_array);
-    free(sd_matrix);
+    double result_fused = calculate_fused_output(
+        workspace->weight_coefficient, workspace->sensor_array,
+        no_of_sensors, &sensed_value);
 
-    free(eigen->eigen_value);
-    for (int i = 0; i < no_of_sensors; i++) {
-        free(eigen->eigen_vector[i]);
-    }
-    free(eigen->eigen_vector);
-    free(eigen);
-
-    free(contribution_rate);
-
-    for (int i = 0; i < contribution_rates_to_use; i++) {
-        free(principal_components_matrix[i]);
-    }
-    free(principal_components_matrix);
-
-    free(integrated_support_matrix);
-    free(weight_coeff);
-   
     if (result_fused < 0) {
       return INVALID_SENSOR_FUSION_VALUE;
     } else {
+      if (engine->parameters.use_fusion_memo) {
+          fusion_memo_store(&engine->memo, sensed_value);
+      }
       return sensed_value;
     }
 }
+
+double do_sensor_fusion_algorithm(Fusion_Engine_t *engine) {
+    double fused_value = fuse_valid_sensors(engine);
+    Node_t *node = engine->sensor_lists[VALID_SENSOR_LIST];
+
+    if (engine->parameters.precision == FUSION_PRECISION_VALIDATE &&
+        node != NULL) {
+        float float_value = 0;
+        Boolean float_valid = (do_sensor_fusion_float(
+            &engine->float_workspace, node, count(node),
+            (float)engine->parameters.q_support_value / 100.0f,
+            (float)engine->parameters.principal_component_ratio / 100.0f,
+            engine->parameters.eigen_backend, &float_value) == 0);
+        Boolean double_valid = (fused_value != INVALID_SENSOR_FUSION_VALUE &&
+            fused_value != INVALID_CONTRIBUTION_RATES);
+        float_divergence_record(&engine->float_divergence, double_valid,
+            fused_value, float_valid, float_value);
+    }
+    return fused_value;
+}
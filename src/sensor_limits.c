@@ -0,0 +1,149 @@
+/**
+ * @file sensor_limits.c
+ *
+ * @brief Implementation of the per-sensor range limits table.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <float.h>
+#include "sensor_limits.h"
+
+/*
+ * Parses one limit field. An empty field means the limit is not used, in
+ * which case no_limit is returned.
+ */
+static float parse_limit_field(char *field, float no_limit) {
+    while ((*field == ' ') || (*field == '\t')) {
+        field++;
+    }
+
+    if ((*field == '\0') || (*field == '\n') || (*field == '\r')) {
+        return no_limit;
+    }
+
+    return strtod(field, NULL);
+}
+
+void limits_init(Sensor_Limits_Table_t *table,
+                 Boolean use_high_range,
+                 float high_range,
+                 Boolean use_low_range,
+                 float low_range) {
+    table->limits = NULL;
+    table->no_of_limits = 0;
+    table->default_high_range = use_high_range ? high_range : FLT_MAX;
+    table->default_low_range = use_low_range ? low_range : -FLT_MAX;
+}
+
+Boolean limits_load_file(Sensor_Limits_Table_t *table, char *file_name) {
+    Sensor_Limit_t *limits;
+    Sensor_Limit_t *limit;
+    FILE *ifp;
+    char buf[MAX_ROW_LIMIT];
+    char *low_field;
+    char *high_field;
+    int row_count = 0;
+    int capacity = table->no_of_limits;
+
+    ifp = fopen(file_name, INPUT_MODE);
+    if (ifp == NULL) {
+        printf("Can't open limits file %s\n", file_name);
+        printf("Error - %s\n", strerror(errno));
+        return FALSE;
+    }
+
+    while (fgets(buf, MAX_ROW_LIMIT, ifp)) {
+        if (++row_count == 1) {
+            /* The first line is the header. */
+            continue;
+        }
+
+        /*
+         * Fields are split by hand rather than with strtok, since an empty
+         * field is meaningful here (no limit on that side).
+         */
+        low_field = strchr(buf, ',');
+        if (low_field == NULL) {
+            continue;
+        }
+        *low_field++ = '\0';
+
+        high_field = strchr(low_field, ',');
+        if (high_field == NULL) {
+            printf("%s: Ignoring malformed line %d\n", __func__, row_count);
+            continue;
+        }
+        *high_field++ = '\0';
+
+        if (table->no_of_limits == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            limits = realloc(table->limits, capacity * sizeof(Sensor_Limit_t));
+            if (limits == NULL) {
+                printf("%s: Unable to allocate memory!\n", __func__);
+                fclose(ifp);
+                return FALSE;
+            }
+            table->limits = limits;
+        }
+
+        limit = &table->limits[table->no_of_limits++];
+        strncpy(limit->pattern, buf, MAX_SENSOR_NAME_SIZE);
+        limit->pattern[MAX_SENSOR_NAME_SIZE - 1] = '\0';
+        limit->pattern_length = strlen(limit->pattern);
+        limit->is_prefix = FALSE;
+        if ((limit->pattern_length > 0) &&
+                (limit->pattern[limit->pattern_length - 1] ==
+                 LIMITS_PREFIX_WILDCARD)) {
+            limit->pattern[--limit->pattern_length] = '\0';
+            limit->is_prefix = TRUE;
+        }
+        limit->low_range = parse_limit_field(low_field, -FLT_MAX);
+        limit->high_range = parse_limit_field(high_field, FLT_MAX);
+    }
+
+    fclose(ifp);
+    return TRUE;
+}
+
+void limits_free(Sensor_Limits_Table_t *table) {
+    free(table->limits);
+    table->limits = NULL;
+    table->no_of_limits = 0;
+}
+
+void limits_resolve(Sensor_Limits_Table_t *table,
+                    char *sensor_name,
+                    float *low_range,
+                    float *high_range) {
+    Sensor_Limit_t *limit;
+    Sensor_Limit_t *best = NULL;
+    int i;
+
+    for (i = 0; i < table->no_of_limits; i++) {
+        limit = &table->limits[i];
+        if (!limit->is_prefix) {
+            if (strcmp(limit->pattern, sensor_name) == 0) {
+                /* An exact match always wins. */
+                best = limit;
+                break;
+            }
+        } else if ((strncmp(limit->pattern,
+                            sensor_name,
+                            limit->pattern_length) == 0) &&
+                   ((best == NULL) ||
+                    (limit->pattern_length > best->pattern_length))) {
+            best = limit;
+        }
+    }
+
+    if (best) {
+        *low_range = best->low_range;
+        *high_range = best->high_range;
+    } else {
+        *low_range = table->default_low_range;
+        *high_range = table->default_high_range;
+    }
+}
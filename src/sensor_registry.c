@@ -0,0 +1,419 @@
+/**
+ * @file sensor_registry.c
+ *
+ * @brief Implementation of the sensor registry.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <float.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sensor_registry.h"
+#include "linked_list.h"
+
+/*
+ * FNV-1a hash of the sensor name.
+ */
+static unsigned int hash_sensor_name(char *sensor_name) {
+    unsigned int hash = 2166136261u;
+
+    while (*sensor_name) {
+        hash ^= (unsigned char)*sensor_name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*
+ * Returns the hash table slot that either holds sensor_name, or is the empty
+ * slot where it would be inserted.
+ */
+static int find_slot(Sensor_Registry_t *registry, char *sensor_name) {
+    int slot = hash_sensor_name(sensor_name) & registry->hash_mask;
+    int id;
+
+    while ((id = registry->hash_table[slot]) != REGISTRY_EMPTY_SLOT) {
+        if (strcmp(registry->records[id].sensor_name, sensor_name) == 0) {
+            break;
+        }
+        slot = (slot + 1) & registry->hash_mask;
+    }
+
+    return slot;
+}
+
+/*
+ * Size in bytes of the storage needed for capacity records.
+ */
+static size_t storage_size_for(int capacity) {
+    return REGISTRY_HEADER_SIZE +
+           (size_t)capacity * sizeof(Sensor_Record_t) +
+           (size_t)capacity * 2 * sizeof(int);
+}
+
+/*
+ * Points the registry at the records and hash table within its storage.
+ */
+static void attach_storage(Sensor_Registry_t *registry) {
+    registry->records = (Sensor_Record_t *)((char *)registry->header +
+                                            REGISTRY_HEADER_SIZE);
+    registry->capacity = registry->header->capacity;
+    registry->no_of_sensors = registry->header->no_of_sensors;
+    registry->hash_table = (int *)(registry->records + registry->capacity);
+    registry->hash_mask = registry->capacity * 2 - 1;
+}
+
+/*
+ * Resizes the storage so that it can hold capacity records. Existing records
+ * are kept, but the hash table moves and needs to be rebuilt by the caller.
+ */
+static Boolean resize_storage(Sensor_Registry_t *registry, int capacity) {
+    Registry_Header_t *header;
+    Boolean is_fresh = (registry->header == NULL);
+    size_t size = storage_size_for(capacity);
+
+    if (registry->is_mapped) {
+        if (registry->header) {
+            munmap(registry->header, registry->storage_size);
+            registry->header = NULL;
+        }
+        if (ftruncate(registry->fd, size) != 0) {
+            printf("%s: Unable to resize registry file!\n", __func__);
+            printf("Error - %s\n", strerror(errno));
+            return FALSE;
+        }
+
+        header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      registry->fd, 0);
+        if (header == MAP_FAILED) {
+            printf("%s: Unable to map registry file!\n", __func__);
+            printf("Error - %s\n", strerror(errno));
+            return FALSE;
+        }
+    } else {
+        header = realloc(registry->header, size);
+        if (header == NULL) {
+            printf("%s: Unable to allocate memory!\n", __func__);
+            return FALSE;
+        }
+    }
+
+    if (is_fresh) {
+        memset(header, 0, REGISTRY_HEADER_SIZE);
+    }
+
+    registry->header = header;
+    registry->storage_size = size;
+    header->capacity = capacity;
+    attach_storage(registry);
+    return TRUE;
+}
+
+/*
+ * Empties the hash table and re-inserts every registered sensor.
+ */
+static void rebuild_hash_table(Sensor_Registry_t *registry) {
+    int id;
+    int i;
+
+    for (i = 0; i <= registry->hash_mask; i++) {
+        registry->hash_table[i] = REGISTRY_EMPTY_SLOT;
+    }
+
+    for (id = 0; id < registry->no_of_sensors; id++) {
+        registry->hash_table[find_slot(registry,
+                                       registry->records[id].sensor_name)] = id;
+    }
+}
+
+/*
+ * Turns freshly allocated storage into an empty registry.
+ */
+static Boolean format_storage(Sensor_Registry_t *registry) {
+    if (!resize_storage(registry, REGISTRY_INITIAL_CAPACITY)) {
+        return FALSE;
+    }
+
+    memcpy(registry->header->magic, REGISTRY_FILE_MAGIC,
+           sizeof(registry->header->magic));
+    registry->header->version = REGISTRY_FILE_VERSION;
+    registry->header->record_size = sizeof(Sensor_Record_t);
+    registry->header->capacity = REGISTRY_INITIAL_CAPACITY;
+    registry->header->no_of_sensors = 0;
+    registry->header->latest_time = -1;
+    attach_storage(registry);
+    rebuild_hash_table(registry);
+    return TRUE;
+}
+
+/*
+ * Checks whether mapped storage holds a registry this program can use as is.
+ */
+static Boolean storage_is_valid(Registry_Header_t *header, size_t size) {
+    return (memcmp(header->magic, REGISTRY_FILE_MAGIC,
+                   sizeof(header->magic)) == 0) &&
+           (header->version == REGISTRY_FILE_VERSION) &&
+           (header->record_size == sizeof(Sensor_Record_t)) &&
+           (header->capacity > 0) &&
+           (header->no_of_sensors >= 0) &&
+           (header->no_of_sensors <= header->capacity) &&
+           (size == storage_size_for(header->capacity));
+}
+
+/*
+ * Doubles the capacity of the registry and rebuilds the hash table. The hash
+ * table is kept at twice the record capacity so that probe chains stay short.
+ */
+static Boolean grow_registry(Sensor_Registry_t *registry) {
+    if (!resize_storage(registry, registry->capacity * 2)) {
+        return FALSE;
+    }
+
+    rebuild_hash_table(registry);
+    return TRUE;
+}
+
+Boolean registry_init(Sensor_Registry_t *registry) {
+    registry->header = NULL;
+    registry->records = NULL;
+    registry->hash_table = NULL;
+    registry->is_mapped = FALSE;
+    registry->fd = -1;
+    registry->storage_size = 0;
+    registry->resume_time = -1;
+
+    if (!format_storage(registry)) {
+        registry_free(registry);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+Boolean registry_open_file(Sensor_Registry_t *registry, char *file_name) {
+    struct stat st;
+    Registry_Header_t *header;
+
+    registry->header = NULL;
+    registry->records = NULL;
+    registry->hash_table = NULL;
+    registry->storage_size = 0;
+    registry->resume_time = -1;
+    registry->is_mapped = TRUE;
+    registry->fd = open(file_name, O_RDWR | O_CREAT, 0644);
+    if ((registry->fd < 0) || (fstat(registry->fd, &st) != 0)) {
+        printf("Can't open registry file %s\n", file_name);
+        printf("Error - %s\n", strerror(errno));
+        registry_free(registry);
+        return FALSE;
+    }
+
+    if ((size_t)st.st_size >= REGISTRY_HEADER_SIZE) {
+        header = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      registry->fd, 0);
+        if (header != MAP_FAILED) {
+            if (storage_is_valid(header, st.st_size)) {
+                /*
+                 * Warm start: the records and the hash table are used
+                 * straight from the file.
+                 */
+                registry->header = header;
+                registry->storage_size = st.st_size;
+                registry->resume_time = header->latest_time;
+                attach_storage(registry);
+                return TRUE;
+            }
+
+            printf("Registry file %s has an unknown layout, "
+                   "starting an empty registry\n", file_name);
+            munmap(header, st.st_size);
+        }
+    }
+
+    if (!format_storage(registry)) {
+        registry_free(registry);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void registry_free(Sensor_Registry_t *registry) {
+    if (registry->is_mapped) {
+        if (registry->header) {
+            msync(registry->header, registry->storage_size, MS_SYNC);
+            munmap(registry->header, registry->storage_size);
+        }
+        if (registry->fd >= 0) {
+            close(registry->fd);
+        }
+    } else {
+        free(registry->header);
+    }
+
+    registry->header = NULL;
+    registry->records = NULL;
+    registry->hash_table = NULL;
+    registry->is_mapped = FALSE;
+    registry->fd = -1;
+    registry->storage_size = 0;
+    registry->no_of_sensors = 0;
+    registry->capacity = 0;
+    registry->resume_time = -1;
+}
+
+void registry_clear(Sensor_Registry_t *registry) {
+    if (registry->header == NULL) {
+        registry_init(registry);
+        return;
+    }
+
+    registry->no_of_sensors = 0;
+    registry->header->no_of_sensors = 0;
+    registry->header->latest_time = -1;
+    registry->resume_time = -1;
+    rebuild_hash_table(registry);
+}
+
+int registry_lookup_sensor(Sensor_Registry_t *registry, char *sensor_name) {
+    if ((registry->hash_table == NULL) || (sensor_name == NULL)) {
+        return -1;
+    }
+
+    return registry->hash_table[find_slot(registry, sensor_name)];
+}
+
+int registry_register_sensor(Sensor_Registry_t *registry,
+                             char *sensor_name,
+                             Boolean *is_new) {
+    Sensor_Record_t *record;
+    int slot;
+    int id;
+
+    if (is_new) {
+        *is_new = FALSE;
+    }
+
+    if ((registry->hash_table == NULL) && !registry_init(registry)) {
+        return -1;
+    }
+
+    slot = find_slot(registry, sensor_name);
+    if (registry->hash_table[slot] != REGISTRY_EMPTY_SLOT) {
+        return registry->hash_table[slot];
+    }
+
+    if (registry->no_of_sensors == registry->capacity) {
+        if (!grow_registry(registry)) {
+            return -1;
+        }
+        /* The table was rebuilt, so the free slot has moved. */
+        slot = find_slot(registry, sensor_name);
+    }
+
+    id = registry->no_of_sensors++;
+    registry->header->no_of_sensors = registry->no_of_sensors;
+    record = &registry->records[id];
+    strncpy(record->sensor_name, sensor_name, MAX_SENSOR_NAME_SIZE);
+    record->sensor_name[MAX_SENSOR_NAME_SIZE - 1] = '\0';
+    record->low_range = -FLT_MAX;
+    record->high_range = FLT_MAX;
+    record->no_of_readings = 0;
+    record->mean = 0;
+    record->m2 = 0;
+    record->last_value = 0;
+    record->last_change_time = 0;
+    record->repeat_count = 0;
+    record->last_time = 0;
+    record->status = VALID_SENSOR_LIST;
+    registry->hash_table[slot] = id;
+
+    if (is_new) {
+        *is_new = TRUE;
+    }
+
+    return id;
+}
+
+void registry_record_reading(Sensor_Registry_t *registry,
+                             int id,
+                             int time_in_minutes,
+                             float sensor_value) {
+    Sensor_Record_t *record = &registry->records[id];
+    double delta;
+
+    /*
+     * A run reading the input of the previous one again (after a restart)
+     * would otherwise count its readings twice.
+     */
+    if (time_in_minutes > registry->resume_time) {
+        registry->resume_time = -1;
+    } else if ((record->no_of_readings > 0) &&
+               (time_in_minutes <= record->last_time)) {
+        return;
+    }
+    if (time_in_minutes > registry->header->latest_time) {
+        registry->header->latest_time = time_in_minutes;
+    }
+
+    if ((record->no_of_readings > 0) && (sensor_value == record->last_value)) {
+        ++record->repeat_count;
+    } else {
+        record->repeat_count = 0;
+        record->last_change_time = time_in_minutes;
+    }
+    record->last_value = sensor_value;
+    record->last_time = time_in_minutes;
+
+    ++record->no_of_readings;
+    delta = sensor_value - record->mean;
+    record->mean += delta / record->no_of_readings;
+    record->m2 += delta * (sensor_value - record->mean);
+}
+
+double registry_variance(Sensor_Record_t *record) {
+    if (record->no_of_readings < 2) {
+        return 0;
+    }
+
+    return record->m2 / (record->no_of_readings - 1);
+}
+
+Boolean registry_write_statistics(Sensor_Registry_t *registry,
+                                  char *file_name) {
+    Sensor_Record_t *record;
+    FILE *fp;
+    int id;
+
+    if ((registry == NULL) || (registry->header == NULL) ||
+            (file_name == NULL)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+
+    fp = fopen(file_name, "w");
+    if (fp == NULL) {
+        printf("Can't open statistics file %s\n", file_name);
+        printf("Error - %s\n", strerror(errno));
+        return FALSE;
+    }
+
+    fprintf(fp, "name,readings,mean,variance\n");
+    for (id = 0; id < registry->no_of_sensors; id++) {
+        record = &registry->records[id];
+        fprintf(fp, "%s,%d,%.6f,%.6f\n", record->sensor_name,
+                record->no_of_readings, record->mean,
+                registry_variance(record));
+    }
+
+    if (fclose(fp) != 0) {
+        printf("Can't write statistics file %s\n", file_name);
+        return FALSE;
+    }
+    return TRUE;
+}
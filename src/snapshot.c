@@ -0,0 +1,417 @@
+/**
+ * @file snapshot.c
+ *
+ * @brief Implementation of the sensor state snapshots and query server.
+ *
+ * @author Karthik Dilliraj - karthikdilliraj@cmail.carleton.ca
+ * @author Nhat Hieu Le - nhathieule@cmail.carleton.ca
+ * @author Jason Miller - jasonmiller@cmail.carleton.ca
+ */
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sensor.h"
+#include "snapshot.h"
+
+/*
+ * Name of each sensor list, as reported by the query server.
+ */
+static const char *snapshot_status_name[] = {"Valid", "OOR", "Stuck"};
+
+/*
+ * Allocates a buffer that can hold at least no_of_sensors sensors.
+ */
+static Snapshot_Buffer_t *create_buffer(int no_of_sensors) {
+    Snapshot_Buffer_t *buffer;
+    int capacity = 64;
+
+    while (capacity < no_of_sensors) {
+        capacity *= 2;
+    }
+
+    buffer = malloc(sizeof(Snapshot_Buffer_t));
+    if (buffer == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        return NULL;
+    }
+
+    buffer->sensors = malloc(capacity * sizeof(Snapshot_Sensor_t));
+    if (buffer->sensors == NULL) {
+        printf("%s: Unable to allocate memory!\n", __func__);
+        free(buffer);
+        return NULL;
+    }
+
+    buffer->capacity = capacity;
+    buffer->retired = NULL;
+    return buffer;
+}
+
+/*
+ * Copies size bytes (a multiple of the word size) a word at a time, each
+ * word being an atomic access. The payload of the sequence lock is written
+ * while readers copy it, so a plain copy would be a data race. The
+ * release stores keep every store after the sequence is made odd, and the
+ * acquire loads keep the sequence check after every load, without the
+ * fences that thread sanitizers cannot follow. Both compile to plain moves
+ * on x86.
+ */
+static void store_words(void *destination, const void *source, size_t size) {
+    unsigned int *to = destination;
+    const unsigned int *from = source;
+    size_t i;
+
+    for (i = 0; i < size / sizeof(unsigned int); i++) {
+        __atomic_store_n(&to[i], from[i], __ATOMIC_RELEASE);
+    }
+}
+
+static void load_words(void *destination, const void *source, size_t size) {
+    unsigned int *to = destination;
+    const unsigned int *from = source;
+    size_t i;
+
+    for (i = 0; i < size / sizeof(unsigned int); i++) {
+        to[i] = __atomic_load_n(&from[i], __ATOMIC_ACQUIRE);
+    }
+}
+
+static void free_buffer(Snapshot_Buffer_t *buffer) {
+    if (buffer) {
+        free(buffer->sensors);
+        free(buffer);
+    }
+}
+
+void snapshot_init(Fusion_Snapshot_t *snapshot) {
+    snapshot->sequence = 0;
+    snapshot->epoch_time = 0;
+    snapshot->fused_value = INVALID_SENSOR_FUSION_VALUE;
+    snapshot->no_of_sensors = 0;
+    snapshot->buffer = NULL;
+    snapshot->retired = NULL;
+}
+
+void snapshot_free(Fusion_Snapshot_t *snapshot) {
+    Snapshot_Buffer_t *next;
+
+    free_buffer(snapshot->buffer);
+    while (snapshot->retired) {
+        next = snapshot->retired->retired;
+        free_buffer(snapshot->retired);
+        snapshot->retired = next;
+    }
+
+    snapshot_init(snapshot);
+}
+
+Boolean snapshot_publish(Fusion_Snapshot_t *snapshot,
+                         Node_t **sensor_lists,
+                         int epoch_time,
+                         double fused_value) {
+    Snapshot_Buffer_t *buffer = snapshot->buffer;
+    Snapshot_Sensor_t *sensor;
+    Snapshot_Sensor_t staged;
+    Node_t *node;
+    unsigned int sequence = snapshot->sequence;
+    int no_of_sensors = 0;
+    int i;
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        no_of_sensors += count(sensor_lists[i]);
+    }
+
+    /*
+     * A buffer that is outgrown may still be read, so it is retired rather
+     * than freed.
+     */
+    if ((buffer == NULL) || (buffer->capacity < no_of_sensors)) {
+        buffer = create_buffer(no_of_sensors);
+        if (buffer == NULL) {
+            return FALSE;
+        }
+    }
+
+    __atomic_store_n(&snapshot->sequence, sequence + 1, __ATOMIC_RELAXED);
+
+    /*
+     * Each sensor is staged, then stored into the buffer a word at a time.
+     */
+    memset(&staged, 0, sizeof(staged));
+    sensor = buffer->sensors;
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        for (node = sensor_lists[i]; node; node = node->next, sensor++) {
+            memcpy(staged.sensor_name, node->sensor_name,
+                   strlen(node->sensor_name) + 1);
+            staged.sensor_value = node->sensor_value;
+            staged.time_in_minutes = node->time_in_minutes;
+            staged.status = i;
+            store_words(sensor, &staged, sizeof(staged));
+        }
+    }
+
+    if (buffer != snapshot->buffer) {
+        if (snapshot->buffer) {
+            snapshot->buffer->retired = snapshot->retired;
+            snapshot->retired = snapshot->buffer;
+        }
+        __atomic_store_n(&snapshot->buffer, buffer, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&snapshot->no_of_sensors, no_of_sensors,
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&snapshot->epoch_time, epoch_time, __ATOMIC_RELEASE);
+    __atomic_store(&snapshot->fused_value, &fused_value, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&snapshot->sequence, sequence + 2, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+Boolean snapshot_read(Fusion_Snapshot_t *snapshot, Fusion_Snapshot_t *copy) {
+    Snapshot_Buffer_t *buffer;
+    unsigned int sequence;
+    int no_of_sensors;
+
+    for (;;) {
+        sequence = __atomic_load_n(&snapshot->sequence, __ATOMIC_ACQUIRE);
+        if (sequence & 1) {
+            continue;
+        }
+
+        buffer = __atomic_load_n(&snapshot->buffer, __ATOMIC_ACQUIRE);
+        no_of_sensors = __atomic_load_n(&snapshot->no_of_sensors,
+                                        __ATOMIC_ACQUIRE);
+        copy->epoch_time = __atomic_load_n(&snapshot->epoch_time,
+                                           __ATOMIC_ACQUIRE);
+        __atomic_load(&snapshot->fused_value, &copy->fused_value,
+                      __ATOMIC_ACQUIRE);
+
+        /*
+         * The count and the buffer may be from different publishes, in which
+         * case the sequence check below fails, but the copy must not run
+         * past the end of either buffer in the meantime.
+         */
+        if ((buffer == NULL) || (no_of_sensors > buffer->capacity)) {
+            no_of_sensors = 0;
+        }
+
+        if ((copy->buffer == NULL) ||
+                (copy->buffer->capacity < no_of_sensors)) {
+            free_buffer(copy->buffer);
+            copy->buffer = create_buffer(no_of_sensors);
+            if (copy->buffer == NULL) {
+                return FALSE;
+            }
+        }
+
+        if (no_of_sensors > 0) {
+            load_words(copy->buffer->sensors, buffer->sensors,
+                       no_of_sensors * sizeof(Snapshot_Sensor_t));
+        }
+        copy->no_of_sensors = no_of_sensors;
+
+        if (__atomic_load_n(&snapshot->sequence, __ATOMIC_RELAXED) ==
+                sequence) {
+            copy->sequence = sequence;
+            return TRUE;
+        }
+    }
+}
+
+/*
+ * Writes one sensor as a line of a response.
+ */
+static void write_sensor(FILE *fp, Snapshot_Sensor_t *sensor) {
+    const char *status = "ERROR";
+
+    if ((sensor->status >= 0) && (sensor->status < MAX_SENSOR_LISTS)) {
+        status = snapshot_status_name[sensor->status];
+    }
+
+    fprintf(fp, "%s %s %0.4f %02d%02d\n",
+            sensor->sensor_name,
+            status,
+            sensor->sensor_value,
+            sensor->time_in_minutes / 60,
+            sensor->time_in_minutes % 60);
+}
+
+/*
+ * Reads the request line of a connection, answers it from a fresh copy of
+ * the snapshot, and closes the connection.
+ */
+static void answer_request(Snapshot_Server_t *server, int client_fd) {
+    Fusion_Snapshot_t *copy = &server->copy;
+    Snapshot_Sensor_t *sensor;
+    char request[SNAPSHOT_MAX_REQUEST_SIZE];
+    struct timeval timeout = {1, 0};
+    ssize_t bytes;
+    size_t length = 0;
+    FILE *fp;
+    int i;
+
+    /*
+     * A client that never sends its request must not hold up the others.
+     */
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    while (length < sizeof(request) - 1) {
+        bytes = read(client_fd, request + length, sizeof(request) - 1 - length);
+        if (bytes <= 0) {
+            break;
+        }
+        length += bytes;
+        if (memchr(request, '\n', length)) {
+            break;
+        }
+    }
+    request[length] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+
+    fp = fdopen(client_fd, "w");
+    if (fp == NULL) {
+        close(client_fd);
+        return;
+    }
+
+    if (!snapshot_read(server->snapshot, copy)) {
+        fprintf(fp, "ERROR\n");
+    } else if (strcmp(request, "FUSED") == 0) {
+        fprintf(fp, "%02d%02d ", copy->epoch_time / 60, copy->epoch_time % 60);
+        if (copy->fused_value == INVALID_SENSOR_FUSION_VALUE) {
+            fprintf(fp, "N/A\n");
+        } else if (copy->fused_value == INVALID_CONTRIBUTION_RATES) {
+            fprintf(fp, "N/A (Invalid Contribution Rates)\n");
+        } else {
+            fprintf(fp, "%0.4f\n", copy->fused_value);
+        }
+    } else if (strncmp(request, "SENSOR ", 7) == 0) {
+        sensor = NULL;
+        for (i = 0; i < copy->no_of_sensors; i++) {
+            if (strcmp(copy->buffer->sensors[i].sensor_name,
+                       request + 7) == 0) {
+                sensor = &copy->buffer->sensors[i];
+                break;
+            }
+        }
+
+        if (sensor) {
+            write_sensor(fp, sensor);
+        } else {
+            fprintf(fp, "UNKNOWN %s\n", request + 7);
+        }
+    } else if (strcmp(request, "LIST") == 0) {
+        for (i = 0; i < copy->no_of_sensors; i++) {
+            write_sensor(fp, &copy->buffer->sensors[i]);
+        }
+        fprintf(fp, "END\n");
+    } else {
+        fprintf(fp, "ERROR unknown request\n");
+    }
+
+    fclose(fp);
+}
+
+static void *server_thread(void *arg) {
+    Snapshot_Server_t *server = arg;
+    struct pollfd fds[2];
+    int client_fd;
+
+    fds[0].fd = server->listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = server->stop_fd[0];
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            client_fd = accept(server->listen_fd, NULL, NULL);
+            if (client_fd >= 0) {
+                answer_request(server, client_fd);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+Boolean snapshot_server_start(Snapshot_Server_t *server,
+                              Fusion_Snapshot_t *snapshot,
+                              char *socket_path) {
+    struct sockaddr_un address;
+
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        printf("%s: Incorrect Input\n", __func__);
+        return FALSE;
+    }
+
+    server->snapshot = snapshot;
+    snapshot_init(&server->copy);
+    strncpy(server->socket_path, socket_path, MAX_FILE_NAME_SIZE - 1);
+    server->socket_path[MAX_FILE_NAME_SIZE - 1] = '\0';
+
+    /*
+     * A client hanging up early must not take the whole process down.
+     */
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((server->listen_fd < 0) ||
+            (bind(server->listen_fd, (struct sockaddr *)&address,
+                  sizeof(address)) != 0) ||
+            (listen(server->listen_fd, 16) != 0)) {
+        printf("Can't listen on query socket %s\n", socket_path);
+        printf("Error - %s\n", strerror(errno));
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        return FALSE;
+    }
+
+    if (pipe(server->stop_fd) != 0) {
+        printf("%s: Unable to create pipe - %s\n", __func__, strerror(errno));
+        close(server->listen_fd);
+        unlink(socket_path);
+        return FALSE;
+    }
+
+    if (pthread_create(&server->thread, NULL, server_thread, server) != 0) {
+        printf("%s: Unable to start server thread\n", __func__);
+        close(server->stop_fd[0]);
+        close(server->stop_fd[1]);
+        close(server->listen_fd);
+        unlink(socket_path);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void snapshot_server_stop(Snapshot_Server_t *server) {
+    char stop = 0;
+
+    if (write(server->stop_fd[1], &stop, 1) == 1) {
+        pthread_join(server->thread, NULL);
+    }
+
+    close(server->stop_fd[0]);
+    close(server->stop_fd[1]);
+    close(server->listen_fd);
+    unlink(server->socket_path);
+    snapshot_free(&server->copy);
+}
@@ -19,6 +19,8 @@
 
 #include "sensor.h"
 #include "calculate_fusion.h"
+#include "exp_kernel.h"
+#include "fusion_batch.h"
 
 /**
  * @brief Epsilon to compare two float or double value
@@ -63,6 +65,194 @@ void automated_testing_csv_parsing(void);
  */
 void automated_sensor_manipulation(void);
 
+/**
+ * @brief Automated unit testing of per-sensor range limits
+ *
+ * @details Automatically tests loading the test limits file, resolving the
+ * limits of a sensor (exact, prefix and global) and the batch classification
+ * of an epoch into the Valid and Out of Range lists.
+ */
+void automated_sensor_limits(void);
+
+/**
+ * @brief Automated unit testing of per-sensor running statistics
+ *
+ * @details Automatically tests the running mean and variance, last change
+ * time and repeat count kept for each sensor, that they are written to the
+ * statistics file, and that a flat-lined sensor is moved into the Stuck
+ * list.
+ */
+void automated_sensor_statistics(void);
+
+/**
+ * @brief Automated unit testing of independent fusion engines
+ *
+ * @details Automatically tests that two engines fed readings from the same
+ * sensor name keep separate sensor lists and registries.
+ */
+void automated_fusion_engines(void);
+
+/**
+ * @brief Automated unit testing of the persistent sensor registry
+ *
+ * @details Automatically tests that a registry file written by one run is
+ * picked up as is by the next (sensor IDs, last time, last value and status),
+ * that opening it lists no sensors until the first epoch, and that a file
+ * with a different layout version is discarded.
+ */
+void automated_sensor_registry_file(void);
+
+/**
+ * @brief Automated unit testing of checkpoint and restore
+ *
+ * @details Automatically tests that the sensor lists, the registry and the
+ * input position saved by a checkpoint (written directly or by a background
+ * process) are restored as they were.
+ */
+void automated_checkpoint(void);
+
+/**
+ * @brief Automated unit testing of the sensor state snapshots
+ *
+ * @details Automatically tests that a published snapshot reads back as it
+ * was, that the query socket answers from it, and that a reader copying the
+ * snapshot while it is being published never sees a mix of two publishes.
+ */
+void automated_snapshot(void);
+
+/**
+ * @brief Automated unit testing of the fusion workspace
+ *
+ * @details Automatically tests that fusing through the workspace gives the
+ * same result as the allocating functions, and that once the workspace has
+ * been used at each fleet size, further epochs make no allocation.
+ */
+void automated_fusion_workspace(void);
+
+/**
+ * @brief Automated unit testing of the memo of fusion results
+ *
+ * @details Checks that a repeated epoch is answered from the memo, that the
+ * same values in another order are fused again, that the parameters are
+ * part of the key, and that the least recently used result is the one
+ * forgotten.
+ */
+void automated_fusion_memo(void);
+
+/**
+ * @brief Automated unit testing of the exp kernels
+ *
+ * @details Checks that every kernel the CPU supports stays within
+ * EXP_KERNEL_MAX_ULP of libm, that they all give the same bits, and that
+ * zero differences, underflow and NaN are handled.
+ */
+void automated_exp_kernel(void);
+
+/**
+ * @brief Automated unit testing of the separable support degree matrix
+ *
+ * @details Checks the matrix built from sorted per-sensor factors against
+ * exp() for every pair, over values spread across several blocks.
+ */
+void automated_separable_support_degree(void);
+
+/**
+ * @brief Automated unit testing of the support degree cache
+ *
+ * @details Runs epochs in which sensors change value, change order, join
+ * and leave, and checks that the cached matrix, read in the order of the
+ * list, is identical to a freshly computed one while only the changed rows
+ * are recomputed, and that an incremental engine agrees with an exact one.
+ */
+void automated_support_degree_cache(void);
+
+/**
+ * @brief Automated unit testing of the partial (Lanczos) eigensolver
+ *
+ * @details Checks the leading eigenpairs and contribution rates against the
+ * full eigensystem for a large fleet of agreeing sensors, and that small
+ * fleets fall back to the full eigensystem.
+ */
+void automated_partial_eigensystem(void);
+
+/**
+ * @brief Automated unit testing of the warm started eigensolver
+ *
+ * @details Solves a few epochs in which the sensors move, change order,
+ * join and leave, and checks every epoch against the full eigensystem and
+ * that the slightly changed epoch converges from its seed.
+ */
+void automated_warm_eigensystem(void);
+
+/**
+ * @brief Automated unit testing of the eigen backends
+ *
+ * @details Solves the same support degree matrix with every backend in the
+ * build, checks the eigenpairs (all of them and just the leading ones)
+ * against GSL, and prints how long each backend took.
+ */
+void automated_eigen_backends(void);
+
+/**
+ * @brief Automated unit testing of the Jacobi eigen backend
+ *
+ * @details Checks it against the built-in backend at every size the auto
+ * backend gives it, that the auto backend picks it by size, and that it
+ * finds a tiny eigenvalue to full relative accuracy.
+ */
+void automated_jacobi_eigensystem(void);
+
+/**
+ * @brief Automated unit testing of the matrix free support degree
+ *
+ * @details Checks its products and leading eigenpairs against the support
+ * degree matrix, and fuses a fleet too large for the matrix to be built.
+ */
+void automated_matrix_free_support_degree(void);
+
+/**
+ * @brief Automated unit testing of the randomized eigensolver
+ *
+ * @details Checks its eigenpairs and error estimate against the full
+ * eigensystem, with and without a matrix, and that a target it cannot meet
+ * still gives an answer at a bounded cost.
+ */
+void automated_randomized_eigensystem(void);
+
+/**
+ * @brief Automated unit testing of the float fusion algorithm
+ *
+ * @details Checks the float eigensystem and fused output against double,
+ * and that validation reports the double result and records the divergence.
+ */
+void automated_float_fusion(void);
+
+/**
+ * @brief Automated unit testing of the batched fusion
+ *
+ * @details Checks a batch with a partial last block against fusing each
+ * epoch alone with the Jacobi backend.
+ */
+void automated_batch_fusion(void);
+
+/**
+ * @brief Automated unit testing of the fusion of an epoch on several threads
+ *
+ * @details Checks the thread pool, that each step shared between threads
+ * agrees with the same step on one thread, and that the engine only shares
+ * epochs from its threshold up.
+ */
+void automated_parallel_fusion(void);
+
+/**
+ * @brief Automated unit testing of the block eigensolver
+ *
+ * @details Checks that sensors in clusters far apart are split into blocks
+ * whose merged spectrum is that of the whole matrix, that a single block is
+ * solved exactly as in full, and that the engine fuses the same value.
+ */
+void automated_block_eigensystem(void);
+
 /**
  * @brief Automated unit testing of calculate_support_degree_matrix
  *
@@ -113,6 +303,15 @@ void automated_calculate_principal_components(void);
  */
 void automated_calculate_integrated_support_degree_matrix(void);
 
+/**
+ * @brief Automated unit testing of the integrated support degree found from
+ * the eigenpairs
+ *
+ * @details Checks it against the product of the principal components for a
+ * fleet that needs several components.
+ */
+void automated_integrated_support_from_eigenpairs(void);
+
 /**
  * @brief Automated unit testing of eliminate_incorrect_data
  *
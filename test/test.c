@@ -9,7 +9,12 @@
  */
 
 #include "test.h"
+#include <float.h>
 #include <math.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
 
 /**
  * Head pointers to three linked lists used for storing three types of sensors
@@ -17,6 +22,46 @@
  */
 Node_t *test_list_head_array[MAX_SENSOR_LISTS] = {NULL};
 
+/**
+ * Fusion engine that the sensor tests feed readings into.
+ */
+Fusion_Engine_t test_engine;
+
+/**
+ * Number of heap allocations made by the program so far. The build of make
+ * test defines TEST_COUNT_ALLOCATIONS and links malloc(), calloc(),
+ * realloc() and posix_memalign() to the wrappers below, which count every
+ * call before passing it on. Other builds leave it at 0.
+ */
+static long test_no_of_allocations;
+
+#ifdef TEST_COUNT_ALLOCATIONS
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t no_of_members, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+int __real_posix_memalign(void **pointer, size_t alignment, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    __atomic_add_fetch(&test_no_of_allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t no_of_members, size_t size) {
+    __atomic_add_fetch(&test_no_of_allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(no_of_members, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    __atomic_add_fetch(&test_no_of_allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(pointer, size);
+}
+
+int __wrap_posix_memalign(void **pointer, size_t alignment, size_t size) {
+    __atomic_add_fetch(&test_no_of_allocations, 1, __ATOMIC_RELAXED);
+    return __real_posix_memalign(pointer, alignment, size);
+}
+#endif
+
 /**
  * Macro to print out 'passed'/'failed' based on the boolean value of what was
  * provided to it.
@@ -43,6 +88,42 @@ Node_t *test_list_head_array[MAX_SENSOR_LISTS] = {NULL};
  */
 #define TEST_FILENAME "test/input_test.csv"
 
+/**
+ * Name of the testing per-sensor limits file
+ */
+#define TEST_LIMITS_FILENAME "test/limits_test.csv"
+
+/**
+ * Name of the registry file created (and removed) by the registry test
+ */
+#define TEST_REGISTRY_FILENAME "registry_test.bin"
+
+/**
+ * Number of sensors registered by the registry test (enough for the registry
+ * to have to grow)
+ */
+#define TEST_REGISTRY_SENSORS 100
+
+/**
+ * Name of the statistics file created (and removed) by the statistics test
+ */
+#define TEST_STATISTICS_FILENAME "statistics_test.csv"
+
+/**
+ * Name of the checkpoint file created (and removed) by the checkpoint test
+ */
+#define TEST_CHECKPOINT_FILENAME "checkpoint_test.bin"
+
+/**
+ * Path of the query socket created (and removed) by the snapshot test
+ */
+#define TEST_SOCKET_PATH "snapshot_test.sock"
+
+/**
+ * Number of snapshots published while a reader is copying them
+ */
+#define TEST_SNAPSHOT_PUBLISHES 2000
+
 /**
  * Test values for the low and high range (sensor values outside of this range
  * will be put in the OOR list, instead of the valid list.
@@ -147,8 +228,10 @@ void automated_testing_linked_list(void) {
                                     "test3") != NULL))
 
     /**
-     * Delete node from list 2 and ensure list 2 is now empty
+     * Delete node from list 2 and ensure list 2 is now empty. move_node()
+     * frees the original node, so we need the copy that is now in list 2.
      */
+    node = search_sensor_name(test_list_head_array[OOR_SENSOR_LIST], "test3");
     printf("Delete only node from list 2 ---- ");
     test_list_head_array[OOR_SENSOR_LIST] =
         remove_node(test_list_head_array[OOR_SENSOR_LIST],
@@ -157,197 +240,2695 @@ void automated_testing_linked_list(void) {
                                    "test3") == NULL)
     --num_nodes;
 
-    printf("Ensure 0 nodes in list 2 -------- ");
-    ASSERT_TEST(count(test_list_head_array[OOR_SENSOR_LIST]) == 0)
+    printf("Ensure 0 nodes in list 2 -------- ");
+    ASSERT_TEST(count(test_list_head_array[OOR_SENSOR_LIST]) == 0)
+
+    /**
+     * Delete node from middle of list 1 and make sure that it is gone. Also
+     * ensure that there are four nodes in the list.
+     */
+    strcpy(str, "test4");
+    printf("\nDelete from middle of list 1 - ");
+    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                              str);
+
+    test_list_head_array[VALID_SENSOR_LIST] =
+        remove_node(test_list_head_array[VALID_SENSOR_LIST],
+                    node);
+    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                                   str) == NULL)
+    --num_nodes;
+    printf("Ensure %d nodes in list 1 ----- ", num_nodes);
+    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+
+    /**
+     * Delete node from end of list 1 and make sure that it is gone. Also
+     * ensure that there are three nodes in the list.
+     */
+    strcpy(str, "test6");
+    printf("\nDelete from end of list 1 - ");
+    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                              str);
+
+    test_list_head_array[VALID_SENSOR_LIST] =
+        remove_node(test_list_head_array[VALID_SENSOR_LIST],
+                    node);
+    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                                   str) == NULL)
+    --num_nodes;
+    printf("Ensure %d nodes in list 1 -- ", num_nodes);
+    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+
+    /**
+     * Delete node from beginning of list 1 and make sure that it is gone. Also
+     * ensure that there are two nodes in the list.
+     */
+    strcpy(str, "test1");
+    printf("\nDelete from end of list 1 - ");
+    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                              str);
+
+    test_list_head_array[VALID_SENSOR_LIST] =
+        remove_node(test_list_head_array[VALID_SENSOR_LIST],
+                    node);
+    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
+                                   str) == NULL)
+    --num_nodes;
+    printf("Ensure %d nodes in list 1 -- ", num_nodes);
+    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+
+    /**
+     * Delete the rest of the nodes from the beginning of the list. We want to
+     * clean up here so everything is empty for later.
+     */
+    while (count(test_list_head_array[VALID_SENSOR_LIST]) > 0) {
+        printf("\nDelete from beginning of list 1\n");
+        test_list_head_array[VALID_SENSOR_LIST] =
+            remove_from_front(test_list_head_array[VALID_SENSOR_LIST]);
+        --num_nodes;
+        printf("Ensure %d nodes in list 1 - ", num_nodes);
+        ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+    }
+}
+
+void automated_testing_csv_parsing(void) {
+    Boolean end_of_file_reached = FALSE;
+    float sensor_value;
+    float test_sensor_value;
+    char sensor_name[MAX_SENSOR_NAME_SIZE];
+    char test_sensor_name[MAX_SENSOR_NAME_SIZE];
+    int time_in_minutes;
+    int lines_read = 1;
+    int test_time_in_minutes;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("PARSER TESTING\n");
+    printf("-------------------\n");
+
+    do {
+        end_of_file_reached = parser_parse_csv_file(TEST_FILENAME,
+                              lines_read,
+                              &time_in_minutes,
+                              &sensor_name[0],
+                              &sensor_value);
+
+        switch (lines_read) {
+        case 1:
+            test_time_in_minutes = 540;
+            strcpy(test_sensor_name, "sens1");
+            test_sensor_value = 10;
+            break;
+        case 2:
+            test_time_in_minutes = 540;
+            strcpy(test_sensor_name, "sens2");
+            test_sensor_value = 12;
+            break;
+        case 3:
+            test_time_in_minutes = 570;
+            strcpy(test_sensor_name, "sens3");
+            test_sensor_value = 14;
+            break;
+        case 4:
+            test_time_in_minutes = 570;
+            strcpy(test_sensor_name, "sens2");
+            test_sensor_value = 13;
+            break;
+        default:
+            return;
+        }
+
+        printf("First line should read: %d.%02d,%s,%0.0f - ",
+               test_time_in_minutes / 60,
+               test_time_in_minutes % 60,
+               test_sensor_name,
+               test_sensor_value);
+        ASSERT_TEST((time_in_minutes == test_time_in_minutes) &&
+                    (strcmp(test_sensor_name, sensor_name) == 0) &&
+                    test_sensor_value == sensor_value)
+
+        ++lines_read;
+    } while (!end_of_file_reached);
+}
+
+void automated_sensor_manipulation(void) {
+    Boolean end_of_file_reached = FALSE;
+    Node_t *node;
+    float sensor_value;
+    char sensor_name[MAX_SENSOR_NAME_SIZE];
+    char test_name[MAX_SENSOR_NAME_SIZE];
+    int time_in_minutes;
+    int lines_read = 1;
+    int list_index;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SENSOR TESTING\n");
+    printf("-------------------\n");
+
+    do {
+        end_of_file_reached = parser_parse_csv_file(TEST_FILENAME,
+                              lines_read,
+                              &time_in_minutes,
+                              &sensor_name[0],
+                              &sensor_value);
+
+        update_sensor_lists(&test_engine,
+                            time_in_minutes,
+                            sensor_name,
+                            sensor_value,
+                            TRUE,
+                            TEST_HIGH_RANGE,
+                            TRUE,
+                            TEST_LOW_RANGE);
+
+        determine_if_sensors_are_stuck(&test_engine,
+                                       time_in_minutes,
+                                       TEST_STUCK_RANGE);
+
+        ++lines_read;
+
+    } while (!end_of_file_reached);
+
+    strcpy(test_name, "sens1");
+    printf("Ensure node \'%s\' is in Valid list - ", test_name);
+    node = search_all_chains(&test_engine, test_name, &list_index);
+    ASSERT_TEST(node && (list_index == VALID_SENSOR_LIST))
+
+    strcpy(test_name, "sens2");
+    printf("Ensure node \'%s\' is in Stuck list - ", test_name);
+    node = search_all_chains(&test_engine, test_name, &list_index);
+    ASSERT_TEST(node && (list_index == STUCK_SENSOR_LIST))
+
+    strcpy(test_name, "sens3");
+    printf("Ensure node \'%s\' is in OOR list --- ", test_name);
+    node = search_all_chains(&test_engine, test_name, &list_index);
+    ASSERT_TEST(node && (list_index == OOR_SENSOR_LIST))
+
+    strcpy(test_name, "sens4");
+    printf("Ensure node \'%s\' is in Stuck list - ", test_name);
+    node = search_all_chains(&test_engine, test_name, &list_index);
+    ASSERT_TEST(node && (list_index == STUCK_SENSOR_LIST))
+
+    strcpy(test_name, "sens5");
+    printf("Ensure node \'%s\' is in OOR list --- ", test_name);
+    node = search_all_chains(&test_engine, test_name, &list_index);
+    ASSERT_TEST(node && (list_index == OOR_SENSOR_LIST))
+}
+
+void automated_sensor_limits(void) {
+    Sensor_Limits_Table_t table;
+    Node_t *node;
+    float low_range;
+    float high_range;
+    int list_index;
+    int i;
+    char *names[] = {"temp1", "temp_probe", "temp_probe2", "press1",
+                     "press_aux1", "other1"};
+    float values[] = {90, -5, -5, 1000, 5000, 5000};
+    int expected_list[] = {OOR_SENSOR_LIST, OOR_SENSOR_LIST,
+                           VALID_SENSOR_LIST, VALID_SENSOR_LIST,
+                           VALID_SENSOR_LIST, OOR_SENSOR_LIST};
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SENSOR LIMITS TESTING\n");
+    printf("-------------------\n");
+
+    limits_init(&table, TRUE, TEST_HIGH_RANGE, TRUE, TEST_LOW_RANGE);
+    printf("Load limits file ------------------- ");
+    ASSERT_TEST(limits_load_file(&table, TEST_LIMITS_FILENAME) &&
+                (table.no_of_limits == 4))
+
+    printf("Exact match wins over prefix ------- ");
+    limits_resolve(&table, "temp_probe", &low_range, &high_range);
+    ASSERT_TEST((low_range == 0) && (high_range == FLT_MAX))
+
+    printf("Longest prefix wins ---------------- ");
+    limits_resolve(&table, "press_aux7", &low_range, &high_range);
+    ASSERT_TEST((low_range == -FLT_MAX) && (high_range == FLT_MAX))
+
+    printf("Prefix match ----------------------- ");
+    limits_resolve(&table, "temp_probe2", &low_range, &high_range);
+    ASSERT_TEST((low_range == -40) && (high_range == 85))
+
+    printf("Unmatched sensor uses global limits  ");
+    limits_resolve(&table, "other1", &low_range, &high_range);
+    ASSERT_TEST((low_range == TEST_LOW_RANGE) &&
+                (high_range == TEST_HIGH_RANGE))
+    limits_free(&table);
+
+    /*
+     * Readings are only range checked once the epoch is classified.
+     */
+    load_sensor_limits(&test_engine, TEST_LIMITS_FILENAME, TRUE,
+                       TEST_HIGH_RANGE, TRUE, TEST_LOW_RANGE);
+    for (i = 0; i < 6; i++) {
+        update_sensor_lists(&test_engine, 600, names[i], values[i], FALSE, 0,
+                            FALSE, 0);
+    }
+    classify_sensor_ranges(&test_engine);
+
+    for (i = 0; i < 6; i++) {
+        printf("Ensure node \'%s\' is in %s list - ", names[i],
+               expected_list[i] == VALID_SENSOR_LIST ? "Valid" : "OOR");
+        node = search_all_chains(&test_engine, names[i], &list_index);
+        ASSERT_TEST(node && (list_index == expected_list[i]))
+    }
+
+    load_sensor_limits(&test_engine, NULL, FALSE, 0, FALSE, 0);
+}
+
+void automated_sensor_statistics(void) {
+    Sensor_Record_t *record;
+    Node_t *node;
+    FILE *fp;
+    char line[MAX_FILE_NAME_SIZE];
+    Boolean found = FALSE;
+    float flat_values[] = {5, 5, 5, 5};
+    float varying_values[] = {2, 4, 4, 4};
+    int list_index;
+    int id;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SENSOR STATISTICS TESTING\n");
+    printf("-------------------\n");
+
+    for (i = 0; i < 4; i++) {
+        update_sensor_lists(&test_engine, 700 + i, "flat1", flat_values[i],
+                            FALSE, 0, FALSE, 0);
+        update_sensor_lists(&test_engine, 700 + i, "vary1", varying_values[i],
+                            FALSE, 0, FALSE, 0);
+    }
+
+    id = registry_lookup_sensor(&test_engine.registry, "vary1");
+    printf("Ensure \'vary1\' is registered ------------ ");
+    ASSERT_TEST(id >= 0)
+    record = &test_engine.registry.records[id];
+
+    printf("Running mean of {2, 4, 4, 4} is 3.5 ---- ");
+    ASSERT_TEST((record->no_of_readings == 4) &&
+                (fabs(record->mean - 3.5) < EPSILON))
+
+    printf("Running variance of {2, 4, 4, 4} is 1 -- ");
+    ASSERT_TEST(fabs(registry_variance(record) - 1.0) < EPSILON)
+
+    printf("Last change of \'vary1\' at 701 --------- ");
+    ASSERT_TEST(record->last_change_time == 701)
+
+    printf("\'vary1\' has repeated twice ------------- ");
+    ASSERT_TEST(record->repeat_count == 2)
+
+    id = registry_lookup_sensor(&test_engine.registry, "flat1");
+    record = &test_engine.registry.records[id];
+    printf("\'flat1\' has repeated three times ------- ");
+    ASSERT_TEST((record->repeat_count == 3) &&
+                (record->last_change_time == 700) &&
+                (registry_variance(record) == 0))
+
+    printf("Statistics written to a file ------- ");
+    if (registry_write_statistics(&test_engine.registry,
+                                  TEST_STATISTICS_FILENAME) &&
+            (fp = fopen(TEST_STATISTICS_FILENAME, "r")) != NULL) {
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            found = found ||
+                    (strcmp(line, "vary1,4,3.500000,1.000000\n") == 0);
+        }
+        fclose(fp);
+    }
+    unlink(TEST_STATISTICS_FILENAME);
+    ASSERT_TEST(found)
+
+    determine_if_sensors_are_flat_lined(&test_engine, 3);
+
+    printf("Ensure node \'flat1\' is in Stuck list --- ");
+    node = search_all_chains(&test_engine, "flat1", &list_index);
+    ASSERT_TEST(node && (list_index == STUCK_SENSOR_LIST))
+
+    printf("Ensure node \'vary1\' is in Valid list --- ");
+    node = search_all_chains(&test_engine, "vary1", &list_index);
+    ASSERT_TEST(node && (list_index == VALID_SENSOR_LIST))
+}
+
+void automated_fusion_engines(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engines[2];
+    Node_t *node;
+    int list_index;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("FUSION ENGINE TESTING\n");
+    printf("-------------------\n");
+
+    /*
+     * The same sensor reports different values to two engines, and is only
+     * out of range in one of them.
+     */
+    parameters.use_high_range = TRUE;
+    parameters.high_range = TEST_HIGH_RANGE;
+    parameters.principal_component_ratio = 100;
+    for (i = 0; i < 2; i++) {
+        engine_init(&engines[i], &parameters, NULL);
+        update_sensor_lists(&engines[i], 600, "site1", 10 + i * 20, FALSE, 0,
+                            FALSE, 0);
+        classify_sensor_ranges(&engines[i]);
+    }
+    update_sensor_lists(&engines[1], 600, "site2", 12, FALSE, 0, FALSE, 0);
+
+    printf("Engine 0 keeps its own reading ----- ");
+    node = search_all_chains(&engines[0], "site1", &list_index);
+    ASSERT_TEST(node && (node->sensor_value == 10) &&
+                (list_index == VALID_SENSOR_LIST) &&
+                (engines[0].registry.no_of_sensors == 1))
+
+    printf("Engine 1 keeps its own reading ----- ");
+    node = search_all_chains(&engines[1], "site1", &list_index);
+    ASSERT_TEST(node && (node->sensor_value == 30) &&
+                (list_index == OOR_SENSOR_LIST) &&
+                (engines[1].registry.no_of_sensors == 2))
+
+    printf("Sensor only seen by engine 1 ------- ");
+    ASSERT_TEST(!search_all_chains(&engines[0], "site2", &list_index) &&
+                (registry_lookup_sensor(&engines[0].registry, "site2") < 0))
+
+    for (i = 0; i < 2; i++) {
+        engine_free(&engines[i]);
+    }
+}
+
+void automated_sensor_registry_file(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engine;
+    Sensor_Registry_t registry;
+    Sensor_Record_t *record;
+    char name[MAX_SENSOR_NAME_SIZE];
+    Boolean rc = TRUE;
+    int id;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SENSOR REGISTRY FILE TESTING\n");
+    printf("-------------------\n");
+
+    unlink(TEST_REGISTRY_FILENAME);
+    printf("Create registry file --------------- ");
+    ASSERT_TEST(registry_open_file(&registry, TEST_REGISTRY_FILENAME) &&
+                (registry.no_of_sensors == 0))
+
+    for (i = 0; i < TEST_REGISTRY_SENSORS; i++) {
+        sprintf(name, "reg%d", i);
+        id = registry_register_sensor(&registry, name, NULL);
+        registry_record_reading(&registry, id, 600 + i, i * 0.5);
+        registry.records[id].status = i % MAX_SENSOR_LISTS;
+    }
+    registry_free(&registry);
+
+    printf("Reopen registry file --------------- ");
+    ASSERT_TEST(registry_open_file(&registry, TEST_REGISTRY_FILENAME) &&
+                (registry.no_of_sensors == TEST_REGISTRY_SENSORS))
+
+    for (i = 0; i < TEST_REGISTRY_SENSORS; i++) {
+        sprintf(name, "reg%d", i);
+        id = registry_lookup_sensor(&registry, name);
+        if (id != i) {
+            rc = FALSE;
+            break;
+        }
+        record = &registry.records[id];
+        rc = rc && (record->last_time == 600 + i) &&
+             (record->last_value == (float)(i * 0.5)) &&
+             (record->status == i % MAX_SENSOR_LISTS) &&
+             (record->no_of_readings == 1);
+    }
+    printf("Sensors restored from registry file  ");
+    ASSERT_TEST(rc)
+
+    printf("Unknown sensor is not found -------- ");
+    ASSERT_TEST(registry_lookup_sensor(&registry, "reg100") < 0)
+
+    /*
+     * A restarted run reads the same input again: only readings newer than
+     * the ones a sensor already has are recorded.
+     */
+    registry_record_reading(&registry, 3, 600, 7.0f);
+    registry_record_reading(&registry, 3, 603, 7.0f);
+    record = &registry.records[3];
+    printf("Replayed readings not recorded ----- ");
+    ASSERT_TEST((record->no_of_readings == 1) &&
+                (record->last_value == 1.5f) && (record->repeat_count == 0))
+
+    registry_record_reading(&registry, 3, 700, 1.5f);
+    printf("New readings recorded -------------- ");
+    ASSERT_TEST((record->no_of_readings == 2) &&
+                (record->repeat_count == 1) && (registry.resume_time == -1))
+
+    registry_free(&registry);
+
+    /*
+     * Opening the registry for a run lists no sensors: the ones that do not
+     * report are only put back into their lists at the first epoch.
+     */
+    engine_init(&engine, &parameters, NULL);
+    printf("Registry opens without listing ----- ");
+    ASSERT_TEST(open_sensor_registry(&engine, TEST_REGISTRY_FILENAME) &&
+                engine.restore_pending &&
+                !engine.sensor_lists[VALID_SENSOR_LIST] &&
+                !engine.sensor_lists[OOR_SENSOR_LIST] &&
+                !engine.sensor_lists[STUCK_SENSOR_LIST])
+
+    /*
+     * A file written with another layout version must not be trusted.
+     */
+    engine.registry.header->version = REGISTRY_FILE_VERSION + 1;
+    engine_free(&engine);
+    printf("Other version starts empty --------- ");
+    ASSERT_TEST(registry_open_file(&registry, TEST_REGISTRY_FILENAME) &&
+                (registry.no_of_sensors == 0))
+    registry_free(&registry);
+    unlink(TEST_REGISTRY_FILENAME);
+}
+
+/*
+ * Checks that a restored list holds the expected (name, value) pairs in order.
+ */
+static Boolean checkpoint_list_matches(Node_t *node,
+                                       char **names,
+                                       float *values,
+                                       int no_of_nodes) {
+    int i;
+
+    for (i = 0; i < no_of_nodes; i++, node = node->next) {
+        if ((node == NULL) || (strcmp(node->sensor_name, names[i]) != 0) ||
+                (node->sensor_value != values[i]) ||
+                (node->time_in_minutes != 600)) {
+            return FALSE;
+        }
+    }
+
+    return (node == NULL);
+}
+
+void automated_checkpoint(void) {
+    char *valid_names[] = {"cp1", "cp2", "cp3"};
+    float valid_values[] = {10.5, 11.5, 12.5};
+    char *oor_names[] = {"cp4"};
+    float oor_values[] = {99};
+    Checkpoint_Position_t position = {42, 600, 601, 1234};
+    Checkpoint_Position_t restored;
+    Sensor_Registry_t registry;
+    pid_t checkpoint_pid = 0;
+    Boolean rc;
+    int id;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("CHECKPOINT TESTING\n");
+    printf("-------------------\n");
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        while (test_list_head_array[i]) {
+            test_list_head_array[i] =
+                remove_from_front(test_list_head_array[i]);
+        }
+    }
+
+    registry_init(&registry);
+    for (i = 2; i >= 0; i--) {
+        test_list_head_array[VALID_SENSOR_LIST] =
+            create(600, valid_names[i], valid_values[i],
+                   test_list_head_array[VALID_SENSOR_LIST]);
+    }
+    test_list_head_array[OOR_SENSOR_LIST] =
+        create(600, oor_names[0], oor_values[0], NULL);
+    for (i = 0; i < 3; i++) {
+        id = registry_register_sensor(&registry, valid_names[i], NULL);
+        registry_record_reading(&registry, id, 600, valid_values[i]);
+    }
+    id = registry_register_sensor(&registry, oor_names[0], NULL);
+    registry.records[id].status = OOR_SENSOR_LIST;
+
+    unlink(TEST_CHECKPOINT_FILENAME);
+    printf("No checkpoint to restore ----------- ");
+    ASSERT_TEST(!checkpoint_read(TEST_CHECKPOINT_FILENAME, &restored,
+                                 test_list_head_array, &registry) &&
+                (count(test_list_head_array[VALID_SENSOR_LIST]) == 3))
+
+    printf("Write checkpoint ------------------- ");
+    ASSERT_TEST(checkpoint_write(TEST_CHECKPOINT_FILENAME, &position,
+                                 test_list_head_array, &registry))
+
+    /*
+     * Change the state, so that the restore has something to undo.
+     */
+    test_list_head_array[VALID_SENSOR_LIST] =
+        remove_from_front(test_list_head_array[VALID_SENSOR_LIST]);
+    registry_register_sensor(&registry, "cp5", NULL);
+
+    printf("Restore checkpoint ----------------- ");
+    rc = checkpoint_read(TEST_CHECKPOINT_FILENAME, &restored,
+                         test_list_head_array, &registry);
+    ASSERT_TEST(rc && (restored.lines_read == 42) &&
+                (restored.current_time == 600) &&
+                (restored.time_in_minutes == 601) &&
+                (restored.output_offset == 1234))
+
+    printf("Sensor lists restored -------------- ");
+    ASSERT_TEST(checkpoint_list_matches(test_list_head_array[VALID_SENSOR_LIST],
+                                        valid_names, valid_values, 3) &&
+                checkpoint_list_matches(test_list_head_array[OOR_SENSOR_LIST],
+                                        oor_names, oor_values, 1) &&
+                (test_list_head_array[STUCK_SENSOR_LIST] == NULL))
+
+    id = registry_lookup_sensor(&registry, "cp2");
+    printf("Registry restored ------------------ ");
+    ASSERT_TEST((registry.no_of_sensors == 4) && (id == 1) &&
+                (registry.records[id].no_of_readings == 1) &&
+                (registry.records[id].last_value == (float)11.5) &&
+                (registry.records[3].status == OOR_SENSOR_LIST) &&
+                (registry_lookup_sensor(&registry, "cp5") < 0))
+
+    /*
+     * Background checkpoint: the state changed after the fork must not end up
+     * in the file.
+     */
+    unlink(TEST_CHECKPOINT_FILENAME);
+    position.lines_read = 50;
+    rc = checkpoint_start_async(&checkpoint_pid, TEST_CHECKPOINT_FILENAME,
+                                &position,
+                                test_list_head_array, &registry);
+    test_list_head_array[VALID_SENSOR_LIST] =
+        remove_from_front(test_list_head_array[VALID_SENSOR_LIST]);
+    printf("Write checkpoint in background ----- ");
+    ASSERT_TEST(rc && checkpoint_wait(&checkpoint_pid))
+
+    printf("Restore background checkpoint ------ ");
+    rc = checkpoint_read(TEST_CHECKPOINT_FILENAME, &restored,
+                         test_list_head_array, &registry);
+    ASSERT_TEST(rc && (restored.lines_read == 50) &&
+                checkpoint_list_matches(test_list_head_array[VALID_SENSOR_LIST],
+                                        valid_names, valid_values, 3))
+
+    for (i = 0; i < MAX_SENSOR_LISTS; i++) {
+        while (test_list_head_array[i]) {
+            test_list_head_array[i] =
+                remove_from_front(test_list_head_array[i]);
+        }
+    }
+    registry_free(&registry);
+    unlink(TEST_CHECKPOINT_FILENAME);
+}
+
+/*
+ * Reader used by the snapshot test. Keeps copying the snapshot while it is
+ * being published, and counts copies that mix two publishes (every sensor
+ * of a publish has the value of its epoch time).
+ */
+static void *snapshot_test_reader(void *arg) {
+    Fusion_Snapshot_t *snapshot = arg;
+    Fusion_Snapshot_t copy;
+    long torn_copies = 0;
+    int i;
+
+    snapshot_init(&copy);
+    do {
+        snapshot_read(snapshot, &copy);
+        for (i = 0; i < copy.no_of_sensors; i++) {
+            if ((copy.buffer->sensors[i].sensor_value != copy.epoch_time) ||
+                    (copy.buffer->sensors[i].time_in_minutes !=
+                     copy.epoch_time)) {
+                ++torn_copies;
+                break;
+            }
+        }
+    } while (copy.epoch_time < TEST_SNAPSHOT_PUBLISHES);
+    snapshot_free(&copy);
+
+    return (void *)torn_copies;
+}
+
+/*
+ * Sends a request to the query socket and reads back the first line of the
+ * response.
+ */
+static Boolean snapshot_test_query(char *request, char *response, int size) {
+    struct sockaddr_un address;
+    FILE *fp;
+    int fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, TEST_SOCKET_PATH);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((fd < 0) ||
+            (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return FALSE;
+    }
+
+    if (write(fd, request, strlen(request)) != (ssize_t)strlen(request)) {
+        close(fd);
+        return FALSE;
+    }
+
+    fp = fdopen(fd, "r");
+    response[0] = '\0';
+    if (fp) {
+        if (fgets(response, size, fp)) {
+            response[strcspn(response, "\n")] = '\0';
+        }
+        fclose(fp);
+    } else {
+        close(fd);
+    }
+
+    return TRUE;
+}
+
+void automated_snapshot(void) {
+    Node_t *lists[MAX_SENSOR_LISTS] = {NULL};
+    Fusion_Snapshot_t snapshot;
+    Fusion_Snapshot_t copy;
+    Snapshot_Server_t server;
+    Node_t *node;
+    char name[MAX_SENSOR_NAME_SIZE];
+    char response[MAX_ROW_LIMIT];
+    pthread_t reader;
+    void *torn_copies;
+    Boolean rc;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SNAPSHOT TESTING\n");
+    printf("-------------------\n");
+
+    snapshot_init(&snapshot);
+    snapshot_init(&copy);
+    lists[VALID_SENSOR_LIST] = create(600, "snap1", 10.5, NULL);
+    lists[STUCK_SENSOR_LIST] = create(540, "snap2", 7.25, NULL);
+
+    snapshot_publish(&snapshot, lists, 600, 10.5);
+    printf("Read published snapshot ------------ ");
+    ASSERT_TEST(snapshot_read(&snapshot, &copy) &&
+                (copy.no_of_sensors == 2) && (copy.epoch_time == 600) &&
+                (copy.fused_value == 10.5) &&
+                (strcmp(copy.buffer->sensors[1].sensor_name, "snap2") == 0) &&
+                (copy.buffer->sensors[1].status == STUCK_SENSOR_LIST))
+
+    printf("Start query server ----------------- ");
+    ASSERT_TEST(snapshot_server_start(&server, &snapshot, TEST_SOCKET_PATH))
+
+    printf("Query fused value ------------------ ");
+    rc = snapshot_test_query("FUSED\n", response, sizeof(response));
+    ASSERT_TEST(rc && (strcmp(response, "1000 10.5000") == 0))
+
+    printf("Query sensor status ---------------- ");
+    rc = snapshot_test_query("SENSOR snap2\n", response, sizeof(response));
+    ASSERT_TEST(rc && (strcmp(response, "snap2 Stuck 7.2500 0900") == 0))
+
+    printf("Query unknown sensor --------------- ");
+    rc = snapshot_test_query("SENSOR snap3\n", response, sizeof(response));
+    ASSERT_TEST(rc && (strcmp(response, "UNKNOWN snap3") == 0))
+
+    snapshot_server_stop(&server);
+
+    /*
+     * Publish while another thread reads. The lists grow as they go, so the
+     * snapshot has to move to bigger buffers under the reader too.
+     */
+    while (lists[VALID_SENSOR_LIST]) {
+        lists[VALID_SENSOR_LIST] = remove_from_front(lists[VALID_SENSOR_LIST]);
+    }
+    while (lists[STUCK_SENSOR_LIST]) {
+        lists[STUCK_SENSOR_LIST] = remove_from_front(lists[STUCK_SENSOR_LIST]);
+    }
+
+    /*
+     * The reader may start before the first publish below, so what it first
+     * sees must be consistent too.
+     */
+    snapshot_publish(&snapshot, lists, 0, 0);
+    pthread_create(&reader, NULL, snapshot_test_reader, &snapshot);
+    for (i = 1; i <= TEST_SNAPSHOT_PUBLISHES; i++) {
+        if ((i % 10) == 0) {
+            sprintf(name, "snap%d", i);
+            lists[VALID_SENSOR_LIST] = create(0, name, 0,
+                                              lists[VALID_SENSOR_LIST]);
+        }
+        for (node = lists[VALID_SENSOR_LIST]; node; node = node->next) {
+            node->sensor_value = i;
+            node->time_in_minutes = i;
+        }
+        snapshot_publish(&snapshot, lists, i, i);
+    }
+    pthread_join(reader, &torn_copies);
+
+    printf("Concurrent reads are consistent ---- ");
+    ASSERT_TEST(torn_copies == NULL)
+
+    while (lists[VALID_SENSOR_LIST]) {
+        lists[VALID_SENSOR_LIST] = remove_from_front(lists[VALID_SENSOR_LIST]);
+    }
+    snapshot_free(&copy);
+    snapshot_free(&snapshot);
+}
+
+/*
+ * Runs the fusion algorithm on values through the allocating functions of
+ * calculate_fusion.h, as a reference for the other implementations.
+ */
+static double reference_fusion(double *values, int no_of_sensors,
+                               int q_support_value,
+                               int principal_component_ratio) {
+    Node_t *node = NULL;
+    double sensor_array[no_of_sensors];
+    double fused_value = INVALID_SENSOR_FUSION_VALUE;
+    int m;
+    int i;
+
+    for (i = no_of_sensors - 1; i >= 0; i--) {
+        node = create(0, "ref", values[i], node);
+    }
+
+    double *sd_matrix = calculate_support_degree_matrix(node, no_of_sensors,
+                                                        sensor_array);
+    struct eigen_systems *eigen = calculate_eigensystem(sd_matrix,
+                                                        no_of_sensors);
+    double *contribution_rate = calculate_contribution_rate(
+                                    eigen->eigen_value, no_of_sensors);
+    m = determine_contribution_rates_to_use(contribution_rate,
+            (float)principal_component_ratio / 100.0, no_of_sensors);
+    double *integrated_support = (double *)malloc(no_of_sensors *
+                                                  sizeof(double));
+    calculate_integrated_support_from_eigenpairs_into(eigen->eigen_value,
+        eigen->eigen_vector, no_of_sensors, contribution_rate, m,
+        no_of_sensors, integrated_support);
+    eliminate_incorrect_data(integrated_support,
+                             (float)q_support_value / 100.0, no_of_sensors);
+    double *weight_coefficient = calculate_weight_coefficient(
+                                     integrated_support, no_of_sensors);
+    calculate_fused_output(weight_coefficient, sensor_array, no_of_sensors,
+                           &fused_value);
+
+    free(eigen->eigen_vector);
+    free(eigen->eigen_value);
+    free(eigen);
+    free(sd_matrix);
+    free(contribution_rate);
+    free(integrated_support);
+    free(weight_coefficient);
+    while (node) {
+        node = remove_from_front(node);
+    }
+
+    return fused_value;
+}
+
+void automated_fusion_workspace(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engine;
+    double values[] = {10.1, 10.3, 9.9, 10.0, 25.0};
+    double fused_value;
+    double fused_value_of_four;
+    long no_of_allocations;
+    long no_of_heap_allocations = 0;
+    long heap_allocations_before;
+    Boolean rc = TRUE;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("FUSION WORKSPACE TESTING\n");
+    printf("-------------------\n");
+
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    engine_init(&engine, &parameters, NULL);
+    for (i = 4; i >= 0; i--) {
+        engine.sensor_lists[VALID_SENSOR_LIST] =
+            create(600, "ws", values[i],
+                   engine.sensor_lists[VALID_SENSOR_LIST]);
+    }
+
+    printf("Same result as allocating functions  ");
+    fused_value = do_sensor_fusion_algorithm(&engine);
+    ASSERT_TEST(fused_value == reference_fusion(values, 5, 70, 85))
+
+    /*
+     * Warm up at both sizes the fleet alternates between.
+     */
+    engine.sensor_lists[VALID_SENSOR_LIST] =
+        remove_from_front(engine.sensor_lists[VALID_SENSOR_LIST]);
+    do_sensor_fusion_algorithm(&engine);
+    no_of_allocations = engine.fusion_workspace.no_of_allocations;
+    fused_value_of_four = reference_fusion(values + 1, 4, 70, 85);
+
+    /*
+     * Only the allocations made while fusing are counted, not those of the
+     * list changes between epochs. The second half runs with the memo on,
+     * as the program does by default; its first epoch at each size fills a
+     * memo entry, so it is part of the warm up.
+     */
+    for (i = 0; i < 200; i++) {
+        double value;
+
+        if (i % 2) {
+            engine.sensor_lists[VALID_SENSOR_LIST] =
+                remove_from_front(engine.sensor_lists[VALID_SENSOR_LIST]);
+        } else {
+            engine.sensor_lists[VALID_SENSOR_LIST] =
+                create(600, "ws", values[0],
+                       engine.sensor_lists[VALID_SENSOR_LIST]);
+        }
+        if (i == 100) {
+            engine.parameters.use_fusion_memo = TRUE;
+        }
+        heap_allocations_before = __atomic_load_n(&test_no_of_allocations,
+                                                  __ATOMIC_RELAXED);
+        value = do_sensor_fusion_algorithm(&engine);
+        if ((i < 100) || (i >= 102)) {
+            no_of_heap_allocations += __atomic_load_n(&test_no_of_allocations,
+                __ATOMIC_RELAXED) - heap_allocations_before;
+        }
+        rc = rc && (value == ((i % 2) ? fused_value_of_four : fused_value));
+    }
+
+    printf("Results stay correct across epochs - ");
+    ASSERT_TEST(rc)
+
+    printf("No allocations once warmed up ------ ");
+    ASSERT_TEST(engine.fusion_workspace.no_of_allocations == no_of_allocations)
+
+#ifdef TEST_COUNT_ALLOCATIONS
+    printf("Heap allocations once warmed up: %ld\n", no_of_heap_allocations);
+    printf("No heap allocations once warmed up - ");
+    ASSERT_TEST((no_of_heap_allocations == 0) && (test_no_of_allocations > 0))
+#else
+    printf("Heap allocations are only counted by make test\n");
+#endif
+
+    printf("Rows aligned for the fleet size ---- ");
+    ASSERT_TEST((engine.fusion_workspace.leading_dimension %
+                 (FUSION_MATRIX_ALIGNMENT / sizeof(double)) == 0) &&
+                (engine.fusion_workspace.leading_dimension >= 5) &&
+                ((uintptr_t)engine.fusion_workspace.sd_matrix %
+                 FUSION_MATRIX_ALIGNMENT == 0) &&
+                ((uintptr_t)engine.fusion_workspace.eigen_vector %
+                 FUSION_MATRIX_ALIGNMENT == 0) &&
+                ((uintptr_t)engine.fusion_workspace.krylov_basis %
+                 FUSION_MATRIX_ALIGNMENT == 0))
+
+    engine_free(&engine);
+}
+
+void automated_fusion_memo(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engine;
+    Fusion_Memo_t memo;
+    double values[] = {10.1, 10.3, 9.9, 10.0, 25.0};
+    double fleet[] = {1.30, 1.31, 0.0, 1.29, 0.01, 1.32};
+    double reordered[] = {0.0, 0.01, 1.30, 1.31, 1.29, 1.32};
+    double fused_value;
+    double remembered_value = 0;
+    Boolean rc = TRUE;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("FUSION MEMO TESTING\n");
+    printf("-------------------\n");
+
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    parameters.use_fusion_memo = TRUE;
+    engine_init(&engine, &parameters, NULL);
+    for (i = 4; i >= 0; i--) {
+        engine.sensor_lists[VALID_SENSOR_LIST] =
+            create(600, "memo", values[i],
+                   engine.sensor_lists[VALID_SENSOR_LIST]);
+    }
+    fused_value = do_sensor_fusion_algorithm(&engine);
+
+    /*
+     * The same readings again.
+     */
+    while (engine.sensor_lists[VALID_SENSOR_LIST]) {
+        engine.sensor_lists[VALID_SENSOR_LIST] =
+            remove_from_front(engine.sensor_lists[VALID_SENSOR_LIST]);
+    }
+    for (i = 4; i >= 0; i--) {
+        engine.sensor_lists[VALID_SENSOR_LIST] =
+            create(601, "memo", values[i],
+                   engine.sensor_lists[VALID_SENSOR_LIST]);
+    }
+
+    printf("Repeated epoch answered from memo -- ");
+    ASSERT_TEST((fused_value == reference_fusion(values, 5, 70, 85)) &&
+                (do_sensor_fusion_algorithm(&engine) == fused_value) &&
+                (engine.memo.no_of_hits == 1) &&
+                (engine.memo.no_of_misses == 1))
+
+    printf("Parameters are part of the key ----- ");
+    engine.parameters.q_support_value = 60;
+    do_sensor_fusion_algorithm(&engine);
+    ASSERT_TEST((engine.memo.no_of_hits == 1) &&
+                (engine.memo.no_of_misses == 2))
+    engine_free(&engine);
+
+    /*
+     * The signs of the eigenvectors depend on the order of the sensors, so
+     * the same readings in another order are fused again.
+     */
+    engine_init(&engine, &parameters, NULL);
+    for (i = 0; i < 2; i++) {
+        double *epoch = i ? reordered : fleet;
+        for (int j = 5; j >= 0; j--) {
+            engine.sensor_lists[VALID_SENSOR_LIST] =
+                create(602 + i, "memo", epoch[j],
+                       engine.sensor_lists[VALID_SENSOR_LIST]);
+        }
+        fused_value = do_sensor_fusion_algorithm(&engine);
+        while (engine.sensor_lists[VALID_SENSOR_LIST]) {
+            engine.sensor_lists[VALID_SENSOR_LIST] =
+                remove_from_front(engine.sensor_lists[VALID_SENSOR_LIST]);
+        }
+    }
+
+    printf("Reordered epoch fused again -------- ");
+    ASSERT_TEST((fused_value == reference_fusion(reordered, 6, 70, 85)) &&
+                (fused_value != reference_fusion(fleet, 6, 70, 85)) &&
+                (engine.memo.no_of_hits == 0) &&
+                (engine.memo.no_of_misses == 2))
+    engine_free(&engine);
+
+    /*
+     * Fill the memo with other epochs while still using the first one, so
+     * that the second one is the least recently used.
+     */
+    fusion_memo_init(&memo);
+    for (i = 0; i <= FUSION_MEMO_ENTRIES; i++) {
+        values[0] = 10.1 + i;
+        if (!fusion_memo_lookup(&memo, values, 5, 70, 85,
+                                &remembered_value)) {
+            fusion_memo_store(&memo, i);
+        }
+        values[0] = 10.1;
+        rc = rc && fusion_memo_lookup(&memo, values, 5, 70, 85,
+                                      &remembered_value);
+    }
+    values[0] = 11.1;
+
+    printf("Least recently used is forgotten --- ");
+    ASSERT_TEST(rc && (remembered_value == 0) &&
+                !fusion_memo_lookup(&memo, values, 5, 70, 85,
+                                    &remembered_value))
+    fusion_memo_free(&memo);
+}
+
+/*
+ * Distance between two doubles of the same sign, in units in the last place.
+ */
+static int64_t ulp_distance(double a, double b) {
+    int64_t bits_a;
+    int64_t bits_b;
+
+    memcpy(&bits_a, &a, sizeof(bits_a));
+    memcpy(&bits_b, &b, sizeof(bits_b));
+    return (bits_a > bits_b) ? bits_a - bits_b : bits_b - bits_a;
+}
+
+void automated_exp_kernel(void) {
+    Exp_Kernel_t selected = exp_kernel_selected();
+    enum { NO_OF_VALUES = 4099 };
+    double values[NO_OF_VALUES];
+    double expected[NO_OF_VALUES];
+    double portable[NO_OF_VALUES];
+    double row[NO_OF_VALUES];
+    double special[] = {0.5, 0.5 + 708.5, 0.5 - 750, NAN, 0.5 - 1e-300};
+    Boolean within_ulp = TRUE;
+    Boolean identical = TRUE;
+    Boolean special_ok = TRUE;
+    int kernel;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("EXP KERNEL TESTING\n");
+    printf("-------------------\n");
+    printf("Selected kernel: %s\n", exp_kernel_name(selected));
+
+    /*
+     * Differences covering the whole range where the result is normal, with
+     * a count that leaves a tail for every vector width.
+     */
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        values[i] = (i % 2) ? 0.5 - i * (708.0 / NO_OF_VALUES) :
+                              0.5 + (i % 97) * 0.0103;
+    }
+    values[1] = 0.5 + 708.2;
+    values[3] = 0.5 - EXP_KERNEL_MIN_ARGUMENT;
+    exp_kernel_select(EXP_KERNEL_REFERENCE);
+    exp_kernel_row(0.5, values, NO_OF_VALUES, expected);
+    exp_kernel_select(EXP_KERNEL_PORTABLE);
+    exp_kernel_row(0.5, values, NO_OF_VALUES, portable);
+
+    for (kernel = EXP_KERNEL_PORTABLE; kernel < EXP_KERNEL_COUNT; kernel++) {
+        if (!exp_kernel_select((Exp_Kernel_t)kernel)) {
+            printf("%s not supported by this CPU\n",
+                   exp_kernel_name((Exp_Kernel_t)kernel));
+            continue;
+        }
+
+        exp_kernel_row(0.5, values, NO_OF_VALUES, row);
+        for (i = 0; i < NO_OF_VALUES; i++) {
+            within_ulp = within_ulp &&
+                (ulp_distance(row[i], expected[i]) <= EXP_KERNEL_MAX_ULP);
+            identical = identical &&
+                (memcmp(&row[i], &portable[i], sizeof(double)) == 0);
+        }
+
+        exp_kernel_row(0.5, special, 5, row);
+        special_ok = special_ok && (row[0] == 1) && (row[1] == 0) &&
+                     (row[2] == 0) && isnan(row[3]) && (row[4] == 1);
+    }
+    exp_kernel_select(selected);
+
+    printf("Within EXP_KERNEL_MAX_ULP of libm -- ");
+    ASSERT_TEST(within_ulp)
+
+    printf("Every kernel gives the same bits --- ");
+    ASSERT_TEST(identical)
+
+    printf("Zero, underflow and NaN ------------ ");
+    ASSERT_TEST(special_ok)
+}
+
+void automated_separable_support_degree(void) {
+    Fusion_Workspace_t workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 60 };
+    double values[NO_OF_VALUES];
+    double sensor_array[NO_OF_VALUES];
+    double sd_matrix[NO_OF_VALUES * NO_OF_VALUES];
+    int64_t max_ulp = 0;
+    Boolean within_ulp = TRUE;
+    Boolean symmetric = TRUE;
+    int i;
+    int j;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SEPARABLE SUPPORT DEGREE TESTING\n");
+    printf("-------------------\n");
+
+    /*
+     * Close readings with repeats, then clusters from a few to over a
+     * thousand apart so that several blocks, and blocks too far apart to
+     * interact, are exercised. The values are floats, like sensor readings.
+     */
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        if (i < 20) {
+            values[i] = (float)(1.2 + (i % 7) * 0.05);
+        } else {
+            values[i] = (float)((i % 8) * 180.0 + (i % 5) * 0.37 - 100.0);
+        }
+    }
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        node = create(0, "sep", values[i], node);
+    }
+
+    fusion_workspace_init(&workspace);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(calculate_support_degree_matrix_separable_into(NULL, node,
+                NO_OF_VALUES, sensor_array, sd_matrix, NO_OF_VALUES) < 0)
+
+    calculate_support_degree_matrix_separable_into(&workspace, node,
+        NO_OF_VALUES, sensor_array, sd_matrix, NO_OF_VALUES);
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double expected = exp(-1 * fabs(values[i] - values[j]));
+            double calculated = sd_matrix[i * NO_OF_VALUES + j];
+            int64_t ulp = ulp_distance(calculated, expected);
+
+            if (expected >= DBL_MIN) {
+                max_ulp = (ulp > max_ulp) ? ulp : max_ulp;
+                within_ulp = within_ulp &&
+                    (ulp <= SUPPORT_DEGREE_SEPARABLE_MAX_ULP);
+            } else {
+                within_ulp = within_ulp && (calculated < DBL_MIN);
+            }
+            symmetric = symmetric &&
+                (calculated == sd_matrix[j * NO_OF_VALUES + i]);
+        }
+    }
+    printf("Largest error: %ld ULP\n", (long)max_ulp);
+
+    printf("Within a few ULP of exp() ---------- ");
+    ASSERT_TEST(within_ulp)
+
+    printf("Symmetric, in sensor order --------- ");
+    ASSERT_TEST(symmetric && (sensor_array[0] == values[0]) &&
+                (sensor_array[NO_OF_VALUES - 1] == values[NO_OF_VALUES - 1]))
+
+    fusion_workspace_free(&workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+/*
+ * Builds one epoch of automated_support_degree_cache() with the cache and
+ * from scratch, and returns whether the cached matrix, read through its row
+ * map, is identical.
+ */
+static Boolean cached_epoch_matches(Support_Degree_Cache_t *cache,
+                                    float *values, int *ids,
+                                    int no_of_sensors) {
+    enum { MAX_VALUES = 40 };
+    double sensor_array[MAX_VALUES];
+    int sensor_id[MAX_VALUES];
+    int row[MAX_VALUES];
+    double fallback[MAX_VALUES * MAX_VALUES];
+    double expected[MAX_VALUES * MAX_VALUES];
+    double *cached = NULL;
+    int cached_ld = 0;
+    Boolean matches = TRUE;
+    Node_t *node = NULL;
+    int i;
+    int j;
+
+    for (i = no_of_sensors - 1; i >= 0; i--) {
+        node = create(0, "cache", values[i], node);
+    }
+    memcpy(sensor_id, ids, sizeof(int) * no_of_sensors);
+    calculate_support_degree_matrix_cached_into(cache, node, no_of_sensors,
+        sensor_id, sensor_array, row, fallback, no_of_sensors, &cached,
+        &cached_ld);
+    for (i = 0; i < no_of_sensors && matches; i++) {
+        matches = (sensor_array[row[i]] == (double)values[i]) &&
+                  (sensor_id[row[i]] == ids[i]);
+    }
+    calculate_support_degree_matrix_into(node, no_of_sensors, sensor_array,
+        expected, no_of_sensors);
+    for (i = 0; i < no_of_sensors && matches; i++) {
+        for (j = 0; j < no_of_sensors && matches; j++) {
+            matches = (cached[(size_t)row[i] * cached_ld + row[j]] ==
+                       expected[i * no_of_sensors + j]);
+        }
+    }
+    while (node) {
+        node = remove_from_front(node);
+    }
+    return matches;
+}
+
+/*
+ * Fuses one epoch with an incremental and an exact engine, the sensors
+ * named by their index and listed in the order given, and returns the
+ * relative difference of the two results.
+ */
+static double incremental_epoch_error(Fusion_Engine_t *incremental,
+                                      Fusion_Engine_t *exact, float *values,
+                                      int *order, int no_of_sensors) {
+    Fusion_Engine_t *engines[] = {incremental, exact};
+    double fused_value[2];
+    char name[MAX_FILE_NAME_SIZE];
+
+    for (int e = 0; e < 2; e++) {
+        for (int i = no_of_sensors - 1; i >= 0; i--) {
+            snprintf(name, sizeof(name), "cache%d", order[i]);
+            registry_register_sensor(&engines[e]->registry, name, NULL);
+            engines[e]->sensor_lists[VALID_SENSOR_LIST] =
+                create(0, name, values[order[i]],
+                       engines[e]->sensor_lists[VALID_SENSOR_LIST]);
+        }
+        fused_value[e] = do_sensor_fusion_algorithm(engines[e]);
+        while (engines[e]->sensor_lists[VALID_SENSOR_LIST]) {
+            engines[e]->sensor_lists[VALID_SENSOR_LIST] = remove_from_front(
+                engines[e]->sensor_lists[VALID_SENSOR_LIST]);
+        }
+    }
+    return fabs(fused_value[0] - fused_value[1]) / fabs(fused_value[1]);
+}
+
+void automated_support_degree_cache(void) {
+    Support_Degree_Cache_t cache;
+    enum { NO_OF_VALUES = 40 };
+    float values[NO_OF_VALUES];
+    int ids[NO_OF_VALUES];
+    double sensor_array[NO_OF_VALUES];
+    double sd_matrix[NO_OF_VALUES * NO_OF_VALUES];
+    int rows_of_sensors[NO_OF_VALUES];
+    double *solve_matrix = NULL;
+    int solve_ld = 0;
+    Boolean matches;
+    long rows;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("SUPPORT DEGREE CACHE TESTING\n");
+    printf("-------------------\n");
+
+    support_degree_cache_init(&cache);
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(calculate_support_degree_matrix_cached_into(&cache, NULL,
+                NO_OF_VALUES, ids, sensor_array, rows_of_sensors, sd_matrix,
+                NO_OF_VALUES, &solve_matrix, &solve_ld) < 0)
+
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        values[i] = 10.0f + (float)((i * 7) % 11) * 0.3f;
+        ids[i] = i;
+    }
+    matches = cached_epoch_matches(&cache, values, ids, NO_OF_VALUES);
+
+    printf("First epoch built in full ---------- ");
+    ASSERT_TEST(matches && (cache.no_of_rebuilds == 1) &&
+                (cache.no_of_rows_computed == NO_OF_VALUES))
+
+    /*
+     * Three sensors change value, sensors 5 and 6 leave, sensor 50 joins and
+     * the list comes in reverse order.
+     */
+    values[1] += 0.5f;
+    values[20] -= 1.25f;
+    values[33] += 2.0f;
+    for (i = 7; i < NO_OF_VALUES; i++) {
+        values[i - 2] = values[i];
+        ids[i - 2] = ids[i];
+    }
+    values[NO_OF_VALUES - 2] = 11.1f;
+    ids[NO_OF_VALUES - 2] = 50;
+    for (i = 0; i < (NO_OF_VALUES - 1) / 2; i++) {
+        float value = values[i];
+        int id = ids[i];
+        values[i] = values[NO_OF_VALUES - 2 - i];
+        ids[i] = ids[NO_OF_VALUES - 2 - i];
+        values[NO_OF_VALUES - 2 - i] = value;
+        ids[NO_OF_VALUES - 2 - i] = id;
+    }
+    rows = cache.no_of_rows_computed;
+    matches = cached_epoch_matches(&cache, values, ids, NO_OF_VALUES - 1);
+
+    printf("Only changed rows recomputed ------- ");
+    ASSERT_TEST(matches && (cache.no_of_rebuilds == 1) &&
+                (cache.no_of_rows_computed - rows == 4) &&
+                (cache.no_of_slots == NO_OF_VALUES - 1))
+
+    for (i = 0; i < NO_OF_VALUES - 1; i++) {
+        values[i] += (i % 4) ? 0.1f : 0.0f;
+    }
+    matches = cached_epoch_matches(&cache, values, ids, NO_OF_VALUES - 1);
+
+    printf("Mostly changed epoch rebuilt ------- ");
+    ASSERT_TEST(matches && (cache.no_of_rebuilds == 2))
+
+    ids[1] = ids[0];
+    matches = cached_epoch_matches(&cache, values, ids, NO_OF_VALUES - 1);
+
+    printf("Repeated sensor ID not cached ------ ");
+    ASSERT_TEST(matches && (cache.no_of_slots == 0))
+
+    support_degree_cache_free(&cache);
+
+    /*
+     * The engine solves the cached matrix in the order of its slots. Two
+     * sensors far from the others make two eigenpairs count, and the list
+     * then puts them first, so that the signs of the eigenvectors depend on
+     * the order of the list.
+     */
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t incremental;
+    Fusion_Engine_t exact;
+    float fleet[] = {1.30f, 1.31f, 0.0f, 1.29f, 0.01f, 1.32f};
+    int orders[][6] = {{0, 1, 2, 3, 4, 5}, {2, 4, 0, 1, 3, 5},
+                       {5, 4, 3, 2, 1, 0}};
+    double error = 0;
+
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    engine_init(&exact, &parameters, NULL);
+    parameters.support_degree_mode = SUPPORT_DEGREE_INCREMENTAL;
+    engine_init(&incremental, &parameters, NULL);
+    for (i = 0; i < 3; i++) {
+        double epoch_error = incremental_epoch_error(&incremental, &exact,
+            fleet, orders[i], 6);
+        error = (epoch_error > error) ? epoch_error : error;
+        fleet[3] += 0.005f;
+    }
+
+    printf("Engine agrees with exact ----------- ");
+    ASSERT_TEST((error < 1e-9) && (incremental.sd_cache.no_of_slots > 0))
+    engine_free(&incremental);
+    engine_free(&exact);
+}
+
+void automated_partial_eigensystem(void) {
+    Fusion_Workspace_t full_workspace;
+    Fusion_Workspace_t partial_workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 200 };
+    float parameter = 0.85f;
+    double max_value_error = 0;
+    double max_vector_error = 0;
+    int i;
+    int j;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("PARTIAL EIGENSYSTEM TESTING\n");
+    printf("-------------------\n");
+
+    /*
+     * Sensors agreeing around 20, with a few stragglers further out.
+     */
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 50 == 7) {
+            value += 1.5f + (float)(i % 3);
+        }
+        node = create(0, "lanczos", value, node);
+    }
+
+    fusion_workspace_init(&full_workspace);
+    fusion_workspace_init(&partial_workspace);
+    fusion_workspace_prepare(&full_workspace, NO_OF_VALUES);
+    fusion_workspace_prepare(&partial_workspace, NO_OF_VALUES);
+    int ld = full_workspace.leading_dimension;
+    struct eigen_systems full = {full_workspace.eigen_value,
+                                 full_workspace.eigen_vector, ld};
+    struct eigen_systems partial = {partial_workspace.eigen_value,
+                                    partial_workspace.eigen_vector, ld};
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        full_workspace.sensor_array, full_workspace.sd_matrix, ld);
+    calculate_eigensystem_into(&full_workspace, full_workspace.sd_matrix, ld,
+        NO_OF_VALUES, &full);
+    calculate_contribution_rate_into(full.eigen_value, NO_OF_VALUES,
+        full_workspace.contribution_rate);
+    int full_rates = determine_contribution_rates_to_use(
+        full_workspace.contribution_rate, parameter, NO_OF_VALUES);
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(calculate_eigensystem_partial_into(&partial_workspace,
+                full_workspace.sd_matrix, ld, NO_OF_VALUES, 0, &partial) < 0)
+
+    int no_of_eigenpairs = calculate_eigensystem_partial_into(
+        &partial_workspace, full_workspace.sd_matrix, ld, NO_OF_VALUES,
+        parameter, &partial);
+    calculate_contribution_rate_trace_into(partial.eigen_value,
+        no_of_eigenpairs, NO_OF_VALUES, partial_workspace.contribution_rate);
+    int partial_rates = determine_contribution_rates_to_use(
+        partial_workspace.contribution_rate, parameter, no_of_eigenpairs);
+    printf("Eigenpairs: %d, Lanczos steps: %d\n", no_of_eigenpairs,
+           partial_workspace.lanczos_steps);
+
+    printf("Stops early ------------------------ ");
+    ASSERT_TEST((no_of_eigenpairs == full_rates) &&
+                (partial_rates == full_rates) &&
+                (partial_workspace.lanczos_steps > 0) &&
+                (partial_workspace.lanczos_steps < NO_OF_VALUES / 2))
+
+    for (i = 0; i < no_of_eigenpairs && i < full_rates; i++) {
+        double value_error = fabs(partial.eigen_value[i] -
+            full.eigen_value[i]);
+        max_value_error = (value_error > max_value_error) ?
+            value_error : max_value_error;
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double vector_error = fabs(partial.eigen_vector[i * ld + j] -
+                full.eigen_vector[i * ld + j]);
+            max_vector_error = (vector_error > max_vector_error) ?
+                vector_error : max_vector_error;
+        }
+    }
+    printf("Largest errors: %g (values), %g (vectors)\n", max_value_error,
+           max_vector_error);
+
+    printf("Matches the full eigensystem ------- ");
+    ASSERT_TEST((max_value_error < 1e-9) && (max_vector_error < 1e-8))
+
+    printf("Trace gives the contribution rates - ");
+    ASSERT_TEST(fabs(partial_workspace.contribution_rate[0] -
+                     full_workspace.contribution_rate[0]) < 1e-12)
+
+    printf("Small fleets solve in full --------- ");
+    ASSERT_TEST((calculate_eigensystem_partial_into(&partial_workspace,
+                 full_workspace.sd_matrix, ld, 4, parameter, &partial) == 4) &&
+                (partial_workspace.lanczos_steps == 0))
+
+    fusion_workspace_free(&full_workspace);
+    fusion_workspace_free(&partial_workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_eigen_backends(void) {
+    Fusion_Workspace_t reference_workspace;
+    Fusion_Workspace_t workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 120, NO_OF_LEADING = 5 };
+    Boolean full_ok = TRUE;
+    Boolean leading_ok = TRUE;
+    int backend;
+    int i;
+    int j;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("EIGEN BACKEND TESTING\n");
+    printf("-------------------\n");
+
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 40 == 7) {
+            value += 1.5f + (float)(i % 3);
+        }
+        node = create(0, "backend", value, node);
+    }
+
+    fusion_workspace_init(&reference_workspace);
+    fusion_workspace_init(&workspace);
+    fusion_workspace_prepare(&reference_workspace, NO_OF_VALUES);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    int ld = reference_workspace.leading_dimension;
+    struct eigen_systems reference = {reference_workspace.eigen_value,
+                                      reference_workspace.eigen_vector, ld};
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector, ld};
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        reference_workspace.sensor_array, reference_workspace.sd_matrix, ld);
+    calculate_eigensystem_into(&reference_workspace,
+        reference_workspace.sd_matrix, ld, NO_OF_VALUES, &reference);
+
+    printf("Incorrect input rejected ----------- ");
+    workspace.eigen_backend = EIGEN_BACKEND_COUNT;
+    ASSERT_TEST((calculate_eigensystem_into(&workspace,
+                 reference_workspace.sd_matrix, ld, NO_OF_VALUES,
+                 &eigen) < 0) &&
+                (calculate_eigensystem_leading_into(&reference_workspace,
+                 reference_workspace.sd_matrix, ld, NO_OF_VALUES,
+                 NO_OF_VALUES + 1, &eigen) < 0))
+
+    for (backend = 0; backend < EIGEN_BACKEND_COUNT; backend++) {
+        double max_value_error = 0;
+        double max_vector_error = 0;
+
+        if (!eigen_backend_supported((Eigen_Backend_t)backend)) {
+            printf("%s not supported by this build\n",
+                   eigen_backend_name((Eigen_Backend_t)backend));
+            continue;
+        }
+        workspace.eigen_backend = (Eigen_Backend_t)backend;
+
+        clock_t start = clock();
+        calculate_eigensystem_into(&workspace, reference_workspace.sd_matrix,
+            ld, NO_OF_VALUES, &eigen);
+        clock_t full_time = clock() - start;
+        for (i = 0; i < NO_OF_VALUES; i++) {
+            double value_error = fabs(eigen.eigen_value[i] -
+                reference.eigen_value[i]);
+            max_value_error = (value_error > max_value_error) ?
+                value_error : max_value_error;
+        }
+
+        /*
+        * Eigenvectors of nearly equal eigenvalues may mix, so only those of
+        * the well separated leading eigenvalues are compared.
+        */
+        for (i = 0; i < NO_OF_LEADING; i++) {
+            for (j = 0; j < NO_OF_VALUES; j++) {
+                double vector_error = fabs(eigen.eigen_vector[i * ld + j] -
+                    reference.eigen_vector[i * ld + j]);
+                max_vector_error = (vector_error > max_vector_error) ?
+                    vector_error : max_vector_error;
+            }
+        }
+        full_ok = full_ok && (max_value_error < 1e-10) &&
+                  (max_vector_error < 1e-8);
+
+        memset(eigen.eigen_value, 0, NO_OF_VALUES * sizeof(double));
+        start = clock();
+        calculate_eigensystem_leading_into(&workspace,
+            reference_workspace.sd_matrix, ld, NO_OF_VALUES, NO_OF_LEADING,
+            &eigen);
+        clock_t leading_time = clock() - start;
+        for (i = 0; i < NO_OF_LEADING; i++) {
+            leading_ok = leading_ok &&
+                (fabs(eigen.eigen_value[i] - reference.eigen_value[i]) <
+                 1e-10);
+            for (j = 0; j < NO_OF_VALUES; j++) {
+                leading_ok = leading_ok &&
+                    (fabs(eigen.eigen_vector[i * ld + j] -
+                          reference.eigen_vector[i * ld + j]) < 1e-8);
+            }
+        }
+
+        printf("%s: %g (values), %g (vectors); %.3f ms in full, %.3f ms "
+               "for %d eigenpairs\n",
+               eigen_backend_name((Eigen_Backend_t)backend), max_value_error,
+               max_vector_error, 1000.0 * full_time / CLOCKS_PER_SEC,
+               1000.0 * leading_time / CLOCKS_PER_SEC, NO_OF_LEADING);
+    }
+
+    printf("Backends agree --------------------- ");
+    ASSERT_TEST(full_ok)
+
+    printf("Leading eigenpairs agree ----------- ");
+    ASSERT_TEST(leading_ok)
+
+    printf("Single sensor ---------------------- ");
+    workspace.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    double one = 1;
+    ASSERT_TEST((calculate_eigensystem_into(&workspace, &one, 1, 1,
+                 &eigen) == 0) &&
+                (eigen.eigen_value[0] == 1) &&
+                (eigen.eigen_vector[0] == 1))
+
+    fusion_workspace_free(&reference_workspace);
+    fusion_workspace_free(&workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_jacobi_eigensystem(void) {
+    Fusion_Workspace_t reference_workspace;
+    Fusion_Workspace_t workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = JACOBI_MAX_SENSORS + 1 };
+    int sizes[] = {1, 2, 5, 16, JACOBI_MAX_SENSORS};
+    Boolean agree = TRUE;
+    Boolean auto_ok = TRUE;
+    int s;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("JACOBI EIGENSYSTEM TESTING\n");
+    printf("-------------------\n");
+
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 5.0f + (float)((i * 11) % 13) * 0.07f;
+        if (i % 9 == 2) {
+            value += 2.5f;
+        }
+        node = create(0, "jacobi", value, node);
+    }
+
+    fusion_workspace_init(&reference_workspace);
+    fusion_workspace_init(&workspace);
+    fusion_workspace_prepare(&reference_workspace, NO_OF_VALUES);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    int ld = reference_workspace.leading_dimension;
+    struct eigen_systems reference = {reference_workspace.eigen_value,
+                                      reference_workspace.eigen_vector, ld};
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector, ld};
+    double *sd_matrix = reference_workspace.sd_matrix;
+    reference_workspace.eigen_backend = EIGEN_BACKEND_BUILTIN;
+
+    /*
+     * Only the leading eigenvector is compared, since the rest of a matrix
+     * of repeated values may mix.
+     */
+    for (s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        int n = sizes[s];
+        calculate_support_degree_matrix_into(node, n,
+            reference_workspace.sensor_array, sd_matrix, ld);
+        calculate_eigensystem_into(&reference_workspace, sd_matrix, ld, n,
+            &reference);
+        workspace.eigen_backend = EIGEN_BACKEND_JACOBI;
+        agree = agree && (calculate_eigensystem_into(&workspace, sd_matrix,
+                          ld, n, &eigen) == 0);
+        for (i = 0; i < n; i++) {
+            agree = agree && (fabs(eigen.eigen_value[i] -
+                              reference.eigen_value[i]) < 1e-12 * n) &&
+                    (fabs(eigen.eigen_vector[i] -
+                          reference.eigen_vector[i]) < 1e-8);
+        }
+
+        double jacobi_value = eigen.eigen_value[n - 1];
+        workspace.eigen_backend = EIGEN_BACKEND_AUTO;
+        calculate_eigensystem_into(&workspace, sd_matrix, ld, n, &eigen);
+        auto_ok = auto_ok && (eigen.eigen_value[n - 1] == jacobi_value);
+    }
+
+    printf("Agrees with the built-in backend --- ");
+    ASSERT_TEST(agree)
+
+    /*
+     * Above JACOBI_MAX_SENSORS, auto is the GSL backend (or the built-in
+     * one without GSL).
+     */
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        reference_workspace.sensor_array, sd_matrix, ld);
+    reference_workspace.eigen_backend =
+        eigen_backend_supported(EIGEN_BACKEND_GSL) ? EIGEN_BACKEND_GSL :
+        EIGEN_BACKEND_BUILTIN;
+    calculate_eigensystem_into(&reference_workspace, sd_matrix, ld,
+        NO_OF_VALUES, &reference);
+    workspace.eigen_backend = EIGEN_BACKEND_AUTO;
+    calculate_eigensystem_into(&workspace, sd_matrix, ld, NO_OF_VALUES,
+        &eigen);
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        auto_ok = auto_ok && (eigen.eigen_value[i] ==
+                              reference.eigen_value[i]);
+    }
+
+    printf("Auto backend picks by size --------- ");
+    ASSERT_TEST(auto_ok)
+
+    /*
+     * The small eigenvalue of [[1, b], [b, c]] is c - b^2 / (1 - c) to
+     * within b^4, and Jacobi finds it to full relative accuracy even though
+     * it is 1e-15 of the large one.
+     */
+    double b = 1e-10;
+    double c = 1e-15;
+    double graded[2 * 2] = {1, b, b, c};
+    double expected = c - b * b / (1 - c);
+    struct eigen_systems small = {workspace.eigen_value,
+                                  workspace.eigen_vector, 2};
+    workspace.eigen_backend = EIGEN_BACKEND_JACOBI;
+    calculate_eigensystem_into(&workspace, graded, 2, 2, &small);
+    printf("Smallest eigenvalue: %.17g (expected %.17g)\n",
+           small.eigen_value[1], expected);
+
+    printf("High relative accuracy ------------- ");
+    ASSERT_TEST(fabs(small.eigen_value[1] - expected) < 1e-13 * expected)
+
+    fusion_workspace_free(&reference_workspace);
+    fusion_workspace_free(&workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_matrix_free_support_degree(void) {
+    Fusion_Workspace_t dense_workspace;
+    Fusion_Workspace_t workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 300, NO_OF_LARGE = 100000 };
+    float parameter = 0.995f;
+    double vector[NO_OF_VALUES];
+    double product[NO_OF_VALUES];
+    double max_product_error = 0;
+    double max_value_error = 0;
+    double max_vector_error = 0;
+    int i;
+    int j;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("MATRIX FREE SUPPORT DEGREE TESTING\n");
+    printf("-------------------\n");
+
+    /*
+     * Agreeing sensors in no particular order, with repeated values, one far
+     * enough out that its support underflows to 0 and one barely supported.
+     */
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 60 == 7) {
+            value += 1.5f + (float)(i % 3);
+        }
+        if (i == 100 || i == 200) {
+            value = (i == 100) ? -900.0f : 30.0f;
+        }
+        node = create(0, "matrixfree", value, node);
+        vector[NO_OF_VALUES - 1 - i] = sin(i);
+    }
+
+    fusion_workspace_init(&dense_workspace);
+    fusion_workspace_init(&workspace);
+    fusion_workspace_prepare(&dense_workspace, NO_OF_VALUES);
+    fusion_workspace_prepare_matrix_free(&workspace, NO_OF_VALUES);
+    int ld = dense_workspace.leading_dimension;
+    struct eigen_systems dense = {dense_workspace.eigen_value,
+                                  dense_workspace.eigen_vector, ld};
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector,
+                                  workspace.leading_dimension};
+
+    printf("Holds no support degree matrix ----- ");
+    ASSERT_TEST((workspace.matrix_free == TRUE) &&
+                (workspace.sd_matrix == NULL))
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        dense_workspace.sensor_array, dense_workspace.sd_matrix, ld);
+    calculate_support_degree_operator_into(&workspace, node, NO_OF_VALUES,
+        workspace.sensor_array);
+    support_degree_operator_multiply(&workspace, NO_OF_VALUES, vector,
+        product);
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        double sum = 0;
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            sum += dense_workspace.sd_matrix[i * ld + j] * vector[j];
+        }
+        max_product_error = (fabs(sum - product[i]) > max_product_error) ?
+            fabs(sum - product[i]) : max_product_error;
+    }
+    printf("Largest product error: %g\n", max_product_error);
+
+    printf("Product matches the matrix --------- ");
+    ASSERT_TEST(max_product_error < 1e-11)
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST((support_degree_operator_multiply(&workspace, NO_OF_VALUES,
+                 vector, vector) < 0) &&
+                (calculate_eigensystem_into(&workspace,
+                 dense_workspace.sd_matrix, ld, NO_OF_VALUES, &eigen) < 0) &&
+                (calculate_eigensystem_matrix_free_into(&dense_workspace,
+                 NO_OF_VALUES, parameter, &dense) < 0))
+
+    calculate_eigensystem_into(&dense_workspace, dense_workspace.sd_matrix,
+        ld, NO_OF_VALUES, &dense);
+    calculate_contribution_rate_into(dense.eigen_value, NO_OF_VALUES,
+        dense_workspace.contribution_rate);
+    int dense_rates = determine_contribution_rates_to_use(
+        dense_workspace.contribution_rate, parameter, NO_OF_VALUES);
+    int no_of_eigenpairs = calculate_eigensystem_matrix_free_into(&workspace,
+        NO_OF_VALUES, parameter, &eigen);
+    for (i = 0; i < no_of_eigenpairs && i < dense_rates; i++) {
+        double value_error = fabs(eigen.eigen_value[i] -
+            dense.eigen_value[i]);
+        max_value_error = (value_error > max_value_error) ?
+            value_error : max_value_error;
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double vector_error = fabs(eigen.eigen_vector[i * ld + j] -
+                dense.eigen_vector[i * ld + j]);
+            max_vector_error = (vector_error > max_vector_error) ?
+                vector_error : max_vector_error;
+        }
+    }
+    printf("Eigenpairs: %d, Lanczos steps: %d, largest errors: %g (values), "
+           "%g (vectors)\n", no_of_eigenpairs, workspace.lanczos_steps,
+           max_value_error, max_vector_error);
+
+    printf("Matches the full eigensystem ------- ");
+    ASSERT_TEST((no_of_eigenpairs == dense_rates) &&
+                (max_value_error < 1e-9) && (max_vector_error < 1e-8))
+
+    fusion_workspace_free(&dense_workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+
+    /*
+     * A fleet whose support degree matrix alone would take 80 GB.
+     */
+    for (i = NO_OF_LARGE - 1; i >= 0; i--) {
+        node = create(0, "matrixfree", 20.0f + (float)(i % 1000) * 0.0005f,
+                      node);
+    }
+    fusion_workspace_prepare_matrix_free(&workspace, NO_OF_LARGE);
+    eigen.eigen_value = workspace.eigen_value;
+    eigen.eigen_vector = workspace.eigen_vector;
+    eigen.leading_dimension = workspace.leading_dimension;
+    calculate_support_degree_operator_into(&workspace, node, NO_OF_LARGE,
+        workspace.sensor_array);
+    no_of_eigenpairs = calculate_eigensystem_matrix_free_into(&workspace,
+        NO_OF_LARGE, parameter, &eigen);
+    calculate_contribution_rate_trace_into(eigen.eigen_value,
+        no_of_eigenpairs, NO_OF_LARGE, workspace.contribution_rate);
+    int rates = determine_contribution_rates_to_use(
+        workspace.contribution_rate, parameter, no_of_eigenpairs);
+    calculate_integrated_support_from_eigenpairs_into(eigen.eigen_value,
+        eigen.eigen_vector, eigen.leading_dimension,
+        workspace.contribution_rate, rates, NO_OF_LARGE,
+        workspace.integrated_support);
+    eliminate_incorrect_data(workspace.integrated_support, 0.7f,
+        NO_OF_LARGE);
+    calculate_weight_coefficient_into(workspace.integrated_support,
+        NO_OF_LARGE, workspace.weight_coefficient);
+    double fused_value = 0;
+    calculate_fused_output(workspace.weight_coefficient,
+        workspace.sensor_array, NO_OF_LARGE, &fused_value);
+    printf("%d sensors: %d eigenpairs, %d Lanczos steps, fused value %f\n",
+           NO_OF_LARGE, no_of_eigenpairs, workspace.lanczos_steps,
+           fused_value);
+
+    printf("Fuses a very large fleet ---------- ");
+    ASSERT_TEST((no_of_eigenpairs > 0) &&
+                (fabs(fused_value - 20.25) < 0.01))
+
+    fusion_workspace_free(&workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_randomized_eigensystem(void) {
+    Fusion_Workspace_t full_workspace;
+    Fusion_Workspace_t workspace;
+    Fusion_Workspace_t matrix_free_workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 200 };
+    float parameter = 0.95f;
+    double max_value_error = 0;
+    double max_vector_error = 0;
+    int i;
+    int j;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("RANDOMIZED EIGENSYSTEM TESTING\n");
+    printf("-------------------\n");
+
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 50 == 7) {
+            value += 1.5f + (float)(i % 3);
+        }
+        node = create(0, "randomized", value, node);
+    }
+
+    fusion_workspace_init(&full_workspace);
+    fusion_workspace_init(&workspace);
+    fusion_workspace_init(&matrix_free_workspace);
+    fusion_workspace_prepare(&full_workspace, NO_OF_VALUES);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    fusion_workspace_prepare_matrix_free(&matrix_free_workspace,
+                                         NO_OF_VALUES);
+    int ld = full_workspace.leading_dimension;
+    struct eigen_systems full = {full_workspace.eigen_value,
+                                 full_workspace.eigen_vector, ld};
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector, ld};
+    struct eigen_systems matrix_free = {matrix_free_workspace.eigen_value,
+                                        matrix_free_workspace.eigen_vector,
+                                        ld};
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        full_workspace.sensor_array, full_workspace.sd_matrix, ld);
+    calculate_eigensystem_into(&full_workspace, full_workspace.sd_matrix, ld,
+        NO_OF_VALUES, &full);
+    calculate_contribution_rate_into(full.eigen_value, NO_OF_VALUES,
+        full_workspace.contribution_rate);
+    int full_rates = determine_contribution_rates_to_use(
+        full_workspace.contribution_rate, parameter, NO_OF_VALUES);
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST((calculate_eigensystem_randomized_into(&workspace,
+                 full_workspace.sd_matrix, ld, NO_OF_VALUES, parameter, 0,
+                 &eigen) < 0) &&
+                (calculate_eigensystem_randomized_into(&workspace, NULL, ld,
+                 NO_OF_VALUES, parameter, RANDOMIZED_DEFAULT_ACCURACY,
+                 &eigen) < 0))
+
+    int no_of_eigenpairs = calculate_eigensystem_randomized_into(&workspace,
+        full_workspace.sd_matrix, ld, NO_OF_VALUES, parameter,
+        RANDOMIZED_DEFAULT_ACCURACY, &eigen);
+    for (i = 0; i < no_of_eigenpairs && i < full_rates; i++) {
+        double value_error = fabs(eigen.eigen_value[i] -
+            full.eigen_value[i]);
+        max_value_error = (value_error > max_value_error) ?
+            value_error : max_value_error;
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double vector_error = fabs(eigen.eigen_vector[i * ld + j] -
+                full.eigen_vector[i * ld + j]);
+            max_vector_error = (vector_error > max_vector_error) ?
+                vector_error : max_vector_error;
+        }
+    }
+    printf("Eigenpairs: %d of %d, sketch: %d, error estimate: %g, largest "
+           "errors: %g (values), %g (vectors)\n", no_of_eigenpairs,
+           full_rates, workspace.sketch_size, workspace.approximation_error,
+           max_value_error, max_vector_error);
+
+    printf("Meets the accuracy target ---------- ");
+    ASSERT_TEST((no_of_eigenpairs == full_rates) &&
+                (workspace.approximation_error <=
+                 RANDOMIZED_DEFAULT_ACCURACY) &&
+                (max_value_error <= workspace.approximation_error *
+                 NO_OF_VALUES) &&
+                (max_vector_error < 1e-4))
+
+    /*
+     * A target no sketch can meet still gives an answer, once the sketch
+     * has grown as far as it may (27 vectors here, the number of distinct
+     * values, past which the rest add no direction).
+     */
+    no_of_eigenpairs = calculate_eigensystem_randomized_into(&workspace,
+        full_workspace.sd_matrix, ld, NO_OF_VALUES, parameter, 1e-300,
+        &eigen);
+    printf("Unreachable target: %d eigenpairs, sketch: %d, error estimate: "
+           "%g\n", no_of_eigenpairs, workspace.sketch_size,
+           workspace.approximation_error);
+
+    printf("Cost is bounded -------------------- ");
+    ASSERT_TEST((no_of_eigenpairs == full_rates) &&
+                (workspace.sketch_size > 16) &&
+                (workspace.sketch_size <= 32) &&
+                (fabs(eigen.eigen_value[0] - full.eigen_value[0]) <
+                 1e-9))
+
+    calculate_support_degree_operator_into(&matrix_free_workspace, node,
+        NO_OF_VALUES, matrix_free_workspace.sensor_array);
+    no_of_eigenpairs = calculate_eigensystem_randomized_into(
+        &matrix_free_workspace, NULL, ld, NO_OF_VALUES, parameter,
+        RANDOMIZED_DEFAULT_ACCURACY, &matrix_free);
+
+    printf("Works without a matrix ------------- ");
+    ASSERT_TEST((no_of_eigenpairs == full_rates) &&
+                (matrix_free_workspace.approximation_error <=
+                 RANDOMIZED_DEFAULT_ACCURACY) &&
+                (fabs(matrix_free.eigen_value[0] - full.eigen_value[0]) <
+                 1e-9))
+
+    printf("Small fleets solve in full --------- ");
+    ASSERT_TEST((calculate_eigensystem_randomized_into(&workspace,
+                 full_workspace.sd_matrix, ld, 4, parameter,
+                 RANDOMIZED_DEFAULT_ACCURACY, &eigen) == 4) &&
+                (workspace.sketch_size == 0) &&
+                (workspace.approximation_error == 0))
+
+    fusion_workspace_free(&full_workspace);
+    fusion_workspace_free(&workspace);
+    fusion_workspace_free(&matrix_free_workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_float_fusion(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engines[FUSION_PRECISION_COUNT];
+    Fusion_Workspace_t workspace;
+    Fusion_Workspace_Float_t float_workspace;
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 60 };
+    double fused_value[FUSION_PRECISION_COUNT];
+    double max_value_error = 0;
+    float float_value;
+    int backend;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("FLOAT FUSION TESTING\n");
+    printf("-------------------\n");
+
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 20 == 3) {
+            value += 2.0f + (float)(i % 3);
+        }
+        node = create(600, "float", value, node);
+    }
+
+    fusion_workspace_init(&workspace);
+    fusion_workspace_float_init(&float_workspace);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    int ld = workspace.leading_dimension;
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector, ld};
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        workspace.sensor_array, workspace.sd_matrix, ld);
+    calculate_eigensystem_into(&workspace, workspace.sd_matrix, ld,
+        NO_OF_VALUES, &eigen);
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST((fusion_workspace_float_prepare(&float_workspace, 0) ==
+                 FALSE) &&
+                (do_sensor_fusion_float(&float_workspace, node, NO_OF_VALUES,
+                 0.7f, 0, EIGEN_BACKEND_BUILTIN, &float_value) < 0) &&
+                (calculate_eigensystem_float_into(&float_workspace,
+                 NO_OF_VALUES, EIGEN_BACKEND_BUILTIN) < 0))
+
+    /*
+     * Each backend that has a float solver gives the double eigenvalues to
+     * float accuracy, with the leading eigenvector the same way round.
+     */
+    for (backend = 0; backend < EIGEN_BACKEND_COUNT; backend++) {
+        if (!eigen_backend_supported(backend)) {
+            continue;
+        }
+        fusion_workspace_float_prepare(&float_workspace, NO_OF_VALUES);
+        int float_ld = float_workspace.leading_dimension;
+        calculate_support_degree_matrix_float_into(node, NO_OF_VALUES,
+            float_workspace.sensor_array, float_workspace.sd_matrix,
+            float_ld);
+        calculate_eigensystem_float_into(&float_workspace, NO_OF_VALUES,
+                                         backend);
+        float *leading = float_workspace.transform +
+            (size_t)float_workspace.order[0] * float_ld;
+        for (i = 0; i < NO_OF_VALUES; i++) {
+            double value_error = fabs(float_workspace.eigen_value[i] -
+                eigen.eigen_value[i]);
+            double vector_error = fabs(leading[i] - eigen.eigen_vector[i]);
+            max_value_error = (value_error > max_value_error) ?
+                value_error : max_value_error;
+            max_value_error = (vector_error > max_value_error) ?
+                vector_error : max_value_error;
+        }
+    }
+    printf("Largest float eigenpair error: %g\n", max_value_error);
+
+    printf("Eigenpairs agree with double ------- ");
+    ASSERT_TEST(max_value_error < 1e-4 * NO_OF_VALUES)
+
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    parameters.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    for (i = 0; i < FUSION_PRECISION_COUNT; i++) {
+        parameters.precision = i;
+        engine_init(&engines[i], &parameters, NULL);
+        engines[i].sensor_lists[VALID_SENSOR_LIST] = node;
+        fused_value[i] = do_sensor_fusion_algorithm(&engines[i]);
+        engines[i].sensor_lists[VALID_SENSOR_LIST] = NULL;
+    }
+    Float_Divergence_t *divergence =
+        &engines[FUSION_PRECISION_VALIDATE].float_divergence;
+    printf("Fused: %.9g (double), %.9g (float)\n",
+           fused_value[FUSION_PRECISION_DOUBLE],
+           fused_value[FUSION_PRECISION_FLOAT]);
+
+    printf("Fused output agrees with double ---- ");
+    ASSERT_TEST(fabs(fused_value[FUSION_PRECISION_FLOAT] -
+                     fused_value[FUSION_PRECISION_DOUBLE]) <
+                1e-5 * fabs(fused_value[FUSION_PRECISION_DOUBLE]))
+
+    printf("Validation reports double ---------- ");
+    ASSERT_TEST(fused_value[FUSION_PRECISION_VALIDATE] ==
+                fused_value[FUSION_PRECISION_DOUBLE])
+
+    printf("Validation records the divergence -- ");
+    ASSERT_TEST((divergence->no_of_epochs == 1) &&
+                (divergence->no_of_mismatches == 0) &&
+                (divergence->largest ==
+                 fabs(fused_value[FUSION_PRECISION_FLOAT] -
+                      fused_value[FUSION_PRECISION_DOUBLE])) &&
+                (divergence->total == divergence->largest))
+
+    for (i = 0; i < FUSION_PRECISION_COUNT; i++) {
+        engine_free(&engines[i]);
+    }
+    fusion_workspace_free(&workspace);
+    fusion_workspace_float_free(&float_workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+}
+
+void automated_batch_fusion(void) {
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t engine;
+    enum { NO_OF_EPOCHS = 2 * FUSION_BATCH_LANES + 3, MAX_SENSORS = 12,
+           NO_OF_RUNS = 200 };
+    static const int sizes[] = {1, 5, MAX_SENSORS};
+    Node_t *epochs[NO_OF_EPOCHS];
+    double values[NO_OF_EPOCHS * MAX_SENSORS];
+    double expected[NO_OF_EPOCHS];
+    double fused_values[NO_OF_EPOCHS];
+    double batch_seconds = 0;
+    double scalar_seconds = 0;
+    clock_t start;
+    Boolean rc = TRUE;
+    int e;
+    int i;
 
-    /**
-     * Delete node from middle of list 1 and make sure that it is gone. Also
-     * ensure that there are four nodes in the list.
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("BATCH FUSION TESTING\n");
+    printf("-------------------\n");
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST((do_sensor_fusion_batch(NULL, 1, 5, 0.7, 0.85f,
+                 fused_values) < 0) &&
+                (do_sensor_fusion_batch(values, 0, 5, 0.7, 0.85f,
+                 fused_values) < 0) &&
+                (do_sensor_fusion_batch(values, 1,
+                 FUSION_BATCH_MAX_SENSORS + 1, 0.7, 0.85f, fused_values) < 0) &&
+                (do_sensor_fusion_batch(values, 1, 5, 0.7, 0,
+                 fused_values) < 0))
+
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    parameters.eigen_backend = EIGEN_BACKEND_JACOBI;
+    engine_init(&engine, &parameters, NULL);
+
+    /*
+     * Each epoch drifts from the last, with one sensor off by a few units in
+     * some of them; it is fused alone through the engine and in the batch.
+     * The largest size is also timed both ways.
      */
-    strcpy(str, "test4");
-    printf("\nDelete from middle of list 1 - ");
-    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                              str);
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        int n = sizes[k];
+        for (e = 0; e < NO_OF_EPOCHS; e++) {
+            epochs[e] = NULL;
+            for (i = n - 1; i >= 0; i--) {
+                float value = 20.0f + 0.05f * e +
+                    (float)((i * 3 + e) % 7) * 0.1f;
+                if (e % 4 == 1 && i == e % n) {
+                    value += 4.0f;
+                }
+                epochs[e] = create(600, "batch", value, epochs[e]);
+                values[e * n + i] = value;
+            }
+            engine.sensor_lists[VALID_SENSOR_LIST] = epochs[e];
+            expected[e] = do_sensor_fusion_algorithm(&engine);
+        }
+        rc = rc && (do_sensor_fusion_batch(values, NO_OF_EPOCHS, n, 0.7,
+                    0.85f, fused_values) == 0);
+        for (e = 0; e < NO_OF_EPOCHS; e++) {
+            rc = rc && (fabs(fused_values[e] - expected[e]) <=
+                        1e-9 * fabs(expected[e]));
+        }
 
-    test_list_head_array[VALID_SENSOR_LIST] =
-        remove_node(test_list_head_array[VALID_SENSOR_LIST],
-                    node);
-    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                                   str) == NULL)
-    --num_nodes;
-    printf("Ensure %d nodes in list 1 ----- ", num_nodes);
-    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+        if (n == MAX_SENSORS) {
+            start = clock();
+            for (i = 0; i < NO_OF_RUNS; i++) {
+                do_sensor_fusion_batch(values, NO_OF_EPOCHS, n, 0.7, 0.85f,
+                    fused_values);
+            }
+            batch_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+            start = clock();
+            for (i = 0; i < NO_OF_RUNS; i++) {
+                for (e = 0; e < NO_OF_EPOCHS; e++) {
+                    engine.sensor_lists[VALID_SENSOR_LIST] = epochs[e];
+                    do_sensor_fusion_algorithm(&engine);
+                }
+            }
+            scalar_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        }
+        engine.sensor_lists[VALID_SENSOR_LIST] = NULL;
+        for (e = 0; e < NO_OF_EPOCHS; e++) {
+            while (epochs[e]) {
+                epochs[e] = remove_from_front(epochs[e]);
+            }
+        }
+    }
 
-    /**
-     * Delete node from end of list 1 and make sure that it is gone. Also
-     * ensure that there are three nodes in the list.
-     */
-    strcpy(str, "test6");
-    printf("\nDelete from end of list 1 - ");
-    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                              str);
+    printf("Same result as one at a time ------- ");
+    ASSERT_TEST(rc)
 
-    test_list_head_array[VALID_SENSOR_LIST] =
-        remove_node(test_list_head_array[VALID_SENSOR_LIST],
-                    node);
-    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                                   str) == NULL)
-    --num_nodes;
-    printf("Ensure %d nodes in list 1 -- ", num_nodes);
-    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+    printf("%d sensors: %.0f ns per epoch (one at a time %.0f ns)\n",
+           MAX_SENSORS, batch_seconds * 1e9 / (NO_OF_RUNS * NO_OF_EPOCHS),
+           scalar_seconds * 1e9 / (NO_OF_RUNS * NO_OF_EPOCHS));
 
-    /**
-     * Delete node from beginning of list 1 and make sure that it is gone. Also
-     * ensure that there are two nodes in the list.
-     */
-    strcpy(str, "test1");
-    printf("\nDelete from end of list 1 - ");
-    node = search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                              str);
+    engine_free(&engine);
+}
 
-    test_list_head_array[VALID_SENSOR_LIST] =
-        remove_node(test_list_head_array[VALID_SENSOR_LIST],
-                    node);
-    ASSERT_TEST(search_sensor_name(test_list_head_array[VALID_SENSOR_LIST],
-                                   str) == NULL)
-    --num_nodes;
-    printf("Ensure %d nodes in list 1 -- ", num_nodes);
-    ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+/*
+ * Task of automated_parallel_fusion() that counts how often each item of a
+ * share is visited.
+ */
+static void count_share_task(void *arg, int thread, int no_of_threads) {
+    int *visits = (int *)arg;
+    int first, last;
 
-    /**
-     * Delete the rest of the nodes from the beginning of the list. We want to
-     * clean up here so everything is empty for later.
-     */
-    while (count(test_list_head_array[VALID_SENSOR_LIST]) > 0) {
-        printf("\nDelete from beginning of list 1\n");
-        test_list_head_array[VALID_SENSOR_LIST] =
-            remove_from_front(test_list_head_array[VALID_SENSOR_LIST]);
-        --num_nodes;
-        printf("Ensure %d nodes in list 1 - ", num_nodes);
-        ASSERT_TEST(count(test_list_head_array[VALID_SENSOR_LIST]) == num_nodes)
+    fusion_thread_share(1000, thread, no_of_threads, &first, &last);
+    for (int i = first; i < last; i++) {
+        visits[i]++;
     }
 }
 
-void automated_testing_csv_parsing(void) {
-    Boolean end_of_file_reached = FALSE;
-    float sensor_value;
-    float test_sensor_value;
-    char sensor_name[MAX_SENSOR_NAME_SIZE];
-    char test_sensor_name[MAX_SENSOR_NAME_SIZE];
-    int time_in_minutes;
-    int lines_read = 1;
-    int test_time_in_minutes;
+void automated_parallel_fusion(void) {
+    Fusion_Thread_Pool_t pool;
+    Fusion_Workspace_t serial;
+    Fusion_Workspace_t parallel;
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t one_thread;
+    Fusion_Engine_t threads;
+    Node_t *node = NULL;
+    enum { NO_OF_THREADS = 4, NO_OF_VALUES = 300, SMALL_FLEET = 100 };
+    int visits[1000] = {0};
+    double largest_value_error = 0;
+    double largest_residual = 0;
+    double one_thread_seconds;
+    double threads_seconds;
+    clock_t start;
+    Boolean rc = TRUE;
+    int i;
+    int j;
 
     printf("\n\n");
     printf("-------------------\n");
-    printf("PARSER TESTING\n");
+    printf("PARALLEL FUSION TESTING\n");
     printf("-------------------\n");
 
-    do {
-        end_of_file_reached = parser_parse_csv_file(TEST_FILENAME,
-                              lines_read,
-                              &time_in_minutes,
-                              &sensor_name[0],
-                              &sensor_value);
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(!fusion_thread_pool_init(&pool, 0) &&
+                !fusion_thread_pool_init(&pool, FUSION_MAX_THREADS + 1))
 
-        switch (lines_read) {
-        case 1:
-            test_time_in_minutes = 540;
-            strcpy(test_sensor_name, "sens1");
-            test_sensor_value = 10;
-            break;
-        case 2:
-            test_time_in_minutes = 540;
-            strcpy(test_sensor_name, "sens2");
-            test_sensor_value = 12;
-            break;
-        case 3:
-            test_time_in_minutes = 570;
-            strcpy(test_sensor_name, "sens3");
-            test_sensor_value = 14;
-            break;
-        case 4:
-            test_time_in_minutes = 570;
-            strcpy(test_sensor_name, "sens2");
-            test_sensor_value = 13;
-            break;
-        default:
-            return;
+    printf("Every item run once ---------------- ");
+    rc = fusion_thread_pool_init(&pool, NO_OF_THREADS);
+    for (i = 0; i < 3 && rc; i++) {
+        fusion_thread_pool_run(&pool, count_share_task, visits);
+    }
+    for (i = 0; i < 1000; i++) {
+        rc = rc && (visits[i] == 3);
+    }
+    ASSERT_TEST(rc && pool.no_of_threads == NO_OF_THREADS)
+
+    /*
+     * Values spread over a few units, with one sensor in ten reading high.
+     */
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = 10.0f + (float)((i * 37) % 101) * 0.02f;
+        if (i % 10 == 3) {
+            value += 2.5f;
         }
+        node = create(600, "parallel", value, node);
+    }
+    fusion_workspace_init(&serial);
+    fusion_workspace_init(&parallel);
+    fusion_workspace_prepare(&serial, NO_OF_VALUES);
+    fusion_workspace_prepare(&parallel, NO_OF_VALUES);
+    parallel.thread_pool = &pool;
+    parallel.parallel_threshold = 1;
+    serial.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    parallel.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    int ld = serial.leading_dimension;
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        serial.sensor_array, serial.sd_matrix, ld);
+    calculate_support_degree_matrix_parallel_into(&parallel, node,
+        NO_OF_VALUES, parallel.sensor_array, parallel.sd_matrix, ld);
+    rc = TRUE;
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        rc = rc && (memcmp(serial.sd_matrix + (size_t)i * ld,
+                           parallel.sd_matrix + (size_t)i * ld,
+                           NO_OF_VALUES * sizeof(double)) == 0);
+    }
+    printf("Same support degree matrix --------- ");
+    ASSERT_TEST(rc)
 
-        printf("First line should read: %d.%02d,%s,%0.0f - ",
-               test_time_in_minutes / 60,
-               test_time_in_minutes % 60,
-               test_sensor_name,
-               test_sensor_value);
-        ASSERT_TEST((time_in_minutes == test_time_in_minutes) &&
-                    (strcmp(test_sensor_name, sensor_name) == 0) &&
-                    test_sensor_value == sensor_value)
+    /*
+     * Both tridiagonalizations give the same spectrum, and every eigenpair
+     * of the threads is one of the matrix.
+     */
+    struct eigen_systems serial_eigen = {serial.eigen_value,
+                                         serial.eigen_vector, ld};
+    struct eigen_systems parallel_eigen = {parallel.eigen_value,
+                                           parallel.eigen_vector, ld};
+    rc = (calculate_eigensystem_into(&serial, serial.sd_matrix, ld,
+            NO_OF_VALUES, &serial_eigen) == 0) &&
+         (calculate_eigensystem_into(&parallel, parallel.sd_matrix, ld,
+            NO_OF_VALUES, &parallel_eigen) == 0);
+    for (i = 0; i < NO_OF_VALUES && rc; i++) {
+        double *vector = parallel.eigen_vector + (size_t)i * ld;
+        double error = fabs(serial.eigen_value[i] - parallel.eigen_value[i]);
+        if (error > largest_value_error) {
+            largest_value_error = error;
+        }
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double *row = parallel.sd_matrix + (size_t)j * ld;
+            double residual = -parallel.eigen_value[i] * vector[j];
+            for (int k = 0; k < NO_OF_VALUES; k++) {
+                residual += row[k] * vector[k];
+            }
+            if (fabs(residual) > largest_residual) {
+                largest_residual = fabs(residual);
+            }
+        }
+    }
+    printf("Largest errors: %g (values), %g (residuals)\n",
+           largest_value_error, largest_residual);
+    printf("Same eigensystem ------------------- ");
+    ASSERT_TEST(rc && largest_value_error < 1e-10 && largest_residual < 1e-10)
 
-        ++lines_read;
-    } while (!end_of_file_reached);
+    /*
+     * Steps 5 to 9 from the same eigenpairs.
+     */
+    double serial_value;
+    double parallel_value;
+    memcpy(parallel.eigen_value, serial.eigen_value,
+           NO_OF_VALUES * sizeof(double));
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        memcpy(parallel.eigen_vector + (size_t)i * ld,
+               serial.eigen_vector + (size_t)i * ld,
+               NO_OF_VALUES * sizeof(double));
+    }
+    calculate_contribution_rate_into(serial.eigen_value, NO_OF_VALUES,
+        serial.contribution_rate);
+    memcpy(parallel.contribution_rate, serial.contribution_rate,
+           NO_OF_VALUES * sizeof(double));
+    int m = determine_contribution_rates_to_use(serial.contribution_rate,
+        0.85f, NO_OF_VALUES);
+    calculate_integrated_support_from_eigenpairs_into(serial.eigen_value,
+        serial.eigen_vector, ld, serial.contribution_rate, m, NO_OF_VALUES,
+        serial.integrated_support);
+    eliminate_incorrect_data(serial.integrated_support, 0.7f, NO_OF_VALUES);
+    calculate_weight_coefficient_into(serial.integrated_support,
+        NO_OF_VALUES, serial.weight_coefficient);
+    calculate_fused_output(serial.weight_coefficient, serial.sensor_array,
+        NO_OF_VALUES, &serial_value);
+    printf("Same fused output ------------------ ");
+    ASSERT_TEST((calculate_fused_output_parallel(&parallel, &parallel_eigen,
+                 m, 0.7f, NO_OF_VALUES, &parallel_value) == 0) &&
+                (fabs(parallel_value - serial_value) <=
+                 1e-12 * fabs(serial_value)))
+
+    /*
+     * Engines with and without threads: an epoch under the threshold is
+     * fused exactly as on one thread.
+     */
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    parameters.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    engine_init(&one_thread, &parameters, NULL);
+    parameters.no_of_threads = NO_OF_THREADS;
+    parameters.parallel_threshold = FUSION_PARALLEL_MIN_SENSORS;
+    engine_init(&threads, &parameters, NULL);
+    Node_t *small_fleet = node;
+    for (i = 0; i < NO_OF_VALUES - SMALL_FLEET; i++) {
+        small_fleet = small_fleet->next;
+    }
+
+    start = clock();
+    one_thread.sensor_lists[VALID_SENSOR_LIST] = node;
+    double one_thread_value = do_sensor_fusion_algorithm(&one_thread);
+    one_thread_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    threads.sensor_lists[VALID_SENSOR_LIST] = node;
+    double threads_value = do_sensor_fusion_algorithm(&threads);
+    threads_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    one_thread.sensor_lists[VALID_SENSOR_LIST] = small_fleet;
+    double one_thread_small = do_sensor_fusion_algorithm(&one_thread);
+    threads.sensor_lists[VALID_SENSOR_LIST] = small_fleet;
+    double threads_small = do_sensor_fusion_algorithm(&threads);
+    one_thread.sensor_lists[VALID_SENSOR_LIST] = NULL;
+    threads.sensor_lists[VALID_SENSOR_LIST] = NULL;
+
+    printf("%d sensors: %.3f ms on %d threads (%.3f ms on one)\n",
+           NO_OF_VALUES, threads_seconds * 1e3, NO_OF_THREADS,
+           one_thread_seconds * 1e3);
+    printf("Engine shares large epochs -------- ");
+    ASSERT_TEST((fabs(threads_value - one_thread_value) <=
+                 1e-9 * fabs(one_thread_value)) &&
+                (threads_small == one_thread_small))
+
+    engine_free(&one_thread);
+    engine_free(&threads);
+    fusion_workspace_free(&serial);
+    fusion_workspace_free(&parallel);
+    fusion_thread_pool_free(&pool);
+    while (node) {
+        node = remove_from_front(node);
+    }
 }
 
-void automated_sensor_manipulation(void) {
-    Boolean end_of_file_reached = FALSE;
-    Node_t *node;
-    float sensor_value;
-    char sensor_name[MAX_SENSOR_NAME_SIZE];
-    char test_name[MAX_SENSOR_NAME_SIZE];
-    int time_in_minutes;
-    int lines_read = 1;
-    int list_index;
+void automated_block_eigensystem(void) {
+    Fusion_Workspace_t workspace;
+    Fusion_Workspace_t full_workspace;
+    Fusion_Parameters_t parameters = {0};
+    Fusion_Engine_t full_engine;
+    Fusion_Engine_t block_engine;
+    Node_t *node = NULL;
+    Node_t *cluster = NULL;
+    enum { NO_OF_VALUES = 241, CLUSTER_SIZE = 40 };
+    double largest_value_error = 0;
+    double largest_residual = 0;
+    double full_seconds;
+    double block_seconds;
+    clock_t start;
+    Boolean rc = TRUE;
+    int i;
+    int j;
 
     printf("\n\n");
     printf("-------------------\n");
-    printf("SENSOR TESTING\n");
+    printf("BLOCK EIGENSYSTEM TESTING\n");
     printf("-------------------\n");
 
-    do {
-        end_of_file_reached = parser_parse_csv_file(TEST_FILENAME,
-                              lines_read,
-                              &time_in_minutes,
-                              &sensor_name[0],
-                              &sensor_value);
+    /*
+     * Three clusters of 80 sensors far apart, interleaved in the list, and
+     * one sensor on its own.
+     */
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        float value = (float)(i % 3) * 60.0f + (float)((i * 37) % 41) * 0.03f;
+        if (i == NO_OF_VALUES - 1) {
+            value = 250.0f;
+        }
+        node = create(600, "blocks", value, node);
+    }
+    for (i = CLUSTER_SIZE - 1; i >= 0; i--) {
+        cluster = create(600, "blocks", 20.0f + (float)(i % 9) * 0.4f,
+                         cluster);
+    }
+    fusion_workspace_init(&workspace);
+    fusion_workspace_init(&full_workspace);
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    fusion_workspace_prepare(&full_workspace, NO_OF_VALUES);
+    workspace.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    full_workspace.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    int ld = workspace.leading_dimension;
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector, ld};
+    struct eigen_systems full = {full_workspace.eigen_value,
+                                 full_workspace.eigen_vector, ld};
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(calculate_eigensystem_blocks_into(&workspace, NULL,
+                workspace.sd_matrix, ld, NO_OF_VALUES, &eigen) < 0)
+
+    calculate_support_degree_matrix_into(node, NO_OF_VALUES,
+        workspace.sensor_array, workspace.sd_matrix, ld);
+    start = clock();
+    rc = (calculate_eigensystem_into(&full_workspace, workspace.sd_matrix,
+            ld, NO_OF_VALUES, &full) == 0);
+    full_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    rc = rc && (calculate_eigensystem_blocks_into(&workspace,
+            workspace.sensor_array, workspace.sd_matrix, ld, NO_OF_VALUES,
+            &eigen) == 0);
+    block_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < NO_OF_VALUES && rc; i++) {
+        double *vector = workspace.eigen_vector + (size_t)i * ld;
+        double error = fabs(workspace.eigen_value[i] -
+                            full_workspace.eigen_value[i]);
+        if (error > largest_value_error) {
+            largest_value_error = error;
+        }
+        for (j = 0; j < NO_OF_VALUES; j++) {
+            double *row = workspace.sd_matrix + (size_t)j * ld;
+            double residual = -workspace.eigen_value[i] * vector[j];
+            for (int k = 0; k < NO_OF_VALUES; k++) {
+                residual += row[k] * vector[k];
+            }
+            if (fabs(residual) > largest_residual) {
+                largest_residual = fabs(residual);
+            }
+        }
+    }
+    printf("%d sensors in %d blocks: %.3f ms (in full %.3f ms)\n",
+           NO_OF_VALUES, workspace.no_of_blocks, block_seconds * 1e3,
+           full_seconds * 1e3);
+    printf("Largest errors: %g (values), %g (residuals)\n",
+           largest_value_error, largest_residual);
+    printf("Same spectrum as in full ----------- ");
+    ASSERT_TEST(rc && workspace.no_of_blocks == 4 &&
+                largest_value_error < 1e-10 && largest_residual < 1e-10)
+
+    /*
+     * One block is solved exactly as in full.
+     */
+    fusion_workspace_prepare(&workspace, CLUSTER_SIZE);
+    fusion_workspace_prepare(&full_workspace, CLUSTER_SIZE);
+    ld = workspace.leading_dimension;
+    eigen.leading_dimension = ld;
+    full.leading_dimension = ld;
+    calculate_support_degree_matrix_into(cluster, CLUSTER_SIZE,
+        workspace.sensor_array, workspace.sd_matrix, ld);
+    rc = (calculate_eigensystem_into(&full_workspace, workspace.sd_matrix,
+            ld, CLUSTER_SIZE, &full) == 0) &&
+         (calculate_eigensystem_blocks_into(&workspace,
+            workspace.sensor_array, workspace.sd_matrix, ld, CLUSTER_SIZE,
+            &eigen) == 0);
+    rc = rc && (memcmp(workspace.eigen_value, full_workspace.eigen_value,
+                       CLUSTER_SIZE * sizeof(double)) == 0);
+    for (i = 0; i < CLUSTER_SIZE && rc; i++) {
+        rc = (memcmp(workspace.eigen_vector + (size_t)i * ld,
+                     full_workspace.eigen_vector + (size_t)i * ld,
+                     CLUSTER_SIZE * sizeof(double)) == 0);
+    }
+    printf("One block solved in full ----------- ");
+    ASSERT_TEST(rc && workspace.no_of_blocks == 1)
 
-        update_sensor_lists(time_in_minutes,
-                            sensor_name,
-                            sensor_value,
-                            TRUE,
-                            TEST_HIGH_RANGE,
-                            TRUE,
-                            TEST_LOW_RANGE);
+    /*
+     * The engine fuses the clusters as it does in full.
+     */
+    parameters.q_support_value = 70;
+    parameters.principal_component_ratio = 85;
+    parameters.eigen_backend = EIGEN_BACKEND_BUILTIN;
+    engine_init(&full_engine, &parameters, NULL);
+    parameters.eigen_solver = EIGEN_SOLVER_BLOCKS;
+    engine_init(&block_engine, &parameters, NULL);
+    full_engine.sensor_lists[VALID_SENSOR_LIST] = node;
+    block_engine.sensor_lists[VALID_SENSOR_LIST] = node;
+    double full_value = do_sensor_fusion_algorithm(&full_engine);
+    double block_value = do_sensor_fusion_algorithm(&block_engine);
+    full_engine.sensor_lists[VALID_SENSOR_LIST] = NULL;
+    block_engine.sensor_lists[VALID_SENSOR_LIST] = NULL;
+    printf("Fused: %.9f (in full %.9f)\n", block_value, full_value);
+    printf("Engine fuses as in full ------------ ");
+    ASSERT_TEST(full_value != INVALID_SENSOR_FUSION_VALUE &&
+                fabs(block_value - full_value) <= 1e-9 * fabs(full_value))
+
+    engine_free(&full_engine);
+    engine_free(&block_engine);
+    fusion_workspace_free(&workspace);
+    fusion_workspace_free(&full_workspace);
+    while (node) {
+        node = remove_from_front(node);
+    }
+    while (cluster) {
+        cluster = remove_from_front(cluster);
+    }
+}
+
+/*
+ * Solves one epoch of automated_warm_eigensystem() warm and in full, and
+ * returns the largest difference between their leading eigenvectors (or 1 if
+ * they disagree on how many are needed).
+ */
+static double warm_epoch_error(Fusion_Workspace_t *workspace,
+                               Fusion_Workspace_t *full_workspace,
+                               Eigen_Warm_Start_t *warm_start,
+                               float *values, int *ids, int no_of_sensors,
+                               float parameter) {
+    Node_t *node = NULL;
+    double error = 0;
+    int i;
+    int j;
 
-        determine_if_sensors_are_stuck(time_in_minutes, TEST_STUCK_RANGE);
+    for (i = no_of_sensors - 1; i >= 0; i--) {
+        node = create(0, "warm", values[i], node);
+    }
+    fusion_workspace_prepare(workspace, no_of_sensors);
+    fusion_workspace_prepare(full_workspace, no_of_sensors);
+    int ld = workspace->leading_dimension;
+    struct eigen_systems warm = {workspace->eigen_value,
+                                 workspace->eigen_vector, ld};
+    struct eigen_systems full = {full_workspace->eigen_value,
+                                 full_workspace->eigen_vector, ld};
+
+    calculate_support_degree_matrix_into(node, no_of_sensors,
+        workspace->sensor_array, workspace->sd_matrix, ld);
+    int no_of_eigenpairs = calculate_eigensystem_warm_into(workspace,
+        warm_start, ids, workspace->sd_matrix, ld, no_of_sensors, parameter,
+        &warm);
+    calculate_eigensystem_into(full_workspace, workspace->sd_matrix, ld,
+        no_of_sensors, &full);
+    calculate_contribution_rate_into(full.eigen_value, no_of_sensors,
+        full_workspace->contribution_rate);
+    int full_rates = determine_contribution_rates_to_use(
+        full_workspace->contribution_rate, parameter, no_of_sensors);
+    printf("Eigenpairs: %d, Lanczos steps: %d\n", no_of_eigenpairs,
+           workspace->lanczos_steps);
+
+    if (no_of_eigenpairs != full_rates) {
+        error = 1;
+    }
+    for (i = 0; i < full_rates && error < 1; i++) {
+        for (j = 0; j < no_of_sensors; j++) {
+            double difference = fabs(warm.eigen_vector[i * ld + j] -
+                full.eigen_vector[i * ld + j]);
+            error = (difference > error) ? difference : error;
+        }
+    }
+    while (node) {
+        node = remove_from_front(node);
+    }
+    return error;
+}
 
-        ++lines_read;
+void automated_warm_eigensystem(void) {
+    Fusion_Workspace_t workspace;
+    Fusion_Workspace_t full_workspace;
+    Eigen_Warm_Start_t warm_start;
+    enum { NO_OF_VALUES = 120 };
+    float values[NO_OF_VALUES];
+    int ids[NO_OF_VALUES];
+    float parameter = 0.85f;
+    int i;
 
-    } while (!end_of_file_reached);
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("WARM EIGENSYSTEM TESTING\n");
+    printf("-------------------\n");
 
-    strcpy(test_name, "sens1");
-    printf("Ensure node \'%s\' is in Valid list - ", test_name);
-    node = search_all_chains(test_name, &list_index);
-    ASSERT_TEST(node && (list_index == VALID_SENSOR_LIST))
+    fusion_workspace_init(&workspace);
+    fusion_workspace_init(&full_workspace);
+    eigen_warm_start_init(&warm_start);
+
+    printf("Incorrect input rejected ----------- ");
+    fusion_workspace_prepare(&workspace, NO_OF_VALUES);
+    struct eigen_systems eigen = {workspace.eigen_value,
+                                  workspace.eigen_vector,
+                                  workspace.leading_dimension};
+    ASSERT_TEST(calculate_eigensystem_warm_into(&workspace, &warm_start, NULL,
+                workspace.sd_matrix, workspace.leading_dimension,
+                NO_OF_VALUES, parameter, &eigen) < 0)
+
+    /*
+     * Epoch 1: agreeing sensors with a few stragglers, solved cold.
+     */
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        values[i] = 20.0f + (float)((i * 37) % 23) * 0.01f;
+        if (i % 40 == 7) {
+            values[i] += 1.5f + (float)(i % 3);
+        }
+        ids[i] = i;
+    }
+    double cold_error = warm_epoch_error(&workspace, &full_workspace,
+        &warm_start, values, ids, NO_OF_VALUES, parameter);
+    int cold_steps = workspace.lanczos_steps;
 
-    strcpy(test_name, "sens2");
-    printf("Ensure node \'%s\' is in Stuck list - ", test_name);
-    node = search_all_chains(test_name, &list_index);
-    ASSERT_TEST(node && (list_index == STUCK_SENSOR_LIST))
+    printf("First epoch solved cold ------------ ");
+    ASSERT_TEST((cold_error < 1e-8) && (warm_start.no_of_warm_solves == 0) &&
+                warm_start.is_seeded)
 
-    strcpy(test_name, "sens3");
-    printf("Ensure node \'%s\' is in OOR list --- ", test_name);
-    node = search_all_chains(test_name, &list_index);
-    ASSERT_TEST(node && (list_index == OOR_SENSOR_LIST))
+    /*
+     * Epoch 2: every sensor moves a little, the list comes in reverse order
+     * and sensor 3 is replaced by a new sensor.
+     */
+    for (i = 0; i < NO_OF_VALUES / 2; i++) {
+        float value = values[i];
+        int id = ids[i];
+        values[i] = values[NO_OF_VALUES - 1 - i] + 0.002f * (float)(i % 5);
+        ids[i] = ids[NO_OF_VALUES - 1 - i];
+        values[NO_OF_VALUES - 1 - i] = value - 0.001f * (float)(i % 3);
+        ids[NO_OF_VALUES - 1 - i] = id;
+    }
+    ids[NO_OF_VALUES - 1 - 3] = NO_OF_VALUES + 5;
+    double warm_error = warm_epoch_error(&workspace, &full_workspace,
+        &warm_start, values, ids, NO_OF_VALUES, parameter);
 
-    strcpy(test_name, "sens4");
-    printf("Ensure node \'%s\' is in Stuck list - ", test_name);
-    node = search_all_chains(test_name, &list_index);
-    ASSERT_TEST(node && (list_index == STUCK_SENSOR_LIST))
+    printf("Small change converges warm -------- ");
+    ASSERT_TEST((warm_error < 1e-8) && (warm_start.no_of_warm_solves == 1) &&
+                (workspace.lanczos_steps < cold_steps))
 
-    strcpy(test_name, "sens5");
-    printf("Ensure node \'%s\' is in OOR list --- ", test_name);
-    node = search_all_chains(test_name, &list_index);
-    ASSERT_TEST(node && (list_index == OOR_SENSOR_LIST))
+    /*
+     * Epoch 3: the fleet splits into two groups of sensors.
+     */
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        values[i] = (i % 2) ? 20.0f + (float)(i % 7) * 0.01f :
+            20.8f + (float)(i % 5) * 0.01f;
+    }
+    double split_error = warm_epoch_error(&workspace, &full_workspace,
+        &warm_start, values, ids, NO_OF_VALUES, parameter);
+
+    printf("Large change still solved ---------- ");
+    ASSERT_TEST(split_error < 1e-8)
+
+    eigen_warm_start_free(&warm_start);
+    fusion_workspace_free(&workspace);
+    fusion_workspace_free(&full_workspace);
 }
 
 void automated_calculate_support_degree_matrix(void) {
@@ -453,6 +3034,7 @@ void automated_calculate_eigensystem(void) {
     printf("\tExpected Eigen Values: {2.7529, 0.1813, 0.0658}\n");
     printf("\tExpected Eigen Vectors: {{0.5711, 0.5896, 0.5711}, {0.7071, -0.0, -0.7071}, {0.4169, -0.8077, 0.4169}}\n");
     struct eigen_systems *eigen_test = calculate_eigensystem(sd_matrix, no_of_sensors);
+    int ld = eigen_test->leading_dimension;
     for (int i = 0; i < no_of_sensors; i++) {
         double result_diff = fabs(eigen_test->eigen_value[i] - expected_eigen_value[i]);
         if (result_diff > EPSILON) {
@@ -464,13 +3046,14 @@ void automated_calculate_eigensystem(void) {
             return;
         }
         for (int j = 0; j < no_of_sensors; j++) {
-            double result_diff = fabs(eigen_test->eigen_vector[i][j] -
+            double result_diff = fabs(eigen_test->eigen_vector[i * ld + j] -
               expected_eigen_vector[i][j]);
             if (result_diff > EPSILON) {
-                ASSERT_TEST(eigen_test->eigen_vector[i][j] ==
+                ASSERT_TEST(eigen_test->eigen_vector[i * ld + j] ==
                   expected_eigen_vector[i][j]);
                 printf("Expected eigen_vector :%f --- Calculated:%f\n",
-                  expected_eigen_vector[i][j], eigen_test->eigen_vector[i][j]);
+                  expected_eigen_vector[i][j],
+                  eigen_test->eigen_vector[i * ld + j]);
                 free(eigen_test->eigen_value);
                 free(eigen_test->eigen_vector);
                 free(eigen_test);
@@ -588,16 +3171,9 @@ void automated_calculate_principal_components(void) {
             {-0.707075, 0.707075}};
     double sd_matrix[] = {1.0, 0.000045, 0.000045, 1.0};
     int no_of_sensors = 2;
-    double **eigen_vector = (double **)malloc(2 * sizeof(double *));
-    for (int i = 0; i < 2; i++) {
-        eigen_vector[i] = (double *)malloc(2 * sizeof(double));
-    }
-    eigen_vector[0][0] = 0.707107;
-    eigen_vector[0][1] = 0.707107;
-    eigen_vector[1][0] = -0.707107;
-    eigen_vector[1][1] = 0.707107;
+    double eigen_vector[] = {0.707107, 0.707107, -0.707107, 0.707107};
     int contribution_rates_to_use = 2;
-    double **calculated_principal_components_matrix;
+    double *calculated_principal_components_matrix;
     printf("--- Test 1: Validate Input ---\n");
     calculated_principal_components_matrix = calculate_principal_components(
       NULL, no_of_sensors, eigen_vector, contribution_rates_to_use);
@@ -639,21 +3215,19 @@ void automated_calculate_principal_components(void) {
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < 2; j++) {
             double result_diff = 
-            fabs(calculated_principal_components_matrix[i][j] -
+            fabs(calculated_principal_components_matrix[i * 2 + j] -
               expected_principal_components_matrix[i][j]);
             if (result_diff > EPSILON) {
-                ASSERT_TEST(calculated_principal_components_matrix[i][j] ==
+                ASSERT_TEST(calculated_principal_components_matrix[i * 2 + j] ==
                   expected_principal_components_matrix[i][j]);
                 printf("Expected:%f --- Calculated:%f\n",
                   expected_principal_components_matrix[i][j],
-                  calculated_principal_components_matrix[i][j]);
-                free(eigen_vector);
+                  calculated_principal_components_matrix[i * 2 + j]);
                 free(calculated_principal_components_matrix);
                 return;
             }
         }
     }
-    free(eigen_vector);
     free(calculated_principal_components_matrix);
     printf("PASSED!\n");
 }
@@ -662,8 +3236,8 @@ void automated_calculate_integrated_support_degree_matrix(void) {
     double contribution_rate_test[] = {0.1, 0.2, 0.3, 0.4};
     double n_sensor_t = 4;
     double n_contri_rate_t = 3;
-    double **principal_components_matrix_test =
-        (double **)malloc(n_sensor_t * sizeof(double *));
+    double *principal_components_matrix_test =
+        fusion_matrix_alloc(n_sensor_t * n_sensor_t);
     int i;
     int j;
 
@@ -676,16 +3250,9 @@ void automated_calculate_integrated_support_degree_matrix(void) {
     }
 
     for (i = 0; i < n_sensor_t; i++) {
-        principal_components_matrix_test[i] =
-            (double *)malloc(n_sensor_t * sizeof(double));
-        if (!principal_components_matrix_test[i]) {
-            printf("Error running test case (malloc for element %d failed)\n",
-                   i);
-            return;
-        }
-
         for (j = 0; j < n_sensor_t; j++) {
-            principal_components_matrix_test[i][j] = (i + 1);
+            principal_components_matrix_test[i * (int)n_sensor_t + j] =
+                (i + 1);
         }
     }
 
@@ -710,7 +3277,7 @@ void automated_calculate_integrated_support_degree_matrix(void) {
 
     calculated_support_matrix =
         calculate_integrated_support_degree_matrix(
-            (double **)principal_components_matrix_test,
+            principal_components_matrix_test,
             NULL, n_contri_rate_t, n_sensor_t);
 
     if (calculated_support_matrix == NULL) {
@@ -724,7 +3291,7 @@ void automated_calculate_integrated_support_degree_matrix(void) {
 
     calculated_support_matrix =
         calculate_integrated_support_degree_matrix(
-            (double **)principal_components_matrix_test,
+            principal_components_matrix_test,
             contribution_rate_test, 0, n_sensor_t);
 
     if (calculated_support_matrix == NULL) {
@@ -738,7 +3305,7 @@ void automated_calculate_integrated_support_degree_matrix(void) {
 
     calculated_support_matrix =
         calculate_integrated_support_degree_matrix(
-            (double **)principal_components_matrix_test,
+            principal_components_matrix_test,
             contribution_rate_test, n_contri_rate_t, 0);
 
     if (calculated_support_matrix == NULL) {
@@ -761,7 +3328,7 @@ void automated_calculate_integrated_support_degree_matrix(void) {
     printf("\tExpected Support Matrix: {1.4, 1.4, 1.4, 1.4}\n");
     calculated_support_matrix =
         calculate_integrated_support_degree_matrix(
-            (double **)principal_components_matrix_test,
+            principal_components_matrix_test,
             contribution_rate_test, n_contri_rate_t, n_sensor_t);
 
     for (int i = 0; i < n_sensor_t; i++) {
@@ -778,11 +3345,78 @@ void automated_calculate_integrated_support_degree_matrix(void) {
     printf("PASSED!\n");
     free(calculated_support_matrix);
 
-    for (i = 0; i < n_sensor_t; i++) {
-        free(principal_components_matrix_test[i]);
+    free(principal_components_matrix_test);
+}
+
+void automated_integrated_support_from_eigenpairs(void) {
+    Node_t *node = NULL;
+    enum { NO_OF_VALUES = 60 };
+    double sensor_array[NO_OF_VALUES];
+    double from_eigenpairs[NO_OF_VALUES];
+    double largest = 0;
+    double error = 0;
+    int i;
+
+    printf("\n\n");
+    printf("-------------------\n");
+    printf("INTEGRATED SUPPORT FROM EIGENPAIRS TESTING\n");
+    printf("-------------------\n");
+
+    printf("Incorrect input rejected ----------- ");
+    ASSERT_TEST(calculate_integrated_support_from_eigenpairs_into(NULL,
+                sensor_array, NO_OF_VALUES, sensor_array, 1, NO_OF_VALUES,
+                from_eigenpairs) < 0)
+
+    /*
+     * Two groups of agreeing sensors and a few outliers, with a ratio that
+     * needs several principal components.
+     */
+    for (i = NO_OF_VALUES - 1; i >= 0; i--) {
+        double value = (i % 3) ? 10.0 + (i % 7) * 0.05 : 11.0 + (i % 5) * 0.1;
+        if (i % 17 == 4) {
+            value += 3.0;
+        }
+        node = create(0, "identity", value, node);
     }
+    double *sd_matrix = calculate_support_degree_matrix(node, NO_OF_VALUES,
+                                                        sensor_array);
+    struct eigen_systems *eigen = calculate_eigensystem(sd_matrix,
+                                                        NO_OF_VALUES);
+    double *contribution_rate = calculate_contribution_rate(
+                                    eigen->eigen_value, NO_OF_VALUES);
+    int m = determine_contribution_rates_to_use(contribution_rate, 0.99f,
+                                                NO_OF_VALUES);
+    double *principal_components = calculate_principal_components(
+                                       sd_matrix, NO_OF_VALUES,
+                                       eigen->eigen_vector, m);
+    double *from_multiply = calculate_integrated_support_degree_matrix(
+                                principal_components, contribution_rate, m,
+                                NO_OF_VALUES);
+    calculate_integrated_support_from_eigenpairs_into(eigen->eigen_value,
+        eigen->eigen_vector, NO_OF_VALUES, contribution_rate, m,
+        NO_OF_VALUES, from_eigenpairs);
+
+    for (i = 0; i < NO_OF_VALUES; i++) {
+        double difference = fabs(from_eigenpairs[i] - from_multiply[i]);
+        error = (difference > error) ? difference : error;
+        largest = (fabs(from_multiply[i]) > largest) ?
+            fabs(from_multiply[i]) : largest;
+    }
+    printf("Components: %d, largest difference: %g\n", m, error);
 
-    free(principal_components_matrix_test);
+    printf("Matches the matrix multiply -------- ");
+    ASSERT_TEST((m > 1) && (error <= 1e-12 * largest))
+
+    free(principal_components);
+    free(from_multiply);
+    free(eigen->eigen_vector);
+    free(eigen->eigen_value);
+    free(eigen);
+    free(sd_matrix);
+    free(contribution_rate);
+    while (node) {
+        node = remove_from_front(node);
+    }
 }
 
 void automated_eliminate_incorrect_data(void) {
@@ -981,16 +3615,45 @@ void automated_calculate_fused_output(void) {
 }
 
 void start_automated_testing(void) {
+    Fusion_Parameters_t parameters = {0};
+
+    parameters.principal_component_ratio = 100;
+    engine_init(&test_engine, &parameters, NULL);
+
     automated_testing_linked_list();
     automated_testing_csv_parsing();
     automated_sensor_manipulation();
+    automated_sensor_limits();
+    automated_sensor_statistics();
+    automated_fusion_engines();
+    automated_sensor_registry_file();
+    automated_checkpoint();
+    automated_snapshot();
+    automated_fusion_workspace();
+    automated_fusion_memo();
+    automated_exp_kernel();
+    automated_separable_support_degree();
+    automated_support_degree_cache();
+    automated_partial_eigensystem();
+    automated_warm_eigensystem();
+    automated_eigen_backends();
+    automated_jacobi_eigensystem();
+    automated_matrix_free_support_degree();
+    automated_randomized_eigensystem();
+    automated_float_fusion();
+    automated_batch_fusion();
+    automated_parallel_fusion();
+    automated_block_eigensystem();
     automated_calculate_support_degree_matrix();
     automated_calculate_eigensystem();
     automated_calculate_contribution_rate();
     automated_determine_contribution_rates_to_use();
     automated_calculate_principal_components();
     automated_calculate_integrated_support_degree_matrix();
+    automated_integrated_support_from_eigenpairs();
     automated_eliminate_incorrect_data();
     automated_calculate_weight_coefficient();
     automated_calculate_fused_output();
+
+    engine_free(&test_engine);
 }